@@ -199,6 +199,7 @@ static inline void block_CopyProperties( block_t *dst, block_t *src )
  * Duplicates a block.
  *
  * Creates a writeable duplicate of a block.
+ * If the duplicate does not need to be written to, block_Share() is cheaper.
  *
  * @return the duplicate on success, NULL on error.
  */
@@ -215,6 +216,39 @@ static inline block_t *block_Duplicate( block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Shares the payload of a block.
+ *
+ * Replaces a block with several blocks referring to the same payload, instead
+ * of copying it. Each reference has its own properties (timestamps, flags...)
+ * and can be released independently; the payload is freed with the last one.
+ *
+ * The payload of a reference is read-only while other references exist.
+ * References can skip or trim their own part of the payload freely;
+ * block_Realloc() and block_MakeWritable() return a private copy of a
+ * shared payload before it gets written to.
+ *
+ * @param block block to share (must not be in a chain)
+ * @param refs table to store the references into [OUT]
+ * @param count number of references to create (at least one)
+ *
+ * @return VLC_SUCCESS if the block was consumed and replaced with count
+ * references, or VLC_ENOMEM if it was left untouched.
+ */
+VLC_API int block_Share(block_t *block, block_t **refs, unsigned count) VLC_USED;
+
+/**
+ * Makes the payload of a block writable.
+ *
+ * This must be called before modifying the payload of a block in place,
+ * without resizing it, if the block may come from block_Share().
+ *
+ * @return the block itself if its payload is not shared, otherwise a copy
+ * with the same properties, or NULL on error.
+ * @note On error, the block is discarded.
+ */
+VLC_API block_t *block_MakeWritable(block_t *block) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -290,6 +324,26 @@ VLC_API block_t *block_File(int fd, bool write) VLC_USED VLC_MALLOC;
  */
 VLC_API block_t *block_FilePath(const char *, bool write) VLC_USED VLC_MALLOC;
 
+/**
+ * Block pool statistics.
+ *
+ * The block pool recycles the memory of blocks allocated with block_Alloc().
+ * It is disabled unless the "block-pool" option is set.
+ */
+typedef struct
+{
+    uint64_t allocs; /**< Allocations handled by the pool */
+    uint64_t hits; /**< Allocations served from recycled blocks */
+    size_t   held; /**< Bytes held in the free lists */
+} block_pool_stats_t;
+
+/**
+ * Gets the block pool statistics.
+ *
+ * The counters are process-wide and only updated while the pool is enabled.
+ */
+VLC_API void block_pool_GetStats(block_pool_stats_t *);
+
 static inline void block_Cleanup (void *block)
 {
     block_Release ((block_t *)block);
@@ -432,6 +486,22 @@ static inline block_t *block_ChainGather( block_t *p_list )
  */
 VLC_API block_fifo_t *block_FifoNew(void) VLC_USED VLC_MALLOC;
 
+/**
+ * Creates a single producer, single consumer FIFO queue of blocks.
+ *
+ * This works as block_FifoNew(), except that at most one thread may queue
+ * blocks, and at most one (other) thread may dequeue them. Queuing and
+ * dequeuing do not take any lock unless the consumer has to wait.
+ *
+ * Only block_FifoPut() may be called by the producer. block_FifoGet(),
+ * block_FifoShow() and block_FifoEmpty() may be called by the consumer.
+ * vlc_fifo_GetCount() and vlc_fifo_GetBytes() may be called from any thread,
+ * without locking. The other vlc_fifo_*() functions must not be used.
+ *
+ * @return the FIFO or NULL on memory error
+ */
+VLC_API block_fifo_t *block_FifoNewSPSC(void) VLC_USED VLC_MALLOC;
+
 /**
  * Destroys a FIFO created by block_FifoNew().
  *
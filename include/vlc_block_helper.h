@@ -375,6 +375,52 @@ static inline int block_GetBytes( block_bytestream_t *p_bytestream,
     return VLC_SUCCESS;
 }
 
+/**
+ * Gets a reference to the next bytes of a block_bytestream_t, without
+ * copying them, if they all lie within the current block.
+ *
+ * The block is replaced by a reference to its payload in the byte stream,
+ * see block_Share(). The returned block is read-only.
+ *
+ * @return the reference, or NULL if the bytes span several blocks or on error
+ */
+VLC_USED
+static inline block_t *block_ShareBytes( block_bytestream_t *p_bytestream,
+                                         size_t i_data )
+{
+    block_t *p_block = p_bytestream->p_block;
+    const size_t i_offset = p_bytestream->i_offset;
+
+    if( p_block == NULL || p_block->i_buffer - i_offset < i_data )
+        return NULL;
+
+    block_t **pp_block = &p_bytestream->p_chain;
+    while( *pp_block != p_block )
+        pp_block = &(*pp_block)->p_next;
+
+    block_t *p_next = p_block->p_next;
+    const bool b_last = p_bytestream->pp_last == &p_block->p_next;
+    block_t *refs[2];
+
+    p_block->p_next = NULL;
+    if( block_Share( p_block, refs, 2 ) )
+    {
+        p_block->p_next = p_next;
+        return NULL;
+    }
+
+    /* Put the first reference in place of the block */
+    *pp_block = p_bytestream->p_block = refs[0];
+    refs[0]->p_next = p_next;
+    if( b_last )
+        p_bytestream->pp_last = &refs[0]->p_next;
+
+    refs[1]->p_buffer += i_offset;
+    refs[1]->i_buffer = i_data;
+    p_bytestream->i_offset += i_data;
+    return refs[1];
+}
+
 static inline int block_PeekOffsetBytes( block_bytestream_t *p_bytestream,
     size_t i_peek_offset, uint8_t *p_data, size_t i_data )
 {
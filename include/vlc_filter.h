@@ -240,6 +240,46 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * It runs a video filter on horizontal bands of a picture in parallel.
+ *
+ * pf_slice is called once for each band, numbered from 0 to i_slices - 1
+ * from top to bottom, on the worker threads of the LibVLC instance (see
+ * vlc_threadpool_Run()), and the function returns once all the bands are
+ * done. The number of bands never exceeds filter_GetMaxSlices().
+ *
+ * \param i_lines number of lines of the picture, bands are no smaller than
+ * 16 lines of it
+ * \param pf_slice callback processing one band: the filter, the opaque
+ * pointer, the band index and the number of bands
+ * \param opaque data pointer for the callback
+ */
+VLC_API void filter_RunSlices( filter_t *, int i_lines,
+                               void (*pf_slice)( filter_t *, void *,
+                                                 unsigned, unsigned ),
+                               void *opaque );
+
+/**
+ * It returns the maximum number of bands filter_RunSlices() can use, for
+ * filters that need a separate context per band.
+ */
+static inline unsigned filter_GetMaxSlices( filter_t *p_filter )
+{
+    return vlc_threadpool_GetThreads( p_filter );
+}
+
+/**
+ * It returns the lines [*pi_first, *pi_last[ of a plane of i_lines lines
+ * covered by a band of filter_RunSlices().
+ */
+static inline void filter_GetSliceLines( int i_lines, unsigned i_slice,
+                                         unsigned i_slices,
+                                         int *pi_first, int *pi_last )
+{
+    *pi_first = (int64_t)i_lines * i_slice / i_slices;
+    *pi_last = (int64_t)i_lines * (i_slice + 1) / i_slices;
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
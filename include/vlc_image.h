@@ -55,12 +55,53 @@ struct image_handler_t
     decoder_t *p_dec;
     encoder_t *p_enc;
     filter_t  *p_filter;
+    struct image_cache_t *p_cache; /* idle instances in persistent mode */
 };
 
 VLC_API image_handler_t * image_HandlerCreate( vlc_object_t * ) VLC_USED;
 #define image_HandlerCreate( a ) image_HandlerCreate( VLC_OBJECT(a) )
+
+/**
+ * Creates a persistent image handler.
+ *
+ * Unlike image_HandlerCreate(), the decoders, encoders and converters that
+ * do not match the current image are kept aside instead of being destroyed,
+ * so that they can be reused without loading their modules again when
+ * images of different formats are interleaved.
+ */
+VLC_API image_handler_t * image_HandlerCreatePersistent( vlc_object_t * )
+VLC_USED;
+#define image_HandlerCreatePersistent( a ) \
+        image_HandlerCreatePersistent( VLC_OBJECT(a) )
 VLC_API void image_HandlerDelete( image_handler_t * );
 
+/**
+ * An image to transcode with image_Batch().
+ */
+typedef struct image_batch_item_t
+{
+    /* Input */
+    const char *psz_url; /**< read if p_block is NULL */
+    block_t *p_block; /**< encoded image, released by image_Batch() */
+    video_format_t fmt_in; /**< i_chroma is the codec, 0 to guess it from
+                                the URL */
+    video_format_t fmt_out; /**< i_chroma is the codec, a 0 dimension keeps
+                                 the aspect ratio, 0 for both the size */
+
+    /* Output */
+    block_t *p_result; /**< encoded image, or NULL on error */
+} image_batch_item_t;
+
+/**
+ * Decodes, scales and encodes images concurrently.
+ *
+ * The images are shared among the worker threads of the LibVLC instance,
+ * each with its own persistent image handler, and the function returns once
+ * all of them are done.
+ */
+VLC_API void image_Batch( vlc_object_t *, image_batch_item_t *, size_t );
+#define image_Batch( a, b, c ) image_Batch( VLC_OBJECT(a), b, c )
+
 #define image_Read( a, b, c, d ) a->pf_read( a, b, c, d )
 #define image_ReadUrl( a, b, c, d ) a->pf_read_url( a, b, c, d )
 #define image_Write( a, b, c, d ) a->pf_write( a, b, c, d )
@@ -0,0 +1,96 @@
+/*****************************************************************************
+ * vlc_seekindex.h: persistent seek indexes
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SEEKINDEX_H
+#define VLC_SEEKINDEX_H 1
+
+/**
+ * \defgroup seekindex Seek indexes
+ * \ingroup input
+ * Persistent seek indexes
+ *
+ * Demuxers that have to scan a file to be able to seek in it (missing or
+ * broken index, no index in the format) can save what they found, and load
+ * it back the next time the same file is opened instead of scanning again.
+ *
+ * Indexes are stored in the user cache directory, one file per media. They
+ * are only available for local files, and an index is only loaded while the
+ * size and modification time of the file are unchanged.
+ * @{
+ * \file
+ * Persistent seek indexes
+ */
+
+/**
+ * Seek index entry.
+ *
+ * Except for the ordering, the meaning of the fields is up to the demuxer.
+ * Entries are stored most compactly when i_pos and i_time grow slowly from
+ * one entry to the next.
+ */
+typedef struct
+{
+    uint64_t i_pos;   /**< byte offset in the stream */
+    uint64_t i_size;  /**< byte size (or any other unsigned value) */
+    int64_t  i_time;  /**< timestamp (or any other signed value) */
+    uint32_t i_track; /**< track (or entry kind) */
+    uint32_t i_flags; /**< demuxer specific flags */
+} vlc_seekindex_entry_t;
+
+/**
+ * Loads the seek index saved for a stream.
+ *
+ * \param obj object to log errors and to read the configuration from
+ * \param s stream the index was built from
+ * \param i_format demuxer specific tag, which must be changed whenever the
+ * meaning of the entries changes
+ * \param pp_entries where to store the entries, to be released with free()
+ * \return the number of entries, 0 if there is no valid index
+ */
+VLC_API size_t vlc_seekindex_Load( vlc_object_t *obj, stream_t *s,
+                                   vlc_fourcc_t i_format,
+                                   vlc_seekindex_entry_t **pp_entries ) VLC_USED;
+#define vlc_seekindex_Load(o, s, f, pp) \
+        vlc_seekindex_Load(VLC_OBJECT(o), s, f, pp)
+
+/**
+ * Saves the seek index of a stream.
+ *
+ * This replaces any index previously saved for the stream, whatever its
+ * format tag. The least recently saved indexes of other streams may be
+ * removed to bound the space used by the indexes.
+ *
+ * \param obj object to log errors and to read the configuration from
+ * \param s stream the index was built from
+ * \param i_format demuxer specific tag
+ * \param p_entries entries
+ * \param i_entries number of entries
+ * \return VLC_SUCCESS, or an error if the index was not saved
+ */
+VLC_API int vlc_seekindex_Save( vlc_object_t *obj, stream_t *s,
+                                vlc_fourcc_t i_format,
+                                const vlc_seekindex_entry_t *p_entries,
+                                size_t i_entries );
+#define vlc_seekindex_Save(o, s, f, p, i) \
+        vlc_seekindex_Save(VLC_OBJECT(o), s, f, p, i)
+
+/** @} */
+
+#endif
@@ -75,6 +75,14 @@ VLC_API void spu_PutSubpicture( spu_t *, subpicture_t * );
  */
 VLC_API subpicture_t * spu_Render( spu_t *, const vlc_fourcc_t *p_chroma_list, const video_format_t *p_fmt_dst, const video_format_t *p_fmt_src, mtime_t render_subtitle_date, mtime_t render_osd_date, bool ignore_osd );
 
+/**
+ * This function returns how many regions the last spu_Render() call had to
+ * render (text layout, conversion or scaling), and how many it reused as
+ * they were rendered by previous calls. Regions that need no rendering are
+ * not counted.
+ */
+VLC_API void spu_GetRenderStatistics( spu_t *, unsigned *pi_rendered, unsigned *pi_reused );
+
 /**
  * It registers a new SPU channel.
  */
@@ -1075,6 +1075,34 @@ VLC_API void vlc_global_mutex(unsigned, bool);
  */
 #define vlc_global_unlock( n ) vlc_global_mutex(n, false)
 
+/**
+ * Runs jobs in parallel.
+ *
+ * Calls pf_job(opaque, i) for every i from 0 to i_jobs - 1, on the worker
+ * threads of the LibVLC instance and on the calling thread, and returns once
+ * all the calls have returned. The jobs of concurrent calls are interleaved.
+ *
+ * Since the calling thread runs jobs itself, this function can be used from
+ * within a job, but a job must not wait for another one.
+ *
+ * @param obj any object of the LibVLC instance
+ * @param i_jobs number of jobs
+ * @param pf_job job callback
+ * @param opaque data pointer for the callback
+ */
+VLC_API void vlc_threadpool_Run(vlc_object_t *obj, unsigned i_jobs,
+                                void (*pf_job)(void *, unsigned),
+                                void *opaque);
+#define vlc_threadpool_Run(o, n, f, d) \
+        vlc_threadpool_Run(VLC_OBJECT(o), n, f, d)
+
+/**
+ * Returns the number of threads that can run the jobs of vlc_threadpool_Run()
+ * at the same time, including the calling one.
+ */
+VLC_API unsigned vlc_threadpool_GetThreads(vlc_object_t *obj) VLC_USED;
+#define vlc_threadpool_GetThreads(o) vlc_threadpool_GetThreads(VLC_OBJECT(o))
+
 /** @} */
 
 #endif /* !_VLC_THREADS_H */
@@ -65,11 +65,27 @@
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
 
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+
+/** Size of the file windows mapped at once */
+#define MMAP_WINDOW (1 << 22)
+
 struct access_sys_t
 {
     int fd;
 
     bool b_pace_control;
+
+#ifdef HAVE_MMAP
+    /* Memory-mapped reading */
+    uint64_t offset;
+    uint64_t size;
+    size_t   page_mask;
+    unsigned windows;
+    uint64_t mapped;
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -128,8 +144,16 @@ static bool IsRemote (const char *path)
 # define posix_fadvise(fd, off, len, adv)
 #endif
 
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
+
 static ssize_t Read (access_t *, void *, size_t);
 static int FileSeek (access_t *, uint64_t);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (access_t *, bool *);
+static int MmapSeek (access_t *, uint64_t);
+#endif
 static int NoSeek (access_t *, uint64_t);
 static int FileControl (access_t *, int, va_list);
 
@@ -237,6 +261,22 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Hand out mapped file pages rather than copies of them. Remote
+         * files are excluded as a server-side truncation would crash. */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->size = st.st_size;
+            p_sys->page_mask = sysconf (_SC_PAGESIZE) - 1;
+            p_sys->windows = 0;
+            p_sys->mapped = 0;
+        }
 #endif
     }
     else
@@ -259,7 +299,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -267,6 +307,11 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_MMAP
+    if (p_access->pf_block == MmapBlock)
+        msg_Dbg (p_access, "mapped %"PRIu64" bytes in %u windows",
+                 p_sys->mapped, p_sys->windows);
+#endif
     vlc_close (p_sys->fd);
     free (p_sys);
 }
@@ -309,6 +354,84 @@ static int FileSeek (access_t *p_access, uint64_t i_pos)
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * MmapBlock: hand out a window of the file mapped in memory
+ *****************************************************************************/
+static block_t *MmapBlock (access_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if (p_sys->offset >= p_sys->size)
+    {   /* The file may have grown since the last check */
+        struct stat st;
+
+        if (fstat (p_sys->fd, &st) == 0)
+            p_sys->size = st.st_size;
+        if (p_sys->offset >= p_sys->size)
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    /* Mappings must start on a page boundary */
+    const uint64_t base = p_sys->offset & ~(uint64_t)p_sys->page_mask;
+    const size_t skip = p_sys->offset - base;
+    const size_t length = __MIN(p_sys->size - base, MMAP_WINDOW);
+
+    void *addr = mmap (NULL, length, PROT_READ, MAP_SHARED, p_sys->fd, base);
+    if (addr == MAP_FAILED)
+    {
+        msg_Warn (p_access, "cannot map file: %s", vlc_strerror_c(errno));
+
+        /* Fall back to a plain read of the same window */
+        block_t *block = block_Alloc (length - skip);
+        if (unlikely(block == NULL))
+            return NULL;
+
+        ssize_t val = pread (p_sys->fd, block->p_buffer, block->i_buffer,
+                             p_sys->offset);
+        if (val <= 0)
+        {
+            block_Release (block);
+            if (val == 0)
+                *eof = true;
+            return NULL;
+        }
+        block->i_buffer = val;
+        p_sys->offset += val;
+        return block;
+    }
+
+    /* The window will be read soon and only once */
+    posix_madvise (addr, length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, length, POSIX_MADV_WILLNEED);
+
+    block_t *block = block_mmap_Alloc (addr, length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    block->p_buffer += skip;
+    block->i_buffer -= skip;
+    p_sys->offset = base + length;
+    p_sys->windows++;
+    p_sys->mapped += length;
+
+    /* Read-ahead the next window while this one gets demuxed */
+    posix_fadvise (p_sys->fd, p_sys->offset, MMAP_WINDOW, POSIX_FADV_WILLNEED);
+    return block;
+}
+
+static int MmapSeek (access_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->offset = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
 static int NoSeek (access_t *p_access, uint64_t i_pos)
 {
     /* vlc_assert_unreachable(); ?? */
@@ -39,6 +39,9 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+    add_bool( "file-mmap", false, N_("Memory map files"),
+              N_("Read regular files through memory mappings, "
+                 "rather than by copying their content."), true )
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
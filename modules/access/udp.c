@@ -56,6 +56,10 @@ static void Close( vlc_object_t * );
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define TIMESTAMPS_TEXT N_("Kernel arrival timestamps")
+#define TIMESTAMPS_LONGTEXT N_( \
+    "Use the arrival time of each datagram, as recorded by the kernel, " \
+    "as its decoding timestamp. This is useful to measure network jitter." )
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -66,6 +70,10 @@ vlc_module_begin ()
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_obsolete_integer( "udp-buffer" ) /* since 3.0.0 */
     add_integer( "udp-timeout", -1, TIMEOUT_TEXT, NULL, true )
+#ifdef HAVE_RECVMMSG
+    add_bool( "udp-timestamps", false, TIMESTAMPS_TEXT, TIMESTAMPS_LONGTEXT,
+              true )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -73,11 +81,32 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef HAVE_RECVMMSG
+/* Maximum number of datagrams received per system call */
+# define UDP_BATCH 32
+#endif
+
 struct access_sys_t
 {
     int fd;
     int timeout;
     size_t mtu;
+#ifdef HAVE_RECVMMSG
+    bool timestamps;
+
+    /* Received packets not handed out yet are pkts[head..head+count) */
+    unsigned head;
+    unsigned count;
+    block_t *pkts[UDP_BATCH];
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iovs[UDP_BATCH];
+# ifdef SO_TIMESTAMPNS
+    char control[UDP_BATCH][CMSG_SPACE(sizeof (struct timespec))];
+# endif
+
+    uint64_t packets;
+    uint64_t syscalls;
+#endif
 };
 
 /*****************************************************************************
@@ -173,6 +202,31 @@ error:
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    sys->timestamps = var_InheritBool( p_access, "udp-timestamps" );
+# ifdef SO_TIMESTAMPNS
+    if( sys->timestamps
+     && setsockopt( sys->fd, SOL_SOCKET, SO_TIMESTAMPNS, &(int){ 1 },
+                    sizeof (int) ) )
+    {
+        msg_Warn( p_access, "cannot enable timestamps: %s",
+                  vlc_strerror_c(errno) );
+        sys->timestamps = false;
+    }
+# else
+    sys->timestamps = false;
+# endif
+    sys->head = sys->count = 0;
+    sys->packets = sys->syscalls = 0;
+    memset( sys->msgs, 0, sizeof (sys->msgs) );
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+    {
+        sys->pkts[i] = NULL;
+        sys->msgs[i].msg_hdr.msg_iov = &sys->iovs[i];
+        sys->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -184,6 +238,13 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    msg_Dbg( p_access, "received %"PRIu64" packets in %"PRIu64" calls",
+             sys->packets, sys->syscalls );
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        if( sys->pkts[i] != NULL )
+            block_Release( sys->pkts[i] );
+#endif
     net_Close( sys->fd );
     free( sys );
 }
@@ -221,6 +282,137 @@ static int Control( access_t *p_access, int i_query, va_list args )
 /*****************************************************************************
  * BlockUDP:
  *****************************************************************************/
+#ifdef HAVE_RECVMMSG
+/**
+ * Converts a kernel (real-time clock) timestamp to the mdate() time base.
+ */
+static mtime_t ArrivalTime(const struct msghdr *msg, mtime_t now, mtime_t real)
+{
+# ifdef SO_TIMESTAMPNS
+    for (const struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR((struct msghdr *)msg, (struct cmsghdr *)cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET
+         || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+            continue;
+
+        struct timespec ts;
+
+        memcpy(&ts, CMSG_DATA(cmsg), sizeof (ts));
+        return now - (real - (INT64_C(1000000) * ts.tv_sec
+                                               + ts.tv_nsec / 1000));
+    }
+# else
+    (void) msg; (void) real;
+# endif
+    return now;
+}
+
+static block_t *BlockUDP(access_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->count == 0)
+    {
+        unsigned n;
+
+        /* Refill the ring with empty packets */
+        for (n = 0; n < UDP_BATCH; n++)
+        {
+            block_t *pkt = sys->pkts[n];
+
+            if (pkt != NULL && pkt->i_buffer < sys->mtu)
+            {   /* Too small since the MTU was raised */
+                block_Release(pkt);
+                pkt = NULL;
+            }
+            if (pkt == NULL)
+            {
+                pkt = block_Alloc(sys->mtu);
+                if (unlikely(pkt == NULL))
+                    break;
+            }
+            sys->pkts[n] = pkt;
+            sys->iovs[n].iov_base = pkt->p_buffer;
+            sys->iovs[n].iov_len = pkt->i_buffer;
+#ifdef SO_TIMESTAMPNS
+            if (sys->timestamps)
+            {
+                sys->msgs[n].msg_hdr.msg_control = sys->control[n];
+                sys->msgs[n].msg_hdr.msg_controllen = sizeof (sys->control[n]);
+            }
+#endif
+        }
+
+        if (unlikely(n == 0))
+        {   /* OOM - dequeue and discard one packet */
+            char dummy;
+            recv(sys->fd, &dummy, 1, 0);
+            return NULL;
+        }
+
+        struct pollfd ufd[1];
+
+        ufd[0].fd = sys->fd;
+        ufd[0].events = POLLIN;
+
+        switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+        {
+            case 0:
+                msg_Err(access, "receive time-out");
+                *eof = true;
+                /* fall through */
+            case -1:
+                return NULL;
+        }
+
+        int val = recvmmsg(sys->fd, sys->msgs, n, MSG_DONTWAIT, NULL);
+        sys->syscalls++;
+        if (val <= 0)
+            return NULL;
+
+        mtime_t now = 0, real = 0;
+        if (sys->timestamps)
+        {
+            struct timespec ts;
+
+            now = mdate();
+            clock_gettime(CLOCK_REALTIME, &ts);
+            real = INT64_C(1000000) * ts.tv_sec + ts.tv_nsec / 1000;
+        }
+
+        for (int i = 0; i < val; i++)
+        {
+            const struct msghdr *msg = &sys->msgs[i].msg_hdr;
+            block_t *pkt = sys->pkts[i];
+            size_t len = sys->msgs[i].msg_len;
+
+            if (msg->msg_flags & MSG_TRUNC)
+            {
+                msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                        len, sys->mtu);
+                pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+                sys->mtu = __MAX(sys->mtu, len);
+            }
+            else
+                pkt->i_buffer = len;
+
+            if (sys->timestamps)
+                pkt->i_dts = ArrivalTime(msg, now, real);
+        }
+
+        sys->head = 0;
+        sys->count = val;
+        sys->packets += val;
+    }
+
+    block_t *pkt = sys->pkts[sys->head];
+
+    sys->pkts[sys->head++] = NULL;
+    sys->count--;
+    return pkt;
+}
+#else
 static block_t *BlockUDP(access_t *access, bool *restrict eof)
 {
     access_sys_t *sys = access->p_sys;
@@ -282,3 +474,4 @@ skip:
 
     return pkt;
 }
+#endif
@@ -45,11 +45,18 @@
 #   include <ws2tcpip.h>
 #else
 #   include <sys/socket.h>
+#   include <sys/uio.h>
+#   include <netinet/udp.h>
+#endif
+#ifdef __linux__
+#   include <sys/prctl.h>
 #endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+/* Maximum number of packets sent at once */
+#define MAX_BATCH 32
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +78,16 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define WINDOW_TEXT N_("Batching window")
+#define WINDOW_LONGTEXT N_("Packets due within this interval, in " \
+                           "microseconds, are sent together in as few " \
+                           "system calls as possible. Larger values " \
+                           "reduce the load but send packets earlier." )
+
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split batches of equally sized " \
+                        "packets (UDP generic segmentation offload).")
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +96,11 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "window", 0, WINDOW_TEXT, WINDOW_LONGTEXT,
+                 true )
+#ifdef UDP_SEGMENT
+    add_bool( SOUT_CFG_PREFIX "gso", false, GSO_TEXT, GSO_LONGTEXT, true )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +114,10 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "window",
+#ifdef UDP_SEGMENT
+    "gso",
+#endif
     NULL
 };
 
@@ -122,6 +148,20 @@ struct sout_access_out_sys_t
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+
+    /* Owned by ThreadWrite() */
+    mtime_t       i_window;
+    bool          b_gso;
+    block_t      *p_pending;
+    block_t      *pp_batch[MAX_BATCH];
+    unsigned      i_batch;
+
+    /* Statistics */
+    uint64_t      i_packets;
+    uint64_t      i_syscalls;
+    uint64_t      i_waits;
+    mtime_t       i_pacing_error;
+    mtime_t       i_pacing_max;
 };
 
 #define DEFAULT_PORT 1234
@@ -210,10 +250,24 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    /* Both queues are only used by the sout thread and ThreadWrite() */
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
 
+    p_sys->i_window = var_GetInteger( p_access, SOUT_CFG_PREFIX "window" );
+    if( p_sys->i_window < 0 )
+        p_sys->i_window = 0;
+#ifdef UDP_SEGMENT
+    p_sys->b_gso = var_GetBool( p_access, SOUT_CFG_PREFIX "gso" );
+#else
+    p_sys->b_gso = false;
+#endif
+    p_sys->p_pending = NULL;
+    p_sys->i_batch = 0;
+    p_sys->i_packets = p_sys->i_syscalls = p_sys->i_waits = 0;
+    p_sys->i_pacing_error = p_sys->i_pacing_max = 0;
+
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
@@ -242,6 +296,21 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
+
+    msg_Dbg( p_access, "sent %"PRIu64" packets in %"PRIu64" calls",
+             p_sys->i_packets, p_sys->i_syscalls );
+    if( p_sys->i_waits > 0 )
+        msg_Dbg( p_access, "pacing error: %"PRId64" us average, "
+                 "%"PRId64" us maximum",
+                 p_sys->i_pacing_error / (mtime_t)p_sys->i_waits,
+                 p_sys->i_pacing_max );
+
+    /* Packets held by the thread when it was cancelled */
+    for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        block_Release( p_sys->pp_batch[i] );
+    if( p_sys->p_pending != NULL )
+        block_Release( p_sys->p_pending );
+
     block_FifoRelease( p_sys->p_fifo );
     block_FifoRelease( p_sys->p_empty_blocks );
 
@@ -392,6 +461,119 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+#ifdef UDP_SEGMENT
+/*****************************************************************************
+ * SendSegments: send the batch as one buffer split by the kernel
+ *****************************************************************************/
+static bool SendSegments( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    block_t **pp_batch = p_sys->pp_batch;
+    const unsigned i_count = p_sys->i_batch;
+    const size_t i_size = pp_batch[0]->i_buffer;
+    struct iovec iov[MAX_BATCH];
+
+    /* All segments but the last one must have the same size */
+    if( i_size == 0 || i_size * i_count > 65000 )
+        return false;
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        if( pp_batch[i]->i_buffer > i_size
+         || (i + 1 < i_count && pp_batch[i]->i_buffer < i_size) )
+            return false;
+        iov[i].iov_base = pp_batch[i]->p_buffer;
+        iov[i].iov_len = pp_batch[i]->i_buffer;
+    }
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = i_count,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+    uint16_t i_segment = i_size;
+
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN( sizeof (i_segment) );
+    memcpy( CMSG_DATA(cmsg), &i_segment, sizeof (i_segment) );
+
+    p_sys->i_syscalls++;
+    if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+    {
+        if( errno == EIO || errno == EINVAL || errno == ENOPROTOOPT
+         || errno == EOPNOTSUPP )
+        {   /* Not supported by the kernel or the interface */
+            msg_Warn( p_access, "segmentation offload error: %s",
+                      vlc_strerror_c(errno) );
+            p_sys->b_gso = false;
+        }
+        return false;
+    }
+    p_sys->i_packets += i_count;
+    return true;
+}
+#endif
+
+/*****************************************************************************
+ * SendBatch: send all batched packets with as few system calls as possible
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    block_t **pp_batch = p_sys->pp_batch;
+    const unsigned i_count = p_sys->i_batch;
+
+#ifdef UDP_SEGMENT
+    if( p_sys->b_gso && i_count > 1 && SendSegments( p_access ) )
+        return;
+#endif
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[MAX_BATCH];
+    struct iovec iov[MAX_BATCH];
+
+    memset( msgs, 0, sizeof (msgs) );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        iov[i].iov_base = pp_batch[i]->p_buffer;
+        iov[i].iov_len = pp_batch[i]->i_buffer;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i = 0; i < i_count; )
+    {
+        int val = sendmmsg( p_sys->i_handle, msgs + i, i_count - i, 0 );
+
+        p_sys->i_syscalls++;
+        if( val == -1 )
+        {   /* Skip the offending packet */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            i++;
+            continue;
+        }
+        p_sys->i_packets += val;
+        i += val;
+    }
+#else
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        p_sys->i_syscalls++;
+        if( send( p_sys->i_handle, pp_batch[i]->p_buffer,
+                  pp_batch[i]->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+        else
+            p_sys->i_packets++;
+    }
+#endif
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -405,44 +587,93 @@ static void* ThreadWrite( void *data )
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
 
+#ifdef PR_SET_TIMERSLACK
+    /* Wake up as close as possible to the packet dates (1 us slack) */
+    prctl( PR_SET_TIMERSLACK, 1000UL );
+#endif
+
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        mtime_t       i_date, i_sent;
+        block_t *p_pk = p_sys->p_pending;
+        mtime_t i_first = 0, i_wait = 0;
+        bool b_wait = false;
+
+        p_sys->p_pending = NULL;
+        if( p_pk == NULL )
+            p_pk = block_FifoGet( p_sys->p_fifo );
 
-        i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        /* Gather the packets due within the batching window */
+        for (;;)
         {
-            if( i_date - i_date_last > 2000000 )
+            mtime_t i_date = p_sys->i_caching + p_pk->i_dts;
+
+            if( p_sys->i_batch > 0 && i_date > i_first + p_sys->i_window )
+            {
+                p_sys->p_pending = p_pk;
+                break;
+            }
+
+            if( i_date_last > 0 && i_date - i_date_last > 2000000 )
             {
                 if( !i_dropped_packets )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
                              i_date - i_date_last );
 
                 block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
-                i_date_last = i_date;
                 i_dropped_packets++;
-                continue;
             }
-            else if( i_date - i_date_last < -1000 )
+            else
             {
-                if( !i_dropped_packets )
+                if( i_date_last > 0 && i_date - i_date_last < -1000
+                 && !i_dropped_packets )
                     msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
                              i_date_last - i_date );
+
+                if( p_sys->i_batch == 0 )
+                    i_first = i_date;
+                p_sys->pp_batch[p_sys->i_batch++] = p_pk;
+
+                i_to_send--;
+                if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+                {
+                    if( !b_wait )
+                    {
+                        b_wait = true;
+                        i_wait = i_date;
+                    }
+                    i_to_send = i_group;
+                }
             }
+            i_date_last = i_date;
+
+            if( p_sys->i_batch == MAX_BATCH
+             || vlc_fifo_GetCount( p_sys->p_fifo ) == 0 )
+                break;
+            p_pk = block_FifoGet( p_sys->p_fifo );
         }
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+        if( p_sys->i_batch == 0 )
+            continue;
+
+        if( b_wait )
         {
-            mwait( i_date );
-            i_to_send = i_group;
+            mtime_t now = mdate();
+
+            if( now < i_wait )
+            {
+                mwait( i_wait );
+
+                mtime_t i_error = mdate() - i_wait;
+                p_sys->i_waits++;
+                p_sys->i_pacing_error += i_error;
+                if( i_error > p_sys->i_pacing_max )
+                    p_sys->i_pacing_max = i_error;
+            }
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+
+        int canc = vlc_savecancel();
+        SendBatch( p_access );
+        vlc_restorecancel( canc );
 
         if( i_dropped_packets )
         {
@@ -451,17 +682,17 @@ static void* ThreadWrite( void *data )
         }
 
 #if 1
-        i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
+        mtime_t i_sent = mdate();
+        if ( i_sent > i_first + 20000 )
         {
             msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_sent - i_date );
+                     i_sent - i_first );
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
-        i_date_last = i_date;
+        for( unsigned i = 0; i < p_sys->i_batch; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, p_sys->pp_batch[i] );
+        p_sys->i_batch = 0;
     }
     return NULL;
 }
@@ -0,0 +1,369 @@
+/*****************************************************************************
+ * biquad.c: multi-channel biquad filters for the equalizers
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "biquad.h"
+
+/* Frames filtered by a section at a time, small enough to stay in cache */
+#define BIQUAD_BLOCK 256
+
+/* Fewest channels for which the sections are vectorized across channels */
+#define BIQUAD_CASCADE_MIN_CHANNELS 3
+#define BIQUAD_BANK_MIN_CHANNELS    4
+
+int biquad_Init( biquad_t *bq, unsigned i_channels, unsigned i_sections )
+{
+    bq->i_channels = i_channels;
+    bq->i_lanes = ( i_channels + BIQUAD_LANES - 1 ) & ~( BIQUAD_LANES - 1 );
+    bq->i_sections = i_sections;
+
+    bq->p_coeffs = calloc( 5 * i_sections, sizeof(float) );
+    bq->p_state = vlc_memalign( 16, 4 * bq->i_lanes * i_sections * sizeof(float) );
+    bq->p_work = vlc_memalign( 16, 2 * bq->i_lanes * BIQUAD_BLOCK * sizeof(float) );
+    if( !bq->p_coeffs || !bq->p_state || !bq->p_work )
+    {
+        biquad_Clean( bq );
+        return VLC_ENOMEM;
+    }
+    biquad_Reset( bq );
+    return VLC_SUCCESS;
+}
+
+void biquad_Clean( biquad_t *bq )
+{
+    free( bq->p_coeffs );
+    vlc_free( bq->p_state );
+    vlc_free( bq->p_work );
+    bq->p_coeffs = NULL;
+    bq->p_state = NULL;
+    bq->p_work = NULL;
+}
+
+void biquad_Reset( biquad_t *bq )
+{
+    memset( bq->p_state, 0, 4 * bq->i_lanes * bq->i_sections * sizeof(float) );
+    /* the padding lanes are never written afterwards */
+    memset( bq->p_work, 0, 2 * bq->i_lanes * BIQUAD_BLOCK * sizeof(float) );
+}
+
+void biquad_SetCoeffs( biquad_t *bq, unsigned i_section, const float coeffs[5] )
+{
+    memcpy( &bq->p_coeffs[5 * i_section], coeffs, 5 * sizeof(float) );
+}
+
+static void Deinterleave( float *p_dst, const float *p_src, unsigned i_frames,
+                          unsigned i_channels, unsigned i_lanes )
+{
+    if( i_channels == i_lanes )
+        memcpy( p_dst, p_src, i_frames * i_lanes * sizeof(float) );
+    else
+        for( unsigned i = 0; i < i_frames; i++ )
+            memcpy( &p_dst[i * i_lanes], &p_src[i * i_channels],
+                    i_channels * sizeof(float) );
+}
+
+static void Interleave( float *p_dst, const float *p_src, unsigned i_frames,
+                        unsigned i_channels, unsigned i_lanes )
+{
+    if( i_channels == i_lanes )
+        memcpy( p_dst, p_src, i_frames * i_lanes * sizeof(float) );
+    else
+        for( unsigned i = 0; i < i_frames; i++ )
+            memcpy( &p_dst[i * i_channels], &p_src[i * i_lanes],
+                    i_channels * sizeof(float) );
+}
+
+/*
+ * With few channels, the vectors are mostly padding, and the recursion of
+ * a section over a block is bound by its latency. Such layouts are
+ * filtered frame by frame instead, like the former filters, so that the
+ * independent sections of a bank or the channels overlap their latencies.
+ * The state is then stored per channel: x1, x2, y1, y2 for each section.
+ */
+static void CascadeScalar( biquad_t *bq, float *p_out, const float *p_in,
+                           unsigned i_samples )
+{
+    const unsigned i_channels = bq->i_channels, i_sections = bq->i_sections;
+    const float *restrict coeffs = bq->p_coeffs;
+
+    for( unsigned i = 0; i < i_samples; i++ )
+    {
+        float *restrict s = bq->p_state;
+
+        for( unsigned ch = 0; ch < i_channels; ch++ )
+        {
+            const float *c = coeffs;
+            float x = p_in[ch];
+
+            for( unsigned j = 0; j < i_sections; j++ )
+            {
+                const float y = x * c[0] + s[0] * c[1] + s[1] * c[2]
+                              - s[2] * c[3] - s[3] * c[4];
+                s[1] = s[0];
+                s[0] = x;
+                s[3] = s[2];
+                s[2] = y;
+                x = y;
+                c += 5;
+                s += 4;
+            }
+            p_out[ch] = x;
+        }
+        p_in += i_channels;
+        p_out += i_channels;
+    }
+}
+
+static void BankScalar( biquad_t *bq, float *p_out, const float *p_in,
+                        unsigned i_samples, const float *restrict p_gains,
+                        float f_dry, float f_out )
+{
+    const unsigned i_channels = bq->i_channels, i_sections = bq->i_sections;
+    const float *restrict coeffs = bq->p_coeffs;
+
+    for( unsigned i = 0; i < i_samples; i++ )
+    {
+        float *restrict s = bq->p_state;
+
+        for( unsigned ch = 0; ch < i_channels; ch++ )
+        {
+            /* the input history is the one of the first section */
+            float *restrict h = s;
+            const float *c = coeffs;
+            const float x = p_in[ch], d = x - h[1];
+            float o = 0.f;
+
+            for( unsigned j = 0; j < i_sections; j++ )
+            {
+                const float y = c[0] * d - c[3] * s[2] - c[4] * s[3];
+                s[3] = s[2];
+                s[2] = y;
+                o += y * p_gains[j];
+                c += 5;
+                s += 4;
+            }
+            h[1] = h[0];
+            h[0] = x;
+            p_out[ch] = f_out * ( f_dry * x + o );
+        }
+        p_in += i_channels;
+        p_out += i_channels;
+    }
+}
+
+/*
+ * Otherwise, every section filters a whole block before the next one, with
+ * its state in registers: the lanes are processed as vectors of VEC_LANES
+ * floats, and the lane counts of the usual layouts are constants after
+ * inlining.
+ */
+#ifdef __GNUC__
+typedef float vec_t __attribute__((vector_size(16)));
+# define VEC_LANES 4
+#else
+typedef float vec_t;
+# define VEC_LANES 1
+#endif
+
+static inline void Cascade( biquad_t *bq, float *p_out, const float *p_in,
+                            unsigned i_samples, const unsigned i_lanes )
+{
+    const unsigned i_channels = bq->i_channels;
+    const unsigned n = i_lanes / VEC_LANES;
+    vec_t *restrict w = (vec_t *)bq->p_work;
+
+    while( i_samples > 0 )
+    {
+        const unsigned i_frames = __MIN( i_samples, BIQUAD_BLOCK );
+        Deinterleave( bq->p_work, p_in, i_frames, i_channels, i_lanes );
+
+        const float *c = bq->p_coeffs;
+        vec_t *s = (vec_t *)bq->p_state;
+        for( unsigned j = 0; j < bq->i_sections; j++ )
+        {
+            const float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+            vec_t x1[n], x2[n], y1[n], y2[n];
+
+            for( unsigned k = 0; k < n; k++ )
+            {
+                x1[k] = s[k];
+                x2[k] = s[n + k];
+                y1[k] = s[2 * n + k];
+                y2[k] = s[3 * n + k];
+            }
+            for( unsigned i = 0; i < i_frames; i++ )
+            {
+                vec_t *restrict x = &w[i * n];
+                for( unsigned k = 0; k < n; k++ )
+                {
+                    const vec_t y = x[k] * b0 + x1[k] * b1 + x2[k] * b2
+                                  - y1[k] * a1 - y2[k] * a2;
+                    x2[k] = x1[k];
+                    x1[k] = x[k];
+                    y2[k] = y1[k];
+                    y1[k] = y;
+                    x[k] = y;
+                }
+            }
+            for( unsigned k = 0; k < n; k++ )
+            {
+                s[k] = x1[k];
+                s[n + k] = x2[k];
+                s[2 * n + k] = y1[k];
+                s[3 * n + k] = y2[k];
+            }
+            c += 5;
+            s += 4 * n;
+        }
+
+        Interleave( p_out, bq->p_work, i_frames, i_channels, i_lanes );
+        p_in += i_frames * i_channels;
+        p_out += i_frames * i_channels;
+        i_samples -= i_frames;
+    }
+}
+
+void biquad_Cascade( biquad_t *bq, float *p_out, const float *p_in,
+                     unsigned i_samples )
+{
+    if( bq->i_channels < BIQUAD_CASCADE_MIN_CHANNELS )
+    {
+        CascadeScalar( bq, p_out, p_in, i_samples );
+        return;
+    }
+
+    switch( bq->i_lanes )
+    {
+        case 4:
+            Cascade( bq, p_out, p_in, i_samples, 4 );
+            break;
+        case 8:
+            Cascade( bq, p_out, p_in, i_samples, 8 );
+            break;
+        default:
+            Cascade( bq, p_out, p_in, i_samples, bq->i_lanes );
+            break;
+    }
+}
+
+static inline void Bank( biquad_t *bq, float *p_out, const float *p_in,
+                         unsigned i_samples, const float *p_gains,
+                         float f_dry, float f_out, const unsigned i_lanes )
+{
+    const unsigned i_channels = bq->i_channels;
+    const unsigned n = i_lanes / VEC_LANES;
+    vec_t *restrict w = (vec_t *)bq->p_work;
+    vec_t *restrict o = w + n * BIQUAD_BLOCK;
+    /* the input history is shared by the sections */
+    vec_t *restrict h1 = (vec_t *)bq->p_state, *restrict h2 = h1 + n;
+    const vec_t zero = { 0 };
+
+    while( i_samples > 0 )
+    {
+        const unsigned i_frames = __MIN( i_samples, BIQUAD_BLOCK );
+        Deinterleave( bq->p_work, p_in, i_frames, i_channels, i_lanes );
+        for( unsigned i = 0; i < i_frames * n; i++ )
+            o[i] = zero;
+
+        const float *c = bq->p_coeffs;
+        vec_t *s = (vec_t *)bq->p_state;
+        for( unsigned j = 0; j < bq->i_sections; j++ )
+        {
+            const float b0 = c[0], a1 = c[3], a2 = c[4];
+            const float gain = p_gains[j];
+            vec_t x1[n], x2[n], y1[n], y2[n];
+
+            for( unsigned k = 0; k < n; k++ )
+            {
+                x1[k] = h1[k];
+                x2[k] = h2[k];
+                y1[k] = s[2 * n + k];
+                y2[k] = s[3 * n + k];
+            }
+            for( unsigned i = 0; i < i_frames; i++ )
+            {
+                const vec_t *restrict x = &w[i * n];
+                vec_t *restrict sum = &o[i * n];
+                for( unsigned k = 0; k < n; k++ )
+                {
+                    const vec_t y = b0 * ( x[k] - x2[k] ) - a1 * y1[k]
+                                  - a2 * y2[k];
+                    x2[k] = x1[k];
+                    x1[k] = x[k];
+                    y2[k] = y1[k];
+                    y1[k] = y;
+                    sum[k] += y * gain;
+                }
+            }
+            for( unsigned k = 0; k < n; k++ )
+            {
+                s[2 * n + k] = y1[k];
+                s[3 * n + k] = y2[k];
+            }
+            c += 5;
+            s += 4 * n;
+        }
+
+        for( unsigned i = 0; i < i_frames; i++ )
+            for( unsigned k = 0; k < n; k++ )
+            {
+                const vec_t x = w[i * n + k];
+                o[i * n + k] = f_out * ( f_dry * x + o[i * n + k] );
+                h2[k] = h1[k];
+                h1[k] = x;
+            }
+
+        Interleave( p_out, (float *)o, i_frames, i_channels, i_lanes );
+        p_in += i_frames * i_channels;
+        p_out += i_frames * i_channels;
+        i_samples -= i_frames;
+    }
+}
+void biquad_Bank( biquad_t *bq, float *p_out, const float *p_in,
+                  unsigned i_samples, const float *p_gains,
+                  float f_dry, float f_out )
+{
+    if( bq->i_channels < BIQUAD_BANK_MIN_CHANNELS )
+    {
+        BankScalar( bq, p_out, p_in, i_samples, p_gains, f_dry, f_out );
+        return;
+    }
+
+    switch( bq->i_lanes )
+    {
+        case 4:
+            Bank( bq, p_out, p_in, i_samples, p_gains, f_dry, f_out, 4 );
+            break;
+        case 8:
+            Bank( bq, p_out, p_in, i_samples, p_gains, f_dry, f_out, 8 );
+            break;
+        default:
+            Bank( bq, p_out, p_in, i_samples, p_gains, f_dry, f_out,
+                  bq->i_lanes );
+            break;
+    }
+}
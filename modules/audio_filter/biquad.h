@@ -0,0 +1,74 @@
+/*****************************************************************************
+ * biquad.h: multi-channel biquad filters for the equalizers
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_AUDIO_FILTER_BIQUAD_H_
+#define VLC_AUDIO_FILTER_BIQUAD_H_
+
+/*
+ * The channels of an interleaved frame are filtered together: the state
+ * of each section is stored as arrays over the channels, padded to a
+ * multiple of BIQUAD_LANES, so that every step of the recursion is a few
+ * vector operations across the channels. Mono and stereo, where that
+ * does not pay off, are filtered one frame at a time.
+ *
+ * The sections use the coefficients normalized by a0, and compute
+ * y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2 in that order.
+ */
+#define BIQUAD_LANES 4
+
+typedef struct
+{
+    unsigned i_channels;
+    unsigned i_lanes;                       /* channels padded to the lanes */
+    unsigned i_sections;
+
+    float   *p_coeffs;                      /* b0, b1, b2, a1, a2 per section */
+    float   *p_state;                       /* per section: x1, x2, y1, y2 */
+    float   *p_work;                        /* padded blocks */
+} biquad_t;
+
+/* There must be at least one section */
+int  biquad_Init( biquad_t *, unsigned i_channels, unsigned i_sections );
+void biquad_Clean( biquad_t * );
+
+/* Clears the history of the filters */
+void biquad_Reset( biquad_t * );
+
+void biquad_SetCoeffs( biquad_t *, unsigned i_section, const float coeffs[5] );
+
+/*
+ * Filters the samples through all the sections one after the other.
+ * p_out can be p_in.
+ */
+void biquad_Cascade( biquad_t *, float *p_out, const float *p_in,
+                     unsigned i_samples );
+
+/*
+ * Filters the samples through all the sections in parallel, and mixes
+ * them: out = f_out * (f_dry * x + sum gain[i] * y[i]).
+ *
+ * The sections must be band-pass with b1 = 0 and b2 = -b0, and are computed
+ * as b0 (x - x2) - a1 y1 - a2 y2; the input history is shared, so only the
+ * x1 and x2 of the first section are used. p_out can be p_in.
+ */
+void biquad_Bank( biquad_t *, float *p_out, const float *p_in,
+                  unsigned i_samples, const float *p_gains,
+                  float f_dry, float f_out );
+
+#endif
@@ -0,0 +1,324 @@
+/*****************************************************************************
+ * correlation.c: cross correlation search for the scaletempo filter
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "correlation.h"
+
+/*****************************************************************************
+ * Dot products
+ *****************************************************************************/
+/* Four partial sums, so that the compiler can keep them in one vector */
+static float DotC( const float *a, const float *b, unsigned i_count )
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    unsigned i = 0;
+
+    for( ; i + 4 <= i_count; i += 4 )
+    {
+        s0 += a[i + 0] * b[i + 0];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for( ; i < i_count; i++ )
+        s0 += a[i] * b[i];
+    return ( s0 + s2 ) + ( s1 + s3 );
+}
+
+#ifdef CAN_COMPILE_SSE
+VLC_SSE
+static float DotSSE( const float *a, const float *b, unsigned i_count )
+{
+    float sum[4] __attribute__ ((aligned (16)));
+    unsigned i_blocks = i_count / 8;
+    float s = 0.f;
+
+    if( i_blocks > 0 )
+    {
+        __asm__ volatile (
+            "xorps      %%xmm0, %%xmm0\n"
+            "xorps      %%xmm1, %%xmm1\n"
+            "1:\n"
+            "movups       (%[a]), %%xmm2\n"
+            "movups     16(%[a]), %%xmm3\n"
+            "movups       (%[b]), %%xmm4\n"
+            "movups     16(%[b]), %%xmm5\n"
+            "mulps      %%xmm4, %%xmm2\n"
+            "mulps      %%xmm5, %%xmm3\n"
+            "addps      %%xmm2, %%xmm0\n"
+            "addps      %%xmm3, %%xmm1\n"
+            "add        $32, %[a]\n"
+            "add        $32, %[b]\n"
+            "dec        %[n]\n"
+            "jnz        1b\n"
+            "addps      %%xmm1, %%xmm0\n"
+            "movaps     %%xmm0, %[sum]\n"
+            : [a] "+r" (a), [b] "+r" (b), [n] "+r" (i_blocks),
+              [sum] "=m" (sum)
+            :
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "memory" );
+        s = ( sum[0] + sum[2] ) + ( sum[1] + sum[3] );
+    }
+    for( unsigned i = 0; i < i_count % 8; i++ )
+        s += a[i] * b[i];
+    return s;
+}
+#endif
+
+static correlation_dot_t GetDot( void )
+{
+#ifdef CAN_COMPILE_SSE
+    if( vlc_CPU_SSE() )
+        return DotSSE;
+#endif
+    return DotC;
+}
+
+float correlation_Dot( const float *a, const float *b, unsigned i_count )
+{
+    return GetDot()( a, b, i_count );
+}
+
+/*****************************************************************************
+ * Frequency domain
+ *****************************************************************************/
+/* In place radix-2 transform of i_fft_size interleaved complex values */
+static void FFT( const correlation_t *c, float *p, bool b_inverse )
+{
+    const unsigned n = c->i_fft_size;
+    const float sign = b_inverse ? -1.f : 1.f;
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        const unsigned j = c->p_bitrev[i];
+        if( i < j )
+        {
+            float re = p[2 * i], im = p[2 * i + 1];
+            p[2 * i] = p[2 * j]; p[2 * i + 1] = p[2 * j + 1];
+            p[2 * j] = re;       p[2 * j + 1] = im;
+        }
+    }
+
+    for( unsigned half = 1, stride = n / 2; half < n; half *= 2, stride /= 2 )
+    {
+        for( unsigned start = 0; start < n; start += 2 * half )
+        {
+            for( unsigned k = 0; k < half; k++ )
+            {
+                const float wr = c->p_twiddle[2 * k * stride];
+                const float wi = sign * c->p_twiddle[2 * k * stride + 1];
+                float *a = &p[2 * ( start + k )];
+                float *b = &p[2 * ( start + k + half )];
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+/*
+ * Cross correlates the real pattern x and signal y with a single forward
+ * transform of x + iy, and leaves r[l] = sum x[i] y[i + l] * n * scale in
+ * the real parts of p_work. The pattern is scaled to the energy of the
+ * signal, otherwise the rounding errors of the larger one swamp the other
+ * when they are separated from the transform.
+ */
+static float CorrelateFFT( correlation_t *c, const float *x, const float *y )
+{
+    const unsigned n = c->i_fft_size;
+    const unsigned i_signal = c->i_length + ( c->i_offsets - 1 ) * c->i_step;
+    float *p = c->p_work;
+    double ex = 0., ey = 0.;
+    float scale = 1.f;
+
+    for( unsigned i = 0; i < c->i_length; i++ )
+        ex += x[i] * x[i];
+    for( unsigned i = 0; i < i_signal; i++ )
+        ey += y[i] * y[i];
+    if( ex > 0. && ey > 0. )
+        scale = sqrt( ey / ex );
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        p[2 * i]     = i < c->i_length ? x[i] * scale : 0.f;
+        p[2 * i + 1] = i < i_signal ? y[i] : 0.f;
+    }
+
+    FFT( c, p, false );
+
+    /* X = (Z[k] + conj(Z[n-k])) / 2, Y = (Z[k] - conj(Z[n-k])) / 2i,
+     * and R = conj(X) Y, whose symmetric value is conj(R) */
+    for( unsigned k = 0; k <= n / 2; k++ )
+    {
+        const unsigned m = ( n - k ) & ( n - 1 );
+        const float zr = p[2 * k], zi = p[2 * k + 1];
+        const float mr = p[2 * m], mi = p[2 * m + 1];
+        const float xr = ( zr + mr ) * .5f, xi = ( zi - mi ) * .5f;
+        const float yr = ( zi + mi ) * .5f, yi = ( mr - zr ) * .5f;
+        const float rr = xr * yr + xi * yi;
+        const float ri = xr * yi - xi * yr;
+
+        p[2 * k] = rr; p[2 * k + 1] = ri;
+        p[2 * m] = rr; p[2 * m + 1] = -ri;
+    }
+
+    FFT( c, p, true );
+    return scale;
+}
+
+/*****************************************************************************
+ * Search
+ *****************************************************************************/
+static unsigned Log2( unsigned i )
+{
+    unsigned i_log = 0;
+    while( ( 1u << i_log ) < i )
+        i_log++;
+    return i_log;
+}
+
+int correlation_Init( correlation_t *c, unsigned i_length, unsigned i_step,
+                      unsigned i_offsets, enum correlation_mode mode )
+{
+    c->i_length = i_length;
+    c->i_step = i_step;
+    c->i_offsets = i_offsets;
+    c->pf_dot = GetDot();
+    c->i_fft_size = 0;
+    c->p_bitrev = NULL;
+    c->p_twiddle = NULL;
+    c->p_work = NULL;
+
+    const unsigned i_log = Log2( i_length + ( i_offsets - 1 ) * i_step );
+    const unsigned n = 1u << i_log;
+
+    if( mode == CORRELATION_AUTO )
+    {
+        /* a transform pair costs about 6 n log2(n) operations, every dot
+         * product i_length multiply-adds (a quarter with SIMD) */
+        uint64_t i_direct = (uint64_t)i_offsets * i_length;
+        if( c->pf_dot != DotC )
+            i_direct /= 4;
+        mode = i_direct > 6 * (uint64_t)n * i_log ? CORRELATION_FFT
+                                                   : CORRELATION_DIRECT;
+    }
+    if( mode == CORRELATION_DIRECT )
+        return VLC_SUCCESS;
+
+    c->i_fft_size = n;
+    c->p_bitrev = malloc( n * sizeof(*c->p_bitrev) );
+    c->p_twiddle = malloc( n * sizeof(*c->p_twiddle) );
+    c->p_work = malloc( 2 * n * sizeof(*c->p_work) );
+    if( !c->p_bitrev || !c->p_twiddle || !c->p_work )
+    {
+        correlation_Clean( c );
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        unsigned j = 0;
+        for( unsigned b = 0; b < i_log; b++ )
+            j |= ( ( i >> b ) & 1 ) << ( i_log - 1 - b );
+        c->p_bitrev[i] = j;
+    }
+    for( unsigned k = 0; k < n / 2; k++ )
+    {
+        c->p_twiddle[2 * k]     = cos( -2. * M_PI * k / n );
+        c->p_twiddle[2 * k + 1] = sin( -2. * M_PI * k / n );
+    }
+    return VLC_SUCCESS;
+}
+
+void correlation_Clean( correlation_t *c )
+{
+    free( c->p_bitrev );
+    free( c->p_twiddle );
+    free( c->p_work );
+    c->p_bitrev = NULL;
+    c->p_twiddle = NULL;
+    c->p_work = NULL;
+    c->i_fft_size = 0;
+}
+
+void correlation_Compute( correlation_t *c, const float *p_pattern,
+                          const float *p_signal, float *p_scores )
+{
+    if( c->i_fft_size == 0 )
+    {
+        for( unsigned off = 0; off < c->i_offsets; off++ )
+            p_scores[off] = c->pf_dot( p_pattern,
+                                       &p_signal[off * c->i_step], c->i_length );
+        return;
+    }
+
+    const float scale = CorrelateFFT( c, p_pattern, p_signal ) * c->i_fft_size;
+    for( unsigned off = 0; off < c->i_offsets; off++ )
+        p_scores[off] = c->p_work[2 * off * c->i_step] / scale;
+}
+
+unsigned correlation_Search( correlation_t *c, const float *p_pattern,
+                             const float *p_signal )
+{
+    unsigned i_best = 0;
+    float f_best = -INFINITY;
+
+    if( c->i_fft_size == 0 )
+    {
+        for( unsigned off = 0; off < c->i_offsets; off++ )
+        {
+            float f = c->pf_dot( p_pattern, &p_signal[off * c->i_step],
+                                 c->i_length );
+            if( f > f_best )
+            {
+                f_best = f;
+                i_best = off;
+            }
+        }
+        return i_best;
+    }
+
+    /* the scores are all scaled by the same factor */
+    CorrelateFFT( c, p_pattern, p_signal );
+    for( unsigned off = 0; off < c->i_offsets; off++ )
+    {
+        float f = c->p_work[2 * off * c->i_step];
+        if( f > f_best )
+        {
+            f_best = f;
+            i_best = off;
+        }
+    }
+    return i_best;
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * correlation.h: cross correlation search for the scaletempo filter
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_AUDIO_FILTER_CORRELATION_H_
+#define VLC_AUDIO_FILTER_CORRELATION_H_
+
+/*
+ * Finds the offset of a signal that best matches a pattern. The candidate
+ * offsets are i_step samples apart (one frame of interleaved samples), and
+ * the score of an offset is the dot product of the pattern with the signal
+ * starting there.
+ *
+ * Short searches compute every dot product directly, with SIMD when the CPU
+ * has it. Long ones compute all of them at once as a cross correlation in
+ * the frequency domain.
+ */
+enum correlation_mode
+{
+    CORRELATION_AUTO,
+    CORRELATION_DIRECT,
+    CORRELATION_FFT,
+};
+
+typedef float (*correlation_dot_t)( const float *, const float *, unsigned );
+
+typedef struct
+{
+    unsigned i_length;                      /* samples of the pattern */
+    unsigned i_step;                        /* samples between two offsets */
+    unsigned i_offsets;
+
+    correlation_dot_t pf_dot;
+
+    /* frequency domain, unused if i_fft_size is 0 */
+    unsigned i_fft_size;                    /* complex values */
+    unsigned *p_bitrev;
+    float    *p_twiddle;                    /* cos, sin pairs */
+    float    *p_work;                       /* i_fft_size complex */
+} correlation_t;
+
+int  correlation_Init( correlation_t *, unsigned i_length, unsigned i_step,
+                       unsigned i_offsets, enum correlation_mode );
+void correlation_Clean( correlation_t * );
+
+/* Returns the dot product of two vectors of i_count samples */
+float correlation_Dot( const float *, const float *, unsigned i_count );
+
+/*
+ * Computes the scores of all the offsets, p_signal holding
+ * i_length + (i_offsets - 1) * i_step samples
+ */
+void correlation_Compute( correlation_t *, const float *p_pattern,
+                          const float *p_signal, float *p_scores );
+
+/* Returns the first offset with the best score */
+unsigned correlation_Search( correlation_t *, const float *p_pattern,
+                             const float *p_signal );
+
+#endif
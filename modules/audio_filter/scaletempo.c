@@ -34,7 +34,8 @@
 #include <vlc_filter.h>
 
 #include <string.h> /* for memset */
-#include <limits.h> /* form INT_MIN */
+
+#include "correlation.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -69,7 +70,8 @@ vlc_module_end ()
  *
  * Scaletempo smooths the overlap further by searching within the input buffer
  * for the best overlap position.  Scaletempo uses a statistical cross correlation
- * (roughly a dot-product).  Scaletempo consumes most of its CPU cycles here.
+ * (roughly a dot-product).  Scaletempo consumes most of its CPU cycles here,
+ * hence the SIMD and frequency domain versions of correlation.c.
  *
  * NOTE:
  * sample: a single audio sample for one channel
@@ -110,6 +112,7 @@ struct filter_sys_t
     unsigned  frames_search;
     void     *buf_pre_corr;
     void     *table_window;
+    correlation_t corr;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
 };
 
@@ -119,10 +122,8 @@ struct filter_sys_t
 static unsigned best_overlap_offset_float( filter_t *p_filter )
 {
     filter_sys_t *p = p_filter->p_sys;
-    float *pw, *po, *ppc, *search_start;
-    float best_corr = INT_MIN;
-    unsigned best_off = 0;
-    unsigned i, off;
+    float *pw, *po, *ppc;
+    unsigned i;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -132,20 +133,8 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
       *ppc++ = *pw++ * *po++;
     }
 
-    search_start = (float *)p->buf_queue + p->samples_per_frame;
-    for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
-      if( corr > best_corr ) {
-        best_corr = corr;
-        best_off  = off;
-      }
-      search_start += p->samples_per_frame;
-    }
+    unsigned best_off = correlation_Search( &p->corr, p->buf_pre_corr,
+        (float *)p->buf_queue + p->samples_per_frame );
 
     return best_off * p->bytes_per_frame;
 }
@@ -337,6 +326,11 @@ static int reinit_buffers( filter_t *p_filter )
             for( j = 0; j < p->samples_per_frame; j++ )
                 *pw++ = v;
         }
+        correlation_Clean( &p->corr );
+        if( correlation_Init( &p->corr, p->samples_overlap - p->samples_per_frame,
+                              p->samples_per_frame, p->frames_search,
+                              CORRELATION_AUTO ) != VLC_SUCCESS )
+            return VLC_ENOMEM;
         p->best_overlap_offset = best_overlap_offset_float;
     }
 
@@ -367,13 +361,14 @@ static int reinit_buffers( filter_t *p_filter )
     p->frames_stride_scaled = p->bytes_stride_scaled / p->bytes_per_frame;
 
     msg_Dbg( VLC_OBJECT(p_filter),
-             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode",
+             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search (%s), %i queue, %s mode",
              p->scale,
              p->frames_stride_scaled,
              (int)( p->bytes_stride / p->bytes_per_frame ),
              (int)( p->bytes_standing / p->bytes_per_frame ),
              (int)( p->bytes_overlap / p->bytes_per_frame ),
              p->frames_search,
+             p->corr.i_fft_size ? "fft" : "direct",
              (int)( p->bytes_queue_max / p->bytes_per_frame ),
              "fl32");
 
@@ -416,6 +411,10 @@ static int Open( vlc_object_t *p_this )
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->corr.p_bitrev  = NULL;
+    p_sys->corr.p_twiddle = NULL;
+    p_sys->corr.p_work    = NULL;
+    p_sys->corr.i_fft_size = 0;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -442,6 +441,7 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    correlation_Clean( &p_sys->corr );
     free( p_sys );
 }
 
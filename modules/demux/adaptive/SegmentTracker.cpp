@@ -85,6 +85,7 @@ SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSe
     index_sent = false;
     init_sent = false;
     curRepresentation = NULL;
+    prefetchDepth = 0;
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
     format = StreamFormat::UNSUPPORTED;
@@ -128,6 +129,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    clearPrefetched();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -284,7 +286,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = getPrefetchedChunk(next, rep);
+    if(!chunk)
+        chunk = segment->toChunk(next, rep, connManager);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -339,6 +343,7 @@ bool SegmentTracker::setPositionByTime(mtime_t time, bool restarted, bool tryonl
 
 void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
 {
+    clearPrefetched();
     if(restarted)
     {
         initializing = true;
@@ -391,6 +396,88 @@ void SegmentTracker::notifyBufferingLevel(mtime_t current, mtime_t target) const
     notify(SegmentTrackerEvent(adaptationSet->getID(), current, target));
 }
 
+void SegmentTracker::setPrefetchDepth(unsigned depth)
+{
+    prefetchDepth = depth;
+}
+
+/* Starts downloading the next segments of the current representation, up to
+ * the given duration. They are only used if the adaptation logic keeps that
+ * representation, so that prefetching does not change what is played. */
+void SegmentTracker::prefetch(mtime_t ahead, AbstractConnectionManager *connManager)
+{
+    BaseRepresentation *rep = curRepresentation;
+    if(!prefetchDepth || !rep || initializing || !init_sent || !index_sent)
+        return;
+
+    prunePrefetched(next, rep);
+
+    const Timescale timescale = rep->inheritTimescale();
+    std::list<PrefetchedChunk>::const_iterator it = prefetched.begin();
+    uint64_t number = next;
+    mtime_t duration = 0;
+    for(unsigned i = 0; i < prefetchDepth && duration < ahead; i++, number++)
+    {
+        bool b_gap = false;
+        uint64_t found;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &found, &b_gap);
+        if(!segment || found != number || b_gap)
+            break;
+        duration += timescale.ToTime(segment->duration.Get());
+
+        if(it != prefetched.end())
+        {
+            if((*it).number != number)
+                break;
+            ++it;
+            continue;
+        }
+
+        PrefetchedChunk entry;
+        entry.number = number;
+        entry.rep = rep;
+        entry.chunk = segment->toChunk(number, rep, connManager);
+        if(!entry.chunk)
+            break;
+        prefetched.push_back(entry);
+        it = prefetched.end();
+    }
+}
+
+/* Drops the chunks which will not be used anymore */
+void SegmentTracker::prunePrefetched(uint64_t number, BaseRepresentation *rep)
+{
+    while(!prefetched.empty())
+    {
+        const PrefetchedChunk &entry = prefetched.front();
+        if(entry.rep == rep && entry.number >= number)
+            break;
+        delete entry.chunk;
+        prefetched.pop_front();
+    }
+}
+
+SegmentChunk * SegmentTracker::getPrefetchedChunk(uint64_t number, BaseRepresentation *rep)
+{
+    prunePrefetched(number, rep);
+    if(prefetched.empty() || prefetched.front().number != number)
+        return NULL;
+
+    SegmentChunk *chunk = prefetched.front().chunk;
+    prefetched.pop_front();
+    return chunk;
+}
+
+void SegmentTracker::clearPrefetched()
+{
+    while(!prefetched.empty())
+    {
+        delete prefetched.front().chunk;
+        prefetched.pop_front();
+    }
+}
+
 void SegmentTracker::registerListener(SegmentTrackerListenerInterface *listener)
 {
     listeners.push_back(listener);
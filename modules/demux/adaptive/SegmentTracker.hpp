@@ -126,10 +126,24 @@ namespace adaptive
             void notifyBufferingLevel(mtime_t, mtime_t) const;
             void registerListener(SegmentTrackerListenerInterface *);
             void updateSelected();
+            void setPrefetchDepth(unsigned);
+            void prefetch(mtime_t, AbstractConnectionManager *);
 
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * getPrefetchedChunk(uint64_t, BaseRepresentation *);
+            void prunePrefetched(uint64_t, BaseRepresentation *);
+            void clearPrefetched();
+            class PrefetchedChunk
+            {
+                public:
+                    uint64_t number;
+                    BaseRepresentation *rep;
+                    SegmentChunk *chunk;
+            };
+            std::list<PrefetchedChunk> prefetched;
+            unsigned prefetchDepth;
             bool first;
             bool initializing;
             bool index_sent;
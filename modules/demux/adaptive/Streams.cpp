@@ -45,6 +45,7 @@ AbstractStream::AbstractStream(demux_t * demux_)
     p_realdemux = demux_;
     format = StreamFormat::UNSUPPORTED;
     currentChunk = NULL;
+    prefetchduration = 0;
     eof = false;
     dead = false;
     disabled = false;
@@ -356,6 +357,7 @@ AbstractStream::buffering_status AbstractStream::doBufferize(mtime_t nz_deadline
             return AbstractStream::buffering_suspended;
         }
 
+        prefetchduration = i_total_buffering - i_demuxed;
         nz_deadline = commandsqueue->getBufferingLevel() +
                      (i_total_buffering - commandsqueue->getDemuxedAmount()) / (CLOCK_FREQ/4);
 
@@ -454,7 +456,11 @@ AbstractStream::status AbstractStream::dequeue(mtime_t nz_deadline, mtime_t *pi_
 block_t * AbstractStream::readNextBlock()
 {
     if (currentChunk == NULL && !eof)
+    {
         currentChunk = segmentTracker->getNextChunk(!fakeesout->restarting(), connManager);
+        if(currentChunk)
+            segmentTracker->prefetch(prefetchduration, connManager);
+    }
 
     if(discontinuity || needrestart)
     {
@@ -575,6 +581,13 @@ void AbstractStream::trackerEvent(const SegmentTrackerEvent &event)
             }
             break;
 
+        case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+            /* Lets the downloader serve first the stream closest to underflow */
+            if(connManager)
+                connManager->updateBufferingLevel(*event.u.buffering_level.id,
+                                                  event.u.buffering_level.current);
+            break;
+
         case SegmentTrackerEvent::SWITCHING:
             if(demuxer && demuxer->needsRestartOnSwitch() && !inrestart)
             {
@@ -117,6 +117,7 @@ namespace adaptive
         SegmentTracker *segmentTracker;
 
         SegmentChunk *currentChunk;
+        mtime_t prefetchduration; /* left to buffer after the current chunk */
         bool eof;
         std::string language;
         std::string description;
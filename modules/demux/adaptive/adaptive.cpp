@@ -75,6 +75,13 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_WORKERS_TEXT N_("Parallel downloads")
+#define ADAPT_WORKERS_LONGTEXT N_("Number of segments downloaded at the same time")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments to prefetch")
+#define ADAPT_PREFETCH_LONGTEXT N_("Maximum number of segments of each stream " \
+    "downloaded ahead of the one being read, within the buffering target")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -116,6 +123,10 @@ vlc_module_begin ()
         add_integer( "adaptive-height", 0, ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, true )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-workers", 2, 1, 16, ADAPT_WORKERS_TEXT,
+                                ADAPT_WORKERS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-prefetch", 1, 0, 16, ADAPT_PREFETCH_TEXT,
+                                ADAPT_PREFETCH_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -182,11 +182,11 @@ block_t * HTTPChunkSource::read(size_t readsize)
         return NULL;
     }
 
-    mtime_t time = mdate();
+    mtime_t time = connManager->startTransfer();
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     /* LVP added */
     // not encountered
-    time = mdate() - time;
+    time = connManager->endTransfer(time);
     if(ret < 0)
     {
         block_Release(p_block);
@@ -248,7 +248,7 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     vlc_cond_init(&avail);
     done = false;
     eof = false;
-    downloadstart = 0;
+    downloadtime = 0;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -279,8 +279,21 @@ bool HTTPChunkBufferedSource::isDone() const
     return b_done;
 }
 
+size_t HTTPChunkBufferedSource::getBufferedSize() const
+{
+    size_t size;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    size = buffered;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return size;
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
+    /* Only the time spent requesting and reading counts, not the time
+     * waiting for a worker, and it is shared with the other transfers */
+    mtime_t transfer = connManager->startTransfer();
+
     vlc_mutex_lock(&lock);
     if(!prepare())
     {
@@ -288,6 +301,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         eof = true;
         vlc_cond_signal(&avail);
         vlc_mutex_unlock(&lock);
+        connManager->endTransfer(transfer);
         return;
     }
 
@@ -303,6 +317,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     if(!p_block)
     {
         eof = true;
+        connManager->endTransfer(transfer);
         return;
     }
 
@@ -315,14 +330,15 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     /* LVP added */
     // encountered, not null
+    transfer = connManager->endTransfer(transfer);
     if(ret <= 0)
     {
         block_Release(p_block);
         vlc_mutex_lock(&lock);
         done = true;
         rate.size = buffered + consumed;
-        rate.time = mdate() - downloadstart;
-        downloadstart = 0;
+        rate.time = downloadtime + transfer;
+        downloadtime = 0;
         vlc_mutex_unlock(&lock);
     }
     else
@@ -331,12 +347,13 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_mutex_lock(&lock);
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
+        downloadtime += transfer;
         if((size_t) ret < readsize)
         {
             done = true;
             rate.size = buffered + consumed;
-            rate.time = mdate() - downloadstart;
-            downloadstart = 0;
+            rate.time = downloadtime;
+            downloadtime = 0;
         }
         vlc_mutex_unlock(&lock);
     }
@@ -354,16 +371,6 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     vlc_cond_signal(&avail);
 }
 
-bool HTTPChunkBufferedSource::prepare()
-{
-    if(!prepared)
-    {
-        downloadstart = mdate();
-        return HTTPChunkSource::prepare();
-    }
-    return true;
-}
-
 bool HTTPChunkBufferedSource::hasMoreData() const
 {
     bool b_hasdata;
@@ -120,9 +120,9 @@ namespace adaptive
                 virtual bool       hasMoreData     () const; /* impl */
 
             protected:
-                virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                size_t             getBufferedSize() const;
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -130,7 +130,7 @@ namespace adaptive
                 size_t              buffered; /* read cache size */
                 bool                done;
                 bool                eof;
-                mtime_t             downloadstart;
+                mtime_t             downloadtime; /* share of the transfer time */
                 vlc_mutex_t         lock;
                 vlc_cond_t          avail;
         };
@@ -26,52 +26,130 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Statistics::Statistics()
+{
+    fetched = 0;
+    totalLatency = 0;
+    maxLatency = 0;
+    queued = 0;
+    maxQueued = 0;
+    buffered = 0;
+}
+
+Downloader::Job::Job(HTTPChunkBufferedSource *source_)
+{
+    source = source_;
+    scheduled = mdate();
+    busy = false;
+    done = false;
+}
+
+Downloader::Downloader(unsigned workers_, size_t maxbuffered_)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&donecond);
     killed = false;
-    thread_handle_valid = false;
+    workers = workers_ ? workers_ : 1;
+    maxbuffered = maxbuffered_;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < workers)
     {
-        return false;
+        vlc_thread_t thread;
+        if(vlc_clone(&thread, downloaderThread,
+                     reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
+    vlc_mutex_lock(&lock);
     killed = true;
-    vlc_cond_signal(&waitcond);
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    vlc_cond_broadcast(&waitcond);
+    vlc_mutex_unlock(&lock);
+    for(size_t i=0; i<threads.size(); i++)
+        vlc_join(threads[i], NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&donecond);
 }
+
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
-    chunks.push_back(source);
-    vlc_cond_signal(&waitcond);
+    std::list<Job>::const_iterator it;
+    for(it = jobs.begin(); it != jobs.end(); ++it)
+        if((*it).source == source)
+            break;
+    if(it == jobs.end())
+    {
+        jobs.push_back(Job(source));
+        stats.queued++;
+        stats.maxQueued = std::max(stats.maxQueued, stats.queued);
+        vlc_cond_signal(&waitcond);
+    }
     vlc_mutex_unlock(&lock);
 }
 
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
-    chunks.remove(source);
+    for(;;)
+    {
+        std::list<Job>::iterator it;
+        for(it = jobs.begin(); it != jobs.end(); ++it)
+            if((*it).source == source)
+                break;
+        if(it == jobs.end())
+            break;
+
+        /* A worker is still reading into it */
+        if((*it).busy)
+        {
+            vlc_cond_wait(&donecond, &lock);
+            continue;
+        }
+
+        if(!(*it).done)
+            stats.queued--;
+        jobs.erase(it);
+        /* Memory was released, or the next source of that stream is now
+         * the one being read */
+        vlc_cond_broadcast(&waitcond);
+        break;
+    }
     vlc_mutex_unlock(&lock);
 }
 
+void Downloader::updateBufferingLevel(const ID &id, mtime_t level)
+{
+    vlc_mutex_lock(&lock);
+    levels[id] = level;
+    vlc_mutex_unlock(&lock);
+}
+
+Downloader::Statistics Downloader::getStatistics() const
+{
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    Statistics ret = stats;
+    ret.buffered = 0;
+    std::list<Job>::const_iterator it;
+    for(it = jobs.begin(); it != jobs.end(); ++it)
+        ret.buffered += (*it).source->getBufferedSize();
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return ret;
+}
+
 void * Downloader::downloaderThread(void *opaque)
 {
     Downloader *instance = reinterpret_cast<Downloader *>(opaque);
@@ -87,31 +165,93 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
-void Downloader::Run()
+/* Picks the source of the stream closest to underflow. The first source of
+ * each stream is the one being read and is always downloaded, the others
+ * are read ahead only while the buffered data is below the limit. */
+Downloader::Job * Downloader::getNextJob(bool *pb_throttled)
 {
-    while(1)
+    size_t buffered = 0;
+    if(maxbuffered)
     {
-        vlc_mutex_lock(&lock);
-        if(killed)
-            break;
+        std::list<Job>::const_iterator it;
+        for(it = jobs.begin(); it != jobs.end(); ++it)
+            buffered += (*it).source->getBufferedSize();
+    }
+
+    std::vector<ID> reading;
+    Job *best = NULL;
+    mtime_t bestlevel = 0;
+    *pb_throttled = false;
+
+    std::list<Job>::iterator it;
+    for(it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        Job &job = *it;
+        const ID &id = job.source->sourceid;
+
+        const bool b_reading = std::find(reading.begin(), reading.end(), id) == reading.end();
+        if(b_reading)
+            reading.push_back(id);
 
-        while(chunks.empty() && !killed)
+        if(job.busy || job.done)
+            continue;
+
+        if(!b_reading && maxbuffered && buffered >= maxbuffered)
         {
-            vlc_cond_wait(&waitcond, &lock);
+            *pb_throttled = true;
+            continue;
         }
 
-        if(killed)
-            break;
+        std::map<ID, mtime_t>::const_iterator level = levels.find(id);
+        const mtime_t i_level = (level != levels.end()) ? (*level).second : 0;
+        if(!best || i_level < bestlevel)
+        {
+            best = &job;
+            bestlevel = i_level;
+        }
+    }
 
-        if(!chunks.empty())
+    return best;
+}
+
+void Downloader::Run()
+{
+    vlc_mutex_lock(&lock);
+    while(!killed)
+    {
+        bool b_throttled;
+        Job *job = getNextJob(&b_throttled);
+        if(!job)
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-                chunks.pop_front();
+            /* Buffers are released by the readers without notice */
+            if(b_throttled)
+                vlc_cond_timedwait(&waitcond, &lock, mdate() + CLOCK_FREQ / 20);
+            else
+                vlc_cond_wait(&waitcond, &lock);
+            continue;
         }
 
+        job->busy = true;
         vlc_mutex_unlock(&lock);
+
+        DownloadSource(job->source);
+
+        vlc_mutex_lock(&lock);
+        job->busy = false;
+        if(job->source->isDone())
+        {
+            const mtime_t latency = mdate() - job->scheduled;
+            job->done = true;
+            stats.queued--;
+            stats.fetched++;
+            stats.totalLatency += latency;
+            stats.maxLatency = std::max(stats.maxLatency, latency);
+        }
+        else
+        {
+            vlc_cond_signal(&waitcond); /* another worker can go on */
+        }
+        vlc_cond_broadcast(&donecond);
     }
     vlc_mutex_unlock(&lock);
 }
@@ -21,9 +21,12 @@
 #define DOWNLOADER_HPP
 
 #include "Chunk.h"
+#include "../ID.hpp"
 
 #include <vlc_common.h>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,23 +37,50 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1, size_t = 0);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
+                void updateBufferingLevel(const ID &, mtime_t);
+
+                class Statistics
+                {
+                    public:
+                        Statistics();
+                        unsigned fetched;       /* completed sources */
+                        mtime_t  totalLatency;  /* from scheduling to completion */
+                        mtime_t  maxLatency;
+                        unsigned queued;        /* sources not completed */
+                        unsigned maxQueued;
+                        size_t   buffered;      /* bytes not read yet */
+                };
+                Statistics getStatistics() const;
 
             private:
+                class Job
+                {
+                    public:
+                        Job(HTTPChunkBufferedSource *);
+                        HTTPChunkBufferedSource *source;
+                        mtime_t scheduled;
+                        bool    busy;
+                        bool    done;
+                };
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                Job * getNextJob(bool *);
+                std::vector<vlc_thread_t> threads;
+                unsigned     workers;
+                size_t       maxbuffered;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                vlc_mutex_t  processlock;
-                bool         thread_handle_valid;
+                vlc_cond_t   donecond;
                 bool         killed;
-                std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<Job> jobs;
+                std::map<ID, mtime_t> levels;
+                Statistics   stats;
         };
 
     }
@@ -31,6 +31,8 @@
 #include "Sockets.hpp"
 #include "Downloader.hpp"
 #include <vlc_url.h>
+
+#include <cassert>
 /* LVP added */
 #include <iostream>
 #include <ctime>
@@ -44,11 +46,15 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    vlc_mutex_init(&transferLock);
+    transfers = 0;
+    transferClock = 0;
+    transferUpdate = 0;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
 {
-
+    vlc_mutex_destroy(&transferLock);
 }
 
 void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size, mtime_t time)
@@ -66,12 +72,46 @@ void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *o
     rateObserver = obs;
 }
 
+/* The transfer clock runs at the wall clock pace divided by the count of
+ * active transfers: each one gets an equal share of the elapsed time */
+void AbstractConnectionManager::advanceTransferClock()
+{
+    const mtime_t now = mdate();
+    if(transfers)
+        transferClock += (now - transferUpdate) / transfers;
+    transferUpdate = now;
+}
+
+mtime_t AbstractConnectionManager::startTransfer()
+{
+    vlc_mutex_lock(&transferLock);
+    advanceTransferClock();
+    transfers++;
+    const mtime_t start = transferClock;
+    vlc_mutex_unlock(&transferLock);
+    return start;
+}
+
+mtime_t AbstractConnectionManager::endTransfer(mtime_t start)
+{
+    vlc_mutex_lock(&transferLock);
+    advanceTransferClock();
+    assert(transfers > 0);
+    transfers--;
+    const mtime_t time = transferClock - start;
+    vlc_mutex_unlock(&transferLock);
+    return time;
+}
+
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, ConnectionFactory *factory_)
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    int64_t workers = var_InheritInteger(p_object, "adaptive-workers");
+    downloader = new (std::nothrow) Downloader(workers > 0 ? workers : 1,
+                                               MAX_PREFETCH_BUFFER);
+    if(downloader)
+        downloader->start();
     if(!factory_)
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
@@ -84,6 +124,14 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
+    if(downloader)
+    {
+        const Downloader::Statistics stats = getStatistics();
+        msg_Dbg(p_object, "fetched %u segments, latency %" PRId64 " us average, "
+                "%" PRId64 " us max, queue depth %u max", stats.fetched,
+                stats.fetched ? stats.totalLatency / stats.fetched : 0,
+                stats.maxLatency, stats.maxQueued);
+    }
     delete downloader;
     delete factory;
     this->closeAllConnections();
@@ -172,3 +220,16 @@ void HTTPConnectionManager::cancel(AbstractChunkSource *source)
     if(src)
         downloader->cancel(src);
 }
+
+void HTTPConnectionManager::updateBufferingLevel(const ID &id, mtime_t level)
+{
+    if(downloader)
+        downloader->updateBufferingLevel(id, level);
+}
+
+Downloader::Statistics HTTPConnectionManager::getStatistics() const
+{
+    if(downloader)
+        return downloader->getStatistics();
+    return Downloader::Statistics();
+}
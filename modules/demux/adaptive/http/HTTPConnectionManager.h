@@ -26,6 +26,7 @@
 #define HTTPCONNECTIONMANAGER_H_
 
 #include "../logic/IDownloadRateObserver.h"
+#include "Downloader.hpp"
 
 #include <vlc_common.h>
 #include <vector>
@@ -38,7 +39,6 @@ namespace adaptive
         class ConnectionParams;
         class ConnectionFactory;
         class AbstractConnection;
-        class Downloader;
         class AbstractChunkSource;
 
         class AbstractConnectionManager : public IDownloadRateObserver
@@ -50,15 +50,27 @@ namespace adaptive
                 virtual AbstractConnection * getConnection(ConnectionParams &) = 0;
                 virtual void start(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
+                virtual void updateBufferingLevel(const ID &, mtime_t) = 0;
 
                 virtual void updateDownloadRate(const ID &, size_t, mtime_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
 
+                /* Concurrent transfers share the time they overlap: the
+                 * durations returned by endTransfer() add up to the time
+                 * during which any transfer was active */
+                mtime_t startTransfer();
+                mtime_t endTransfer(mtime_t);
+
             protected:
                 vlc_object_t                                       *p_object;
 
             private:
+                void advanceTransferClock();
                 IDownloadRateObserver                              *rateObserver;
+                vlc_mutex_t                                         transferLock;
+                unsigned                                            transfers;
+                mtime_t                                             transferClock;
+                mtime_t                                             transferUpdate;
         };
 
         class HTTPConnectionManager : public AbstractConnectionManager
@@ -72,6 +84,10 @@ namespace adaptive
 
                 virtual void start(AbstractChunkSource *) /* impl */;
                 virtual void cancel(AbstractChunkSource *) /* impl */;
+                virtual void updateBufferingLevel(const ID &, mtime_t) /* impl */;
+                Downloader::Statistics getStatistics() const;
+
+                static const size_t MAX_PREFETCH_BUFFER = 32 * 1024 * 1024;
 
             private:
                 void    releaseAllConnections ();
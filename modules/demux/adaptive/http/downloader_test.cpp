@@ -0,0 +1,402 @@
+/*
+ * downloader_test.cpp: adaptive segment downloader tests
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "Chunk.h"
+#include "ConnectionParams.hpp"
+#include "Downloader.hpp"
+#include "HTTPConnection.hpp"
+#include "HTTPConnectionManager.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "../../../../lib/libvlc_internal.h"
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+/* The fake server: every "/<stream>/<size>" path is a segment of that size,
+ * served at a fixed pace per read, or through a link of a fixed rate shared
+ * by all the connections. While held, requests block once they are
+ * recorded, so that the tests control when the workers go on. */
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    vlc_mutex_t link;
+    std::vector<std::string> requests;
+    unsigned active;
+    unsigned maxactive;
+    mtime_t  delay;
+    size_t   rate;  /* bytes per second, 0 if unlimited */
+    bool     hold;
+} server;
+
+class FakeConnection : public AbstractConnection
+{
+    public:
+        FakeConnection(vlc_object_t *obj) : AbstractConnection(obj) {}
+
+        virtual bool canReuse(const ConnectionParams &) const
+        {
+            return available;
+        }
+
+        virtual int request(const std::string &path, const BytesRange &)
+        {
+            contentLength = atoi(path.substr(path.rfind('/') + 1).c_str());
+            bytesRead = 0;
+            vlc_mutex_lock(&server.lock);
+            server.requests.push_back(path);
+            vlc_cond_broadcast(&server.wait);
+            while(server.hold)
+                vlc_cond_wait(&server.wait, &server.lock);
+            vlc_mutex_unlock(&server.lock);
+            return VLC_SUCCESS;
+        }
+
+        virtual ssize_t read(void *p_buffer, size_t len)
+        {
+            vlc_mutex_lock(&server.lock);
+            if(++server.active > server.maxactive)
+                server.maxactive = server.active;
+            mtime_t delay = server.delay;
+            size_t rate = server.rate;
+            vlc_mutex_unlock(&server.lock);
+
+            if(delay)
+                mwait(mdate() + delay);
+            if(len > contentLength - bytesRead)
+                len = contentLength - bytesRead;
+            if(rate)
+            {
+                /* one read at a time goes through the link */
+                vlc_mutex_lock(&server.link);
+                mwait(mdate() + CLOCK_FREQ * len / rate);
+                vlc_mutex_unlock(&server.link);
+            }
+            memset(p_buffer, 0x42, len);
+            bytesRead += len;
+
+            vlc_mutex_lock(&server.lock);
+            server.active--;
+            vlc_mutex_unlock(&server.lock);
+            return len;
+        }
+
+        virtual void setUsed(bool b)
+        {
+            available = !b;
+        }
+};
+
+class FakeConnectionFactory : public ConnectionFactory
+{
+    public:
+        virtual AbstractConnection * createConnection(vlc_object_t *obj,
+                                                      const ConnectionParams &)
+        {
+            return new FakeConnection(obj);
+        }
+};
+
+static void reset_server(mtime_t delay, bool hold)
+{
+    vlc_mutex_lock(&server.lock);
+    server.requests.clear();
+    server.active = server.maxactive = 0;
+    server.delay = delay;
+    server.rate = 0;
+    server.hold = hold;
+    vlc_mutex_unlock(&server.lock);
+}
+
+/* Waits for the server to be blocked on that many requests */
+static void wait_requests(size_t count)
+{
+    vlc_mutex_lock(&server.lock);
+    assert(server.hold);
+    while(server.requests.size() < count)
+        vlc_cond_wait(&server.wait, &server.lock);
+    assert(server.requests.size() == count);
+    vlc_mutex_unlock(&server.lock);
+}
+
+static void release_server(void)
+{
+    vlc_mutex_lock(&server.lock);
+    server.hold = false;
+    vlc_cond_broadcast(&server.wait);
+    vlc_mutex_unlock(&server.lock);
+}
+
+static HTTPConnectionManager * create_manager(vlc_object_t *obj, unsigned workers)
+{
+    var_SetInteger(obj, "adaptive-workers", workers);
+    return new HTTPConnectionManager(obj, new FakeConnectionFactory());
+}
+
+static HTTPChunkBufferedSource * fetch(HTTPConnectionManager *manager,
+                                       const char *stream, size_t size)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "http://localhost/%s/%zu", stream, size);
+    HTTPChunkBufferedSource *source =
+            new HTTPChunkBufferedSource(url, manager, ID(stream));
+    manager->start(source);
+    return source;
+}
+
+static size_t read_all(HTTPChunkBufferedSource *source)
+{
+    size_t total = 0;
+    block_t *p_block;
+    while((p_block = source->readBlock()) != NULL)
+    {
+        for(size_t i = 0; i < p_block->i_buffer; i++)
+            assert(p_block->p_buffer[i] == 0x42);
+        total += p_block->i_buffer;
+        block_Release(p_block);
+    }
+    return total;
+}
+
+/* Waits for the workers to stop making progress */
+static Downloader::Statistics wait_idle(HTTPConnectionManager *manager)
+{
+    Downloader::Statistics last = manager->getStatistics();
+    for(;;)
+    {
+        mwait(mdate() + CLOCK_FREQ / 5);
+        Downloader::Statistics stats = manager->getStatistics();
+        if(stats.fetched == last.fetched && stats.buffered == last.buffered)
+            return stats;
+        last = stats;
+    }
+}
+
+/* Two streams are downloaded at the same time */
+static void test_parallel(vlc_object_t *obj)
+{
+    reset_server(5000, true);
+    HTTPConnectionManager *manager = create_manager(obj, 2);
+
+    HTTPChunkBufferedSource *video = fetch(manager, "video", 1 << 20);
+    HTTPChunkBufferedSource *audio = fetch(manager, "audio", 1 << 18);
+    /* both requests are pending at the same time */
+    wait_requests(2);
+    release_server();
+    assert(read_all(audio) == 1 << 18);
+    assert(read_all(video) == 1 << 20);
+    delete audio;
+    delete video;
+
+    Downloader::Statistics stats = manager->getStatistics();
+    assert(stats.fetched == 2 && stats.queued == 0);
+    assert(stats.maxLatency > 0 && stats.totalLatency >= stats.maxLatency);
+    delete manager;
+}
+
+/* The stream closest to underflow goes first */
+static void test_priority(vlc_object_t *obj)
+{
+    reset_server(5000, true);
+    HTTPConnectionManager *manager = create_manager(obj, 1);
+    manager->updateBufferingLevel(ID("a"), 0);
+    manager->updateBufferingLevel(ID("b"), 5 * CLOCK_FREQ);
+    manager->updateBufferingLevel(ID("c"), CLOCK_FREQ);
+
+    /* keeps the single worker busy while the others get queued */
+    HTTPChunkBufferedSource *a = fetch(manager, "a", 1 << 18);
+    wait_requests(1);
+    HTTPChunkBufferedSource *b = fetch(manager, "b", 1 << 16);
+    HTTPChunkBufferedSource *c = fetch(manager, "c", 1 << 16);
+    release_server();
+    read_all(a);
+    read_all(b);
+    read_all(c);
+
+    vlc_mutex_lock(&server.lock);
+    assert(server.requests.size() == 3);
+    assert(server.requests[0] == "/a/262144");
+    assert(server.requests[1] == "/c/65536");
+    assert(server.requests[2] == "/b/65536");
+    assert(server.maxactive == 1);
+    vlc_mutex_unlock(&server.lock);
+
+    /* levels change while waiting */
+    reset_server(5000, true);
+    HTTPChunkBufferedSource *a2 = fetch(manager, "a", 1 << 18);
+    wait_requests(1);
+    HTTPChunkBufferedSource *b2 = fetch(manager, "b", 1 << 16);
+    HTTPChunkBufferedSource *c2 = fetch(manager, "c", 1 << 16);
+    manager->updateBufferingLevel(ID("b"), 0);
+    release_server();
+    read_all(c2);
+
+    vlc_mutex_lock(&server.lock);
+    assert(server.requests.size() == 3);
+    assert(server.requests[1] == "/b/65536");
+    assert(server.requests[2] == "/c/65536");
+    vlc_mutex_unlock(&server.lock);
+
+    delete a2; delete b2; delete c2;
+    delete a; delete b; delete c;
+    delete manager;
+}
+
+/* Sums up the download rate reports, as the rate based logic does */
+class RateObserver : public IDownloadRateObserver
+{
+    public:
+        RateObserver()
+        {
+            vlc_mutex_init(&lock);
+            size = 0;
+            time = 0;
+        }
+
+        virtual ~RateObserver()
+        {
+            vlc_mutex_destroy(&lock);
+        }
+
+        virtual void updateDownloadRate(const ID &, size_t size_, mtime_t time_)
+        {
+            vlc_mutex_lock(&lock);
+            size += size_;
+            time += time_;
+            vlc_mutex_unlock(&lock);
+        }
+
+        size_t getRate()
+        {
+            vlc_mutex_lock(&lock);
+            assert(time > 0);
+            size_t rate = CLOCK_FREQ * size / time;
+            vlc_mutex_unlock(&lock);
+            return rate;
+        }
+
+    private:
+        vlc_mutex_t lock;
+        size_t      size;
+        mtime_t     time;
+};
+
+/* Two streams downloaded at once through the same link are measured at the
+ * link rate, not at the rate each of them gets */
+static void test_rate(vlc_object_t *obj)
+{
+    const size_t rate = 8 << 20;
+    RateObserver observer;
+
+    reset_server(0, true);
+    vlc_mutex_lock(&server.lock);
+    server.rate = rate;
+    vlc_mutex_unlock(&server.lock);
+    HTTPConnectionManager *manager = create_manager(obj, 2);
+    manager->setDownloadRateObserver(&observer);
+
+    HTTPChunkBufferedSource *video = fetch(manager, "video", 2 << 20);
+    HTTPChunkBufferedSource *audio = fetch(manager, "audio", 2 << 20);
+    wait_requests(2);
+    release_server();
+    assert(read_all(audio) == 2 << 20);
+    assert(read_all(video) == 2 << 20);
+    delete audio;
+    delete video;
+
+    const size_t estimate = observer.getRate();
+    fprintf(stderr, "link at %zu KiB/s, estimated at %zu KiB/s\n",
+            rate / 1024, estimate / 1024);
+    assert(estimate > rate * 3 / 4 && estimate < rate * 5 / 4);
+    delete manager;
+}
+
+/* Unread segments are fetched ahead up to the memory limit */
+static void test_prefetch_limit(vlc_object_t *obj)
+{
+    const size_t limit = HTTPConnectionManager::MAX_PREFETCH_BUFFER;
+    const size_t size = (1 << 20) - 1000; /* short last read */
+    const unsigned count = limit / size + 8;
+    std::vector<HTTPChunkBufferedSource *> sources;
+
+    reset_server(0, false);
+    HTTPConnectionManager *manager = create_manager(obj, 2);
+    for(unsigned i = 0; i < count; i++)
+        sources.push_back(fetch(manager, "video", size));
+
+    Downloader::Statistics stats = wait_idle(manager);
+    assert(stats.fetched < count);
+    assert(stats.buffered >= limit);
+    assert(stats.buffered <= limit + 2 * HTTPChunkSource::CHUNK_SIZE);
+
+    /* reading frees memory, and the downloads resume */
+    for(unsigned i = 0; i < 8; i++)
+    {
+        assert(read_all(sources[i]) == size);
+        delete sources[i];
+    }
+    stats = wait_idle(manager);
+    assert(stats.fetched == count);
+    assert(stats.queued == 0);
+    assert(stats.buffered == (count - 8) * size);
+
+    for(unsigned i = 8; i < count; i++)
+        delete sources[i];
+    assert(manager->getStatistics().buffered == 0);
+    delete manager;
+}
+
+int main(void)
+{
+    vlc_mutex_init(&server.lock);
+    vlc_cond_init(&server.wait);
+    vlc_mutex_init(&server.link);
+
+    libvlc_int_t *vlc = libvlc_InternalCreate();
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc);
+    obj->obj.flags |= OBJECT_FLAGS_QUIET; /* no logger without plugins */
+    var_Create(obj, "adaptive-workers", VLC_VAR_INTEGER);
+    var_Create(obj, "adaptive-use-access", VLC_VAR_BOOL);
+
+    test_parallel(obj);
+    test_priority(obj);
+    test_rate(obj);
+    test_prefetch_limit(obj);
+
+    libvlc_InternalDestroy(vlc);
+    vlc_mutex_destroy(&server.link);
+    vlc_cond_destroy(&server.wait);
+    vlc_mutex_destroy(&server.lock);
+    return 0;
+}
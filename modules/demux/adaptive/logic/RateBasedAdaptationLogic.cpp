@@ -116,7 +116,9 @@ void RateBasedAdaptationLogic::updateDownloadRate(const ID &, size_t size, mtime
         return;
     }
 
-    /* Accumulate up to observation window */
+    /* Accumulate up to observation window: the workers report
+     * concurrently */
+    vlc_mutex_lock(&lock);
     dllength += time;
     dlsize += size;
 
@@ -128,12 +130,12 @@ void RateBasedAdaptationLogic::updateDownloadRate(const ID &, size_t size, mtime
         /* LVP added, TFE DEBUG */
         msg_Info(p_obj, "TFE DEBUG dllength < CLOCK_FREQ / 4 happened in ... Logic update download rate, %" PRId64,
                 mdate());
+        vlc_mutex_unlock(&lock);
         return;
     }
 
     const size_t bps = CLOCK_FREQ * dlsize * 8 / dllength;
 
-    vlc_mutex_lock(&lock);
     bpsAvg = average.push(bps);
 
     BwDebug(msg_Dbg(p_obj, "bw estimation bps %zu -> avg %zu",
@@ -38,6 +38,7 @@
 #include <vlc_input.h>
 
 #include <vlc_dialog.h>
+#include <vlc_seekindex.h>
 
 #include <vlc_meta.h>
 #include <vlc_codecs.h>
@@ -228,6 +229,7 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static bool AVI_IndexRestoreAll( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -771,7 +773,13 @@ aviindex:
                 b_index = true;
                 goto aviindex;
             }
-            if( i_do_index == 0 )
+            if( i_do_index == 0 && AVI_IndexRestoreAll( p_demux ) )
+            {
+                /* Fixed the last time this file was opened, no need to ask */
+                b_index = true;
+                p_sys->i_length = AVI_MovieGetLength( p_demux );
+            }
+            else if( i_do_index == 0 )
             {
                 const char *psz_msg = _(
                     "Because this AVI file index is broken or missing, "
@@ -2615,6 +2623,125 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
+/* Format of the indexes saved by AVI_IndexCreate(): one entry per chunk,
+ * track by track, with the chunk fourcc as time */
+#define AVI_SEEKINDEX_FORMAT VLC_FOURCC('A','V','I','1')
+
+static bool AVI_IndexRestore( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    vlc_seekindex_entry_t *p_entries;
+    size_t i_entries = vlc_seekindex_Load( p_demux, p_demux->s,
+                                           AVI_SEEKINDEX_FORMAT, &p_entries );
+    if( i_entries == 0 )
+        return false;
+
+    off_t i_last_pos = p_sys->i_movi_lastchunk_pos;
+    bool b_valid = true;
+
+    for( size_t i = 0; i < i_entries && b_valid; i++ )
+    {
+        const vlc_seekindex_entry_t *p_entry = &p_entries[i];
+
+        if( p_entry->i_track >= p_sys->i_track
+         || p_entry->i_size > UINT32_MAX
+         || p_entry->i_pos > (uint64_t)stream_Size( p_demux->s ) )
+        {
+            b_valid = false;
+            break;
+        }
+
+        avi_track_t *tk = p_sys->track[p_entry->i_track];
+        avi_entry_t index;
+        index.i_id      = p_entry->i_time;
+        index.i_flags   = p_entry->i_flags;
+        index.i_pos     = p_entry->i_pos;
+        index.i_length  = p_entry->i_size;
+        index.i_lengthtotal = p_entry->i_size;
+        avi_index_Append( &tk->idx, &i_last_pos, &index );
+        b_valid = tk->idx.p_entry != NULL;
+    }
+    free( p_entries );
+
+    if( !b_valid )
+    {
+        msg_Warn( p_demux, "saved index does not match the file" );
+        for( unsigned i = 0; i < p_sys->i_track; i++ )
+        {
+            avi_index_Clean( &p_sys->track[i]->idx );
+            avi_index_Init( &p_sys->track[i]->idx );
+        }
+        return false;
+    }
+
+    p_sys->i_movi_lastchunk_pos = i_last_pos;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        msg_Dbg( p_demux, "stream[%u] restored %u index entries",
+                 i, p_sys->track[i]->idx.i_size );
+    return true;
+}
+
+/* Replaces the index read from the file with the saved one */
+static bool AVI_IndexRestoreAll( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_index_t idx[p_sys->i_track];
+    off_t i_last_pos = p_sys->i_movi_lastchunk_pos;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        idx[i] = p_sys->track[i]->idx;
+        avi_index_Init( &p_sys->track[i]->idx );
+    }
+
+    if( !AVI_IndexRestore( p_demux ) )
+    {
+        for( unsigned i = 0; i < p_sys->i_track; i++ )
+            p_sys->track[i]->idx = idx[i];
+        p_sys->i_movi_lastchunk_pos = i_last_pos;
+        return false;
+    }
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Clean( &idx[i] );
+    return true;
+}
+
+static void AVI_IndexSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_entries = 0;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        i_entries += p_sys->track[i]->idx.i_size;
+    if( i_entries == 0 )
+        return;
+
+    vlc_seekindex_entry_t *p_entries = malloc( i_entries * sizeof(*p_entries) );
+    if( unlikely(p_entries == NULL) )
+        return;
+
+    vlc_seekindex_entry_t *p_entry = p_entries;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+
+        for( unsigned j = 0; j < p_index->i_size; j++ )
+        {
+            p_entry->i_pos   = p_index->p_entry[j].i_pos;
+            p_entry->i_size  = p_index->p_entry[j].i_length;
+            p_entry->i_time  = p_index->p_entry[j].i_id;
+            p_entry->i_track = i;
+            p_entry->i_flags = p_index->p_entry[j].i_flags;
+            p_entry++;
+        }
+    }
+
+    vlc_seekindex_Save( p_demux, p_demux->s, AVI_SEEKINDEX_FORMAT,
+                        p_entries, i_entries );
+    free( p_entries );
+}
+
 static void AVI_IndexCreate( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2627,6 +2754,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_cancelled = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2638,7 +2766,14 @@ static void AVI_IndexCreate( demux_t *p_demux )
     }
 
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        avi_index_Clean( &p_sys->track[i_stream]->idx );
         avi_index_Init( &p_sys->track[i_stream]->idx );
+    }
+
+    /* Reuse the index built the last time this file was opened */
+    if( AVI_IndexRestore( p_demux ) )
+        return;
 
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
@@ -2665,7 +2800,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && mdate() - i_dialog_update > 100000 )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cancelled = true;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2744,6 +2882,9 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( !b_cancelled )
+        AVI_IndexSave( p_demux );
 }
 
 /* */
@@ -432,6 +432,10 @@ demux_sys_t::~demux_sys_t()
 {
     CleanUi();
     size_t i;
+    /* while their streams are still open */
+    for ( i=0; i<opened_segments.size(); i++ )
+        if( opened_segments[i] )
+            opened_segments[i]->SaveIndex();
     for ( i=0; i<streams.size(); i++ )
         delete streams[i];
     for ( i=0; i<opened_segments.size(); i++ )
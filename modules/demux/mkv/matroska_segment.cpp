@@ -60,6 +60,7 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep(NULL)
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,b_seekindex(false)
 {
 }
 
@@ -514,9 +515,16 @@ bool matroska_segment_c::PreloadClusters(uint64 i_cluster_pos)
         }
     }
 
+    _seeker._b_modified = true;
     return true;
 }
 
+void matroska_segment_c::SaveIndex()
+{
+    if( b_seekindex && !b_cues )
+        _seeker.save_index( *this );
+}
+
 bool matroska_segment_c::PreloadFamily( const matroska_segment_c & of_segment )
 {
     if ( b_preloaded )
@@ -626,7 +634,10 @@ bool matroska_segment_c::Preload( )
         }
         else if( MKV_CHECKED_PTR_DECL ( kc_ptr, KaxCluster, el ) )
         {
-            if( var_InheritBool( &sys.demuxer, "mkv-preload-clusters" ) )
+            /* Without cues, reuse what was scanned the last time */
+            bool b_restored = !b_cues && b_seekindex && _seeker.load_index( *this );
+
+            if( !b_restored && var_InheritBool( &sys.demuxer, "mkv-preload-clusters" ) )
             {
                 PreloadClusters        ( kc_ptr->GetElementPosition() );
                 es.I_O().setFilePointer( kc_ptr->GetElementPosition() );
@@ -133,11 +133,13 @@ public:
     EbmlParser                     *ep;
     bool                           b_preloaded;
     bool                           b_ref_external_segments;
+    bool                           b_seekindex; /* index saved across sessions */
 
     bool Preload();
     bool PreloadFamily( const matroska_segment_c & segment );
     bool PreloadClusters( uint64 i_cluster_position );
     void InformationCreate();
+    void SaveIndex();
 
     void FastSeek( mtime_t i_mk_date, mtime_t i_mk_time_offset );
     void Seek( mtime_t i_mk_date, mtime_t i_mk_time_offset );
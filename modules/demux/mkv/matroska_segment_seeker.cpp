@@ -29,6 +29,8 @@
 #include "util.hpp"
 #include "stream_io_callback.hpp"
 
+#include <vlc_seekindex.h>
+
 #include <sstream>
 #include <limits>
 
@@ -73,6 +75,12 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
             : UINT64_MAX
     };
 
+    return add_cluster( cinfo );
+}
+
+SegmentSeeker::cluster_map_t::iterator
+SegmentSeeker::add_cluster( Cluster const& cinfo )
+{
     add_cluster_position( cinfo.fpos );
 
     cluster_map_t::iterator it = _clusters.lower_bound( cinfo.pts );
@@ -348,6 +356,8 @@ SegmentSeeker::index_unsearched_range( matroska_segment_c& ms, Range search_area
 void
 SegmentSeeker::mark_range_as_searched( Range data )
 {
+    _b_modified = true;
+
     /* TODO: this is utterly ugly, we should do the insertion in-place */
 
     _ranges_searched.insert( std::upper_bound( _ranges_searched.begin(), _ranges_searched.end(), data ), data );
@@ -464,3 +474,146 @@ SegmentSeeker::mkv_jump_to( matroska_segment_c& ms, fptr_t fpos )
     ms.es.I_O().setFilePointer( fpos );
 }
 
+
+// -----------------------------------------------------------------------
+// The index of files without cues is saved with vlc_seekindex, so that
+// what was scanned once does not have to be scanned again.
+// -----------------------------------------------------------------------
+
+#define MKV_SEEKINDEX_FORMAT VLC_FOURCC('M','K','V','1')
+
+enum {
+    INDEX_SEEKPOINT,       // i_track, i_pos, i_time, trust level in i_size
+    INDEX_CLUSTER,         // i_pos, i_time, i_size
+    INDEX_CLUSTER_POSITION,// i_pos
+    INDEX_RANGE_SEARCHED,  // i_pos, i_size
+};
+
+bool
+SegmentSeeker::load_index( matroska_segment_c& ms )
+{
+    vlc_seekindex_entry_t * p_entries;
+    size_t const i_entries = vlc_seekindex_Load( &ms.sys.demuxer, ms.sys.demuxer.s,
+                                                 MKV_SEEKINDEX_FORMAT, &p_entries );
+    if( i_entries == 0 )
+        return false;
+
+    uint64_t const i_stream_size = stream_Size( ms.sys.demuxer.s );
+    SegmentSeeker index;
+
+    bool b_valid = true;
+
+    for( size_t i = 0; i < i_entries && b_valid; ++i )
+    {
+        vlc_seekindex_entry_t const& entry = p_entries[i];
+
+        b_valid = entry.i_pos <= i_stream_size;
+        if( !b_valid )
+            break;
+
+        switch( entry.i_flags )
+        {
+            case INDEX_SEEKPOINT:
+                b_valid = ms.tracks.find( entry.i_track ) != ms.tracks.end();
+                if( b_valid )
+                    index.add_seekpoint( entry.i_track, int( int64_t( entry.i_size ) ),
+                                         entry.i_pos, entry.i_time );
+                break;
+
+            case INDEX_CLUSTER:
+            {
+                Cluster const cinfo = { entry.i_pos, entry.i_time, -1, entry.i_size };
+                index.add_cluster( cinfo );
+                break;
+            }
+
+            case INDEX_CLUSTER_POSITION:
+                index.add_cluster_position( entry.i_pos );
+                break;
+
+            case INDEX_RANGE_SEARCHED:
+                index.mark_range_as_searched( Range( entry.i_pos, entry.i_pos + entry.i_size ) );
+                break;
+
+            default:
+                b_valid = false;
+        }
+    }
+    free( p_entries );
+
+    if( !b_valid )
+    {
+        msg_Warn( &ms.sys.demuxer, "saved index does not match the file" );
+        return false;
+    }
+
+    // keep what was found while opening, it may be more accurate
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); it != _tracks_seekpoints.end(); ++it )
+    {
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+            index.add_seekpoint( it->first, sp->trust_level, sp->fpos, sp->pts );
+    }
+    for( cluster_map_t::const_iterator it = _clusters.begin(); it != _clusters.end(); ++it )
+        index.add_cluster( it->second );
+    for( cluster_positions_t::const_iterator it = _cluster_positions.begin(); it != _cluster_positions.end(); ++it )
+        index.add_cluster_position( *it );
+    for( ranges_t::const_iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
+        index.mark_range_as_searched( *it );
+
+    _ranges_searched   = index._ranges_searched;
+    _tracks_seekpoints = index._tracks_seekpoints;
+    _cluster_positions = index._cluster_positions;
+    _clusters          = index._clusters;
+    _b_modified        = false;
+
+    msg_Dbg( &ms.sys.demuxer, "restored %zu clusters and %zu searched ranges",
+             _clusters.size(), _ranges_searched.size() );
+    return true;
+}
+
+void
+SegmentSeeker::save_index( matroska_segment_c& ms )
+{
+    if( !_b_modified )
+        return;
+
+    std::vector<vlc_seekindex_entry_t> entries;
+
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); it != _tracks_seekpoints.end(); ++it )
+    {
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+        {
+            vlc_seekindex_entry_t const entry = {
+                sp->fpos, uint64_t( int64_t( sp->trust_level ) ), sp->pts, it->first, INDEX_SEEKPOINT
+            };
+            entries.push_back( entry );
+        }
+    }
+
+    for( cluster_map_t::const_iterator it = _clusters.begin(); it != _clusters.end(); ++it )
+    {
+        vlc_seekindex_entry_t const entry = {
+            it->second.fpos, it->second.size, it->second.pts, 0, INDEX_CLUSTER
+        };
+        entries.push_back( entry );
+    }
+
+    for( cluster_positions_t::const_iterator it = _cluster_positions.begin(); it != _cluster_positions.end(); ++it )
+    {
+        vlc_seekindex_entry_t const entry = { *it, 0, 0, 0, INDEX_CLUSTER_POSITION };
+        entries.push_back( entry );
+    }
+
+    for( ranges_t::const_iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
+    {
+        vlc_seekindex_entry_t const entry = {
+            it->start, it->end - it->start, 0, 0, INDEX_RANGE_SEARCHED
+        };
+        entries.push_back( entry );
+    }
+
+    if( entries.size() &&
+        vlc_seekindex_Save( &ms.sys.demuxer, ms.sys.demuxer.s, MKV_SEEKINDEX_FORMAT,
+                            &entries[0], entries.size() ) == VLC_SUCCESS )
+        _b_modified = false;
+}
@@ -138,6 +138,10 @@ static int Open( vlc_object_t * p_this )
     p_stream->p_io_callback = p_io_callback;
     p_stream->p_estream = p_io_stream;
 
+    /* The seek index is saved per file, not per segment */
+    if( p_stream->segments.size() == 1 )
+        p_stream->segments[0]->b_seekindex = true;
+
     for (size_t i=0; i<p_stream->segments.size(); i++)
     {
         p_stream->segments[i]->Preload();
@@ -47,11 +47,17 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_duration;    /* total duration of all samples */
 
+    /* Run-length tables. For the moov chunks, they point into the stts and
+     * ctts boxes at the entry of the first sample of the chunk, and the
+     * previous chunks already used i_skip samples of that entry. The last
+     * entry can hold more samples than the chunk. Fragments own theirs. */
     uint32_t     i_entries_dts;
+    uint32_t     i_skip_dts;
     uint32_t     *p_sample_count_dts;
     uint32_t     *p_sample_delta_dts;   /* dts delta */
 
     uint32_t     i_entries_pts;
+    uint32_t     i_skip_pts;
     uint32_t     *p_sample_count_pts;
     int32_t      *p_sample_offset_pts;  /* pts-dts */
 
@@ -115,8 +121,7 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    const uint32_t   *p_sample_size; /* points into the stsz box */
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
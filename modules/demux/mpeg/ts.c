@@ -168,21 +168,26 @@ static bool PIDReferencedByProgram( const ts_pmt_t *, uint16_t );
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
 static inline void FlushESBuffer( ts_pes_t *p_pes );
 static void UpdatePIDScrambledState( demux_t *p_demux, ts_pid_t *p_pid, bool );
-static inline int PIDGet( block_t *p )
+static inline int PIDGet( const uint8_t *p )
 {
-    return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
+    return ( (p[1]&0x1f)<<8 )|p[2];
 }
-static mtime_t GetPCR( const block_t * );
+static mtime_t GetPCR( const uint8_t *, size_t );
 
 static bool ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt );
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t, bool );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static block_t* ReadTSPacketBatch( demux_t *p_demux, unsigned i_max );
+static block_t* TakePendingPackets( demux_sys_t *p_sys );
+static bool DemuxTSPacket( demux_t *p_demux, const uint8_t *p_data, size_t i_data );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
+static void IndexRAP( demux_t *, const ts_pid_t *, const uint8_t *, size_t );
+static void IndexScan( demux_t *, uint64_t );
 
 #define TS_PACKET_SIZE_188 188
 #define TS_PACKET_SIZE_192 192
@@ -410,6 +415,10 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_access_control = true;
     p_sys->b_access_control = ( VLC_SUCCESS == SetPIDFilter( p_sys, patpid, true ) );
 
+    ts_index_Init( &p_sys->index );
+    p_sys->i_index_run = 1;
+    p_sys->p_pending = NULL;
+
     p_sys->i_pmt_es = 0;
     p_sys->b_es_all = false;
 
@@ -505,6 +514,8 @@ static int Open( vlc_object_t *p_this )
     vlc_stream_Control( p_sys->stream, STREAM_CAN_SEEK, &p_sys->b_canseek );
     vlc_stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK,
                         &p_sys->b_canfastseek );
+    if( p_sys->b_canfastseek )
+        ts_index_Load( &p_sys->index, p_demux );
 
     /* Preparse time */
     if( p_sys->b_canseek )
@@ -531,6 +542,14 @@ static void Close( vlc_object_t *p_this )
 
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
+    if( p_sys->p_pending )
+        block_Release( p_sys->p_pending );
+
+    ts_index_StopScan( &p_sys->index );
+    if( p_sys->b_canfastseek )
+        ts_index_Save( &p_sys->index, p_demux );
+    ts_index_Clean( &p_sys->index );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -590,6 +609,7 @@ static int Demux( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     bool b_wait_es = p_sys->i_pmt_es <= 0;
+    const size_t i_min_size = TS_HEADER_SIZE + p_sys->i_packet_header_size;
 
     /* If we had no PAT within MIN_PAT_INTERVAL, create PAT/PMT from probed streams */
     if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.status == PAT_MISSING )
@@ -598,114 +618,169 @@ static int Demux( demux_t *p_demux )
         p_sys->patfix.status = PAT_FIXTRIED;
     }
 
-    /* We read at most 100 TS packet or until a frame is completed */
-    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
+    /* We read at most i_ts_read TS packets or until a frame is completed.
+     * Packets are fetched in batches into a single block, and only the ones
+     * going to the PES gathering get their own block. The packets of a batch
+     * following a completed frame are kept for the next call */
+    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; )
     {
-        bool         b_frame = false;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        bool     b_frame = false;
+        block_t *p_batch = TakePendingPackets( p_sys );
+        if( !p_batch )
         {
-            return VLC_DEMUXER_EOF;
-        }
+            p_batch = ReadTSPacketBatch( p_demux, p_sys->i_ts_read - i_pkt );
+            if( !p_batch )
+                return VLC_DEMUXER_EOF;
 
-        if( p_sys->b_start_record )
-        {
-            /* Enable recording once synchronized */
-            vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true,
-                                "ts" );
-            p_sys->b_start_record = false;
-        }
+            if( p_sys->b_start_record )
+            {
+                /* Enable recording once synchronized */
+                vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE,
+                                    true, "ts" );
+                p_sys->b_start_record = false;
+            }
 
-        /* Parse the TS packet */
-        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
+            const uint64_t i_batch_pos = vlc_stream_Tell( p_sys->stream )
+                                       - p_batch->i_buffer;
+            if( i_batch_pos != p_sys->i_packet_pos )
+                p_sys->i_index_run++; /* seek or lost synchro */
+            p_sys->i_packet_pos = i_batch_pos;
+        }
 
-        if( (p_pkt->p_buffer[1] & 0x40) && (p_pkt->p_buffer[3] & 0x10) &&
-            !SCRAMBLED(*p_pid) != !(p_pkt->p_buffer[3] & 0x80) )
+        stream_t *p_stream = p_sys->stream;
+        while( !b_frame && !( b_wait_es && p_sys->i_pmt_es > 0 ) &&
+               p_batch->i_buffer >= i_min_size )
         {
-            UpdatePIDScrambledState( p_demux, p_pid, p_pkt->p_buffer[3] & 0x80 );
+            const size_t i_size = __MIN( p_batch->i_buffer, p_sys->i_packet_size );
+            /* Skip header (BluRay streams) */
+            b_frame = DemuxTSPacket( p_demux,
+                                     p_batch->p_buffer + p_sys->i_packet_header_size,
+                                     i_size - p_sys->i_packet_header_size );
+            p_batch->p_buffer += i_size;
+            p_batch->i_buffer -= i_size;
+            p_sys->i_packet_pos += i_size;
+            i_pkt++;
         }
 
-        if( !SEEN(p_pid) )
+        if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
         {
-            if( p_pid->type == TYPE_FREE )
-                msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
-            p_pid->i_flags |= FLAG_SEEN;
-            if( p_pid->i_pid == 0x01 )
-                p_sys->b_valid_scrambling = true;
+            if( p_batch->i_buffer >= i_min_size )
+            {
+                p_sys->p_pending = p_batch;
+                p_sys->p_pending_stream = p_stream;
+                p_sys->i_pending_end = p_sys->i_packet_pos + p_batch->i_buffer;
+            }
+            else
+                block_Release( p_batch );
+            break;
         }
+        block_Release( p_batch );
+    }
 
-        /* Adaptation field cannot be scrambled */
-        mtime_t i_pcr = GetPCR( p_pkt );
-        if( i_pcr > VLC_TS_INVALID )
-            PCRHandle( p_demux, p_pid, i_pcr );
+    demux_UpdateTitleFromStream( p_demux );
+    return VLC_DEMUXER_SUCCESS;
+}
 
-        if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa && p_sys->b_valid_scrambling )
-        {
-            block_Release( p_pkt );
-            continue;
-        }
+/*****************************************************************************
+ * DemuxTSPacket: handle a single synchronized TS packet
+ *****************************************************************************
+ * p_data points to the sync byte, and is only referenced during the call.
+ * Returns true if a frame has been completed.
+ *****************************************************************************/
+static bool DemuxTSPacket( demux_t *p_demux, const uint8_t *p_data, size_t i_data )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_frame = false;
 
-        /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
-        if( !SEEN( GetPID( p_sys, 0 ) ) &&
-            (p_pid->probed.i_type == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
-            (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-            (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
-        {
-            ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
-                      p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
-        }
+    /* Parse the TS packet */
+    ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_data ) );
 
-        switch( p_pid->type )
-        {
-        case TYPE_PAT:
-        case TYPE_PMT:
-            ts_psi_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+    if( (p_data[1] & 0x40) && (p_data[3] & 0x10) &&
+        !SCRAMBLED(*p_pid) != !(p_data[3] & 0x80) )
+    {
+        UpdatePIDScrambledState( p_demux, p_pid, p_data[3] & 0x80 );
+    }
 
-        case TYPE_PES:
-            p_sys->b_end_preparse = true;
+    if( !SEEN(p_pid) )
+    {
+        if( p_pid->type == TYPE_FREE )
+            msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
+        p_pid->i_flags |= FLAG_SEEN;
+        if( p_pid->i_pid == 0x01 )
+            p_sys->b_valid_scrambling = true;
+    }
 
-            if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
-            {
-                msg_Dbg( p_demux, "Creating delayed ES" );
-                AddAndCreateES( p_demux, p_pid, true );
-            }
+    /* Adaptation field cannot be scrambled */
+    mtime_t i_pcr = GetPCR( p_data, i_data );
+    if( i_pcr > VLC_TS_INVALID )
+        PCRHandle( p_demux, p_pid, i_pcr );
 
-            /* Emulate HW filter */
-            if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
-            {
-                /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
-                continue;
-            }
+    if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa && p_sys->b_valid_scrambling )
+        return false;
 
-            b_frame = ProcessTSPacket( p_demux, p_pid, p_pkt );
-            break;
+    /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
+    if( !SEEN( GetPID( p_sys, 0 ) ) &&
+        (p_pid->probed.i_type == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
+        (p_data[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
+        (p_data[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
+    {
+        ProbePES( p_demux, p_pid, p_data + TS_HEADER_SIZE,
+                  i_data - TS_HEADER_SIZE, p_data[3] & 0x20 /* Adaptation field */);
+    }
 
-        case TYPE_SI:
-            ts_si_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+    switch( p_pid->type )
+    {
+    case TYPE_PAT:
+    case TYPE_PMT:
+        ts_psi_Packet_Push( p_pid, p_data );
+        break;
 
-        case TYPE_PSIP:
-            ts_psip_Packet_Push( p_pid, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+    case TYPE_PES:
+    {
+        p_sys->b_end_preparse = true;
 
-        case TYPE_CAT:
-        default:
-            /* We have to handle PCR if present */
-            block_Release( p_pkt );
+        if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
+        {
+            msg_Dbg( p_demux, "Creating delayed ES" );
+            AddAndCreateES( p_demux, p_pid, true );
+        }
+
+        /* Index key frames of all the programs, as the PCR */
+        if( p_sys->b_canfastseek && (p_data[1] & 0x40) )
+            IndexRAP( p_demux, p_pid, p_data, i_data );
+
+        /* Emulate HW filter */
+        if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
+        {
+            /* That packet is for an unselected ES, don't waste time/memory gathering its data */
             break;
         }
 
-        if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
+        /* PES gathering keeps the packets, so they need their own storage */
+        block_t *p_pkt = block_Alloc( i_data );
+        if( unlikely(p_pkt == NULL) )
             break;
+        memcpy( p_pkt->p_buffer, p_data, i_data );
+
+        b_frame = ProcessTSPacket( p_demux, p_pid, p_pkt );
+        break;
     }
 
-    demux_UpdateTitleFromStream( p_demux );
-    return VLC_DEMUXER_SUCCESS;
+    case TYPE_SI:
+        ts_si_Packet_Push( p_pid, p_data );
+        break;
+
+    case TYPE_PSIP:
+        ts_psip_Packet_Push( p_pid, p_data );
+        break;
+
+    case TYPE_CAT:
+    default:
+        /* We have to handle PCR if present */
+        break;
+    }
+
+    return b_frame;
 }
 
 /*****************************************************************************
@@ -1619,6 +1694,62 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     return b_ret;
 }
 
+static void ReadTSFailure( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    int64_t size = stream_Size( p_sys->stream );
+    if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
+        msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
+    else
+        msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+}
+
+/* Skips garbage until two consecutive sync bytes are found */
+static bool ResyncTS( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_header = p_sys->i_packet_header_size;
+    const size_t i_size = p_sys->i_packet_size;
+
+    for( ;; )
+    {
+        const uint8_t *p_peek;
+        size_t i_skip = 0;
+
+        ssize_t i_peek = vlc_stream_Peek( p_sys->stream, &p_peek, i_size * 10 );
+        if( i_peek < 0 || (size_t)i_peek < i_size + i_header + 1 )
+        {
+            msg_Dbg( p_demux, "eof ?" );
+            return false;
+        }
+
+        /* Let memchr() do the sync byte lookup, it is vectorized by most libc */
+        const size_t i_scan = i_peek - i_size - i_header;
+        while( i_skip < i_scan )
+        {
+            const uint8_t *p_sync = memchr( &p_peek[i_skip + i_header], 0x47,
+                                            i_scan - i_skip );
+            if( p_sync == NULL )
+            {
+                i_skip = i_scan;
+                break;
+            }
+            i_skip = p_sync - p_peek - i_header;
+            if( p_sync[i_size] == 0x47 )
+                break;
+            i_skip++;
+        }
+
+        msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+        if( vlc_stream_Read( p_sys->stream, NULL, i_skip ) != (ssize_t)i_skip )
+            return false;
+
+        if( i_skip < i_scan )
+            return true;
+    }
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -1628,11 +1759,7 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     /* Get a new TS packet */
     if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
     {
-        int64_t size = stream_Size( p_sys->stream );
-        if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
-            msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
-        else
-            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+        ReadTSFailure( p_demux );
         return NULL;
     }
 
@@ -1654,38 +1781,8 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     {
         msg_Warn( p_demux, "lost synchro" );
         block_Release( p_pkt );
-        for( ;; )
-        {
-            const uint8_t *p_peek;
-            int i_peek = 0;
-            unsigned i_skip = 0;
-
-            i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
-                    p_sys->i_packet_size * 10 );
-            if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
-            {
-                msg_Dbg( p_demux, "eof ?" );
-                return NULL;
-            }
-
-            while( i_skip < i_peek - p_sys->i_packet_size )
-            {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
-                {
-                    break;
-                }
-                i_skip++;
-            }
-            msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-            if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
-                return NULL;
-
-            if( i_skip < i_peek - p_sys->i_packet_size )
-            {
-                break;
-            }
-        }
+        if( !ResyncTS( p_demux ) )
+            return NULL;
         if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
         {
             msg_Dbg( p_demux, "eof ?" );
@@ -1695,13 +1792,70 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
-static mtime_t GetPCR( const block_t *p_pkt )
+/* Returns the packets left by the previous Demux() call, unless the
+ * stream was seeked or replaced since */
+static block_t* TakePendingPackets( demux_sys_t *p_sys )
 {
-    const uint8_t *p = p_pkt->p_buffer;
+    block_t *p_pending = p_sys->p_pending;
 
+    if( p_pending == NULL )
+        return NULL;
+    p_sys->p_pending = NULL;
+
+    if( p_sys->stream != p_sys->p_pending_stream
+     || vlc_stream_Tell( p_sys->stream ) != p_sys->i_pending_end )
+    {
+        block_Release( p_pending );
+        return NULL;
+    }
+    return p_pending;
+}
+
+/* Reads up to i_max synchronized TS packets into a single block.
+ * Unlike ReadTSPacket(), the packets keep their extra header, if any. */
+static block_t* ReadTSPacketBatch( demux_t *p_demux, unsigned i_max )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_header = p_sys->i_packet_header_size;
+    const size_t i_size = p_sys->i_packet_size;
+
+    for( ;; )
+    {
+        const uint8_t *p_peek;
+        ssize_t i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
+                                          (size_t)i_max * i_size );
+        if( i_peek < (ssize_t)(TS_HEADER_SIZE + i_header) )
+        {
+            ReadTSFailure( p_demux );
+            return NULL;
+        }
+
+        /* Only take the leading packets that are in sync */
+        size_t i_batch = 0;
+        while( i_batch + TS_HEADER_SIZE + i_header <= (size_t)i_peek &&
+               p_peek[i_batch + i_header] == 0x47 )
+            i_batch += i_size;
+
+        if( i_batch > 0 )
+        {
+            block_t *p_batch = vlc_stream_Block( p_sys->stream,
+                                                 __MIN( i_batch, (size_t)i_peek ) );
+            if( p_batch == NULL )
+                ReadTSFailure( p_demux );
+            return p_batch;
+        }
+
+        msg_Warn( p_demux, "lost synchro" );
+        if( !ResyncTS( p_demux ) )
+            return NULL;
+    }
+}
+
+static mtime_t GetPCR( const uint8_t *p, size_t i_data )
+{
     mtime_t i_pcr = -1;
 
-    if( likely(p_pkt->i_buffer > 11) &&
+    if( likely(i_data > 11) &&
         ( p[3]&0x20 ) && /* adaptation */
         ( p[5]&0x10 ) &&
         ( p[4] >= 7 ) )
@@ -1820,15 +1974,25 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
+    /* Go straight to the key frame if it is known */
+    uint64_t i_rap_pos;
+    if( ts_index_FindRAP( &p_sys->index, p_pmt->i_number, i_scaledtime, &i_rap_pos ) &&
+        vlc_stream_Seek( p_sys->stream, i_rap_pos ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+
     const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
 
-    /* Find the time position by using binary search algorithm. */
+    /* Find the time position by using binary search algorithm, between the
+     * indexed PCR around it if any. */
     uint64_t i_head_pos = 0;
     uint64_t i_tail_pos = (uint64_t) i_stream_size - p_sys->i_packet_size;
     if( i_head_pos >= i_tail_pos )
         return VLC_EGENERIC;
+    bool b_bounded = ts_index_Bound( &p_sys->index, p_pmt->i_number,
+                                     i_scaledtime, &i_head_pos, &i_tail_pos );
 
     bool b_found = false;
+retry:
     while( (i_head_pos + p_sys->i_packet_size) <= i_tail_pos && !b_found )
     {
         /* Round i_pos to a multiple of p_sys->i_packet_size */
@@ -1852,7 +2016,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
             else
                 i_pos = vlc_stream_Tell( p_sys->stream );
 
-            int i_pid = PIDGet( p_pkt );
+            int i_pid = PIDGet( p_pkt->p_buffer );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
             if( i_pid != 0x1FFF && p_pid->type == TYPE_PES &&
                 ts_pes_Find_es( p_pid->u.p_pes, p_pmt ) &&
@@ -1865,7 +2029,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                 {
                     if( p_pkt->i_buffer >= 4 + 2 + 5 )
                     {
-                        i_pcr = GetPCR( p_pkt );
+                        i_pcr = GetPCR( p_pkt->p_buffer, p_pkt->i_buffer );
                         i_skip += 1 + p_pkt->p_buffer[4];
                     }
                 }
@@ -1902,12 +2066,25 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
             i_tail_pos = (i_splitpos >= p_sys->i_packet_size) ? i_splitpos - p_sys->i_packet_size : 0;
     }
 
+    if( !b_found && b_bounded )
+    {
+        /* The indexed points did not lead to it, search the whole stream */
+        msg_Dbg( p_demux, "Seek():time position not within the index" );
+        b_bounded = false;
+        i_head_pos = 0;
+        i_tail_pos = (uint64_t) i_stream_size - p_sys->i_packet_size;
+        goto retry;
+    }
+
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
         vlc_stream_Seek( p_sys->stream, i_initial_pos );
         return VLC_EGENERIC;
     }
+
+    /* Index the rest of the file for the next seeks, from here */
+    IndexScan( p_demux, vlc_stream_Tell( p_sys->stream ) );
     return VLC_SUCCESS;
 }
 
@@ -1928,7 +2105,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
             break;
         }
 
-        const int i_pid = PIDGet( p_pkt );
+        const int i_pid = PIDGet( p_pkt->p_buffer );
         ts_pid_t *p_pid = GetPID(p_sys, i_pid);
 
         p_pid->i_flags |= FLAG_SEEN;
@@ -1939,7 +2116,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
             bool b_adaptfield = p_pkt->p_buffer[3] & 0x20;
 
             if( b_adaptfield && p_pkt->i_buffer >= 4 + 2 + 5 )
-                *pi_pcr = GetPCR( p_pkt );
+                *pi_pcr = GetPCR( p_pkt->p_buffer, p_pkt->i_buffer );
 
             if( *pi_pcr == -1 &&
                 (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* payload start */
@@ -2198,6 +2375,106 @@ static void PCRCheckDTS( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr)
     }
 }
 
+static void IndexPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_canfastseek || p_pmt->pcr.i_first == -1 )
+        return;
+
+    const ts_index_point_t prev = {
+        .i_time = p_pmt->index.i_time,
+        .i_pos = p_pmt->index.i_pos,
+    };
+    const ts_index_point_t pcr = {
+        .i_time = i_pcr,
+        .i_pos = p_sys->i_packet_pos,
+    };
+    ts_index_AddPCR( &p_sys->index, p_pmt->i_number,
+                     ( p_pmt->index.i_run == p_sys->i_index_run ) ? &prev : NULL,
+                     pcr );
+    p_pmt->index.i_time = pcr.i_time;
+    p_pmt->index.i_pos = pcr.i_pos;
+    p_pmt->index.i_run = p_sys->i_index_run;
+}
+
+static void IndexRAP( demux_t *p_demux, const ts_pid_t *p_pid,
+                      const uint8_t *p_data, size_t i_data )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( const ts_pes_es_t *p_es = p_pid->u.p_pes->p_es; p_es; p_es = p_es->p_next )
+    {
+        const ts_pmt_t *p_pmt = p_es->p_program;
+        int64_t i_pts;
+
+        if( p_es->fmt.i_cat != VIDEO_ES || !p_pmt || p_pmt->pcr.i_first == -1 ||
+            !ts_index_IsRAP( VLC_OBJECT(p_demux), p_data, i_data,
+                             p_es->fmt.i_codec, &i_pts ) )
+            continue;
+
+        const ts_index_point_t rap = {
+            .i_time = TimeStampWrapAround( p_pmt->pcr.i_first, i_pts ),
+            .i_pos = p_sys->i_packet_pos,
+        };
+        ts_index_AddRAP( &p_sys->index, p_pmt->i_number, rap );
+    }
+}
+
+/* Indexes the whole file in the background, starting from the given offset */
+static void IndexScan( demux_t *p_demux, uint64_t i_pos )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_index_pid_t pids[64];
+    size_t i_pids = 0;
+
+    if( GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        const ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_pmt->pcr.i_first == -1 || p_pmt->i_pid_pcr == 0x1FFF ||
+            i_pids == ARRAY_SIZE(pids) )
+            continue;
+
+        ts_index_pid_t *p_pcr = &pids[i_pids++];
+        *p_pcr = (ts_index_pid_t) {
+            .i_pid = p_pmt->i_pid_pcr,
+            .i_program = p_pmt->i_number,
+            .b_pcr = true,
+            .i_first_pcr = p_pmt->pcr.i_first,
+        };
+
+        for( int j = 0; j < p_pmt->e_streams.i_size; j++ )
+        {
+            const ts_pid_t *pid = p_pmt->e_streams.p_elems[j];
+            if( pid->type != TYPE_PES )
+                continue;
+
+            for( const ts_pes_es_t *p_es = pid->u.p_pes->p_es; p_es; p_es = p_es->p_next )
+            {
+                if( p_es->p_program != p_pmt || p_es->fmt.i_cat != VIDEO_ES )
+                    continue;
+
+                if( pid->i_pid == p_pcr->i_pid )
+                    p_pcr->i_codec = p_es->fmt.i_codec;
+                else if( i_pids < ARRAY_SIZE(pids) )
+                    pids[i_pids++] = (ts_index_pid_t) {
+                        .i_pid = pid->i_pid,
+                        .i_program = p_pmt->i_number,
+                        .i_codec = p_es->fmt.i_codec,
+                        .i_first_pcr = p_pmt->pcr.i_first,
+                    };
+            }
+        }
+    }
+
+    ts_index_Scan( &p_sys->index, p_demux, i_pos, p_sys->i_packet_size,
+                   p_sys->i_packet_header_size, pids, i_pids );
+}
+
 static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
@@ -2223,6 +2500,7 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
             {
                 /* ? update PCR for the whole group program ? */
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                IndexPCR( p_demux, p_pmt, i_program_pcr );
             }
         }
         else /* set PCR provided by current pid to program(s) referencing it */
@@ -2233,6 +2511,7 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
                 /* We've found a target group for update */
                 PCRCheckDTS( p_demux, p_pmt, i_pcr );
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                IndexPCR( p_demux, p_pmt, i_program_pcr );
             }
         }
 
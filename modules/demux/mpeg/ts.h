@@ -20,6 +20,8 @@
 #ifndef VLC_TS_H
 #define VLC_TS_H
 
+#include "ts_index.h"
+
 #ifdef HAVE_ARIBB24
     typedef struct arib_instance_t arib_instance_t;
 #endif
@@ -62,6 +64,18 @@ struct demux_sys_t
 
     bool        b_ignore_time_for_positions;
 
+    /* PCR and key frame positions, offset of the packet being demuxed, and
+     * number of the contiguous reading it belongs to */
+    ts_index_t  index;
+    uint64_t    i_packet_pos;
+    unsigned    i_index_run;
+
+    /* Packets read past the last completed frame, valid as long as the
+     * stream is still at i_pending_end */
+    block_t    *p_pending;
+    stream_t   *p_pending_stream;
+    uint64_t    i_pending_end;
+
     ts_standards_e standard;
 
     struct
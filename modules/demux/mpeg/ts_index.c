@@ -0,0 +1,725 @@
+/*****************************************************************************
+ * ts_index.c : TS demuxer time and random access index
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_arrays.h>
+#include <vlc_atomic.h>
+#include <vlc_codec.h>
+#include <vlc_seekindex.h>
+
+#include "pes.h"
+#include "timestamps.h"
+#include "ts_index.h"
+
+#define TS_SEEKINDEX_FORMAT VLC_FOURCC('T','S','I','2')
+
+/* Kinds of the saved entries */
+enum
+{
+    ENTRY_PCR,
+    ENTRY_RAP,
+    ENTRY_RANGE,
+};
+
+/* Largest PCR interval of a contiguous reading (the norm is 100ms) */
+#define TS_INDEX_MAX_GAP TO_SCALE_NZ(5 * CLOCK_FREQ)
+/* Packets read at once by the background scan */
+#define TS_INDEX_SCAN_PACKETS 2048
+
+struct ts_index_scan_t
+{
+    vlc_thread_t    thread;
+    demux_t        *p_demux;
+    ts_index_t     *p_index;
+    char           *psz_url;
+    unsigned        i_packet_size;
+    unsigned        i_header_size;
+    atomic_bool     b_stop;
+
+    /* Requested offset, protected by the index lock */
+    uint64_t        i_jump;
+    bool            b_jump;
+
+    size_t            i_pids;
+    ts_index_pid_t   *p_pids;
+    ts_index_point_t *p_last; /* last PCR read on each pid */
+};
+
+void ts_index_Init( ts_index_t *p_index )
+{
+    vlc_mutex_init( &p_index->lock );
+    ARRAY_INIT( p_index->programs );
+    p_index->b_modified = false;
+    p_index->p_scan = NULL;
+}
+
+void ts_index_Clean( ts_index_t *p_index )
+{
+    ts_index_StopScan( p_index );
+
+    for( int i = 0; i < p_index->programs.i_size; i++ )
+    {
+        ts_index_program_t *p_prg = p_index->programs.p_elems[i];
+        ARRAY_RESET( p_prg->points );
+        ARRAY_RESET( p_prg->raps );
+        ARRAY_RESET( p_prg->ranges );
+        free( p_prg );
+    }
+    ARRAY_RESET( p_index->programs );
+    vlc_mutex_destroy( &p_index->lock );
+}
+
+static ts_index_program_t *GetProgram( ts_index_t *p_index, uint16_t i_program,
+                                       bool b_create )
+{
+    for( int i = 0; i < p_index->programs.i_size; i++ )
+        if( p_index->programs.p_elems[i]->i_program == i_program )
+            return p_index->programs.p_elems[i];
+
+    if( !b_create )
+        return NULL;
+
+    ts_index_program_t *p_prg = malloc( sizeof(*p_prg) );
+    if( unlikely(!p_prg) )
+        return NULL;
+    p_prg->i_program = i_program;
+    ARRAY_INIT( p_prg->points );
+    ARRAY_INIT( p_prg->raps );
+    ARRAY_INIT( p_prg->ranges );
+    ARRAY_APPEND( p_index->programs, p_prg );
+    return p_prg;
+}
+
+/* Returns the number of points at or before the given offset */
+static int FindPos( const ts_index_points_t *p_points, uint64_t i_pos )
+{
+    int i_low = 0, i_high = p_points->i_size;
+
+    while( i_low < i_high )
+    {
+        int i_mid = (i_low + i_high) / 2;
+        if( p_points->p_elems[i_mid].i_pos <= i_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+/* Returns the number of points at or before the given time */
+static int FindTime( const ts_index_points_t *p_points, int64_t i_time )
+{
+    int i_low = 0, i_high = p_points->i_size;
+
+    while( i_low < i_high )
+    {
+        int i_mid = (i_low + i_high) / 2;
+        if( p_points->p_elems[i_mid].i_time <= i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+static bool InsertPoint( ts_index_points_t *p_points, ts_index_point_t point,
+                         int64_t i_interval )
+{
+    const int i_next = FindPos( p_points, point.i_pos );
+    const ts_index_point_t *p_prev = ( i_next > 0 ) ?
+                                     &p_points->p_elems[i_next - 1] : NULL;
+    const ts_index_point_t *p_next = ( i_next < p_points->i_size ) ?
+                                     &p_points->p_elems[i_next] : NULL;
+
+    /* Only keep points spaced enough, and consistent with the known ones:
+     * the time map is meaningless across discontinuities */
+    if( p_prev && ( p_prev->i_pos == point.i_pos ||
+                    point.i_time - p_prev->i_time < i_interval ) )
+        return false;
+    if( p_next && p_next->i_time - point.i_time < i_interval )
+        return false;
+
+    ARRAY_INSERT( (*p_points), point, i_next );
+    return true;
+}
+
+/* Returns the index of the first range not ending before the offset */
+static int FindRange( const ts_index_program_t *p_prg, uint64_t i_pos )
+{
+    int i_low = 0, i_high = p_prg->ranges.i_size;
+
+    while( i_low < i_high )
+    {
+        int i_mid = (i_low + i_high) / 2;
+        if( p_prg->ranges.p_elems[i_mid].i_end < i_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+static const ts_index_range_t *GetRange( const ts_index_program_t *p_prg,
+                                         uint64_t i_pos )
+{
+    const int i = FindRange( p_prg, i_pos );
+    if( i < p_prg->ranges.i_size && p_prg->ranges.p_elems[i].i_start <= i_pos )
+        return &p_prg->ranges.p_elems[i];
+    return NULL;
+}
+
+static bool AddRange( ts_index_program_t *p_prg, uint64_t i_start, uint64_t i_end )
+{
+    const int i = FindRange( p_prg, i_start );
+
+    if( i == p_prg->ranges.i_size || p_prg->ranges.p_elems[i].i_start > i_end )
+    {
+        ts_index_range_t range = { .i_start = i_start, .i_end = i_end };
+        ARRAY_INSERT( p_prg->ranges, range, i );
+        return true;
+    }
+
+    ts_index_range_t *p_range = &p_prg->ranges.p_elems[i];
+    if( p_range->i_start <= i_start && i_end <= p_range->i_end )
+        return false;
+
+    p_range->i_start = __MIN( p_range->i_start, i_start );
+    p_range->i_end = __MAX( p_range->i_end, i_end );
+    while( i + 1 < p_prg->ranges.i_size &&
+           p_prg->ranges.p_elems[i + 1].i_start <= p_range->i_end )
+    {
+        p_range->i_end = __MAX( p_range->i_end, p_prg->ranges.p_elems[i + 1].i_end );
+        ARRAY_REMOVE( p_prg->ranges, i + 1 );
+        p_range = &p_prg->ranges.p_elems[i];
+    }
+    return true;
+}
+
+void ts_index_AddPCR( ts_index_t *p_index, uint16_t i_program,
+                      const ts_index_point_t *p_prev, ts_index_point_t pcr )
+{
+    vlc_mutex_lock( &p_index->lock );
+    ts_index_program_t *p_prg = GetProgram( p_index, i_program, true );
+    if( p_prg )
+    {
+        if( InsertPoint( &p_prg->points, pcr, TS_INDEX_INTERVAL ) )
+            p_index->b_modified = true;
+
+        if( p_prev && p_prev->i_pos < pcr.i_pos &&
+            p_prev->i_time <= pcr.i_time &&
+            pcr.i_time - p_prev->i_time <= TS_INDEX_MAX_GAP &&
+            AddRange( p_prg, p_prev->i_pos, pcr.i_pos ) )
+            p_index->b_modified = true;
+    }
+    vlc_mutex_unlock( &p_index->lock );
+}
+
+void ts_index_AddRAP( ts_index_t *p_index, uint16_t i_program, ts_index_point_t rap )
+{
+    vlc_mutex_lock( &p_index->lock );
+    ts_index_program_t *p_prg = GetProgram( p_index, i_program, true );
+    if( p_prg && InsertPoint( &p_prg->raps, rap, 1 ) )
+        p_index->b_modified = true;
+    vlc_mutex_unlock( &p_index->lock );
+}
+
+bool ts_index_Bound( ts_index_t *p_index, uint16_t i_program, int64_t i_time,
+                     uint64_t *pi_head, uint64_t *pi_tail )
+{
+    bool b_bounded = false;
+
+    vlc_mutex_lock( &p_index->lock );
+    const ts_index_program_t *p_prg = GetProgram( p_index, i_program, false );
+    if( p_prg && p_prg->points.i_size > 0 )
+    {
+        const int i_next = FindTime( &p_prg->points, i_time );
+        if( i_next > 0 )
+            *pi_head = __MAX( *pi_head, p_prg->points.p_elems[i_next - 1].i_pos );
+        if( i_next < p_prg->points.i_size )
+            *pi_tail = __MIN( *pi_tail, p_prg->points.p_elems[i_next].i_pos );
+        b_bounded = true;
+    }
+    vlc_mutex_unlock( &p_index->lock );
+    return b_bounded;
+}
+
+bool ts_index_FindRAP( ts_index_t *p_index, uint16_t i_program, int64_t i_time,
+                       uint64_t *pi_pos )
+{
+    bool b_found = false;
+
+    vlc_mutex_lock( &p_index->lock );
+    const ts_index_program_t *p_prg = GetProgram( p_index, i_program, false );
+    const int i_next = p_prg ? FindTime( &p_prg->raps, i_time ) : 0;
+    if( i_next > 0 )
+    {
+        const ts_index_point_t *p_rap = &p_prg->raps.p_elems[i_next - 1];
+        const ts_index_range_t *p_range = GetRange( p_prg, p_rap->i_pos );
+
+        /* It is the last key frame before the time if every key frame is
+         * known from there up to a later one, or to a later PCR (a frame is
+         * sent before its time) */
+        if( p_range )
+        {
+            if( i_next < p_prg->raps.i_size )
+                b_found = p_prg->raps.p_elems[i_next].i_pos <= p_range->i_end;
+            if( !b_found )
+            {
+                const int i_pcr = FindTime( &p_prg->points, i_time );
+                b_found = i_pcr < p_prg->points.i_size &&
+                          p_prg->points.p_elems[i_pcr].i_pos >= p_rap->i_pos &&
+                          p_prg->points.p_elems[i_pcr].i_pos <= p_range->i_end;
+            }
+        }
+        if( b_found )
+            *pi_pos = p_rap->i_pos;
+    }
+    vlc_mutex_unlock( &p_index->lock );
+    return b_found;
+}
+
+/* Looks for the start of a key frame in the beginning of a video payload */
+static bool IsKeyFrame( vlc_fourcc_t i_codec, const uint8_t *p, size_t i_size )
+{
+    for( size_t i = 0; i + 3 < i_size; i++ )
+    {
+        if( p[i] != 0 || p[i + 1] != 0 || p[i + 2] != 1 )
+            continue;
+
+        const uint8_t i_code = p[i + 3];
+        switch( i_codec )
+        {
+            case VLC_CODEC_H264:
+                switch( i_code & 0x1f )
+                {
+                    case 5: /* IDR slice */
+                    case 7: /* SPS */
+                        return true;
+                    case 1: /* other slice */
+                        return false;
+                }
+                break;
+            case VLC_CODEC_HEVC:
+            {
+                const uint8_t i_type = ( i_code >> 1 ) & 0x3f;
+                if( ( i_type >= 16 && i_type <= 21 ) || /* IRAP slice */
+                    i_type == 32 || i_type == 33 )      /* VPS, SPS */
+                    return true;
+                if( i_type < 16 )
+                    return false;
+                break;
+            }
+            case VLC_CODEC_MPGV:
+                if( i_code == 0xB3 || i_code == 0xB8 ) /* sequence, GOP */
+                    return true;
+                if( i_code == 0x00 ) /* picture */
+                    return false;
+                break;
+            default:
+                return false;
+        }
+        i += 3;
+    }
+    return false;
+}
+
+bool ts_index_IsRAP( vlc_object_t *p_obj, const uint8_t *p, size_t i_pkt,
+                     vlc_fourcc_t i_codec, int64_t *pi_pts )
+{
+    if( i_pkt < 4 || !( p[1] & 0x40 ) || !( p[3] & 0x10 ) )
+        return false;
+
+    size_t i_skip = 4;
+    bool b_rai = false;
+    if( p[3] & 0x20 )
+    {
+        if( 5u + p[4] > i_pkt )
+            return false;
+        b_rai = p[4] > 0 && ( p[5] & 0x40 ); /* random access indicator */
+        i_skip += 1 + p[4];
+    }
+    if( p[3] & 0xC0 ) /* scrambled */
+        return false;
+
+    p += i_skip;
+    i_pkt -= i_skip;
+    if( i_pkt < 9 || p[0] != 0 || p[1] != 0 || p[2] != 1 )
+        return false;
+
+    unsigned i_pes_skip;
+    mtime_t i_dts = -1, i_pts = -1;
+    uint8_t i_stream_id;
+    if( ParsePESHeader( p_obj, p, i_pkt, &i_pes_skip, &i_dts, &i_pts,
+                        &i_stream_id, NULL ) != VLC_SUCCESS )
+        return false;
+    if( i_pts == -1 )
+        i_pts = i_dts;
+    if( i_pts == -1 )
+        return false;
+
+    if( !b_rai && ( i_pes_skip >= i_pkt ||
+                    !IsKeyFrame( i_codec, &p[i_pes_skip], i_pkt - i_pes_skip ) ) )
+        return false;
+
+    *pi_pts = i_pts;
+    return true;
+}
+
+/*****************************************************************************
+ * Background scan
+ *****************************************************************************/
+static int64_t ReadPCR( const uint8_t *p, size_t i_pkt )
+{
+    if( i_pkt > 11 && ( p[3] & 0x20 ) && ( p[5] & 0x10 ) && p[4] >= 7 )
+        return ( (int64_t)p[6] << 25 ) | ( (int64_t)p[7] << 17 ) |
+               ( (int64_t)p[8] << 9 ) | ( (int64_t)p[9] << 1 ) |
+               ( (int64_t)p[10] >> 7 );
+    return -1;
+}
+
+static void ScanBreak( ts_index_scan_t *p_scan )
+{
+    for( size_t i = 0; i < p_scan->i_pids; i++ )
+        p_scan->p_last[i].i_pos = UINT64_MAX;
+}
+
+/* Returns the first offset from which not everything is known */
+static uint64_t ScanNext( ts_index_scan_t *p_scan, uint64_t i_pos )
+{
+    uint64_t i_next = UINT64_MAX;
+
+    for( size_t i = 0; i < p_scan->i_pids; i++ )
+    {
+        if( !p_scan->p_pids[i].b_pcr )
+            continue;
+
+        const ts_index_program_t *p_prg =
+            GetProgram( p_scan->p_index, p_scan->p_pids[i].i_program, false );
+        const ts_index_range_t *p_range = p_prg ? GetRange( p_prg, i_pos ) : NULL;
+        if( !p_range )
+            return i_pos;
+        i_next = __MIN( i_next, p_range->i_end );
+    }
+    return ( i_next == UINT64_MAX ) ? i_pos : i_next;
+}
+
+static void ScanPacket( ts_index_scan_t *p_scan, size_t i_entry,
+                        const uint8_t *p, size_t i_pkt, uint64_t i_pos )
+{
+    const ts_index_pid_t *p_pid = &p_scan->p_pids[i_entry];
+    int64_t i_pts;
+
+    /* The random access point goes first, as the range up to the PCR of
+     * the same packet must include it */
+    if( p_pid->i_codec &&
+        ts_index_IsRAP( VLC_OBJECT(p_scan->p_demux), p, i_pkt,
+                        p_pid->i_codec, &i_pts ) )
+    {
+        const ts_index_point_t rap = {
+            .i_time = TimeStampWrapAround( p_pid->i_first_pcr, i_pts ),
+            .i_pos = i_pos,
+        };
+        ts_index_AddRAP( p_scan->p_index, p_pid->i_program, rap );
+    }
+
+    const int64_t i_pcr = p_pid->b_pcr ? ReadPCR( p, i_pkt ) : -1;
+    if( i_pcr > -1 )
+    {
+        ts_index_point_t *p_last = &p_scan->p_last[i_entry];
+        const ts_index_point_t pcr = {
+            .i_time = TimeStampWrapAround( p_pid->i_first_pcr, i_pcr ),
+            .i_pos = i_pos,
+        };
+        ts_index_AddPCR( p_scan->p_index, p_pid->i_program,
+                         ( p_last->i_pos != UINT64_MAX ) ? p_last : NULL, pcr );
+        *p_last = pcr;
+    }
+}
+
+/* Indexes the packets of a buffer, returns the size of the complete ones */
+static size_t ScanPackets( ts_index_scan_t *p_scan, const uint8_t *p_buf,
+                           size_t i_buf, uint64_t i_pos )
+{
+    const size_t i_size = p_scan->i_packet_size;
+    const size_t i_header = p_scan->i_header_size;
+    size_t i = 0;
+
+    while( i + i_size <= i_buf )
+    {
+        const uint8_t *p = &p_buf[i + i_header];
+
+        if( p[0] != 0x47 || ( i + 2 * i_size <= i_buf && p[i_size] != 0x47 ) )
+        {
+            /* Lost sync */
+            ScanBreak( p_scan );
+            i++;
+            continue;
+        }
+
+        const uint16_t i_pid = ( ( p[1] & 0x1f ) << 8 ) | p[2];
+        for( size_t j = 0; j < p_scan->i_pids; j++ )
+            if( p_scan->p_pids[j].i_pid == i_pid )
+                ScanPacket( p_scan, j, p, i_size - i_header, i_pos + i );
+        i += i_size;
+    }
+    return i;
+}
+
+/* Reads the file from the requested offset to its end, then from its start,
+ * skipping the parts already indexed */
+static void *ScanThread( void *data )
+{
+    ts_index_scan_t *p_scan = data;
+    ts_index_t *p_index = p_scan->p_index;
+    const size_t i_chunk = TS_INDEX_SCAN_PACKETS * p_scan->i_packet_size;
+
+    uint8_t *p_buf = malloc( i_chunk );
+    stream_t *s = p_buf ? vlc_stream_NewMRL( p_scan->p_demux, p_scan->psz_url )
+                        : NULL;
+    if( s == NULL )
+    {
+        free( p_buf );
+        return NULL;
+    }
+
+    const uint64_t i_size = stream_Size( s );
+    uint64_t i_pos = 0, i_stream_pos = UINT64_MAX, i_scanned = 0;
+    bool b_wrapped = false;
+    mtime_t i_start = mdate();
+
+    while( !atomic_load( &p_scan->b_stop ) )
+    {
+        vlc_mutex_lock( &p_index->lock );
+        if( p_scan->b_jump )
+        {
+            i_pos = p_scan->i_jump;
+            p_scan->b_jump = false;
+            b_wrapped = false;
+        }
+        i_pos = ScanNext( p_scan, i_pos );
+        vlc_mutex_unlock( &p_index->lock );
+
+        if( i_pos + p_scan->i_packet_size > i_size )
+        {
+            if( b_wrapped )
+                break;
+            b_wrapped = true;
+            i_pos = 0;
+            continue;
+        }
+
+        if( i_pos != i_stream_pos )
+        {
+            if( vlc_stream_Seek( s, i_pos ) != VLC_SUCCESS )
+                break;
+            ScanBreak( p_scan );
+        }
+
+        ssize_t i_read = vlc_stream_Read( s, p_buf, i_chunk );
+        if( i_read < (ssize_t)p_scan->i_packet_size )
+        {
+            i_stream_pos = UINT64_MAX;
+            i_pos = i_size;
+            continue;
+        }
+        i_scanned += i_read;
+        i_stream_pos = i_pos + i_read;
+        i_pos += ScanPackets( p_scan, p_buf, i_read, i_pos );
+    }
+
+    msg_Dbg( p_scan->p_demux, "indexed %"PRIu64" bytes in %"PRId64" ms",
+             i_scanned, ( mdate() - i_start ) / 1000 );
+    vlc_stream_Delete( s );
+    free( p_buf );
+    return NULL;
+}
+
+void ts_index_Scan( ts_index_t *p_index, demux_t *p_demux, uint64_t i_pos,
+                    unsigned i_packet_size, unsigned i_header_size,
+                    const ts_index_pid_t *p_pids, size_t i_pids )
+{
+    if( p_index->p_scan )
+    {
+        vlc_mutex_lock( &p_index->lock );
+        p_index->p_scan->i_jump = i_pos;
+        p_index->p_scan->b_jump = true;
+        vlc_mutex_unlock( &p_index->lock );
+        return;
+    }
+
+    if( i_pids == 0 || p_demux->s->psz_url == NULL )
+        return;
+
+    ts_index_scan_t *p_scan = malloc( sizeof(*p_scan) );
+    if( unlikely(!p_scan) )
+        return;
+
+    p_scan->p_demux = p_demux;
+    p_scan->p_index = p_index;
+    p_scan->psz_url = strdup( p_demux->s->psz_url );
+    p_scan->i_packet_size = i_packet_size;
+    p_scan->i_header_size = i_header_size;
+    atomic_init( &p_scan->b_stop, false );
+    p_scan->i_jump = i_pos;
+    p_scan->b_jump = true;
+    p_scan->i_pids = i_pids;
+    p_scan->p_pids = malloc( i_pids * sizeof(*p_pids) );
+    p_scan->p_last = calloc( i_pids, sizeof(*p_scan->p_last) );
+    if( likely(p_scan->p_pids) )
+        memcpy( p_scan->p_pids, p_pids, i_pids * sizeof(*p_pids) );
+
+    if( unlikely(!p_scan->psz_url || !p_scan->p_pids || !p_scan->p_last) ||
+        vlc_clone( &p_scan->thread, ScanThread, p_scan,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        free( p_scan->psz_url );
+        free( p_scan->p_pids );
+        free( p_scan->p_last );
+        free( p_scan );
+        return;
+    }
+    p_index->p_scan = p_scan;
+}
+
+void ts_index_StopScan( ts_index_t *p_index )
+{
+    ts_index_scan_t *p_scan = p_index->p_scan;
+    if( !p_scan )
+        return;
+
+    atomic_store( &p_scan->b_stop, true );
+    vlc_join( p_scan->thread, NULL );
+    free( p_scan->psz_url );
+    free( p_scan->p_pids );
+    free( p_scan->p_last );
+    free( p_scan );
+    p_index->p_scan = NULL;
+}
+
+/*****************************************************************************
+ * Persistence
+ *****************************************************************************/
+void ts_index_Load( ts_index_t *p_index, demux_t *p_demux )
+{
+    vlc_seekindex_entry_t *p_entries;
+    size_t i_entries = vlc_seekindex_Load( p_demux, p_demux->s,
+                                           TS_SEEKINDEX_FORMAT, &p_entries );
+    if( i_entries == 0 )
+        return;
+
+    const uint64_t i_size = stream_Size( p_demux->s );
+
+    vlc_mutex_lock( &p_index->lock );
+    for( size_t i = 0; i < i_entries; i++ )
+    {
+        const vlc_seekindex_entry_t *p_entry = &p_entries[i];
+        if( p_entry->i_track > UINT16_MAX || p_entry->i_pos >= i_size )
+            continue;
+
+        ts_index_program_t *p_prg = GetProgram( p_index, p_entry->i_track, true );
+        if( !p_prg )
+            break;
+
+        const ts_index_point_t point = {
+            .i_time = p_entry->i_time,
+            .i_pos = p_entry->i_pos,
+        };
+        switch( p_entry->i_flags )
+        {
+            case ENTRY_PCR:
+                InsertPoint( &p_prg->points, point, TS_INDEX_INTERVAL );
+                break;
+            case ENTRY_RAP:
+                InsertPoint( &p_prg->raps, point, 1 );
+                break;
+            case ENTRY_RANGE:
+                if( p_entry->i_size < i_size - p_entry->i_pos )
+                    AddRange( p_prg, p_entry->i_pos,
+                              p_entry->i_pos + p_entry->i_size );
+                break;
+        }
+    }
+    p_index->b_modified = false;
+    vlc_mutex_unlock( &p_index->lock );
+    free( p_entries );
+}
+
+static void SavePoints( vlc_seekindex_entry_t **pp_entry, uint16_t i_program,
+                        const ts_index_points_t *p_points, uint32_t i_kind )
+{
+    for( int i = 0; i < p_points->i_size; i++ )
+    {
+        *(*pp_entry)++ = (vlc_seekindex_entry_t) {
+            .i_pos = p_points->p_elems[i].i_pos,
+            .i_time = p_points->p_elems[i].i_time,
+            .i_track = i_program,
+            .i_flags = i_kind,
+        };
+    }
+}
+
+void ts_index_Save( ts_index_t *p_index, demux_t *p_demux )
+{
+    if( !p_index->b_modified )
+        return;
+
+    size_t i_entries = 0;
+    for( int i = 0; i < p_index->programs.i_size; i++ )
+    {
+        const ts_index_program_t *p_prg = p_index->programs.p_elems[i];
+        i_entries += p_prg->points.i_size + p_prg->raps.i_size +
+                     p_prg->ranges.i_size;
+    }
+    if( i_entries == 0 )
+        return;
+
+    vlc_seekindex_entry_t *p_entries = NULL;
+    if( likely(i_entries <= SIZE_MAX / sizeof(*p_entries)) )
+        p_entries = malloc( i_entries * sizeof(*p_entries) );
+    if( unlikely(!p_entries) )
+        return;
+
+    vlc_seekindex_entry_t *p_entry = p_entries;
+    for( int i = 0; i < p_index->programs.i_size; i++ )
+    {
+        const ts_index_program_t *p_prg = p_index->programs.p_elems[i];
+
+        SavePoints( &p_entry, p_prg->i_program, &p_prg->points, ENTRY_PCR );
+        SavePoints( &p_entry, p_prg->i_program, &p_prg->raps, ENTRY_RAP );
+        for( int j = 0; j < p_prg->ranges.i_size; j++ )
+        {
+            const ts_index_range_t *p_range = &p_prg->ranges.p_elems[j];
+            *p_entry++ = (vlc_seekindex_entry_t) {
+                .i_pos = p_range->i_start,
+                .i_size = p_range->i_end - p_range->i_start,
+                .i_track = p_prg->i_program,
+                .i_flags = ENTRY_RANGE,
+            };
+        }
+    }
+
+    if( vlc_seekindex_Save( p_demux, p_demux->s, TS_SEEKINDEX_FORMAT,
+                            p_entries, i_entries ) == VLC_SUCCESS )
+        p_index->b_modified = false;
+    free( p_entries );
+}
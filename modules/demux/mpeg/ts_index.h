@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * ts_index.h : TS demuxer time and random access index
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifndef VLC_TS_INDEX_H
+#define VLC_TS_INDEX_H
+
+/* Minimum (scaled) time between two PCR points of a program */
+#define TS_INDEX_INTERVAL TO_SCALE_NZ(CLOCK_FREQ)
+
+typedef struct
+{
+    int64_t  i_time; /* scaled, wrap around handled against the first PCR */
+    uint64_t i_pos;  /* offset of the packet */
+} ts_index_point_t;
+
+TYPEDEF_ARRAY( ts_index_point_t, ts_index_points_t )
+
+typedef struct
+{
+    uint64_t i_start;
+    uint64_t i_end;   /* offset of the last packet */
+} ts_index_range_t;
+
+typedef struct
+{
+    uint16_t i_program;
+    ts_index_points_t points; /* PCR, sorted by time and offset */
+    ts_index_points_t raps;   /* video random access points, by PTS */
+    DECL_ARRAY( ts_index_range_t ) ranges; /* spans where all the random
+                                              access points are known */
+} ts_index_program_t;
+
+typedef struct ts_index_scan_t ts_index_scan_t;
+
+/* PCR and random access points of the programs, filled while demuxing and
+ * by a background scan of the file, used to seek straight to key frames,
+ * and saved for the next opening of the file */
+typedef struct
+{
+    vlc_mutex_t lock;
+    DECL_ARRAY( ts_index_program_t * ) programs;
+    bool b_modified;
+    ts_index_scan_t *p_scan;
+} ts_index_t;
+
+/* Elementary stream of a program for the background scan */
+typedef struct
+{
+    uint16_t     i_pid;
+    uint16_t     i_program;
+    bool         b_pcr;
+    vlc_fourcc_t i_codec;     /* video codec, 0 if not video */
+    int64_t      i_first_pcr;
+} ts_index_pid_t;
+
+void ts_index_Init( ts_index_t * );
+void ts_index_Clean( ts_index_t * );
+
+/* Adds a PCR. All the random access points between the previous PCR of the
+ * program read contiguously, if any, and this one must have been added. */
+void ts_index_AddPCR( ts_index_t *, uint16_t i_program,
+                      const ts_index_point_t *p_prev, ts_index_point_t pcr );
+void ts_index_AddRAP( ts_index_t *, uint16_t i_program, ts_index_point_t rap );
+
+bool ts_index_Bound( ts_index_t *, uint16_t i_program, int64_t i_time,
+                     uint64_t *pi_head, uint64_t *pi_tail );
+bool ts_index_FindRAP( ts_index_t *, uint16_t i_program, int64_t i_time,
+                       uint64_t *pi_pos );
+
+/* Tells if a payload unit start packet begins a video random access point,
+ * and returns its (unscaled) PTS */
+bool ts_index_IsRAP( vlc_object_t *, const uint8_t *p_pkt, size_t i_pkt,
+                     vlc_fourcc_t i_codec, int64_t *pi_pts );
+
+/* Starts indexing the file from the given offset in the background, or
+ * moves the running scan there */
+void ts_index_Scan( ts_index_t *, demux_t *, uint64_t i_pos,
+                    unsigned i_packet_size, unsigned i_header_size,
+                    const ts_index_pid_t *p_pids, size_t i_pids );
+void ts_index_StopScan( ts_index_t * );
+
+void ts_index_Load( ts_index_t *, demux_t * );
+void ts_index_Save( ts_index_t *, demux_t * );
+
+#endif
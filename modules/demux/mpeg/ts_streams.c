@@ -133,6 +133,10 @@ ts_pmt_t *ts_pmt_New( demux_t *p_demux )
 
     pmt->pcr.b_fix_done = false;
 
+    pmt->index.i_time = -1;
+    pmt->index.i_pos = 0;
+    pmt->index.i_run = 0;
+
     pmt->eit.i_event_length = 0;
     pmt->eit.i_event_start = 0;
 
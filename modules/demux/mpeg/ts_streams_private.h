@@ -73,6 +73,12 @@ struct ts_pmt_t
 
     mtime_t i_last_dts;
 
+    struct
+    {
+        int64_t  i_time; /* last PCR indexed */
+        uint64_t i_pos;
+        unsigned i_run;  /* contiguous reading it was demuxed in */
+    } index;
 };
 
 struct ts_pes_es_t
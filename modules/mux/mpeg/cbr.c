@@ -0,0 +1,347 @@
+/*****************************************************************************
+ * cbr.c: constant bitrate scheduling of transport stream packets
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include "cbr.h"
+
+#define CLOCK_27M   UINT64_C(27000000)
+#define TS_PID_NULL 0x1fff
+
+/* The slot timeline is resynchronized when a slice starts that far after it */
+#define MAX_DRIFT   (CLOCK_27M)
+
+/* The PCR applies to the byte holding the last bit of its base */
+#define PCR_BYTE    10
+
+/* Transport buffer size and packet size, in bits * 27 MHz */
+#define TB_SIZE     (512 * 8 * CLOCK_27M)
+#define TS_SIZE     (188 * 8 * CLOCK_27M)
+
+/* Packets looked at when the next one would overflow its buffer */
+#define LOOKAHEAD   32
+
+/* Fraction of the slots of a slice left to the packets held back */
+#define SLACK       16
+
+static void Advance( uint64_t *pi_value, uint64_t *pi_frac,
+                     uint64_t i_step, uint64_t i_step_frac, uint64_t i_rate )
+{
+    *pi_value += i_step;
+    *pi_frac += i_step_frac;
+    if( *pi_frac >= i_rate )
+    {
+        *pi_frac -= i_rate;
+        (*pi_value)++;
+    }
+}
+
+void ts_cbr_Init( ts_cbr_t *p_cbr, uint64_t i_rate, mtime_t i_pcr_interval )
+{
+    memset( p_cbr, 0, sizeof( *p_cbr ) );
+
+    /* Durations are (bits * 27 MHz) / rate, kept as quotient and remainder */
+    const uint64_t i_slot = 188 * 8 * CLOCK_27M;
+    const uint64_t i_pcr = PCR_BYTE * 8 * CLOCK_27M;
+
+    p_cbr->i_rate = i_rate;
+    p_cbr->i_step = i_slot / i_rate;
+    p_cbr->i_step_frac = i_slot % i_rate;
+    p_cbr->i_pcr_offset = i_pcr / i_rate;
+    p_cbr->i_pcr_offset_frac = i_pcr % i_rate;
+
+    p_cbr->i_pcr_interval = i_pcr_interval * 27;
+    p_cbr->i_pcr_pid = TS_PID_NULL;
+    p_cbr->i_pcr_cc = -1;
+}
+
+void ts_cbr_SetPCRPID( ts_cbr_t *p_cbr, uint16_t i_pid )
+{
+    if( p_cbr->i_pcr_pid != i_pid )
+    {
+        p_cbr->i_pcr_pid = i_pid;
+        p_cbr->i_pcr_cc = -1;
+    }
+}
+
+static uint16_t GetPID( const block_t *p_ts )
+{
+    return ( ( p_ts->p_buffer[1] & 0x1f ) << 8 ) | p_ts->p_buffer[2];
+}
+
+int ts_cbr_SetLeakRate( ts_cbr_t *p_cbr, uint16_t i_pid, uint64_t i_rx )
+{
+    for( unsigned i = 0; i < p_cbr->i_buffers; i++ )
+    {
+        if( p_cbr->buffers[i].i_pid != i_pid )
+            continue;
+        if( i_rx > 0 )
+            p_cbr->buffers[i].i_rx = i_rx;
+        else
+            p_cbr->buffers[i] = p_cbr->buffers[--p_cbr->i_buffers];
+        return VLC_SUCCESS;
+    }
+
+    if( i_rx == 0 )
+        return VLC_SUCCESS;
+    if( p_cbr->i_buffers >= TS_CBR_MAX_BUFFERS )
+        return VLC_EGENERIC;
+
+    ts_cbr_buffer_t *p_tb = &p_cbr->buffers[p_cbr->i_buffers++];
+    p_tb->i_pid = i_pid;
+    p_tb->i_rx = i_rx;
+    p_tb->i_level = 0;
+    p_tb->i_time = 0;
+    return VLC_SUCCESS;
+}
+
+static ts_cbr_buffer_t *FindBuffer( ts_cbr_t *p_cbr, uint16_t i_pid )
+{
+    for( unsigned i = 0; i < p_cbr->i_buffers; i++ )
+        if( p_cbr->buffers[i].i_pid == i_pid )
+            return &p_cbr->buffers[i];
+    return NULL;
+}
+
+static uint64_t BufferLevel( const ts_cbr_buffer_t *p_tb, uint64_t i_time )
+{
+    if( i_time <= p_tb->i_time )
+        return p_tb->i_level;
+
+    const uint64_t i_elapsed = i_time - p_tb->i_time;
+    if( i_elapsed > p_tb->i_level / p_tb->i_rx )
+        return 0;
+    return p_tb->i_level - i_elapsed * p_tb->i_rx;
+}
+
+/* Finds the first packet fitting in its transport buffer, while keeping
+ * the order of the packets of each PID */
+static block_t **PickPacket( ts_cbr_t *p_cbr, block_t **pp_chain )
+{
+    uint16_t pi_full[LOOKAHEAD];
+    unsigned i_full = 0;
+
+    for( unsigned i = 0; *pp_chain != NULL && i < LOOKAHEAD;
+         i++, pp_chain = &(*pp_chain)->p_next )
+    {
+        const uint16_t i_pid = GetPID( *pp_chain );
+        bool b_full = false;
+
+        for( unsigned j = 0; j < i_full && !b_full; j++ )
+            b_full = pi_full[j] == i_pid;
+        if( b_full )
+            continue;
+
+        ts_cbr_buffer_t *p_tb = FindBuffer( p_cbr, i_pid );
+        if( p_tb == NULL ||
+            BufferLevel( p_tb, p_cbr->i_clock ) + TS_SIZE <= TB_SIZE )
+            return pp_chain;
+
+        pi_full[i_full++] = i_pid;
+    }
+    return NULL;
+}
+
+/* Number of slots starting before the given time */
+static uint64_t SlotsBefore( const ts_cbr_t *p_cbr, uint64_t i_time )
+{
+    if( i_time <= p_cbr->i_clock )
+        return 0;
+
+    /* Bounded by the slice duration and MAX_DRIFT: this cannot overflow */
+    const uint64_t i_left = ( i_time - p_cbr->i_clock ) * p_cbr->i_rate
+                          - p_cbr->i_clock_frac;
+    const uint64_t i_slot = p_cbr->i_step * p_cbr->i_rate + p_cbr->i_step_frac;
+
+    return ( i_left + i_slot - 1 ) / i_slot;
+}
+
+static void SetPCR( uint8_t *p, uint64_t i_pcr )
+{
+    const uint64_t i_base = ( i_pcr / 300 ) & UINT64_C(0x1ffffffff);
+    const unsigned i_ext = i_pcr % 300;
+
+    p[6]  = i_base >> 25;
+    p[7]  = i_base >> 17;
+    p[8]  = i_base >> 9;
+    p[9]  = i_base >> 1;
+    p[10] = ( ( i_base << 7 ) & 0x80 ) | 0x7e | ( i_ext >> 8 );
+    p[11] = i_ext;
+}
+
+static block_t *NewNull( void )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( likely(p_ts) )
+    {
+        p_ts->p_buffer[0] = 0x47;
+        p_ts->p_buffer[1] = TS_PID_NULL >> 8;
+        p_ts->p_buffer[2] = TS_PID_NULL & 0xff;
+        p_ts->p_buffer[3] = 0x10;
+        memset( &p_ts->p_buffer[4], 0xff, 184 );
+    }
+    return p_ts;
+}
+
+/* Adaptation field only packet: it does not increment the counter */
+static block_t *NewPCR( uint16_t i_pid, int i_cc )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( likely(p_ts) )
+    {
+        p_ts->p_buffer[0] = 0x47;
+        p_ts->p_buffer[1] = i_pid >> 8;
+        p_ts->p_buffer[2] = i_pid & 0xff;
+        p_ts->p_buffer[3] = 0x20 | i_cc;
+        p_ts->p_buffer[4] = 183;
+        p_ts->p_buffer[5] = 0x10; /* PCR_flag */
+        memset( &p_ts->p_buffer[12], 0xff, 176 );
+        p_ts->i_flags |= BLOCK_FLAG_CLOCK;
+    }
+    return p_ts;
+}
+
+block_t *ts_cbr_Schedule( ts_cbr_t *p_cbr, block_t *p_chain,
+                          mtime_t i_start, mtime_t i_end, mtime_t i_origin )
+{
+    const uint64_t i_start27 = i_start * 27;
+    const uint64_t i_end27 = i_end * 27;
+    const uint64_t i_origin27 = i_origin * 27;
+
+    /* The clock never goes back: when the rate is too low, the data are
+     * sent later and later instead */
+    if( !p_cbr->b_started || p_cbr->i_clock + MAX_DRIFT < i_start27 )
+    {
+        if( p_cbr->b_started )
+            p_cbr->i_resyncs++;
+        p_cbr->i_clock = i_start27;
+        p_cbr->i_clock_frac = 0;
+        p_cbr->b_started = true;
+    }
+
+    uint64_t i_data = 0;
+    for( block_t *p = p_chain; p != NULL; p = p->p_next )
+        i_data++;
+
+    /* Spread the data evenly on the slots, Bresenham style, leaving some
+     * room at the end for the packets held back by full buffers */
+    uint64_t i_slots = SlotsBefore( p_cbr, i_end27 );
+    const uint64_t i_spread = __MAX( i_slots - i_slots / SLACK, i_data );
+    const uint64_t i_spread_data = i_data;
+    uint64_t i_acc = 0;
+
+    block_t *p_out = NULL, **pp_last = &p_out;
+
+    while( p_chain != NULL || i_slots > 0 )
+    {
+        block_t *p_ts;
+        bool b_data = false;
+
+        i_acc += i_spread_data;
+        if( i_acc >= i_spread )
+        {
+            i_acc -= i_spread;
+            b_data = true;
+        }
+        if( i_data > 0 && i_data >= i_slots )
+            b_data = true;
+        if( i_data == 0 )
+            b_data = false;
+
+        block_t **pp_data = NULL;
+        if( b_data )
+        {
+            pp_data = PickPacket( p_cbr, &p_chain );
+            if( pp_data == NULL )
+            {
+                i_acc += i_spread; /* try again on the next slot */
+                p_cbr->i_delayed++;
+            }
+        }
+
+        const bool b_pcr_due = p_cbr->i_pcr_cc >= 0 &&
+            ( !p_cbr->b_pcr_sent ||
+              p_cbr->i_clock >= p_cbr->i_last_pcr + p_cbr->i_pcr_interval );
+
+        if( b_pcr_due &&
+            !( pp_data != NULL && ( (*pp_data)->i_flags & BLOCK_FLAG_CLOCK ) ) )
+        {
+            p_ts = NewPCR( p_cbr->i_pcr_pid, p_cbr->i_pcr_cc );
+            if( pp_data != NULL )
+                i_acc += i_spread;
+            p_cbr->i_pcrs++;
+        }
+        else if( pp_data != NULL )
+        {
+            p_ts = *pp_data;
+            *pp_data = p_ts->p_next;
+            p_ts->p_next = NULL;
+            i_data--;
+
+            if( GetPID( p_ts ) == p_cbr->i_pcr_pid && ( p_ts->p_buffer[3] & 0x10 ) )
+                p_cbr->i_pcr_cc = p_ts->p_buffer[3] & 0x0f;
+            if( i_slots == 0 )
+                p_cbr->i_late++;
+        }
+        else
+        {
+            p_ts = NewNull();
+            p_cbr->i_nulls++;
+        }
+
+        if( likely(p_ts) )
+        {
+            ts_cbr_buffer_t *p_tb = FindBuffer( p_cbr, GetPID( p_ts ) );
+            if( p_tb != NULL )
+            {
+                p_tb->i_level = BufferLevel( p_tb, p_cbr->i_clock ) + TS_SIZE;
+                p_tb->i_time = p_cbr->i_clock;
+            }
+
+            if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+            {
+                uint64_t i_pcr = p_cbr->i_clock, i_pcr_frac = p_cbr->i_clock_frac;
+                Advance( &i_pcr, &i_pcr_frac, p_cbr->i_pcr_offset,
+                         p_cbr->i_pcr_offset_frac, p_cbr->i_rate );
+                SetPCR( p_ts->p_buffer, i_pcr - i_origin27 );
+
+                p_cbr->i_last_pcr = p_cbr->i_clock;
+                p_cbr->b_pcr_sent = true;
+            }
+            p_ts->i_dts = p_cbr->i_clock / 27;
+            p_ts->i_length = p_cbr->i_step / 27;
+
+            *pp_last = p_ts;
+            pp_last = &p_ts->p_next;
+        }
+
+        Advance( &p_cbr->i_clock, &p_cbr->i_clock_frac,
+                 p_cbr->i_step, p_cbr->i_step_frac, p_cbr->i_rate );
+        p_cbr->i_packets++;
+        if( i_slots > 0 )
+            i_slots--;
+    }
+
+    return p_out;
+}
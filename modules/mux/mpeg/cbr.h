@@ -0,0 +1,91 @@
+/*****************************************************************************
+ * cbr.h: constant bitrate scheduling of transport stream packets
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_MPEG_CBR_H_
+#define VLC_MPEG_CBR_H_
+
+/*
+ * The output is a timeline of packet slots at the mux rate. Every slot
+ * carries a data packet, a PCR only packet or a null packet, and its
+ * time is kept as an exact 27 MHz clock (integer part and remainder in
+ * 1/rate units), so that PCRs are exact whatever the stream duration.
+ */
+#define TS_CBR_MAX_BUFFERS 64
+
+/* Transport buffer of the T-STD: 512 bytes, emptied at the Rx rate */
+typedef struct
+{
+    uint16_t i_pid;
+    uint64_t i_rx;                          /* bit/s */
+    uint64_t i_level;                       /* bits * 27 MHz */
+    uint64_t i_time;                        /* 27 MHz time of i_level */
+} ts_cbr_buffer_t;
+
+typedef struct
+{
+    uint64_t i_rate;                        /* bit/s */
+
+    uint64_t i_clock;                       /* 27 MHz time of the next slot */
+    uint64_t i_clock_frac;
+    uint64_t i_step;                        /* duration of a slot */
+    uint64_t i_step_frac;
+    uint64_t i_pcr_offset;                  /* from the slot to the PCR */
+    uint64_t i_pcr_offset_frac;
+    bool     b_started;
+
+    uint64_t i_pcr_interval;                /* 27 MHz */
+    uint64_t i_last_pcr;                    /* 27 MHz time of the last PCR */
+    bool     b_pcr_sent;
+    uint16_t i_pcr_pid;
+    int      i_pcr_cc;                      /* -1 until known */
+
+    ts_cbr_buffer_t buffers[TS_CBR_MAX_BUFFERS];
+    unsigned i_buffers;
+
+    /* statistics */
+    uint64_t i_packets;
+    uint64_t i_nulls;
+    uint64_t i_pcrs;                        /* PCR only packets */
+    uint64_t i_late;                        /* data after their slice */
+    uint64_t i_delayed;                     /* held back by a full buffer */
+    unsigned i_resyncs;
+} ts_cbr_t;
+
+void ts_cbr_Init( ts_cbr_t *, uint64_t i_rate, mtime_t i_pcr_interval );
+
+/* Sets the PID where PCR only packets are inserted when PCRs are due */
+void ts_cbr_SetPCRPID( ts_cbr_t *, uint16_t i_pid );
+
+/*
+ * Limits the rate of a PID so that its transport buffer does not overflow.
+ * The packets of other PIDs are sent first when the buffer is full.
+ * A zero rate removes the limit.
+ */
+int ts_cbr_SetLeakRate( ts_cbr_t *, uint16_t i_pid, uint64_t i_rx );
+
+/*
+ * Spreads the packets of the [i_start, i_end) slice on the slots, with null
+ * packets in between, and returns the resulting chain. The packets are
+ * dated with their slot time, and the PCRs of the packets flagged with
+ * BLOCK_FLAG_CLOCK are written relative to i_origin.
+ */
+block_t *ts_cbr_Schedule( ts_cbr_t *, block_t *p_chain,
+                          mtime_t i_start, mtime_t i_end, mtime_t i_origin );
+
+#endif
@@ -28,6 +28,8 @@
 
 #include <vlc_common.h>
 
+#include <assert.h>
+
 #include "csa.h"
 
 struct csa_t
@@ -56,6 +58,29 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
 
+/* Bit-sliced stream cypher: one bit of each packet per lane of a word */
+#if defined(__GNUC__) && defined(__AVX2__)
+typedef uint64_t csa_word_t __attribute__((vector_size(32)));
+#elif defined(__GNUC__) && defined(__SSE2__)
+typedef uint64_t csa_word_t __attribute__((vector_size(16)));
+#else
+typedef uint64_t csa_word_t;
+#endif
+
+#define CSA_LANES (8 * sizeof (csa_word_t))
+
+typedef struct
+{
+    csa_word_t A[11][4];
+    csa_word_t B[11][4];
+    csa_word_t X[4], Y[4], Z[4];
+    csa_word_t D[4], E[4], F[4];
+    csa_word_t p, q, r;
+} csa_slices_t;
+
+static void csa_SlicedEncrypt( csa_t *c, uint8_t *const *pkts, unsigned i_count,
+                               int i_pkt_size );
+
 /*****************************************************************************
  * csa_New:
  *****************************************************************************/
@@ -307,6 +332,22 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_EncryptPackets:
+ *****************************************************************************/
+void csa_EncryptPackets( csa_t *c, uint8_t *const *pkts, unsigned i_count,
+                         int i_pkt_size )
+{
+    while( i_count > 0 )
+    {
+        unsigned i_lanes = __MIN( i_count, CSA_LANES );
+
+        csa_SlicedEncrypt( c, pkts, i_lanes, i_pkt_size );
+        pkts += i_lanes;
+        i_count -= i_lanes;
+    }
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -610,3 +651,268 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+/*****************************************************************************
+ * Bit-sliced stream cypher
+ *****************************************************************************
+ * Each bit of the cypher state is stored in a word whose lane L holds the
+ * state of the L-th packet, so that all packets of a batch are processed by
+ * the same boolean operations. All packets share the same control word.
+ *****************************************************************************/
+
+/* Truth tables of the low and high output bits of sbox1..7 */
+static const uint32_t sliced_sbox[7][2] =
+{
+    { 0x78C6B16C, 0x4B368771 },
+    { 0xE41B4B63, 0x58B98679 },
+    { 0xE41B1BE4, 0x69D25879 },
+    { 0x92AD994B, 0x66B492AD },
+    { 0x35E29E58, 0x9C274CF1 },
+    { 0x66D2E61A, 0x691BB46C },
+    { 0x266D9D92, 0xB38C691E },
+};
+
+static inline csa_word_t csa_Fill( unsigned bit )
+{
+    csa_word_t w = { 0 };
+    return w - (uint64_t)bit;
+}
+
+/* Evaluates one output bit of a 5 bits sbox (in[4] most significant) */
+static inline csa_word_t csa_SlicedLookup( uint32_t table,
+                                           const csa_word_t in[5] )
+{
+    csa_word_t t[16];
+
+    for( unsigned k = 0; k < 16; k++ )
+    {
+        csa_word_t lo = csa_Fill( (table >> (2 * k)) & 1 );
+        csa_word_t hi = csa_Fill( (table >> (2 * k + 1)) & 1 );
+        t[k] = lo ^ ((lo ^ hi) & in[0]);
+    }
+    for( unsigned n = 8, b = 1; n > 0; n >>= 1, b++ )
+        for( unsigned k = 0; k < n; k++ )
+            t[k] = t[2 * k] ^ ((t[2 * k] ^ t[2 * k + 1]) & in[b]);
+    return t[0];
+}
+
+static inline void csa_SlicedSbox( const uint32_t table[2], csa_word_t out[2],
+                                   csa_word_t i4, csa_word_t i3, csa_word_t i2,
+                                   csa_word_t i1, csa_word_t i0 )
+{
+    const csa_word_t in[5] = { i0, i1, i2, i3, i4 };
+
+    out[0] = csa_SlicedLookup( table[0], in );
+    out[1] = csa_SlicedLookup( table[1], in );
+}
+
+/* One clock of the stream cypher, same as an iteration of the j loop of
+ * csa_StreamCypher(). in_a and in_b are NULL once initialised. */
+static void csa_SlicedClock( csa_slices_t *s, const csa_word_t *in_a,
+                             const csa_word_t *in_b, csa_word_t out[2] )
+{
+    csa_word_t s1[2], s2[2], s3[2], s4[2], s5[2], s6[2], s7[2];
+    csa_word_t (*A)[4] = s->A, (*B)[4] = s->B;
+    csa_word_t extra_B[4], next_A1[4], next_B1[4], rot[4], sum[4];
+
+    csa_SlicedSbox( sliced_sbox[0], s1, A[4][0], A[1][2], A[6][1], A[7][3], A[9][0] );
+    csa_SlicedSbox( sliced_sbox[1], s2, A[2][1], A[3][2], A[6][3], A[7][0], A[9][1] );
+    csa_SlicedSbox( sliced_sbox[2], s3, A[1][3], A[2][0], A[5][1], A[5][3], A[6][2] );
+    csa_SlicedSbox( sliced_sbox[3], s4, A[3][3], A[1][1], A[2][3], A[4][2], A[8][0] );
+    csa_SlicedSbox( sliced_sbox[4], s5, A[5][2], A[4][3], A[6][0], A[8][1], A[9][2] );
+    csa_SlicedSbox( sliced_sbox[5], s6, A[3][1], A[4][1], A[5][0], A[7][2], A[9][3] );
+    csa_SlicedSbox( sliced_sbox[6], s7, A[2][2], A[3][0], A[7][1], A[8][2], A[8][3] );
+
+    extra_B[3] = B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3];
+    extra_B[2] = B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2];
+    extra_B[1] = B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1];
+    extra_B[0] = B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0];
+
+    for( unsigned k = 0; k < 4; k++ )
+    {
+        next_A1[k] = A[10][k] ^ s->X[k];
+        next_B1[k] = B[7][k] ^ B[10][k] ^ s->Y[k];
+        if( in_a != NULL )
+        {
+            next_A1[k] ^= s->D[k] ^ in_a[k];
+            next_B1[k] ^= in_b[k];
+        }
+    }
+
+    /* if p=1, rotate left */
+    rot[0] = next_B1[3];
+    rot[1] = next_B1[0];
+    rot[2] = next_B1[1];
+    rot[3] = next_B1[2];
+    for( unsigned k = 0; k < 4; k++ )
+        next_B1[k] ^= (next_B1[k] ^ rot[k]) & s->p;
+
+    /* T4 = sum, carry of Z + E + r, if q=1 */
+    csa_word_t carry = s->r;
+    for( unsigned k = 0; k < 4; k++ )
+    {
+        csa_word_t half = s->Z[k] ^ s->E[k];
+
+        sum[k] = half ^ carry;
+        carry = (s->Z[k] & s->E[k]) | (half & carry);
+    }
+    s->r ^= (s->r ^ carry) & s->q;
+
+    for( unsigned k = 0; k < 4; k++ )
+    {
+        /* T3 */
+        s->D[k] = s->E[k] ^ s->Z[k] ^ extra_B[k];
+
+        csa_word_t next_E = s->F[k];
+        s->F[k] = s->E[k] ^ ((s->E[k] ^ sum[k]) & s->q);
+        s->E[k] = next_E;
+    }
+
+    memmove( &A[2], &A[1], 9 * sizeof (A[1]) );
+    memmove( &B[2], &B[1], 9 * sizeof (B[1]) );
+    memcpy( A[1], next_A1, sizeof (next_A1) );
+    memcpy( B[1], next_B1, sizeof (next_B1) );
+
+    s->X[3] = s4[0]; s->X[2] = s3[0]; s->X[1] = s2[1]; s->X[0] = s1[1];
+    s->Y[3] = s6[0]; s->Y[2] = s5[0]; s->Y[1] = s4[1]; s->Y[0] = s3[1];
+    s->Z[3] = s2[0]; s->Z[2] = s1[0]; s->Z[1] = s6[1]; s->Z[0] = s5[1];
+    s->p = s7[1];
+    s->q = s7[0];
+
+    out[1] = s->D[2] ^ s->D[3];
+    out[0] = s->D[0] ^ s->D[1];
+}
+
+typedef union
+{
+    csa_word_t w;
+    uint64_t   u[sizeof (csa_word_t) / 8];
+} csa_lanes_t;
+
+static void csa_SlicedInit( csa_slices_t *s, const uint8_t ck[8],
+                            uint8_t *const *ib, unsigned i_count )
+{
+    csa_lanes_t in[8][8];
+    csa_word_t out[2];
+
+    memset( s, 0, sizeof (*s) );
+    for( unsigned i = 0; i < 4; i++ )
+        for( unsigned k = 0; k < 4; k++ )
+        {
+            s->A[1 + 2 * i][k] = csa_Fill( (ck[i] >> (4 + k)) & 1 );
+            s->A[2 + 2 * i][k] = csa_Fill( (ck[i] >> k) & 1 );
+            s->B[1 + 2 * i][k] = csa_Fill( (ck[4 + i] >> (4 + k)) & 1 );
+            s->B[2 + 2 * i][k] = csa_Fill( (ck[4 + i] >> k) & 1 );
+        }
+
+    /* Transpose the first cyphered block of each packet */
+    memset( in, 0, sizeof (in) );
+    for( unsigned l = 0; l < i_count; l++ )
+        for( unsigned i = 0; i < 8; i++ )
+            for( unsigned b = 0; b < 8; b++ )
+                in[i][b].u[l / 64] |= (uint64_t)((ib[l][i] >> b) & 1)
+                                      << (l % 64);
+
+    for( unsigned i = 0; i < 8; i++ )
+    {
+        const csa_word_t hi[4] = { in[i][4].w, in[i][5].w,
+                                   in[i][6].w, in[i][7].w };
+        const csa_word_t lo[4] = { in[i][0].w, in[i][1].w,
+                                   in[i][2].w, in[i][3].w };
+
+        for( unsigned j = 0; j < 4; j++ )
+            csa_SlicedClock( s, (j % 2) ? lo : hi, (j % 2) ? hi : lo, out );
+    }
+}
+
+static void csa_SlicedEncrypt( csa_t *c, uint8_t *const *pkts, unsigned i_count,
+                               int i_pkt_size )
+{
+    uint8_t *ck = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+    uint8_t *lanes[CSA_LANES], *ib[CSA_LANES];
+    int      blocks[CSA_LANES], residue[CSA_LANES];
+    unsigned i_lanes = 0;
+    int      i_max = 0;
+
+    assert( i_count <= CSA_LANES );
+
+    /* Block cypher, backwards and in place, one packet at a time */
+    for( unsigned l = 0; l < i_count; l++ )
+    {
+        uint8_t *pkt = pkts[l];
+        int i_hdr = 4;
+
+        /* set transport scrambling control */
+        pkt[3] |= c->use_odd ? 0xc0 : 0x80;
+        if( pkt[3]&0x20 )
+        {
+            /* skip adaption field */
+            i_hdr += pkt[4] + 1;
+        }
+
+        int n = (i_pkt_size - i_hdr) / 8;
+        if( n <= 0 )
+        {
+            pkt[3] &= 0x3f;
+            continue;
+        }
+
+        uint8_t *p = &pkt[i_hdr];
+        uint8_t block[8];
+
+        memcpy( block, &p[8 * (n - 1)], 8 );
+        csa_BlockCypher( kk, block, &p[8 * (n - 1)] );
+        for( int i = n - 1; i > 0; i-- )
+        {
+            for( int j = 0; j < 8; j++ )
+                block[j] = p[8 * (i - 1) + j] ^ p[8 * i + j];
+            csa_BlockCypher( kk, block, &p[8 * (i - 1)] );
+        }
+
+        lanes[i_lanes] = p;
+        ib[i_lanes] = p;
+        residue[i_lanes] = (i_pkt_size - i_hdr) % 8;
+        /* stream blocks to xor: all but the first block, and the residue */
+        blocks[i_lanes] = n - 1 + (residue[i_lanes] > 0);
+        i_max = __MAX( i_max, blocks[i_lanes] );
+        i_lanes++;
+    }
+
+    if( i_lanes == 0 )
+        return;
+
+    /* Stream cypher, all packets at once */
+    csa_slices_t s;
+    csa_SlicedInit( &s, ck, ib, i_lanes );
+
+    for( int k = 0; k < i_max; k++ )
+    {
+        for( int i = 0; i < 8; i++ )
+        {
+            csa_lanes_t op[8];
+
+            for( int j = 0; j < 4; j++ )
+            {
+                csa_word_t out[2];
+
+                csa_SlicedClock( &s, NULL, NULL, out );
+                op[7 - 2 * j].w = out[1];
+                op[6 - 2 * j].w = out[0];
+            }
+
+            for( unsigned l = 0; l < i_lanes; l++ )
+            {
+                if( k >= blocks[l]
+                 || (k == blocks[l] - 1 && residue[l] > 0 && i >= residue[l]) )
+                    continue;
+
+                const unsigned w = l / 64, sh = l % 64;
+                uint8_t stream = 0;
+
+                for( int b = 0; b < 8; b++ )
+                    stream |= ((op[b].u[w] >> sh) & 1) << b;
+                lanes[l][8 * (k + 1) + i] ^= stream;
+            }
+        }
+    }
+}
@@ -46,6 +46,7 @@
 #include "bits.h"
 #include "pes.h"
 #include "csa.h"
+#include "cbr.h"
 #include "tsutil.h"
 #include "streams.h"
 
@@ -144,6 +145,11 @@ static void    Close  ( vlc_object_t * );
   "PCRs (Program Clock Reference) will be sent (in milliseconds). " \
   "This value should be below 100ms. (default is 70ms).")
 
+#define MUXRATE_TEXT N_("Mux rate (bit/s)")
+#define MUXRATE_LONGTEXT N_("Output a constant bitrate " \
+  "stream at the given rate, filled with null packets, with PCRs matching " \
+  "the packet positions. 0 keeps the variable bitrate output.")
+
 #define BMIN_TEXT N_( "Minimum B (deprecated)")
 #define BMIN_LONGTEXT N_( "This setting is deprecated and not used anymore" )
 
@@ -213,6 +219,7 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "use-key-frames", false, KEYF_TEXT, KEYF_LONGTEXT, true)
 
     add_integer( SOUT_CFG_PREFIX "pcr", 70, PCR_TEXT, PCR_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
@@ -233,7 +240,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "pid-video", "pid-audio", "pid-spu", "pid-pmt", "tsid",
     "netid", "sdtdesc",
-    "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
+    "es-id-pid", "shaping", "pcr", "muxrate", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
     "muxpmt", "program-pmt", "alignment",
     NULL
@@ -366,6 +373,9 @@ struct sout_mux_sys_t
 
     mtime_t         i_pcr;  /* last PCR emited */
 
+    uint64_t        i_muxrate;  /* 0 for variable bitrate */
+    ts_cbr_t        cbr;
+
     csa_t           *csa;
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
@@ -462,6 +472,8 @@ static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
+static void TSDateCBR   ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+                          mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
@@ -710,6 +722,15 @@ static int Open( vlc_object_t *p_this )
     var_Get( p_mux, SOUT_CFG_PREFIX "dts-delay", &val );
     p_sys->i_dts_delay = val.i_int * 1000;
 
+    var_Get( p_mux, SOUT_CFG_PREFIX "muxrate", &val );
+    if( val.i_int > 0 )
+    {
+        p_sys->i_muxrate = val.i_int;
+        ts_cbr_Init( &p_sys->cbr, p_sys->i_muxrate, p_sys->i_pcr_delay );
+        msg_Dbg( p_mux, "constant bitrate at %"PRIu64" bit/s",
+                 p_sys->i_muxrate );
+    }
+
     msg_Dbg( p_mux, "shaping=%"PRId64" pcr=%"PRId64" dts_delay=%"PRId64,
              p_sys->i_shaping_delay, p_sys->i_pcr_delay, p_sys->i_dts_delay );
 
@@ -738,6 +759,12 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_dvbpsi )
         dvbpsi_delete( p_sys->p_dvbpsi );
 
+    if( p_sys->i_muxrate )
+        msg_Dbg( p_mux, "sent %"PRIu64" packets, %"PRIu64" null, %"PRIu64
+                 " PCR only, %"PRIu64" late, %"PRIu64" delayed, %u resyncs",
+                 p_sys->cbr.i_packets, p_sys->cbr.i_nulls, p_sys->cbr.i_pcrs,
+                 p_sys->cbr.i_late, p_sys->cbr.i_delayed, p_sys->cbr.i_resyncs );
+
     if( p_sys->csa )
     {
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa-ck", ChangeKeyCallback, NULL );
@@ -890,10 +917,14 @@ static void SelectPCRStream( sout_mux_t *p_mux, sout_input_t *p_removed_pcr_inpu
 
     if( p_sys->p_pcr_input )
     {
+        sout_input_sys_t *p_pcr_stream = p_sys->p_pcr_input->p_sys;
+
         /* Empty TS buffer */
         /* FIXME */
-        msg_Dbg( p_mux, "new PCR PID is %d",
-                 ((sout_input_sys_t *)p_sys->p_pcr_input->p_sys)->ts.i_pid );
+        msg_Dbg( p_mux, "new PCR PID is %d", p_pcr_stream->ts.i_pid );
+
+        if( p_sys->i_muxrate )
+            ts_cbr_SetPCRPID( &p_sys->cbr, p_pcr_stream->ts.i_pid );
     }
 
 }
@@ -1122,6 +1153,13 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
     /* Init pes chain */
     BufferChainInit( &p_stream->state.chain_pes );
 
+    /* T-STD audio transport buffers are emptied at 2 Mbit/s, video ones
+     * depend on the profile and level and are left alone */
+    if( p_sys->i_muxrate && p_input->p_fmt->i_cat == AUDIO_ES &&
+        ts_cbr_SetLeakRate( &p_sys->cbr, p_stream->ts.i_pid, 2000000 ) )
+        msg_Warn( p_mux, "too many streams to check the buffer of pid=%d",
+                  p_stream->ts.i_pid );
+
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number = ( p_sys->i_pmt_version_number + 1 )%32;
 
@@ -1159,6 +1197,9 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     /* Empty all data in chain_pes */
     BufferChainClean( &p_stream->state.chain_pes );
 
+    if( p_sys->i_muxrate )
+        ts_cbr_SetLeakRate( &p_sys->cbr, p_stream->ts.i_pid, 0 );
+
     free(p_stream->pes.lang);
     free( p_stream->pes.p_extra );
 
@@ -1607,7 +1648,10 @@ static bool MuxStreams(sout_mux_t *p_mux )
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    if( p_sys->i_muxrate )
+        TSDateCBR( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    else
+        TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
     return false;
 }
 
@@ -1795,6 +1839,32 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+/* Scrambles the packets of a chain together, all with the same key */
+static void TSScramble( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint8_t *pkts[256];
+    unsigned i_count = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( block_t *p_ts = BufferChainPeek( p_chain_ts ); p_ts != NULL;
+         p_ts = p_ts->p_next )
+    {
+        if( !(p_ts->i_flags & BLOCK_FLAG_SCRAMBLED) )
+            continue;
+
+        pkts[i_count++] = p_ts->p_buffer;
+        if( i_count == ARRAY_SIZE(pkts) )
+        {
+            csa_EncryptPackets( p_sys->csa, pkts, i_count,
+                                p_sys->i_csa_pkt_size );
+            i_count = 0;
+        }
+    }
+    csa_EncryptPackets( p_sys->csa, pkts, i_count, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
@@ -1820,6 +1890,9 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    if( p_sys->csa != NULL )
+        TSScramble( p_mux, p_chain_ts );
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
@@ -1834,17 +1907,37 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
+        /* latency */
+        p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+        sout_AccessOutWrite( p_mux->p_access, p_ts );
+    }
+}
+
+/* Places the packets on the constant bitrate timeline, with null packets
+ * and extra PCRs in between */
+static void TSDateCBR( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+                       mtime_t i_pcr_length, mtime_t i_pcr_dts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+
+    if( p_sys->csa != NULL )
+        TSScramble( p_mux, p_chain_ts );
+
+    block_t *p_ts = ts_cbr_Schedule( &p_sys->cbr, p_chain_ts->p_first,
+                                     i_pcr_dts, i_pcr_dts + i_pcr_length,
+                                     p_sys->first_dts );
+    BufferChainInit( p_chain_ts );
+    while( p_ts != NULL )
+    {
+        block_t *p_next = p_ts->p_next;
 
+        p_ts->p_next = NULL;
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
         sout_AccessOutWrite( p_mux->p_access, p_ts );
+        p_ts = p_next;
     }
 }
 
@@ -202,6 +202,7 @@ static int Open( vlc_object_t *p_this )
                      p_h264_startcode, sizeof(p_h264_startcode), startcode_FindAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
+    p_sys->packetizer.b_share = true;
 
     p_sys->b_slice = false;
     p_sys->p_frame = NULL;
@@ -328,6 +329,9 @@ static void Close( vlc_object_t *p_this )
     decoder_sys_t *p_sys = p_dec->p_sys;
     int i;
 
+    msg_Dbg( p_dec, "%"PRIu64" bytes referenced, %"PRIu64" bytes copied",
+             p_sys->packetizer.i_bytes_shared, p_sys->packetizer.i_bytes_copied );
+
     if( p_sys->p_frame )
         block_ChainRelease( p_sys->p_frame );
     for( i = 0; i < H264_SPS_ID_MAX; i++ )
@@ -599,11 +603,11 @@ static block_t *OutputPicture( decoder_t *p_dec )
         if( p_sys->p_frame )
             block_ChainAppend( &p_head, p_sys->p_frame );
 
-        p_pic = block_ChainGather( p_head );
+        p_pic = packetizer_Gather( &p_sys->packetizer, p_head );
     }
     else
     {
-        p_pic = block_ChainGather( p_sys->p_frame );
+        p_pic = packetizer_Gather( &p_sys->packetizer, p_sys->p_frame );
     }
 
     unsigned i_num_clock_ts = 2;
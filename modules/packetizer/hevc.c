@@ -176,6 +176,7 @@ static int Open(vlc_object_t *p_this)
                     p_hevc_startcode, sizeof(p_hevc_startcode), startcode_FindAnnexB,
                     p_hevc_startcode, 1, 5,
                     PacketizeReset, PacketizeParse, PacketizeValidate, p_dec);
+    p_sys->packetizer.b_share = true;
 
     /* Copy properties */
     es_format_Copy(&p_dec->fmt_out, &p_dec->fmt_in);
@@ -224,6 +225,9 @@ static void Close(vlc_object_t *p_this)
 {
     decoder_t *p_dec = (decoder_t*)p_this;
     decoder_sys_t *p_sys = p_dec->p_sys;
+
+    msg_Dbg(p_dec, "%"PRIu64" bytes referenced, %"PRIu64" bytes copied",
+            p_sys->packetizer.i_bytes_shared, p_sys->packetizer.i_bytes_copied);
     packetizer_Clean(&p_sys->packetizer);
 
     block_ChainRelease(p_sys->frame.p_chain);
@@ -601,7 +605,7 @@ static block_t * ParseNonVCL(decoder_t *p_dec, uint8_t i_nal_type, block_t *p_na
     return p_ret;
 }
 
-static block_t *GatherAndValidateChain(block_t *p_outputchain)
+static block_t *GatherAndValidateChain(decoder_sys_t *p_sys, block_t *p_outputchain)
 {
     block_t *p_output = NULL;
 
@@ -610,7 +614,7 @@ static block_t *GatherAndValidateChain(block_t *p_outputchain)
         if(p_outputchain->i_flags & BLOCK_FLAG_CORRUPTED)
             p_output = p_outputchain; /* Avoid useless gather */
         else
-            p_output = block_ChainGather(p_outputchain);
+            p_output = packetizer_Gather(&p_sys->packetizer, p_outputchain);
     }
 
     if(p_output && (p_output->i_flags & BLOCK_FLAG_CORRUPTED))
@@ -643,7 +647,7 @@ static block_t *ParseNALBlock(decoder_t *p_dec, bool *pb_ts_used, block_t *p_fra
         msg_Warn(p_dec,"Forbidden zero bit not null, corrupted NAL");
         block_Release(p_frag);
         *pb_ts_used = false;
-        return GatherAndValidateChain(OutputQueues(p_sys, false)); /* will drop */
+        return GatherAndValidateChain(p_sys, OutputQueues(p_sys, false)); /* will drop */
     }
 
     /* Get NALU type */
@@ -661,7 +665,7 @@ static block_t *ParseNALBlock(decoder_t *p_dec, bool *pb_ts_used, block_t *p_fra
         p_output = ParseNonVCL(p_dec, i_nal_type, p_frag);
     }
 
-    p_output = GatherAndValidateChain(p_output);
+    p_output = GatherAndValidateChain(p_sys, p_output);
     *pb_ts_used = (p_output != NULL);
     return p_output;
 }
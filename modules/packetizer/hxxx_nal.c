@@ -55,6 +55,11 @@ block_t *hxxx_AnnexB_to_xVC( block_t *p_block, uint8_t i_nal_length_size )
     if(!p_block->i_buffer || p_block->p_buffer[0])
         goto error;
 
+    /* Start codes are rewritten in place */
+    p_block = block_MakeWritable( p_block );
+    if( unlikely(!p_block) )
+        return NULL;
+
     if(! (p_list = malloc( sizeof(*p_list) * i_list )) )
         goto error;
 
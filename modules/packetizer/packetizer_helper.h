@@ -36,6 +36,9 @@ enum
     STATE_SEND_DATA
 };
 
+/* Fragments at least that large are referenced rather than copied */
+#define PACKETIZER_SHARE_MIN 1024
+
 typedef void (*packetizer_reset_t)( void *p_private, bool b_broken );
 typedef block_t *(*packetizer_parse_t)( void *p_private, bool *pb_ts_used, block_t * );
 typedef int (*packetizer_validate_t)( void *p_private, block_t * );
@@ -55,6 +58,10 @@ typedef struct
 
     unsigned i_au_min_size;
 
+    bool b_share;
+    uint64_t i_bytes_shared;
+    uint64_t i_bytes_copied;
+
     void *p_private;
     packetizer_reset_t    pf_reset;
     packetizer_parse_t    pf_parse;
@@ -80,6 +87,10 @@ static inline void packetizer_Init( packetizer_t *p_pack,
     p_pack->p_au_prepend = p_au_prepend;
     p_pack->i_au_min_size = i_au_min_size;
 
+    p_pack->b_share = false;
+    p_pack->i_bytes_shared = 0;
+    p_pack->i_bytes_copied = 0;
+
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
     p_pack->pf_startcode_helper = pf_start_helper;
@@ -102,6 +113,75 @@ static inline void packetizer_Flush( packetizer_t *p_pack )
     p_pack->pf_reset( p_pack->p_private, true );
 }
 
+/* Gets the next fragment, by reference when it is large enough and lies
+ * within a single block, and the block it starts in.
+ * A shared fragment loses the trailing zero bytes (leading zeros of the
+ * next startcode) that are already in the next block. */
+static inline block_t *packetizer_GetFragment( packetizer_t *p_pack,
+                                               block_t **pp_origin )
+{
+    block_bytestream_t *p_bytestream = &p_pack->bytestream;
+    const size_t i_prepend = p_pack->i_au_prepend;
+    block_t *p_frag;
+
+    *pp_origin = p_bytestream->p_block;
+
+    if( p_pack->b_share && p_pack->i_offset >= PACKETIZER_SHARE_MIN )
+    {
+        const block_t *p_block = p_bytestream->p_block;
+        const uint8_t *p_data = &p_block->p_buffer[p_bytestream->i_offset];
+        const size_t i_size = __MIN( p_pack->i_offset,
+                                     p_block->i_buffer - p_bytestream->i_offset );
+        uint8_t p_zero[4];
+        const size_t i_zero = p_pack->i_offset - i_size;
+
+        /* The bytes to prepend must already be in front of the fragment,
+         * possibly in data of the payload that was already consumed */
+        if( i_size >= PACKETIZER_SHARE_MIN && i_zero <= sizeof (p_zero) &&
+            (size_t)( p_data - p_block->p_start ) >= i_prepend &&
+            !memcmp( p_data - i_prepend, p_pack->p_au_prepend, i_prepend ) &&
+            ( i_zero == 0 ||
+              ( !block_PeekOffsetBytes( p_bytestream, i_size, p_zero, i_zero ) &&
+                !memcmp( p_zero, "\0\0\0\0", i_zero ) ) ) &&
+            ( p_frag = block_ShareBytes( p_bytestream, i_size ) ) )
+        {
+            *pp_origin = p_bytestream->p_block;
+            if( i_zero > 0 )
+                block_SkipBytes( p_bytestream, i_zero );
+            p_frag->p_buffer -= i_prepend;
+            p_frag->i_buffer += i_prepend;
+            p_frag->i_flags = 0;
+            p_frag->i_nb_samples = 0;
+            p_frag->i_length = 0;
+            p_pack->i_bytes_shared += p_frag->i_buffer;
+            return p_frag;
+        }
+    }
+
+    p_frag = block_Alloc( p_pack->i_offset + i_prepend );
+    if( unlikely( p_frag == NULL ) )
+        return NULL;
+
+    block_GetBytes( p_bytestream, &p_frag->p_buffer[i_prepend], p_pack->i_offset );
+    if( i_prepend > 0 )
+        memcpy( p_frag->p_buffer, p_pack->p_au_prepend, i_prepend );
+    p_pack->i_bytes_copied += p_frag->i_buffer;
+    return p_frag;
+}
+
+/* Gathers the fragments of an access unit, counting the copied bytes */
+static inline block_t *packetizer_Gather( packetizer_t *p_pack, block_t *p_chain )
+{
+    if( p_chain->p_next != NULL )
+    {
+        size_t i_size;
+
+        block_ChainProperties( p_chain, NULL, &i_size, NULL );
+        p_pack->i_bytes_copied += i_size;
+    }
+    return block_ChainGather( p_chain );
+}
+
 static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_block )
 {
     block_t *p_block = ( pp_block ) ? *pp_block : NULL;
@@ -178,17 +258,19 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
             block_BytestreamFlush( &p_pack->bytestream );
 
             /* Get the new fragment and set the pts/dts */
-            block_t *p_block_bytestream = p_pack->bytestream.p_block;
+            block_t *p_block_bytestream;
 
-            p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+            p_pic = packetizer_GetFragment( p_pack, &p_block_bytestream );
+            if( unlikely( p_pic == NULL ) )
+            {
+                block_SkipBytes( &p_pack->bytestream, p_pack->i_offset );
+                p_pack->i_offset = 0;
+                p_pack->i_state = STATE_NOSYNC;
+                break;
+            }
             p_pic->i_pts = p_block_bytestream->i_pts;
             p_pic->i_dts = p_block_bytestream->i_dts;
 
-            block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
-                            p_pic->i_buffer - p_pack->i_au_prepend );
-            if( p_pack->i_au_prepend > 0 )
-                memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
-
             p_pack->i_offset = 0;
 
             /* Parse the NAL */
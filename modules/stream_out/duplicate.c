@@ -264,37 +264,45 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                  block_t *p_buffer )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
-    sout_stream_t     *p_dup_stream;
     int               i_stream;
+    int               i_count = 0;
+
+    for( i_stream = 0; i_stream < p_sys->i_nb_streams; i_stream++ )
+        if( id->pp_ids[i_stream] )
+            i_count++;
+
+    if( i_count == 0 )
+    {
+        block_ChainRelease( p_buffer );
+        return VLC_SUCCESS;
+    }
 
     /* Loop through the linked list of buffers */
     while( p_buffer )
     {
         block_t *p_next = p_buffer->p_next;
+        block_t *pp_refs[i_count];
 
         p_buffer->p_next = NULL;
 
-        for( i_stream = 0; i_stream < p_sys->i_nb_streams - 1; i_stream++ )
+        /* Outputs writing to the data get their own copy of it */
+        if( i_count == 1 || block_Share( p_buffer, pp_refs, i_count ) )
         {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-
-            if( id->pp_ids[i_stream] )
-            {
-                block_t *p_dup = block_Duplicate( p_buffer );
-
-                if( p_dup )
-                    sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_dup );
-            }
+            for( int i = 0; i < i_count - 1; i++ )
+                pp_refs[i] = block_Duplicate( p_buffer );
+            pp_refs[i_count - 1] = p_buffer;
         }
 
-        if( i_stream < p_sys->i_nb_streams && id->pp_ids[i_stream] )
+        int i = 0;
+        for( i_stream = 0; i_stream < p_sys->i_nb_streams; i_stream++ )
         {
-            p_dup_stream = p_sys->pp_streams[i_stream];
-            sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_buffer );
-        }
-        else
-        {
-            block_Release( p_buffer );
+            if( id->pp_ids[i_stream] == NULL )
+                continue;
+
+            block_t *p_ref = pp_refs[i++];
+            if( p_ref != NULL )
+                sout_StreamIdSend( p_sys->pp_streams[i_stream],
+                                   id->pp_ids[i_stream], p_ref );
         }
 
         p_buffer = p_next;
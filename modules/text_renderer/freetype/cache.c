@@ -0,0 +1,195 @@
+/*****************************************************************************
+ * cache.c : LRU cache for glyphs and text layouts
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used cache with binary keys and a memory limit
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "cache.h"
+
+#define CACHE_BUCKETS 1024
+
+typedef struct cache_entry_t cache_entry_t;
+struct cache_entry_t
+{
+    cache_entry_t *p_next;      /**< Next entry in the same bucket */
+    cache_entry_t *p_newer;     /**< Towards the most recently used entry */
+    cache_entry_t *p_older;     /**< Towards the least recently used entry */
+    void          *p_value;
+    size_t         i_size;
+    uint32_t       i_hash;
+    size_t         i_key;
+    unsigned char  key[];
+};
+
+struct text_cache_t
+{
+    cache_entry_t *pp_buckets[CACHE_BUCKETS];
+    cache_entry_t *p_newest;
+    cache_entry_t *p_oldest;
+    size_t         i_size;
+    size_t         i_max_size;
+    void         (*pf_free)( void * );
+
+    uint64_t       i_hits;
+    uint64_t       i_misses;
+};
+
+static uint32_t Hash( const unsigned char *p_key, size_t i_key )
+{
+    /* FNV-1a */
+    uint32_t i_hash = 2166136261u;
+
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p_key[i] ) * 16777619u;
+    return i_hash;
+}
+
+static void Unlink( text_cache_t *p_cache, cache_entry_t *p_entry )
+{
+    if( p_entry->p_newer )
+        p_entry->p_newer->p_older = p_entry->p_older;
+    else
+        p_cache->p_newest = p_entry->p_older;
+    if( p_entry->p_older )
+        p_entry->p_older->p_newer = p_entry->p_newer;
+    else
+        p_cache->p_oldest = p_entry->p_newer;
+}
+
+static void LinkNewest( text_cache_t *p_cache, cache_entry_t *p_entry )
+{
+    p_entry->p_newer = NULL;
+    p_entry->p_older = p_cache->p_newest;
+    if( p_cache->p_newest )
+        p_cache->p_newest->p_newer = p_entry;
+    else
+        p_cache->p_oldest = p_entry;
+    p_cache->p_newest = p_entry;
+}
+
+static void Evict( text_cache_t *p_cache )
+{
+    cache_entry_t *p_entry = p_cache->p_oldest;
+    cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash % CACHE_BUCKETS];
+
+    while( *pp != p_entry )
+        pp = &(*pp)->p_next;
+    *pp = p_entry->p_next;
+
+    Unlink( p_cache, p_entry );
+    p_cache->i_size -= p_entry->i_size;
+    p_cache->pf_free( p_entry->p_value );
+    free( p_entry );
+}
+
+text_cache_t *CacheNew( size_t i_max_size, void (*pf_free)( void * ) )
+{
+    text_cache_t *p_cache = calloc( 1, sizeof( *p_cache ) );
+    if( !p_cache )
+        return NULL;
+
+    p_cache->i_max_size = i_max_size;
+    p_cache->pf_free = pf_free;
+    return p_cache;
+}
+
+void CacheDelete( text_cache_t *p_cache )
+{
+    while( p_cache->p_oldest )
+        Evict( p_cache );
+    free( p_cache );
+}
+
+void *CacheGet( text_cache_t *p_cache, const void *p_key, size_t i_key )
+{
+    const uint32_t i_hash = Hash( p_key, i_key );
+
+    for( cache_entry_t *p_entry = p_cache->pp_buckets[i_hash % CACHE_BUCKETS];
+         p_entry != NULL; p_entry = p_entry->p_next )
+    {
+        if( p_entry->i_hash != i_hash || p_entry->i_key != i_key
+         || memcmp( p_entry->key, p_key, i_key ) )
+            continue;
+
+        if( p_cache->p_newest != p_entry )
+        {
+            Unlink( p_cache, p_entry );
+            LinkNewest( p_cache, p_entry );
+        }
+        p_cache->i_hits++;
+        return p_entry->p_value;
+    }
+
+    p_cache->i_misses++;
+    return NULL;
+}
+
+void CachePut( text_cache_t *p_cache, const void *p_key, size_t i_key,
+               void *p_value, size_t i_size )
+{
+    i_size += sizeof( cache_entry_t ) + i_key;
+    if( i_size > p_cache->i_max_size )
+    {
+        p_cache->pf_free( p_value );
+        return;
+    }
+
+    cache_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key );
+    if( unlikely( !p_entry ) )
+    {
+        p_cache->pf_free( p_value );
+        return;
+    }
+
+    while( p_cache->i_size + i_size > p_cache->i_max_size )
+        Evict( p_cache );
+
+    p_entry->p_value = p_value;
+    p_entry->i_size = i_size;
+    p_entry->i_hash = Hash( p_key, i_key );
+    p_entry->i_key = i_key;
+    memcpy( p_entry->key, p_key, i_key );
+
+    cache_entry_t **pp_bucket =
+        &p_cache->pp_buckets[p_entry->i_hash % CACHE_BUCKETS];
+    p_entry->p_next = *pp_bucket;
+    *pp_bucket = p_entry;
+    LinkNewest( p_cache, p_entry );
+    p_cache->i_size += i_size;
+}
+
+void CacheGetStats( const text_cache_t *p_cache, uint64_t *pi_hits,
+                    uint64_t *pi_misses, size_t *pi_size )
+{
+    *pi_hits = p_cache->i_hits;
+    *pi_misses = p_cache->i_misses;
+    *pi_size = p_cache->i_size;
+}
+
+/** @} */
@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * cache.h : LRU cache for glyphs and text layouts
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_CACHE_H
+#define VLC_FREETYPE_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used cache with binary keys and a memory limit
+ */
+
+typedef struct text_cache_t text_cache_t;
+
+/**
+ * Creates a cache.
+ *
+ * \param i_max_size memory limit for the cached values, in bytes [IN]
+ * \param pf_free callback releasing an evicted value [IN]
+ */
+text_cache_t *CacheNew( size_t i_max_size, void (*pf_free)( void * ) );
+
+/**
+ * Releases a cache and all the values it still holds.
+ */
+void CacheDelete( text_cache_t *p_cache );
+
+/**
+ * Looks a value up, and marks it as the most recently used one.
+ *
+ * \return the value, still owned by the cache, or NULL if not found
+ */
+void *CacheGet( text_cache_t *p_cache, const void *p_key, size_t i_key );
+
+/**
+ * Inserts a value, evicting the least recently used ones if needed.
+ *
+ * The cache takes ownership of the value, and releases it at once if it
+ * does not fit. The key must not be cached already.
+ *
+ * \param i_size memory used by the value, in bytes [IN]
+ */
+void CachePut( text_cache_t *p_cache, const void *p_key, size_t i_key,
+               void *p_value, size_t i_size );
+
+/**
+ * Gets the cache statistics.
+ */
+void CacheGetStats( const text_cache_t *p_cache, uint64_t *pi_hits,
+                    uint64_t *pi_misses, size_t *pi_size );
+
+/** @} */
+
+#endif
@@ -41,6 +41,7 @@
 #include <vlc_filter.h>                                      /* filter_sys_t */
 #include <vlc_text_style.h>                                   /* text_style_t*/
 #include <vlc_charset.h>
+#include <vlc_memstream.h>
 
 /* apple stuff */
 #ifdef __APPLE__
@@ -123,6 +124,10 @@ static void Destroy( vlc_object_t * );
 static const int pi_sizes[] = { 20, 18, 16, 12, 6 };
 static const char *const ppsz_sizes_text[] = {
     N_("Smaller"), N_("Small"), N_("Normal"), N_("Large"), N_("Larger") };
+#define CACHE_TEXT N_("Cache size (kB)")
+#define CACHE_LONGTEXT N_("Memory used by each of the glyph and text " \
+  "layout caches, in kilobytes. Zero disables the caches." )
+
 #define YUVP_TEXT N_("Use YUVP renderer")
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
@@ -231,6 +236,8 @@ vlc_module_begin ()
 
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
+    add_integer( "freetype-cache-size", 4096, CACHE_TEXT,
+                 CACHE_LONGTEXT, true )
 
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
@@ -1051,6 +1058,117 @@ static uni_char_t* SegmentsToTextAndStyles( filter_t *p_filter, const text_segme
     return psz_uni;
 }
 
+typedef struct
+{
+    line_desc_t   *p_lines;
+    FT_BBox        bbox;
+    int            i_max_face_height;
+    text_style_t **pp_styles;   /* referenced by the lines */
+    size_t         i_styles;
+} cached_layout_t;
+
+static void FreeCachedLayout( void *p_data )
+{
+    cached_layout_t *p_layout = p_data;
+
+    FreeLines( p_layout->p_lines );
+    FreeStylesArray( p_layout->pp_styles, p_layout->i_styles );
+    free( p_layout );
+}
+
+static size_t BitmapSize( FT_BitmapGlyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+    return sizeof( *p_glyph )
+         + (size_t)abs( p_glyph->bitmap.pitch ) * p_glyph->bitmap.rows;
+}
+
+static size_t LinesSize( const line_desc_t *p_lines )
+{
+    size_t i_size = 0;
+
+    for( const line_desc_t *p_line = p_lines; p_line; p_line = p_line->p_next )
+    {
+        i_size += sizeof( *p_line )
+                + p_line->i_character_count * sizeof( *p_line->p_character );
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            const line_character_t *ch = &p_line->p_character[i];
+            i_size += BitmapSize( ch->p_glyph ) + BitmapSize( ch->p_outline )
+                    + BitmapSize( ch->p_shadow );
+        }
+    }
+    return i_size;
+}
+
+static void WriteStyleKey( struct vlc_memstream *p_key,
+                           const text_style_t *p_style )
+{
+#define WRITE( field ) \
+    vlc_memstream_write( p_key, &p_style->field, sizeof( p_style->field ) )
+    WRITE( i_features );
+    WRITE( i_style_flags );
+    WRITE( f_font_relsize );
+    WRITE( i_font_size );
+    WRITE( i_font_color );
+    WRITE( i_font_alpha );
+    WRITE( i_spacing );
+    WRITE( i_outline_color );
+    WRITE( i_outline_alpha );
+    WRITE( i_outline_width );
+    WRITE( i_shadow_color );
+    WRITE( i_shadow_alpha );
+    WRITE( i_shadow_width );
+    WRITE( i_background_color );
+    WRITE( i_background_alpha );
+    WRITE( i_karaoke_background_color );
+    WRITE( i_karaoke_background_alpha );
+#undef WRITE
+    /* Include the terminating nul, so that names cannot run into each other */
+    const char *psz_font = p_style->psz_fontname ? p_style->psz_fontname : "";
+    const char *psz_mono = p_style->psz_monofontname ? p_style->psz_monofontname : "";
+    vlc_memstream_write( p_key, psz_font, strlen( psz_font ) + 1 );
+    vlc_memstream_write( p_key, psz_mono, strlen( psz_mono ) + 1 );
+}
+
+/**
+ * Builds the layout cache key, from the text, its styles and
+ * every other parameter that LayoutText() depends on.
+ */
+static int LayoutKey( filter_t *p_filter, struct vlc_memstream *p_key,
+                      const uni_char_t *psz_text, text_style_t *const *pp_styles,
+                      size_t i_text_length, bool b_grid )
+{
+    const int pi_params[] = {
+        p_filter->p_sys->i_scale,
+        p_filter->fmt_out.video.i_visible_width,
+        p_filter->fmt_out.video.i_height,
+        b_grid,
+        var_InheritInteger( p_filter, "freetype-outline-thickness" ),
+#ifdef HAVE_FRIBIDI
+        var_InheritInteger( p_filter, "freetype-text-direction" ),
+#endif
+    };
+
+    if( vlc_memstream_open( p_key ) )
+        return VLC_ENOMEM;
+
+    vlc_memstream_write( p_key, pi_params, sizeof( pi_params ) );
+    for( size_t i = 0; i < i_text_length; i++ )
+    {
+        if( i > 0 && pp_styles[i] == pp_styles[i - 1] )
+            continue;
+
+        const uint32_t i_start = i;
+        vlc_memstream_write( p_key, &i_start, sizeof( i_start ) );
+        WriteStyleKey( p_key, pp_styles[i] );
+    }
+    vlc_memstream_write( p_key, psz_text, i_text_length * sizeof( *psz_text ) );
+
+    return vlc_memstream_close( p_key );
+}
+
 /**
  * This function renders a text subpicture region into another one.
  * It also calculates the size needed for this string, and renders the
@@ -1096,9 +1214,28 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
 
     uint32_t *pi_k_durations   = NULL;
 
-    rv = LayoutText( p_filter,
-                     &p_lines, &bbox, &i_max_face_height,
-                     psz_text, pp_styles, pi_k_durations, i_text_length, p_region_in->b_gridmode );
+    struct vlc_memstream key = { .ptr = NULL };
+    cached_layout_t *p_cached = NULL;
+
+    if( p_sys->p_layout_cache
+     && LayoutKey( p_filter, &key, psz_text, pp_styles, i_text_length,
+                   p_region_in->b_gridmode ) == 0 )
+        p_cached = CacheGet( p_sys->p_layout_cache, key.ptr, key.length );
+    else
+        key.ptr = NULL;
+
+    if( p_cached )
+    {
+        p_lines = p_cached->p_lines;
+        bbox = p_cached->bbox;
+        i_max_face_height = p_cached->i_max_face_height;
+    }
+    else
+        rv = LayoutText( p_filter,
+                         &p_lines, &bbox, &i_max_face_height,
+                         psz_text, pp_styles, pi_k_durations, i_text_length, p_region_in->b_gridmode );
+    const bool b_cache_hit = p_cached != NULL;
+    const bool b_layout_ok = !rv;
 
     p_region_out->i_x = p_region_in->i_x;
     p_region_out->i_y = p_region_in->i_y;
@@ -1153,10 +1290,30 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
             var_SetBool( p_filter, "text-rerender", true );
     }
 
-    FreeLines( p_lines );
+    if( b_cache_hit )
+        /* The lines belong to the cache */
+        FreeStylesArray( pp_styles, i_styles );
+    else if( b_layout_ok && key.ptr != NULL
+          && ( p_cached = malloc( sizeof( *p_cached ) ) ) != NULL )
+    {
+        /* The cache takes over the lines, and the styles they point to */
+        p_cached->p_lines = p_lines;
+        p_cached->bbox = bbox;
+        p_cached->i_max_face_height = i_max_face_height;
+        p_cached->pp_styles = pp_styles;
+        p_cached->i_styles = i_styles;
+        CachePut( p_sys->p_layout_cache, key.ptr, key.length, p_cached,
+                  sizeof( *p_cached ) + LinesSize( p_lines )
+                  + i_styles * sizeof( *pp_styles ) );
+    }
+    else
+    {
+        FreeLines( p_lines );
+        FreeStylesArray( pp_styles, i_styles );
+    }
+    free( key.ptr );
 
     free( psz_text );
-    FreeStylesArray( pp_styles, i_styles );
     free( pi_k_durations );
 
     return rv;
@@ -1205,6 +1362,15 @@ static int Create( vlc_object_t *p_this )
 
     p_sys->i_scale = 100;
 
+    /* Glyph and layout caches */
+    size_t i_cache_size = var_InheritInteger( p_filter, "freetype-cache-size" );
+    if( i_cache_size > 0 )
+    {
+        i_cache_size *= 1024;
+        p_sys->p_glyph_cache = CacheNew( i_cache_size, FreeCachedGlyph );
+        p_sys->p_layout_cache = CacheNew( i_cache_size, FreeCachedLayout );
+    }
+
     /* default style to apply to uncomplete segmeents styles */
     p_sys->p_default_style = text_style_Create( STYLE_FULLY_SET );
     if(unlikely(!p_sys->p_default_style))
@@ -1301,6 +1467,21 @@ error:
     return VLC_EGENERIC;
 }
 
+static void DeleteCache( filter_t *p_filter, text_cache_t *p_cache,
+                         const char *psz_name )
+{
+    uint64_t i_hits, i_misses;
+    size_t i_size;
+
+    if( !p_cache )
+        return;
+
+    CacheGetStats( p_cache, &i_hits, &i_misses, &i_size );
+    msg_Dbg( p_filter, "%s cache: %"PRIu64" hits, %"PRIu64" misses, "
+             "%zu bytes used", psz_name, i_hits, i_misses, i_size );
+    CacheDelete( p_cache );
+}
+
 /*****************************************************************************
  * Destroy: destroy Clone video thread output method
  *****************************************************************************
@@ -1335,6 +1516,10 @@ static void Destroy( vlc_object_t *p_this )
         free( p_sys->pp_font_attachments );
     }
 
+    /* Caches, before the faces and the library they depend on */
+    DeleteCache( p_filter, p_sys->p_glyph_cache, "glyph" );
+    DeleteCache( p_filter, p_sys->p_layout_cache, "layout" );
+
     /* Text styles */
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
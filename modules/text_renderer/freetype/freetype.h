@@ -47,6 +47,8 @@
 #include FT_GLYPH_H
 #include FT_STROKER_H
 
+#include "cache.h"
+
 /* Consistency between Freetype versions and platforms */
 #define FT_FLOOR(X)     ((X & -64) >> 6)
 #define FT_CEIL(X)      (((X + 63) & -64) >> 6)
@@ -116,6 +118,12 @@ struct filter_sys_t
     /* Current scaling of the text, default is 100 (%) */
     int               i_scale;
 
+    /** Glyph outlines and bitmaps, see text_layout.c */
+    text_cache_t     *p_glyph_cache;
+
+    /** Laid out lines, keyed by text, styles and rendering parameters */
+    text_cache_t     *p_layout_cache;
+
     /**
      * Select a font, based on the family, the styles and the codepoint
      */
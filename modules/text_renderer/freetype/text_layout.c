@@ -117,6 +117,34 @@ typedef struct run_desc_t
 
 } run_desc_t;
 
+/**
+ * Identifies a glyph in the glyph cache
+ */
+typedef struct glyph_key_t
+{
+    FT_Face   p_face;           /**< Face, which also sets the size */
+    FT_UInt   i_index;          /**< Glyph index within the face */
+    int       i_style_flags;    /**< Synthesized styles */
+    int       i_radius;         /**< Outline stroke radius, 0 if none */
+    int       i_kind;           /**< GLYPH_* kind of glyph */
+    FT_Pos    i_origin_x;       /**< Sub-pixel origin of bitmaps */
+    FT_Pos    i_origin_y;
+} glyph_key_t;
+
+enum
+{
+    GLYPH_OUTLINE_GLYPH,        /**< Loaded glyph */
+    GLYPH_OUTLINE_STROKED,      /**< Border of the loaded glyph */
+    GLYPH_BITMAP_GLYPH,         /**< Rendered glyph */
+    GLYPH_BITMAP_STROKED,       /**< Rendered border */
+};
+
+typedef struct
+{
+    FT_Glyph  p_glyph;
+    FT_Vector advance;          /**< 26.6 advance of the loaded glyph */
+} cached_glyph_t;
+
 /**
  * Glyph bitmaps. Advance and offset are 26.6 values
  */
@@ -132,6 +160,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_key_t key;            /**< Cache key, p_face is NULL if none */
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -161,6 +190,123 @@ typedef struct paragraph_t
 
 } paragraph_t;
 
+void FreeCachedGlyph( void *p_data )
+{
+    cached_glyph_t *p_cached = p_data;
+
+    FT_Done_Glyph( p_cached->p_glyph );
+    free( p_cached );
+}
+
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)p_glyph)->bitmap;
+        return sizeof( FT_BitmapGlyphRec )
+             + (size_t)abs( p_bitmap->pitch ) * p_bitmap->rows;
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &((FT_OutlineGlyph)p_glyph)->outline;
+        return sizeof( FT_OutlineGlyphRec )
+             + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+             + p_outline->n_contours * sizeof( short );
+    }
+    return sizeof( FT_GlyphRec );
+}
+
+/**
+ * Returns a copy of a cached glyph, or NULL if it is not cached
+ */
+static FT_Glyph GetCachedGlyph( filter_sys_t *p_sys, const glyph_key_t *p_key,
+                                FT_Vector *p_advance )
+{
+    if( !p_sys->p_glyph_cache || !p_key->p_face )
+        return NULL;
+
+    cached_glyph_t *p_cached = CacheGet( p_sys->p_glyph_cache,
+                                         p_key, sizeof( *p_key ) );
+    FT_Glyph p_glyph;
+
+    if( !p_cached || FT_Glyph_Copy( p_cached->p_glyph, &p_glyph ) )
+        return NULL;
+    if( p_advance )
+        *p_advance = p_cached->advance;
+    return p_glyph;
+}
+
+/**
+ * Stores a copy of a glyph in the cache
+ */
+static void CacheGlyph( filter_sys_t *p_sys, const glyph_key_t *p_key,
+                        FT_Glyph p_glyph, const FT_Vector *p_advance )
+{
+    if( !p_sys->p_glyph_cache || !p_key->p_face )
+        return;
+
+    cached_glyph_t *p_cached = malloc( sizeof( *p_cached ) );
+    if( !p_cached )
+        return;
+    if( FT_Glyph_Copy( p_glyph, &p_cached->p_glyph ) )
+    {
+        free( p_cached );
+        return;
+    }
+    if( p_advance )
+        p_cached->advance = *p_advance;
+    else
+        p_cached->advance = (FT_Vector){ 0, 0 };
+
+    CachePut( p_sys->p_glyph_cache, p_key, sizeof( *p_key ), p_cached,
+              GlyphSize( p_cached->p_glyph ) );
+}
+
+/**
+ * Renders a glyph into a bitmap glyph, as FT_Glyph_To_Bitmap() does.
+ *
+ * Bitmaps only depend on the sub-pixel part of the origin, so they are
+ * cached for that part and moved by the whole pixels.
+ */
+static FT_Error RenderGlyph( filter_sys_t *p_sys, const glyph_key_t *p_key,
+                             int i_kind, FT_Glyph *pp_glyph,
+                             const FT_Vector *p_origin, bool b_destroy )
+{
+    if( !p_sys->p_glyph_cache || !p_key->p_face )
+    {
+        FT_Vector origin = *p_origin;
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   &origin, b_destroy );
+    }
+
+    FT_Vector subpixel = { p_origin->x & 63, p_origin->y & 63 };
+    glyph_key_t key = *p_key;
+    key.i_kind = i_kind;
+    key.i_origin_x = subpixel.x;
+    key.i_origin_y = subpixel.y;
+
+    FT_Glyph p_bitmap = GetCachedGlyph( p_sys, &key, NULL );
+    if( !p_bitmap )
+    {
+        p_bitmap = *pp_glyph;
+
+        FT_Error i_error = FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                               &subpixel, 0 );
+        if( i_error )
+            return i_error;
+        CacheGlyph( p_sys, &key, p_bitmap, NULL );
+    }
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+
+    FT_BitmapGlyph p_bitmap_glyph = (FT_BitmapGlyph)p_bitmap;
+    p_bitmap_glyph->left += ( p_origin->x - subpixel.x ) / 64;
+    p_bitmap_glyph->top  += ( p_origin->y - subpixel.y ) / 64;
+    *pp_glyph = p_bitmap;
+    return 0;
+}
+
 static void FreeLine( line_desc_t *p_line )
 {
     for( int i = 0; i < p_line->i_character_count; i++ )
@@ -957,12 +1103,13 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
@@ -982,6 +1129,7 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
 
 #define SKIP_GLYPH( p_bitmaps ) \
     { \
+        p_bitmaps->key.p_face = NULL; \
         p_bitmaps->p_glyph = 0; \
         p_bitmaps->p_outline = 0; \
         p_bitmaps->p_shadow = 0; \
@@ -1019,29 +1167,55 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            glyph_key_t *p_key = &p_bitmaps->key;
+            memset( p_key, 0, sizeof( *p_key ) );
+            p_key->p_face = p_face;
+            p_key->i_index = i_glyph_index;
+            p_key->i_style_flags = p_style->i_style_flags
+                                 & ( STYLE_BOLD | STYLE_ITALIC );
+            p_key->i_radius = i_radius;
+            p_key->i_kind = GLYPH_OUTLINE_GLYPH;
+
+            FT_Vector advance;
+            p_bitmaps->p_glyph = GetCachedGlyph( p_sys, p_key, &advance );
+            if( !p_bitmaps->p_glyph )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
+
+                if( ( p_style->i_style_flags & STYLE_BOLD )
+                      && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( ( p_style->i_style_flags & STYLE_ITALIC )
+                      && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                advance = p_face->glyph->advance;
+                CacheGlyph( p_sys, p_key, p_bitmaps->p_glyph, &advance );
+            }
 
 #undef SKIP_GLYPH
 
             if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
             {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_filter->p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                glyph_key_t key = *p_key;
+                key.i_kind = GLYPH_OUTLINE_STROKED;
+
+                p_bitmaps->p_outline = GetCachedGlyph( p_sys, &key, NULL );
+                if( !p_bitmaps->p_outline )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_filter->p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                    else
+                        CacheGlyph( p_sys, &key, p_bitmaps->p_outline, NULL );
+                }
             }
 
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
@@ -1050,8 +1224,8 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
         }
 
@@ -1152,8 +1326,10 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            const int i_kind = p_bitmaps->p_shadow == p_bitmaps->p_outline
+                             ? GLYPH_BITMAP_STROKED : GLYPH_BITMAP_GLYPH;
+            if( RenderGlyph( p_sys, &p_bitmaps->key, i_kind,
+                             &p_bitmaps->p_shadow, &pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1161,8 +1337,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_sys, &p_bitmaps->key, GLYPH_BITMAP_GLYPH,
+                             &p_bitmaps->p_glyph, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1178,8 +1354,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_sys, &p_bitmaps->key, GLYPH_BITMAP_STROKED,
+                             &p_bitmaps->p_outline, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
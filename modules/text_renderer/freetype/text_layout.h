@@ -62,6 +62,11 @@ struct line_desc_t
 void FreeLines( line_desc_t *p_lines );
 line_desc_t *NewLine( int i_count );
 
+/**
+ * Releases a glyph cache entry, for use with CacheNew().
+ */
+void FreeCachedGlyph( void *p_cached );
+
 /**
  * Layout the text with shaping, bidirectional support, and font fallback if available.
  *
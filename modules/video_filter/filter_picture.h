@@ -163,3 +163,24 @@ static inline picture_t *CopyInfoAndRelease( picture_t *p_outpic, picture_t *p_i
 
     return p_outpic;
 }
+
+/*****************************************************************************
+ * Restricts the planes of a picture to the lines of a filter_RunSlices() band
+ *****************************************************************************/
+static inline void SliceView( picture_t *p_view, const picture_t *p_pic,
+                              unsigned i_slice, unsigned i_slices )
+{
+    memcpy( p_view, p_pic, sizeof( *p_view ) );
+
+    for( int i = 0; i < p_view->i_planes; i++ )
+    {
+        plane_t *p_plane = &p_view->p[i];
+        int i_first, i_last;
+
+        filter_GetSliceLines( p_plane->i_visible_lines, i_slice, i_slices,
+                              &i_first, &i_last );
+        p_plane->p_pixels += i_first * p_plane->i_pitch;
+        p_plane->i_lines -= i_first;
+        p_plane->i_visible_lines = i_last - i_first;
+    }
+}
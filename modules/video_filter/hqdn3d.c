@@ -90,6 +90,7 @@ struct filter_sys_t
 {
     const vlc_chroma_description_t *chroma;
     int w[3], h[3];
+    int wmax;
 
     struct vf_priv_s cfg;
     bool   b_recalc_coefs;
@@ -137,7 +138,9 @@ static int Open(vlc_object_t *this)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
+    /* One line of vertical low pass per band */
+    sys->wmax = wmax;
+    cfg->Line = malloc(wmax*filter_GetMaxSlices(filter)*sizeof(unsigned int));
     if (!cfg->Line) {
         free(sys);
         return VLC_ENOMEM;
@@ -191,6 +194,44 @@ static void Close(vlc_object_t *this)
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+/* The vertical low pass restarts at the top of bands of at least that many
+ * luma lines, whatever the number of slices, so that the output does not
+ * depend on the number of threads */
+#define BAND_LINES 128
+
+struct hqdn3d_pictures
+{
+    picture_t *src;
+    picture_t *dst;
+    unsigned bands;
+};
+
+static void FilterSlice(filter_t *filter, void *opaque,
+                        unsigned slice, unsigned slices)
+{
+    filter_sys_t *sys = filter->p_sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    const struct hqdn3d_pictures *pics = opaque;
+    unsigned int *line = &cfg->Line[slice * sys->wmax];
+    int band_first, band_last;
+
+    filter_GetSliceLines(pics->bands, slice, slices, &band_first, &band_last);
+
+    for (int band = band_first; band < band_last; ++band) {
+        for (int i = 0; i < 3; ++i) {
+            int *spat = cfg->Coefs[i ? 2 : 0];
+            int *temp = cfg->Coefs[i ? 3 : 1];
+            int first, last;
+
+            filter_GetSliceLines(sys->h[i], band, pics->bands, &first, &last);
+            deNoise(pics->src->p[i].p_pixels, pics->dst->p[i].p_pixels,
+                    line, cfg->Frame[i], sys->w[i], first, last,
+                    pics->src->p[i].i_pitch, pics->dst->p[i].i_pitch,
+                    spat, spat, temp);
+        }
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -220,32 +261,24 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
-    {
-        picture_Release( src );
-        picture_Release( dst );
-        return NULL;
+    for (int i = 0; i < 3; ++i) {
+        if (!cfg->Frame[i])
+            cfg->Frame[i] = deNoiseInit(src->p[i].p_pixels,
+                                        sys->w[i], sys->h[i],
+                                        src->p[i].i_pitch);
+        if (unlikely(!cfg->Frame[i])) {
+            picture_Release( src );
+            picture_Release( dst );
+            return NULL;
+        }
     }
 
+    struct hqdn3d_pictures pics = {
+        .src = src, .dst = dst,
+        .bands = __MAX(sys->h[0] / BAND_LINES, 1),
+    };
+    filter_RunSlices(filter, sys->h[0], FilterSlice, &pics);
+
     return CopyInfoAndRelease(dst, src);
 }
 
@@ -67,113 +67,79 @@ static void deNoiseTemporal(
     }
 }
 
-static void deNoiseSpacial(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
+/* Number of lines above a band used to prime the vertical low pass, since
+ * the lines of the previous band are filtered at the same time */
+#define WARMUP_LINES 16
+
+static void deNoiseSpacialLine(
+                    const unsigned char *Frame,  // line of mpi->planes[x]
                     unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+                    int W, int *Horizontal, int *Vertical, bool Top)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    /* First pixel on each line doesn't have previous pixel */
+    unsigned int PixelAnt = Frame[0]<<16;
+    LineAnt[0] = Top ? PixelAnt : LowPassMul(LineAnt[0], PixelAnt, Vertical);
 
-    /* First line has no top neighbor, only left. */
     for (long X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        /* The rest are normal, the top line has no top neighbor */
+        PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        LineAnt[X] = Top ? PixelAnt
+                         : LowPassMul(LineAnt[X], PixelAnt, Vertical);
     }
+}
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
-        }
+static unsigned short *deNoiseInit(const unsigned char *Frame,
+                                   int W, int H, int sStride)
+{
+    unsigned short *FrameAnt = malloc(W*H*sizeof(unsigned short));
+    if(!FrameAnt)
+        return NULL;
+    for (long Y = 0; Y < H; Y++){
+        unsigned short* dst=&FrameAnt[Y*W];
+        const unsigned char* src=Frame+Y*sStride;
+        for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
     }
+    return FrameAnt;
 }
 
+/* Denoises the lines [Y0, Y1[ of a plane */
 static void deNoise(unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
+                    unsigned short *FrameAnt,
+                    int W, int Y0, int Y1, int sStride, int dStride,
                     int *Horizontal, int *Vertical, int *Temporal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
-
-    if(!FrameAnt){
-        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
-        if(!FrameAnt)
-            return;
-        for (long Y = 0; Y < H; Y++){
-            unsigned short* dst=&FrameAnt[Y*W];
-            unsigned char* src=Frame+Y*sStride;
-            for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
-        }
-    }
-
     if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
-        return;
-    }
-    if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
+        deNoiseTemporal(Frame + Y0*sStride, FrameDest + Y0*dStride,
+                        FrameAnt + Y0*W,
+                        W, Y1 - Y0, sStride, dStride, Temporal);
         return;
     }
 
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    const long YTop = Y0 > WARMUP_LINES ? Y0 - WARMUP_LINES : 0;
+    for (long Y = YTop; Y < Y0; Y++)
+        deNoiseSpacialLine(Frame + Y*sStride, LineAnt,
+                           W, Horizontal, Vertical, Y == YTop);
 
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (long X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
+    for (long Y = Y0; Y < Y1; Y++){
+        unsigned char *LineDest = FrameDest + Y*dStride;
+
+        deNoiseSpacialLine(Frame + Y*sStride, LineAnt,
+                           W, Horizontal, Vertical, Y == YTop);
+
+        if(!Temporal[0]){
+            for (long X = 0; X < W; X++)
+                LineDest[X]= ((LineAnt[X]+0x10007FFF)>>16);
+            continue;
+        }
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
         unsigned short* LinePrev=&FrameAnt[Y*W];
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
+        for (long X = 0; X < W; X++){
+            unsigned int PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X],
+                                               Temporal);
             LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+            LineDest[X]= ((PixelDst+0x10007FFF)>>16);
         }
     }
 }
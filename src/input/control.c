@@ -214,7 +214,7 @@ int input_vaControl( input_thread_t *p_input, int i_query, va_list args )
             input_item_SetName( priv->p_item, psz_name );
 
             if( !priv->b_preparsing )
-                input_SendEventMetaName( p_input, psz_name );
+                input_SendEventMetaName( p_input );
             return VLC_SUCCESS;
         }
 
@@ -215,16 +215,10 @@ void input_SendEventMetaInfo( input_thread_t *p_input )
     vlc_event_send( &input_priv(p_input)->p_item->event_manager, &event );
 }
 
-void input_SendEventMetaName( input_thread_t *p_input, const char *psz_name )
+void input_SendEventMetaName( input_thread_t *p_input )
 {
+    /* The item sends vlc_InputItemNameChanged itself */
     Trigger( p_input, INPUT_EVENT_ITEM_NAME );
-
-    /* FIXME remove this ugliness */
-    vlc_event_t event;
-
-    event.type = vlc_InputItemNameChanged;
-    event.u.input_item_name_changed.new_name = psz_name;
-    vlc_event_send( &input_priv(p_input)->p_item->event_manager, &event );
 }
 
 void input_SendEventMetaEpg( input_thread_t *p_input )
@@ -343,6 +343,11 @@ void input_item_SetName( input_item_t *p_item, const char *psz_name )
     p_item->psz_name = strdup( psz_name );
 
     vlc_mutex_unlock( &p_item->lock );
+
+    vlc_event_t event;
+    event.type = vlc_InputItemNameChanged;
+    event.u.input_item_name_changed.new_name = psz_name;
+    vlc_event_send( &p_item->event_manager, &event );
 }
 
 char *input_item_GetURI( input_item_t *p_i )
@@ -0,0 +1,454 @@
+/*****************************************************************************
+ * seekindex.c: persistent seek indexes
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_seekindex.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+/* Index files directory, in the user cache directory */
+#define INDEX_DIR "seekindex"
+/* Magic for the index files, the header is little endian */
+#define INDEX_MAGIC "VLCSIDX1"
+/* Total size of the index files beyond which the oldest ones are removed,
+ * and the size they are then brought back to */
+#define INDEX_DIR_MAX_SIZE (UINT64_C(64) << 20)
+#define INDEX_DIR_LOW_SIZE (INDEX_DIR_MAX_SIZE / 4 * 3)
+
+/*
+ * File layout:
+ *  - magic,
+ *  - format tag (32 bits), file size (64 bits), modification time (64 bits),
+ *  - URL size (32 bits) and URL, to reject MD5 collisions,
+ *  - number of entries (64 bits),
+ *  - entries. Each one is the position and time deltas from the previous
+ *    entry (zigzag coded), then the size, track and flags, all as LEB128
+ *    variable length integers.
+ */
+#define INDEX_HEADER_SIZE (sizeof (INDEX_MAGIC) - 1 + 4 + 8 + 8 + 4)
+#define ENTRY_SIZE_MIN    5
+#define ENTRY_SIZE_MAX    (3 * 10 + 2 * 5)
+
+typedef struct
+{
+    char     *psz_url;
+    char     *psz_dir;
+    char     *psz_filename;
+    uint64_t  i_size;
+    int64_t   i_mtime;
+} index_file_t;
+
+static void FileClean( index_file_t *p_file )
+{
+    free( p_file->psz_url );
+    free( p_file->psz_dir );
+    free( p_file->psz_filename );
+}
+
+/* Finds where the index of a stream is stored, and the identity of the
+ * stream file */
+static int FileInit( vlc_object_t *obj, stream_t *s, index_file_t *p_file )
+{
+    if( !var_InheritBool( obj, "seek-index" ) || s->psz_url == NULL )
+        return VLC_EGENERIC;
+
+    char *psz_path = vlc_uri2path( s->psz_url );
+    if( psz_path == NULL )
+        return VLC_EGENERIC; /* not a local file */
+
+    struct stat st;
+    int i_ret = vlc_stat( psz_path, &st );
+    free( psz_path );
+    /* A filtered stream (decompression...) has its own size */
+    if( i_ret || !S_ISREG(st.st_mode)
+     || stream_Size( s ) != st.st_size )
+        return VLC_EGENERIC;
+
+    char *psz_cache = config_GetUserDir( VLC_CACHE_DIR );
+    if( unlikely(psz_cache == NULL) )
+        return VLC_ENOMEM;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, s->psz_url, strlen( s->psz_url ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    p_file->psz_url = strdup( s->psz_url );
+    if( asprintf( &p_file->psz_dir, "%s"DIR_SEP INDEX_DIR, psz_cache ) == -1 )
+        p_file->psz_dir = NULL;
+    if( psz_hash == NULL || p_file->psz_dir == NULL
+     || asprintf( &p_file->psz_filename, "%s"DIR_SEP"%s.idx",
+                  p_file->psz_dir, psz_hash ) == -1 )
+        p_file->psz_filename = NULL;
+    free( psz_hash );
+    free( psz_cache );
+
+    if( unlikely(p_file->psz_url == NULL || p_file->psz_filename == NULL) )
+    {
+        FileClean( p_file );
+        return VLC_ENOMEM;
+    }
+    p_file->i_size = st.st_size;
+    p_file->i_mtime = st.st_mtime;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Variable length integers
+ *****************************************************************************/
+static size_t PutVarint( uint8_t *p, uint64_t i_value )
+{
+    size_t i = 0;
+
+    while( i_value >= 0x80 )
+    {
+        p[i++] = 0x80 | ( i_value & 0x7f );
+        i_value >>= 7;
+    }
+    p[i++] = i_value;
+    return i;
+}
+
+static int GetVarint( const uint8_t **pp, const uint8_t *p_end,
+                      uint64_t *pi_value )
+{
+    uint64_t i_value = 0;
+
+    for( unsigned i_shift = 0; i_shift < 64; i_shift += 7 )
+    {
+        if( *pp >= p_end )
+            return -1;
+
+        uint8_t i_byte = *(*pp)++;
+        i_value |= (uint64_t)( i_byte & 0x7f ) << i_shift;
+        if( !( i_byte & 0x80 ) )
+        {
+            *pi_value = i_value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static uint64_t ZigZag( uint64_t i_delta )
+{
+    return ( i_delta << 1 ) ^ ( ( i_delta & UINT64_C(0x8000000000000000) )
+                                ? UINT64_MAX : 0 );
+}
+
+static uint64_t UnZigZag( uint64_t i_value )
+{
+    return ( i_value >> 1 ) ^ ( ( i_value & 1 ) ? UINT64_MAX : 0 );
+}
+
+/*****************************************************************************
+ * Load
+ *****************************************************************************/
+size_t (vlc_seekindex_Load)( vlc_object_t *obj, stream_t *s,
+                             vlc_fourcc_t i_format,
+                             vlc_seekindex_entry_t **pp_entries )
+{
+    index_file_t file;
+
+    *pp_entries = NULL;
+    if( FileInit( obj, s, &file ) )
+        return 0;
+
+    block_t *p_block = block_FilePath( file.psz_filename, false );
+    if( p_block == NULL )
+    {
+        FileClean( &file );
+        return 0;
+    }
+
+    const uint8_t *p = p_block->p_buffer;
+    const uint8_t *p_end = p + p_block->i_buffer;
+    const size_t i_url = strlen( file.psz_url );
+    vlc_seekindex_entry_t *p_entries = NULL;
+    uint64_t i_entries = 0;
+
+    /* Reject indexes of other files, or of older versions of this one */
+    if( p_block->i_buffer < INDEX_HEADER_SIZE + i_url + 8
+     || memcmp( p, INDEX_MAGIC, sizeof (INDEX_MAGIC) - 1 ) )
+        goto error;
+    p += sizeof (INDEX_MAGIC) - 1;
+    if( GetDWLE( p ) != i_format || GetQWLE( p + 4 ) != file.i_size
+     || (int64_t)GetQWLE( p + 12 ) != file.i_mtime
+     || GetDWLE( p + 20 ) != i_url || memcmp( p + 24, file.psz_url, i_url ) )
+        goto error;
+    p += 24 + i_url;
+
+    i_entries = GetQWLE( p );
+    p += 8;
+    if( i_entries == 0 || i_entries > (uint64_t)( p_end - p ) / ENTRY_SIZE_MIN )
+        goto error;
+
+    p_entries = malloc( i_entries * sizeof (*p_entries) );
+    if( unlikely(p_entries == NULL) )
+        goto error;
+
+    uint64_t i_pos = 0, i_time = 0;
+    for( uint64_t i = 0; i < i_entries; i++ )
+    {
+        uint64_t i_dpos, i_dtime, i_size, i_track, i_flags;
+
+        if( GetVarint( &p, p_end, &i_dpos ) || GetVarint( &p, p_end, &i_dtime )
+         || GetVarint( &p, p_end, &i_size ) || GetVarint( &p, p_end, &i_track )
+         || GetVarint( &p, p_end, &i_flags )
+         || i_track > UINT32_MAX || i_flags > UINT32_MAX )
+            goto error;
+
+        i_pos += UnZigZag( i_dpos );
+        i_time += UnZigZag( i_dtime );
+        p_entries[i].i_pos = i_pos;
+        p_entries[i].i_size = i_size;
+        p_entries[i].i_time = i_time;
+        p_entries[i].i_track = i_track;
+        p_entries[i].i_flags = i_flags;
+    }
+    if( p != p_end )
+        goto error;
+
+    msg_Dbg( obj, "loaded %"PRIu64" seek index entries", i_entries );
+    block_Release( p_block );
+    FileClean( &file );
+    *pp_entries = p_entries;
+    return i_entries;
+
+error:
+    msg_Dbg( obj, "ignoring outdated or invalid seek index %s",
+             file.psz_filename );
+    free( p_entries );
+    block_Release( p_block );
+    FileClean( &file );
+    return 0;
+}
+
+/*****************************************************************************
+ * Save
+ *****************************************************************************/
+static int Serialize( FILE *stream, const index_file_t *p_file,
+                      vlc_fourcc_t i_format,
+                      const vlc_seekindex_entry_t *p_entries,
+                      size_t i_entries )
+{
+    const size_t i_url = strlen( p_file->psz_url );
+    uint8_t header[INDEX_HEADER_SIZE - (sizeof (INDEX_MAGIC) - 1)];
+    uint8_t count[8];
+
+    SetDWLE( &header[0], i_format );
+    SetQWLE( &header[4], p_file->i_size );
+    SetQWLE( &header[12], p_file->i_mtime );
+    SetDWLE( &header[20], i_url );
+    SetQWLE( count, i_entries );
+    if( fputs( INDEX_MAGIC, stream ) == EOF
+     || fwrite( header, sizeof (header), 1, stream ) != 1
+     || fwrite( p_file->psz_url, 1, i_url, stream ) != i_url
+     || fwrite( count, sizeof (count), 1, stream ) != 1 )
+        return -1;
+
+    uint64_t i_pos = 0, i_time = 0;
+    for( size_t i = 0; i < i_entries; i++ )
+    {
+        uint8_t entry[ENTRY_SIZE_MAX];
+        size_t i_entry = 0;
+
+        i_entry += PutVarint( &entry[i_entry],
+                              ZigZag( p_entries[i].i_pos - i_pos ) );
+        i_entry += PutVarint( &entry[i_entry],
+                              ZigZag( (uint64_t)p_entries[i].i_time - i_time ) );
+        i_entry += PutVarint( &entry[i_entry], p_entries[i].i_size );
+        i_entry += PutVarint( &entry[i_entry], p_entries[i].i_track );
+        i_entry += PutVarint( &entry[i_entry], p_entries[i].i_flags );
+        if( fwrite( entry, 1, i_entry, stream ) != i_entry )
+            return -1;
+
+        i_pos = p_entries[i].i_pos;
+        i_time = p_entries[i].i_time;
+    }
+
+    return fflush( stream ) ? -1 : 0;
+}
+
+typedef struct
+{
+    char    *psz_path;
+    uint64_t i_size;
+    time_t   i_mtime;
+} index_dirent_t;
+
+static int DirentCmp( const void *a, const void *b )
+{
+    const index_dirent_t *p_a = a, *p_b = b;
+
+    return ( p_a->i_mtime > p_b->i_mtime ) - ( p_a->i_mtime < p_b->i_mtime );
+}
+
+/* Removes the least recently saved index files when they take too much
+ * space, except the one just saved */
+static void Prune( vlc_object_t *obj, const index_file_t *p_file )
+{
+    DIR *dir = vlc_opendir( p_file->psz_dir );
+    if( dir == NULL )
+        return;
+
+    index_dirent_t *p_dirents = NULL;
+    size_t i_dirents = 0, i_alloc = 0;
+    uint64_t i_total = 0;
+    const char *psz_name;
+
+    while( ( psz_name = vlc_readdir( dir ) ) != NULL )
+    {
+        const size_t i_name = strlen( psz_name );
+        char *psz_path;
+        struct stat st;
+
+        /* Temporary files are left alone, they may be in use */
+        if( i_name < 4 || strcmp( psz_name + i_name - 4, ".idx" )
+         || asprintf( &psz_path, "%s"DIR_SEP"%s", p_file->psz_dir,
+                      psz_name ) == -1 )
+            continue;
+
+        if( vlc_stat( psz_path, &st ) || !S_ISREG(st.st_mode) )
+        {
+            free( psz_path );
+            continue;
+        }
+        i_total += st.st_size;
+
+        if( !strcmp( psz_path, p_file->psz_filename ) )
+        {
+            free( psz_path );
+            continue;
+        }
+
+        if( i_dirents == i_alloc )
+        {
+            size_t i_new = i_alloc ? 2 * i_alloc : 64;
+            index_dirent_t *p_new = realloc( p_dirents,
+                                             i_new * sizeof (*p_dirents) );
+            if( unlikely(p_new == NULL) )
+            {
+                free( psz_path );
+                break;
+            }
+            p_dirents = p_new;
+            i_alloc = i_new;
+        }
+        p_dirents[i_dirents].psz_path = psz_path;
+        p_dirents[i_dirents].i_size = st.st_size;
+        p_dirents[i_dirents].i_mtime = st.st_mtime;
+        i_dirents++;
+    }
+    closedir( dir );
+
+    if( i_total > INDEX_DIR_MAX_SIZE )
+    {
+        size_t i_removed = 0;
+
+        qsort( p_dirents, i_dirents, sizeof (*p_dirents), DirentCmp );
+        for( size_t i = 0; i < i_dirents && i_total > INDEX_DIR_LOW_SIZE; i++ )
+            if( vlc_unlink( p_dirents[i].psz_path ) == 0 )
+            {
+                i_total -= p_dirents[i].i_size;
+                i_removed++;
+            }
+        msg_Dbg( obj, "removed %zu old seek indexes", i_removed );
+    }
+
+    for( size_t i = 0; i < i_dirents; i++ )
+        free( p_dirents[i].psz_path );
+    free( p_dirents );
+}
+
+int (vlc_seekindex_Save)( vlc_object_t *obj, stream_t *s,
+                          vlc_fourcc_t i_format,
+                          const vlc_seekindex_entry_t *p_entries,
+                          size_t i_entries )
+{
+    index_file_t file;
+    char *psz_tmpname;
+    int i_ret = VLC_EGENERIC;
+
+    if( i_entries == 0 || FileInit( obj, s, &file ) )
+        return VLC_EGENERIC;
+
+    if( asprintf( &psz_tmpname, "%s.%"PRIu32, file.psz_filename,
+                  (uint32_t)getpid() ) == -1 )
+    {
+        FileClean( &file );
+        return VLC_ENOMEM;
+    }
+
+    /* The cache directory itself may not exist yet */
+    char *psz_sep = strrchr( file.psz_dir, DIR_SEP_CHAR );
+    if( psz_sep != NULL )
+    {
+        *psz_sep = '\0';
+        vlc_mkdir( file.psz_dir, 0700 );
+        *psz_sep = DIR_SEP_CHAR;
+    }
+    vlc_mkdir( file.psz_dir, 0700 );
+
+    FILE *stream = vlc_fopen( psz_tmpname, "wb" );
+    if( stream == NULL )
+    {
+        msg_Warn( obj, "cannot create %s: %s", psz_tmpname,
+                  vlc_strerror_c(errno) );
+        goto out;
+    }
+
+    if( Serialize( stream, &file, i_format, p_entries, i_entries ) )
+    {
+        msg_Warn( obj, "cannot write %s: %s", psz_tmpname,
+                  vlc_strerror_c(errno) );
+        clearerr( stream );
+        fclose( stream );
+        vlc_unlink( psz_tmpname );
+        goto out;
+    }
+
+#if !defined( _WIN32 ) && !defined( __OS2__ )
+    vlc_rename( psz_tmpname, file.psz_filename ); /* atomically replace */
+    fclose( stream );
+#else
+    vlc_unlink( file.psz_filename );
+    fclose( stream );
+    vlc_rename( psz_tmpname, file.psz_filename );
+#endif
+    msg_Dbg( obj, "saved %zu seek index entries", i_entries );
+    Prune( obj, &file );
+    i_ret = VLC_SUCCESS;
+out:
+    free( psz_tmpname );
+    FileClean( &file );
+    return i_ret;
+}
@@ -643,6 +643,11 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define SEEK_INDEX_TEXT N_("Remember seek indexes")
+#define SEEK_INDEX_LONGTEXT N_( \
+    "Save the index built by scanning a local file that has a broken or " \
+    "missing index, and reuse it the next time the file is opened." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -1082,6 +1087,18 @@ static const char *const ppsz_prefres[] = {
 #define ONEINSTANCEWHENSTARTEDFROMFILE_TEXT N_( \
     "Use only one instance when started from file manager")
 
+#define BLOCK_POOL_TEXT N_("Recycle data blocks memory")
+#define BLOCK_POOL_LONGTEXT N_( \
+    "Keep the memory of released data blocks in per-thread free lists, " \
+    "instead of returning it to the system allocator. This can reduce " \
+    "the allocation overhead of high bitrate streaming and transcoding, " \
+    "at the expense of some memory usage.")
+
+#define WORKER_THREADS_TEXT N_("Worker threads")
+#define WORKER_THREADS_LONGTEXT N_( \
+    "Number of threads sharing the work of the video filters that can " \
+    "process a picture in parallel (0 = one per CPU, 1 = no parallelism).")
+
 #define HPRIORITY_TEXT N_("Increase the priority of the process")
 #define HPRIORITY_LONGTEXT N_( \
     "Increasing the priority of the process will very likely improve your " \
@@ -1115,6 +1132,19 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_TIMEOUT_LONGTEXT N_( \
     "Maximum time allowed to preparse a file" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of files preparsed at the same time." )
+
+#define PREPARSE_CACHE_TEXT N_( "Preparsing cache" )
+#define PREPARSE_CACHE_LONGTEXT N_( \
+    "Remember the meta data and tracks of local files across sessions, " \
+    "so that they are not preparsed again until they are modified." )
+
+#define PREPARSE_CACHE_SIZE_TEXT N_( "Preparsing cache size" )
+#define PREPARSE_CACHE_SIZE_LONGTEXT N_( \
+    "Maximum number of files remembered by the preparsing cache." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 #define SD_TEXT N_( "Services discovery modules")
@@ -1732,6 +1762,8 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "seek-index", true,
+              SEEK_INDEX_TEXT, SEEK_INDEX_LONGTEXT, true )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -2009,6 +2041,12 @@ vlc_module_begin ()
               HPRIORITY_LONGTEXT, false )
 #endif
 
+    add_bool( "block-pool", false, BLOCK_POOL_TEXT,
+              BLOCK_POOL_LONGTEXT, true )
+    add_integer_with_range( "worker-threads", 0, 0, 64,
+                            WORKER_THREADS_TEXT, WORKER_THREADS_LONGTEXT,
+                            true )
+
 #define CLOCK_SOURCE_TEXT N_("Clock source")
 #ifdef _WIN32
     add_string( "clock-source", NULL, CLOCK_SOURCE_TEXT, CLOCK_SOURCE_TEXT, true )
@@ -2059,6 +2097,14 @@ vlc_module_begin ()
 
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
+    add_integer_with_range( "preparse-threads", 2, 1, 32,
+                            PREPARSE_THREADS_TEXT, PREPARSE_THREADS_LONGTEXT,
+                            true )
+    add_bool( "preparse-cache", true, PREPARSE_CACHE_TEXT,
+              PREPARSE_CACHE_LONGTEXT, true )
+    add_integer_with_range( "preparse-cache-size", 10000, 1, 1000000,
+                            PREPARSE_CACHE_SIZE_TEXT,
+                            PREPARSE_CACHE_SIZE_LONGTEXT, true )
 
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
@@ -355,6 +355,9 @@ dbus_out:
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
 
+    if( var_InheritBool( p_libvlc, "block-pool" ) )
+        block_pool_Enable();
+
     /*
      * Initialize hotkey handling
      */
@@ -369,6 +372,11 @@ dbus_out:
     if( !priv->parser )
         goto error;
 
+    priv->threadpool = vlc_threadpool_New( VLC_OBJECT(p_libvlc),
+                               var_InheritInteger( p_libvlc, "worker-threads" ) );
+    if( !priv->threadpool )
+        goto error;
+
     /* Create a variable for showing the fullscreen interface */
     var_Create( p_libvlc, "intf-toggle-fscontrol", VLC_VAR_BOOL );
     var_SetBool( p_libvlc, "intf-toggle-fscontrol", true );
@@ -538,6 +546,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
 
+    if (priv->threadpool != NULL)
+        vlc_threadpool_Delete(priv->threadpool);
+
     vlc_DeinitActions( p_libvlc, priv->actions );
 
     /* Save the configuration */
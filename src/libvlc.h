@@ -48,6 +48,11 @@ size_t EnumClockSource( vlc_object_t *, const char *, char ***, char *** );
 void vlc_CPU_init(void);
 void vlc_CPU_dump(vlc_object_t *);
 
+/*
+ * Data blocks
+ */
+void block_pool_Enable(void);
+
 /*
  * Threads subsystem
  */
@@ -59,6 +64,10 @@ int vlc_set_priority( vlc_thread_t, int );
 
 void vlc_threads_setup (libvlc_int_t *);
 
+typedef struct vlc_threadpool vlc_threadpool_t;
+vlc_threadpool_t *vlc_threadpool_New(vlc_object_t *, unsigned);
+void vlc_threadpool_Delete(vlc_threadpool_t *);
+
 void vlc_trace (const char *fn, const char *file, unsigned line);
 #define vlc_backtrace() vlc_trace(__func__, __FILE__, __LINE__)
 
@@ -151,6 +160,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    vlc_threadpool_t *threadpool; ///< Worker threads for parallel jobs
 
     /* Exit callback */
     vlc_exit_t       exit;
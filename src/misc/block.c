@@ -34,6 +34,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
@@ -117,6 +119,286 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Block pool
+ *
+ * When enabled, the buffers of block_Alloc() are rounded up to a power of two
+ * size class, and recycled through per-thread free lists. Threads exchange
+ * batches of free blocks with a shared depot, so that blocks released by a
+ * consumer thread get back to the producer thread.
+ */
+#define BLOCK_POOL_MIN_SHIFT   9  /* 512 bytes */
+#define BLOCK_POOL_MAX_SHIFT  17  /* 128 KiB */
+#define BLOCK_POOL_CLASSES    (BLOCK_POOL_MAX_SHIFT - BLOCK_POOL_MIN_SHIFT + 1)
+
+/** Maximum count of free blocks per size class in a thread cache */
+#define BLOCK_POOL_CACHE_DEPTH  32
+/** Maximum count of free blocks per size class in the shared depot */
+#define BLOCK_POOL_DEPOT_DEPTH 256
+
+struct block_cache
+{
+    struct block_cache *next;
+    block_t  *head[BLOCK_POOL_CLASSES];
+    unsigned  count[BLOCK_POOL_CLASSES];
+
+    /* Statistics: only written by the owner thread, read by anyone */
+    atomic_ullong allocs;
+    atomic_ullong hits;
+    atomic_size_t held;
+};
+
+#define block_stat_add(var, n) \
+    atomic_store_explicit(var, atomic_load_explicit(var, \
+                          memory_order_relaxed) + (n), memory_order_relaxed)
+#define block_stat_sub(var, n) \
+    atomic_store_explicit(var, atomic_load_explicit(var, \
+                          memory_order_relaxed) - (n), memory_order_relaxed)
+
+static struct
+{
+    vlc_mutex_t     lock;
+    vlc_threadvar_t key;
+    atomic_bool     enabled;
+
+    /* All of the following is protected by lock */
+    struct block_cache *caches;
+
+    /* Shared depot */
+    block_t        *head[BLOCK_POOL_CLASSES];
+    unsigned        count[BLOCK_POOL_CLASSES];
+
+    /* Statistics of the exited threads */
+    uint64_t        allocs;
+    uint64_t        hits;
+} block_pool = { .lock = VLC_STATIC_MUTEX, };
+
+static inline size_t BlockPoolClassSize (unsigned cls)
+{
+    return (size_t)1 << (cls + BLOCK_POOL_MIN_SHIFT);
+}
+
+/** Returns the size class of a buffer size, or -1 if it is too large. */
+static int BlockPoolClass (size_t size)
+{
+    unsigned cls = 0;
+
+    while (BlockPoolClassSize (cls) < size)
+        if (++cls >= BLOCK_POOL_CLASSES)
+            return -1;
+    return cls;
+}
+
+/** Moves free blocks from a thread cache to the depot, down to count. */
+static void BlockCacheSpill (struct block_cache *cache, unsigned cls,
+                             unsigned count)
+{
+    block_t *excess = NULL;
+
+    block_stat_sub (&cache->held,
+                    (cache->count[cls] - count) * BlockPoolClassSize (cls));
+
+    vlc_mutex_lock (&block_pool.lock);
+    while (cache->count[cls] > count)
+    {
+        block_t *b = cache->head[cls];
+
+        cache->head[cls] = b->p_next;
+        cache->count[cls]--;
+
+        if (block_pool.count[cls] < BLOCK_POOL_DEPOT_DEPTH)
+        {
+            b->p_next = block_pool.head[cls];
+            block_pool.head[cls] = b;
+            block_pool.count[cls]++;
+        }
+        else
+        {
+            b->p_next = excess;
+            excess = b;
+        }
+    }
+    vlc_mutex_unlock (&block_pool.lock);
+
+    while (excess != NULL)
+    {
+        block_t *next = excess->p_next;
+
+        free (excess);
+        excess = next;
+    }
+}
+
+/** Moves free blocks from the depot to a thread cache. */
+static void BlockCacheRefill (struct block_cache *cache, unsigned cls)
+{
+    unsigned count = cache->count[cls];
+
+    vlc_mutex_lock (&block_pool.lock);
+    while (block_pool.count[cls] > 0
+        && cache->count[cls] < BLOCK_POOL_CACHE_DEPTH / 2)
+    {
+        block_t *b = block_pool.head[cls];
+
+        block_pool.head[cls] = b->p_next;
+        block_pool.count[cls]--;
+        b->p_next = cache->head[cls];
+        cache->head[cls] = b;
+        cache->count[cls]++;
+    }
+    vlc_mutex_unlock (&block_pool.lock);
+
+    block_stat_add (&cache->held,
+                    (cache->count[cls] - count) * BlockPoolClassSize (cls));
+}
+
+static void BlockCacheDestroy (void *data)
+{
+    struct block_cache *cache = data;
+
+    for (unsigned cls = 0; cls < BLOCK_POOL_CLASSES; cls++)
+        BlockCacheSpill (cache, cls, 0);
+
+    vlc_mutex_lock (&block_pool.lock);
+    for (struct block_cache **pp = &block_pool.caches; *pp != NULL;
+         pp = &(*pp)->next)
+        if (*pp == cache)
+        {
+            *pp = cache->next;
+            break;
+        }
+    block_pool.allocs += atomic_load_explicit (&cache->allocs,
+                                               memory_order_relaxed);
+    block_pool.hits += atomic_load_explicit (&cache->hits,
+                                             memory_order_relaxed);
+    vlc_mutex_unlock (&block_pool.lock);
+    free (cache);
+}
+
+static struct block_cache *BlockCacheGet (void)
+{
+    struct block_cache *cache = vlc_threadvar_get (block_pool.key);
+
+    if (unlikely(cache == NULL))
+    {
+        cache = calloc (1, sizeof (*cache));
+        if (unlikely(cache == NULL))
+            return NULL;
+        if (vlc_threadvar_set (block_pool.key, cache))
+        {
+            free (cache);
+            return NULL;
+        }
+
+        atomic_init (&cache->allocs, 0);
+        atomic_init (&cache->hits, 0);
+        atomic_init (&cache->held, 0);
+
+        vlc_mutex_lock (&block_pool.lock);
+        cache->next = block_pool.caches;
+        block_pool.caches = cache;
+        vlc_mutex_unlock (&block_pool.lock);
+    }
+    return cache;
+}
+
+static void block_pool_Release (block_t *block)
+{
+    /* That is always true for blocks allocated with block_Alloc(). */
+    assert (block->p_start == (unsigned char *)(block + 1));
+    block_Invalidate (block);
+
+    int cls = BlockPoolClass (block->i_size);
+    assert (cls >= 0 && block->i_size == BlockPoolClassSize (cls));
+
+    struct block_cache *cache = BlockCacheGet ();
+    if (unlikely(cache == NULL))
+    {
+        free (block);
+        return;
+    }
+
+    block->p_next = cache->head[cls];
+    cache->head[cls] = block;
+    block_stat_add (&cache->held, block->i_size);
+
+    if (++cache->count[cls] > BLOCK_POOL_CACHE_DEPTH)
+        BlockCacheSpill (cache, cls, BLOCK_POOL_CACHE_DEPTH / 2);
+}
+
+/**
+ * Gets a block with a buffer of at least the given size from the pool.
+ * @return a block, or NULL if the pool is disabled or cannot serve that size.
+ */
+static block_t *block_pool_Get (size_t size)
+{
+    if (!atomic_load_explicit (&block_pool.enabled, memory_order_acquire))
+        return NULL;
+
+    int cls = BlockPoolClass (size);
+    if (cls < 0)
+        return NULL;
+
+    struct block_cache *cache = BlockCacheGet ();
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    block_stat_add (&cache->allocs, 1);
+
+    size = BlockPoolClassSize (cls);
+    if (cache->head[cls] == NULL)
+        BlockCacheRefill (cache, cls);
+
+    block_t *b = cache->head[cls];
+    if (b != NULL)
+    {
+        cache->head[cls] = b->p_next;
+        cache->count[cls]--;
+        block_stat_add (&cache->hits, 1);
+        block_stat_sub (&cache->held, size);
+    }
+    else
+    {
+        b = malloc (sizeof (*b) + size);
+        if (unlikely(b == NULL))
+            return NULL;
+    }
+
+    block_Init (b, b + 1, size);
+    b->pf_release = block_pool_Release;
+    return b;
+}
+
+void block_pool_Enable (void)
+{
+    vlc_mutex_lock (&block_pool.lock);
+    if (!atomic_load_explicit (&block_pool.enabled, memory_order_relaxed)
+     && vlc_threadvar_create (&block_pool.key, BlockCacheDestroy) == 0)
+        atomic_store_explicit (&block_pool.enabled, true,
+                               memory_order_release);
+    vlc_mutex_unlock (&block_pool.lock);
+}
+
+void block_pool_GetStats (block_pool_stats_t *stats)
+{
+    vlc_mutex_lock (&block_pool.lock);
+    stats->allocs = block_pool.allocs;
+    stats->hits = block_pool.hits;
+    stats->held = 0;
+
+    for (unsigned cls = 0; cls < BLOCK_POOL_CLASSES; cls++)
+        stats->held += block_pool.count[cls] * BlockPoolClassSize (cls);
+
+    for (struct block_cache *c = block_pool.caches; c != NULL; c = c->next)
+    {
+        stats->allocs += atomic_load_explicit (&c->allocs,
+                                               memory_order_relaxed);
+        stats->hits += atomic_load_explicit (&c->hits, memory_order_relaxed);
+        stats->held += atomic_load_explicit (&c->held, memory_order_relaxed);
+    }
+    vlc_mutex_unlock (&block_pool.lock);
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
@@ -125,24 +407,133 @@ block_t *block_Alloc (size_t size)
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
-        return NULL;
+    block_t *b = block_pool_Get (alloc - sizeof (*b));
+    if (b == NULL)
+    {
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+
+        block_Init (b, b + 1, alloc - sizeof (*b));
+        b->pf_release = block_generic_Release;
+    }
 
-    block_Init (b, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
     return b;
 }
 
+/*
+ * Shared blocks
+ *
+ * A shared payload belongs to its original block, which is only released
+ * with the last reference. References have their own properties and may
+ * skip or trim their own view of the payload, but never write to it.
+ */
+typedef struct
+{
+    block_t    *owner; /**< Block owning the payload */
+    atomic_uint refs;
+} block_payload_t;
+
+typedef struct
+{
+    block_t          self;
+    block_payload_t *payload;
+} block_ref_t;
+
+static void block_ref_Release (block_t *block)
+{
+    block_ref_t *ref = (block_ref_t *)block;
+    block_payload_t *payload = ref->payload;
+
+    block_Invalidate (block);
+    free (ref);
+
+    if (atomic_fetch_sub_explicit (&payload->refs, 1,
+                                   memory_order_acq_rel) == 1)
+    {
+        block_Release (payload->owner);
+        free (payload);
+    }
+}
+
+static inline bool block_IsRef (const block_t *block)
+{
+    return block->pf_release == block_ref_Release;
+}
+
+/* A reference is only shared while other references to its payload exist */
+static inline bool block_IsShared (const block_t *block)
+{
+    if (!block_IsRef (block))
+        return false;
+
+    const block_payload_t *payload = ((const block_ref_t *)block)->payload;
+    return atomic_load_explicit (&payload->refs, memory_order_acquire) > 1;
+}
+
+int block_Share (block_t *block, block_t **refs, unsigned count)
+{
+    block_Check (block);
+    assert (block->p_next == NULL);
+    assert (count > 0);
+
+    block_payload_t *payload;
+    unsigned i = 0;
+
+    if (block_IsRef (block))
+    {   /* Already a reference: it is recycled as the first one */
+        payload = ((block_ref_t *)block)->payload;
+        refs[i++] = block;
+    }
+    else
+    {
+        payload = malloc (sizeof (*payload));
+        if (unlikely(payload == NULL))
+            return VLC_ENOMEM;
+        payload->owner = block;
+    }
+
+    for (unsigned j = i; j < count; j++)
+    {
+        block_ref_t *ref = malloc (sizeof (*ref));
+        if (unlikely(ref == NULL))
+        {
+            while (j > i)
+                free (refs[--j]);
+            if (i == 0)
+                free (payload);
+            return VLC_ENOMEM;
+        }
+
+        block_Init (&ref->self, block->p_start, block->i_size);
+        ref->self.p_buffer = block->p_buffer;
+        ref->self.i_buffer = block->i_buffer;
+        block_CopyProperties (&ref->self, block);
+        ref->self.pf_release = block_ref_Release;
+        ref->payload = payload;
+        refs[j] = &ref->self;
+    }
+
+    if (i == 0)
+        atomic_init (&payload->refs, count);
+    else
+        atomic_fetch_add_explicit (&payload->refs, count - 1,
+                                   memory_order_relaxed);
+    return VLC_SUCCESS;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
 
+    /* Shared payloads are read-only: the caller gets a copy to write to */
+    const bool b_shared = block_IsShared( p_block );
+
     /* Corner case: empty block requested */
     if( i_prebody <= 0 && i_body <= (size_t)(-i_prebody) )
         i_prebody = i_body = 0;
@@ -175,7 +566,7 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && (!b_shared || requested == 0) )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -200,7 +591,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || b_shared )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea == NULL )
@@ -230,6 +622,26 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     return p_block;
 }
 
+block_t *block_MakeWritable (block_t *block)
+{
+    block_Check (block);
+
+    if (!block_IsShared (block))
+        return block;
+
+    block_t *copy = block_Alloc (block->i_buffer);
+    if (unlikely(copy == NULL))
+    {
+        block_Release (block);
+        return NULL;
+    }
+
+    memcpy (copy->p_buffer, block->p_buffer, block->i_buffer);
+    BlockMetaCopy (copy, block);
+    block_Release (block);
+    return copy;
+}
+
 block_t *block_Realloc (block_t *block, ssize_t prebody, size_t body)
 {
     block_t *rea = block_TryRealloc (block, prebody, body);
@@ -30,10 +30,16 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
  * Internal state for block queues
+ *
+ * In single producer/single consumer mode, the producer pushes blocks onto
+ * a lock-free stack (in reverse order), and the consumer takes the whole
+ * stack at once into its private list (p_first). The lock and the condition
+ * variable are then only used to sleep when the queue is empty.
  */
 struct block_fifo_t
 {
@@ -42,8 +48,12 @@ struct block_fifo_t
 
     block_t             *p_first;
     block_t             **pp_last;
-    size_t              i_depth;
-    size_t              i_size;
+    atomic_size_t       i_depth;
+    atomic_size_t       i_size;
+
+    bool                b_spsc;
+    atomic_uintptr_t    p_stack;   /**< Blocks queued by the producer */
+    atomic_bool         b_waiting; /**< The consumer is sleeping */
 };
 
 void vlc_fifo_Lock(vlc_fifo_t *fifo)
@@ -78,27 +88,48 @@ int vlc_fifo_TimedWaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar, mtime_t deadli
 
 size_t vlc_fifo_GetCount(const vlc_fifo_t *fifo)
 {
-    return fifo->i_depth;
+    return atomic_load_explicit(&fifo->i_depth, memory_order_relaxed);
 }
 
 size_t vlc_fifo_GetBytes(const vlc_fifo_t *fifo)
 {
-    return fifo->i_size;
+    return atomic_load_explicit(&fifo->i_size, memory_order_relaxed);
+}
+
+static void FifoAccount(block_fifo_t *fifo, block_t *block)
+{
+    size_t depth = 0, size = 0;
+
+    for (; block != NULL; block = block->p_next)
+    {
+        depth++;
+        size += block->i_buffer;
+    }
+    atomic_fetch_add_explicit(&fifo->i_depth, depth, memory_order_relaxed);
+    atomic_fetch_add_explicit(&fifo->i_size, size, memory_order_relaxed);
+}
+
+static void FifoUnaccount(block_fifo_t *fifo, const block_t *block)
+{
+    assert(vlc_fifo_GetCount(fifo) > 0);
+    atomic_fetch_sub_explicit(&fifo->i_depth, 1, memory_order_relaxed);
+    assert(vlc_fifo_GetBytes(fifo) >= block->i_buffer);
+    atomic_fetch_sub_explicit(&fifo->i_size, block->i_buffer,
+                              memory_order_relaxed);
 }
 
 void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
 {
     vlc_assert_locked(&fifo->lock);
+    assert(!fifo->b_spsc);
     assert(*(fifo->pp_last) == NULL);
 
     *(fifo->pp_last) = block;
+    FifoAccount(fifo, block);
 
     while (block != NULL)
     {
         fifo->pp_last = &block->p_next;
-        fifo->i_depth++;
-        fifo->i_size += block->i_buffer;
-
         block = block->p_next;
     }
 
@@ -108,6 +139,7 @@ void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
 block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
+    assert(!fifo->b_spsc);
 
     block_t *block = fifo->p_first;
 
@@ -119,29 +151,79 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
         fifo->pp_last = &fifo->p_first;
     block->p_next = NULL;
 
-    assert(fifo->i_depth > 0);
-    fifo->i_depth--;
-    assert(fifo->i_size >= block->i_buffer);
-    fifo->i_size -= block->i_buffer;
-
+    FifoUnaccount(fifo, block);
     return block;
 }
 
 block_t *vlc_fifo_DequeueAllUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
+    assert(!fifo->b_spsc);
 
     block_t *block = fifo->p_first;
 
     fifo->p_first = NULL;
     fifo->pp_last = &fifo->p_first;
-    fifo->i_depth = 0;
-    fifo->i_size = 0;
+    atomic_store_explicit(&fifo->i_depth, 0, memory_order_relaxed);
+    atomic_store_explicit(&fifo->i_size, 0, memory_order_relaxed);
 
     return block;
 }
 
-block_fifo_t *block_FifoNew( void )
+/**
+ * Moves the blocks pushed by the producer to the consumer list
+ * (single producer/single consumer mode only).
+ * @return true if the consumer list is not empty
+ */
+static bool FifoCollect(block_fifo_t *fifo)
+{
+    block_t *stack = (block_t *)atomic_exchange(&fifo->p_stack, 0);
+
+    if (stack != NULL)
+    {   /* Reverse the stack back to queue order */
+        block_t *list = NULL;
+        block_t **pp_last = &stack->p_next;
+
+        while (stack != NULL)
+        {
+            block_t *next = stack->p_next;
+
+            stack->p_next = list;
+            list = stack;
+            stack = next;
+        }
+        *(fifo->pp_last) = list;
+        fifo->pp_last = pp_last;
+    }
+    return fifo->p_first != NULL;
+}
+
+static block_t *FifoPop(block_fifo_t *fifo)
+{
+    block_t *block = fifo->p_first;
+
+    assert(block != NULL);
+    fifo->p_first = block->p_next;
+    if (block->p_next == NULL)
+        fifo->pp_last = &fifo->p_first;
+    block->p_next = NULL;
+
+    FifoUnaccount(fifo, block);
+    return block;
+}
+
+/** Count of polls of an empty queue before sleeping */
+#define FIFO_SPIN 1000
+
+static void FifoWaiting(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    atomic_store(&fifo->b_waiting, false);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+static block_fifo_t *FifoNew(bool spsc)
 {
     block_fifo_t *p_fifo = malloc( sizeof( block_fifo_t ) );
     if( !p_fifo )
@@ -151,13 +233,29 @@ block_fifo_t *block_FifoNew( void )
     vlc_cond_init( &p_fifo->wait );
     p_fifo->p_first = NULL;
     p_fifo->pp_last = &p_fifo->p_first;
-    p_fifo->i_depth = p_fifo->i_size = 0;
+    atomic_init( &p_fifo->i_depth, 0 );
+    atomic_init( &p_fifo->i_size, 0 );
+    p_fifo->b_spsc = spsc;
+    atomic_init( &p_fifo->p_stack, 0 );
+    atomic_init( &p_fifo->b_waiting, false );
 
     return p_fifo;
 }
 
+block_fifo_t *block_FifoNew( void )
+{
+    return FifoNew( false );
+}
+
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    return FifoNew( true );
+}
+
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
+    if( p_fifo->b_spsc )
+        FifoCollect( p_fifo );
     block_ChainRelease( p_fifo->p_first );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
@@ -168,6 +266,14 @@ void block_FifoEmpty(block_fifo_t *fifo)
 {
     block_t *block;
 
+    if (fifo->b_spsc)
+    {
+        FifoCollect(fifo);
+        while (fifo->p_first != NULL)
+            block_Release(FifoPop(fifo));
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     block = vlc_fifo_DequeueAllUnlocked(fifo);
     vlc_fifo_Unlock(fifo);
@@ -176,6 +282,41 @@ void block_FifoEmpty(block_fifo_t *fifo)
 
 void block_FifoPut(block_fifo_t *fifo, block_t *block)
 {
+    if (fifo->b_spsc)
+    {
+        if (block == NULL)
+            return;
+
+        /* Account before publishing, so the counters never underflow */
+        FifoAccount(fifo, block);
+
+        /* Reverse the chain, and push it onto the stack as a whole */
+        block_t *last = block, *list = NULL;
+        while (block != NULL)
+        {
+            block_t *next = block->p_next;
+
+            block->p_next = list;
+            list = block;
+            block = next;
+        }
+
+        uintptr_t stack = atomic_load_explicit(&fifo->p_stack,
+                                               memory_order_relaxed);
+        do
+            last->p_next = (block_t *)stack;
+        while (!atomic_compare_exchange_weak(&fifo->p_stack, &stack,
+                                             (uintptr_t)list));
+
+        if (atomic_load(&fifo->b_waiting))
+        {
+            vlc_mutex_lock(&fifo->lock);
+            vlc_cond_signal(&fifo->wait);
+            vlc_mutex_unlock(&fifo->lock);
+        }
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     vlc_fifo_QueueUnlocked(fifo, block);
     vlc_fifo_Unlock(fifo);
@@ -187,6 +328,26 @@ block_t *block_FifoGet(block_fifo_t *fifo)
 
     vlc_testcancel();
 
+    if (fifo->b_spsc)
+    {
+        /* Spin a little, as sleeping costs much more than queuing */
+        for (unsigned i = 0; fifo->p_first == NULL && i < FIFO_SPIN; i++)
+            if (atomic_load_explicit(&fifo->p_stack, memory_order_relaxed))
+                FifoCollect(fifo);
+
+        if (fifo->p_first == NULL && !FifoCollect(fifo))
+        {   /* Empty queue: sleep until the producer pushes something */
+            vlc_mutex_lock(&fifo->lock);
+            atomic_store(&fifo->b_waiting, true);
+            vlc_cleanup_push(FifoWaiting, fifo);
+            while (!FifoCollect(fifo))
+                vlc_cond_wait(&fifo->wait, &fifo->lock);
+            vlc_cleanup_pop();
+            FifoWaiting(fifo);
+        }
+        return FifoPop(fifo);
+    }
+
     vlc_fifo_Lock(fifo);
     while (vlc_fifo_IsEmpty(fifo))
     {
@@ -204,6 +365,13 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 {
     block_t *b;
 
+    if( p_fifo->b_spsc )
+    {
+        FifoCollect( p_fifo );
+        assert(p_fifo->p_first != NULL);
+        return p_fifo->p_first;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     assert(p_fifo->p_first != NULL);
     b = p_fifo->p_first;
@@ -215,21 +383,11 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 /* FIXME: not (really) thread-safe */
 size_t block_FifoSize (block_fifo_t *fifo)
 {
-    size_t size;
-
-    vlc_mutex_lock (&fifo->lock);
-    size = fifo->i_size;
-    vlc_mutex_unlock (&fifo->lock);
-    return size;
+    return vlc_fifo_GetBytes (fifo);
 }
 
 /* FIXME: not (really) thread-safe */
 size_t block_FifoCount (block_fifo_t *fifo)
 {
-    size_t depth;
-
-    vlc_mutex_lock (&fifo->lock);
-    depth = fifo->i_depth;
-    vlc_mutex_unlock (&fifo->lock);
-    return depth;
+    return vlc_fifo_GetCount (fifo);
 }
@@ -111,6 +111,44 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+struct filter_slices
+{
+    filter_t *p_filter;
+    void (*pf_slice)( filter_t *, void *, unsigned, unsigned );
+    void *opaque;
+    unsigned i_slices;
+};
+
+static void FilterSlice( void *data, unsigned i_slice )
+{
+    struct filter_slices *p_slices = data;
+
+    p_slices->pf_slice( p_slices->p_filter, p_slices->opaque,
+                        i_slice, p_slices->i_slices );
+}
+
+void filter_RunSlices( filter_t *p_filter, int i_lines,
+                       void (*pf_slice)( filter_t *, void *,
+                                         unsigned, unsigned ),
+                       void *opaque )
+{
+    /* Smaller bands are not worth the synchronization */
+    unsigned i_slices = filter_GetMaxSlices( p_filter );
+    if( i_slices > (unsigned)i_lines / 16 )
+        i_slices = i_lines / 16;
+    if( i_slices <= 1 )
+    {
+        pf_slice( p_filter, opaque, 0, 1 );
+        return;
+    }
+
+    struct filter_slices slices = {
+        .p_filter = p_filter, .pf_slice = pf_slice, .opaque = opaque,
+        .i_slices = i_slices,
+    };
+    vlc_threadpool_Run( p_filter, i_slices, FilterSlice, &slices );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
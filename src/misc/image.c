@@ -36,6 +36,7 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_codec.h>
@@ -70,6 +71,13 @@ static filter_t *CreateFilter( vlc_object_t *, es_format_t *,
                                video_format_t * );
 static void DeleteFilter( filter_t * );
 
+static decoder_t *FetchDecoder( image_handler_t *, vlc_fourcc_t );
+static encoder_t *FetchEncoder( image_handler_t *, const video_format_t * );
+static filter_t *FetchFilter( image_handler_t *, vlc_fourcc_t, vlc_fourcc_t );
+static void ReleaseDecoder( image_handler_t * );
+static void ReleaseEncoder( image_handler_t * );
+static void ReleaseFilter( image_handler_t * );
+
 vlc_fourcc_t image_Type2Fourcc( const char * );
 vlc_fourcc_t image_Ext2Fourcc( const char * );
 /*static const char *Fourcc2Ext( vlc_fourcc_t );*/
@@ -96,6 +104,37 @@ image_handler_t *image_HandlerCreate( vlc_object_t *p_this )
     return p_image;
 }
 
+/* Number of idle instances of each kind kept by a persistent handler */
+#define IMAGE_CACHE_SIZE 8
+
+struct image_cache_t
+{
+    /* Most recently used first */
+    vlc_object_t *pp_dec[IMAGE_CACHE_SIZE];
+    vlc_object_t *pp_enc[IMAGE_CACHE_SIZE];
+    vlc_object_t *pp_filter[IMAGE_CACHE_SIZE];
+};
+
+#undef image_HandlerCreatePersistent
+/**
+ * Create a persistent image_handler_t instance
+ *
+ */
+image_handler_t *image_HandlerCreatePersistent( vlc_object_t *p_this )
+{
+    image_handler_t *p_image = image_HandlerCreate( p_this );
+    if( !p_image )
+        return NULL;
+
+    p_image->p_cache = calloc( 1, sizeof(*p_image->p_cache) );
+    if( !p_image->p_cache )
+    {
+        free( p_image );
+        return NULL;
+    }
+    return p_image;
+}
+
 /**
  * Delete the image_handler_t instance
  *
@@ -108,6 +147,21 @@ void image_HandlerDelete( image_handler_t *p_image )
     if( p_image->p_enc ) DeleteEncoder( p_image->p_enc );
     if( p_image->p_filter ) DeleteFilter( p_image->p_filter );
 
+    struct image_cache_t *p_cache = p_image->p_cache;
+    if( p_cache )
+    {
+        for( unsigned i = 0; i < IMAGE_CACHE_SIZE; i++ )
+        {
+            if( p_cache->pp_dec[i] )
+                DeleteDecoder( (decoder_t *)p_cache->pp_dec[i] );
+            if( p_cache->pp_enc[i] )
+                DeleteEncoder( (encoder_t *)p_cache->pp_enc[i] );
+            if( p_cache->pp_filter[i] )
+                DeleteFilter( (filter_t *)p_cache->pp_filter[i] );
+        }
+        free( p_cache );
+    }
+
     free( p_image );
     p_image = NULL;
 }
@@ -126,12 +180,11 @@ static picture_t *ImageRead( image_handler_t *p_image, block_t *p_block,
     /* Check if we can reuse the current decoder */
     if( p_image->p_dec &&
         p_image->p_dec->fmt_in.i_codec != p_fmt_in->i_chroma )
-    {
-        DeleteDecoder( p_image->p_dec );
-        p_image->p_dec = 0;
-    }
+        ReleaseDecoder( p_image );
 
     /* Start a decoder */
+    if( !p_image->p_dec )
+        p_image->p_dec = FetchDecoder( p_image, p_fmt_in->i_chroma );
     if( !p_image->p_dec )
     {
         p_image->p_dec = CreateDecoder( p_image->p_parent, p_fmt_in );
@@ -192,11 +245,14 @@ static picture_t *ImageRead( image_handler_t *p_image, block_t *p_block,
             p_image->p_filter->fmt_out.video.i_chroma != p_fmt_out->i_chroma )
         {
             /* We need to restart a new filter */
-            DeleteFilter( p_image->p_filter );
-            p_image->p_filter = 0;
+            ReleaseFilter( p_image );
         }
 
         /* Start a filter */
+        if( !p_image->p_filter )
+            p_image->p_filter =
+                FetchFilter( p_image, p_image->p_dec->fmt_out.video.i_chroma,
+                             p_fmt_out->i_chroma );
         if( !p_image->p_filter )
         {
             p_image->p_filter =
@@ -295,12 +351,11 @@ static block_t *ImageWrite( image_handler_t *p_image, picture_t *p_pic,
         ( p_image->p_enc->fmt_out.i_codec != p_fmt_out->i_chroma ||
           p_image->p_enc->fmt_out.video.i_width != p_fmt_out->i_width ||
           p_image->p_enc->fmt_out.video.i_height != p_fmt_out->i_height ) )
-    {
-        DeleteEncoder( p_image->p_enc );
-        p_image->p_enc = 0;
-    }
+        ReleaseEncoder( p_image );
 
     /* Start an encoder */
+    if( !p_image->p_enc )
+        p_image->p_enc = FetchEncoder( p_image, p_fmt_out );
     if( !p_image->p_enc )
     {
         p_image->p_enc = CreateEncoder( p_image->p_parent,
@@ -321,11 +376,14 @@ static block_t *ImageWrite( image_handler_t *p_image, picture_t *p_pic,
             p_image->p_enc->fmt_in.video.i_chroma )
         {
             /* We need to restart a new filter */
-            DeleteFilter( p_image->p_filter );
-            p_image->p_filter = 0;
+            ReleaseFilter( p_image );
         }
 
         /* Start a filter */
+        if( !p_image->p_filter )
+            p_image->p_filter =
+                FetchFilter( p_image, p_fmt_in->i_chroma,
+                             p_image->p_enc->fmt_in.video.i_chroma );
         if( !p_image->p_filter )
         {
             es_format_t fmt_in;
@@ -345,7 +403,7 @@ static block_t *ImageWrite( image_handler_t *p_image, picture_t *p_pic,
         {
             /* Filters should handle on-the-fly size changes */
             p_image->p_filter->fmt_in.i_codec = p_fmt_in->i_chroma;
-            p_image->p_filter->fmt_out.video = *p_fmt_in;
+            p_image->p_filter->fmt_in.video = *p_fmt_in;
             p_image->p_filter->fmt_out.i_codec =p_image->p_enc->fmt_in.i_codec;
             p_image->p_filter->fmt_out.video = p_image->p_enc->fmt_in.video;
         }
@@ -458,11 +516,13 @@ static picture_t *ImageConvert( image_handler_t *p_image, picture_t *p_pic,
         p_image->p_filter->fmt_out.video.i_chroma != p_fmt_out->i_chroma )
     {
         /* We need to restart a new filter */
-        DeleteFilter( p_image->p_filter );
-        p_image->p_filter = NULL;
+        ReleaseFilter( p_image );
     }
 
     /* Start a filter */
+    if( !p_image->p_filter )
+        p_image->p_filter =
+            FetchFilter( p_image, p_fmt_in->i_chroma, p_fmt_out->i_chroma );
     if( !p_image->p_filter )
     {
         es_format_t fmt_in;
@@ -761,3 +821,206 @@ static void DeleteFilter( filter_t * p_filter )
 
     vlc_object_release( p_filter );
 }
+
+/**
+ * Persistent handler cache
+ *
+ */
+
+/* Takes an instance out of the cache */
+static vlc_object_t *CacheTake( vlc_object_t **pp_cache, unsigned i )
+{
+    vlc_object_t *p_obj = pp_cache[i];
+
+    memmove( &pp_cache[i], &pp_cache[i + 1],
+             ( IMAGE_CACHE_SIZE - i - 1 ) * sizeof(*pp_cache) );
+    pp_cache[IMAGE_CACHE_SIZE - 1] = NULL;
+    return p_obj;
+}
+
+/* Puts an instance in the cache, and returns the one that does not fit
+ * anymore if any */
+static vlc_object_t *CachePut( vlc_object_t **pp_cache, vlc_object_t *p_obj )
+{
+    vlc_object_t *p_evicted = pp_cache[IMAGE_CACHE_SIZE - 1];
+
+    memmove( &pp_cache[1], &pp_cache[0],
+             ( IMAGE_CACHE_SIZE - 1 ) * sizeof(*pp_cache) );
+    pp_cache[0] = p_obj;
+    return p_evicted;
+}
+
+static decoder_t *FetchDecoder( image_handler_t *p_image, vlc_fourcc_t i_codec )
+{
+    if( !p_image->p_cache )
+        return NULL;
+
+    vlc_object_t **pp_cache = p_image->p_cache->pp_dec;
+    for( unsigned i = 0; i < IMAGE_CACHE_SIZE && pp_cache[i]; i++ )
+    {
+        decoder_t *p_dec = (decoder_t *)pp_cache[i];
+        if( p_dec->fmt_in.i_codec == i_codec )
+            return (decoder_t *)CacheTake( pp_cache, i );
+    }
+    return NULL;
+}
+
+static encoder_t *FetchEncoder( image_handler_t *p_image,
+                                const video_format_t *p_fmt_out )
+{
+    if( !p_image->p_cache )
+        return NULL;
+
+    vlc_object_t **pp_cache = p_image->p_cache->pp_enc;
+    for( unsigned i = 0; i < IMAGE_CACHE_SIZE && pp_cache[i]; i++ )
+    {
+        encoder_t *p_enc = (encoder_t *)pp_cache[i];
+        if( p_enc->fmt_out.i_codec == p_fmt_out->i_chroma &&
+            p_enc->fmt_out.video.i_width == p_fmt_out->i_width &&
+            p_enc->fmt_out.video.i_height == p_fmt_out->i_height )
+            return (encoder_t *)CacheTake( pp_cache, i );
+    }
+    return NULL;
+}
+
+static filter_t *FetchFilter( image_handler_t *p_image,
+                              vlc_fourcc_t i_chroma_in,
+                              vlc_fourcc_t i_chroma_out )
+{
+    if( !p_image->p_cache )
+        return NULL;
+
+    vlc_object_t **pp_cache = p_image->p_cache->pp_filter;
+    for( unsigned i = 0; i < IMAGE_CACHE_SIZE && pp_cache[i]; i++ )
+    {
+        filter_t *p_filter = (filter_t *)pp_cache[i];
+        if( p_filter->fmt_in.video.i_chroma == i_chroma_in &&
+            p_filter->fmt_out.video.i_chroma == i_chroma_out )
+            return (filter_t *)CacheTake( pp_cache, i );
+    }
+    return NULL;
+}
+
+static void ReleaseDecoder( image_handler_t *p_image )
+{
+    decoder_t *p_dec = p_image->p_dec;
+
+    p_image->p_dec = NULL;
+    if( p_image->p_cache )
+        p_dec = (decoder_t *)CachePut( p_image->p_cache->pp_dec,
+                                       VLC_OBJECT(p_dec) );
+    if( p_dec )
+        DeleteDecoder( p_dec );
+}
+
+static void ReleaseEncoder( image_handler_t *p_image )
+{
+    encoder_t *p_enc = p_image->p_enc;
+
+    p_image->p_enc = NULL;
+    if( p_image->p_cache )
+        p_enc = (encoder_t *)CachePut( p_image->p_cache->pp_enc,
+                                       VLC_OBJECT(p_enc) );
+    if( p_enc )
+        DeleteEncoder( p_enc );
+}
+
+static void ReleaseFilter( image_handler_t *p_image )
+{
+    filter_t *p_filter = p_image->p_filter;
+
+    p_image->p_filter = NULL;
+    if( p_image->p_cache )
+        p_filter = (filter_t *)CachePut( p_image->p_cache->pp_filter,
+                                         VLC_OBJECT(p_filter) );
+    if( p_filter )
+        DeleteFilter( p_filter );
+}
+
+/**
+ * Batch transcoding
+ *
+ */
+
+struct image_batch
+{
+    vlc_object_t *p_parent;
+    image_batch_item_t *p_items;
+    size_t i_items;
+    atomic_size_t i_next;
+};
+
+static void BatchItem( image_handler_t *p_image, image_batch_item_t *p_item )
+{
+    video_format_t fmt_in = p_item->fmt_in;
+    video_format_t fmt_out = p_item->fmt_out;
+    video_format_t fmt_pic;
+    picture_t *p_pic;
+
+    /* Decode and scale in the native chroma of the decoder */
+    video_format_Init( &fmt_pic, 0 );
+    fmt_pic.i_width = fmt_out.i_width;
+    fmt_pic.i_height = fmt_out.i_height;
+
+    if( p_item->p_block )
+    {
+        p_pic = ImageRead( p_image, p_item->p_block, &fmt_in, &fmt_pic );
+        p_item->p_block = NULL;
+    }
+    else
+        p_pic = ImageReadUrl( p_image, p_item->psz_url, &fmt_in, &fmt_pic );
+    if( !p_pic )
+        return;
+
+    fmt_out.i_width = fmt_pic.i_width;
+    fmt_out.i_height = fmt_pic.i_height;
+    fmt_out.i_visible_width = fmt_pic.i_visible_width;
+    fmt_out.i_visible_height = fmt_pic.i_visible_height;
+    p_item->p_result = ImageWrite( p_image, p_pic, &fmt_pic, &fmt_out );
+    picture_Release( p_pic );
+}
+
+static void BatchJob( void *data, unsigned i_job )
+{
+    struct image_batch *p_batch = data;
+    image_handler_t *p_image =
+        image_HandlerCreatePersistent( p_batch->p_parent );
+
+    VLC_UNUSED(i_job);
+
+    for( ;; )
+    {
+        size_t i = atomic_fetch_add( &p_batch->i_next, 1 );
+        if( i >= p_batch->i_items )
+            break;
+
+        image_batch_item_t *p_item = &p_batch->p_items[i];
+        p_item->p_result = NULL;
+        if( likely(p_image) )
+            BatchItem( p_image, p_item );
+        else if( p_item->p_block )
+        {
+            block_Release( p_item->p_block );
+            p_item->p_block = NULL;
+        }
+    }
+
+    image_HandlerDelete( p_image );
+}
+
+#undef image_Batch
+void image_Batch( vlc_object_t *p_this, image_batch_item_t *p_items,
+                  size_t i_items )
+{
+    struct image_batch batch = {
+        .p_parent = p_this,
+        .p_items = p_items,
+        .i_items = i_items,
+    };
+    unsigned i_jobs = vlc_threadpool_GetThreads( p_this );
+
+    atomic_init( &batch.i_next, 0 );
+    if( i_jobs > i_items )
+        i_jobs = i_items;
+    vlc_threadpool_Run( p_this, i_jobs, BatchJob, &batch );
+}
@@ -192,6 +192,7 @@ subpicture_region_private_t *subpicture_region_private_New( video_format_t *p_fm
     }
 
     p_private->p_picture = NULL;
+    p_private->p_source = NULL;
     return p_private;
 }
 
@@ -199,11 +200,13 @@ void subpicture_region_private_Delete( subpicture_region_private_t *p_private )
 {
     if( p_private->p_picture )
         picture_Release( p_private->p_picture );
+    if( p_private->p_source )
+        picture_Release( p_private->p_source );
     video_format_Clean( &p_private->fmt );
     free( p_private );
 }
 
-subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+static subpicture_region_t *RegionNew( const video_format_t *p_fmt )
 {
     subpicture_region_t *p_region = calloc( 1, sizeof(*p_region ) );
     if( !p_region )
@@ -230,6 +233,25 @@ subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
     }
 
     p_region->i_alpha = 0xff;
+    return p_region;
+}
+
+subpicture_region_t *subpicture_region_NewWithPicture( const video_format_t *p_fmt,
+                                                       picture_t *p_picture )
+{
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( !p_region )
+        return NULL;
+
+    p_region->p_picture = picture_Hold( p_picture );
+    return p_region;
+}
+
+subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+{
+    subpicture_region_t *p_region = RegionNew( p_fmt );
+    if( !p_region )
+        return NULL;
 
     if( p_fmt->i_chroma == VLC_CODEC_TEXT )
         return p_region;
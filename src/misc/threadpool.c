@@ -0,0 +1,213 @@
+/*****************************************************************************
+ * threadpool.c: worker threads for parallel jobs
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "libvlc.h"
+
+/* The jobs of one vlc_threadpool_Run() call */
+typedef struct vlc_threadpool_batch
+{
+    void (*pf_job)(void *, unsigned);
+    void *opaque;
+    unsigned i_jobs;
+    unsigned i_next; /**< first job not started yet */
+    unsigned i_done;
+    struct vlc_threadpool_batch *p_next;
+} vlc_threadpool_batch_t;
+
+struct vlc_threadpool
+{
+    vlc_object_t *obj;
+    vlc_mutex_t lock;
+    vlc_cond_t  wait; /**< a batch was queued */
+    vlc_cond_t  done; /**< a batch was completed */
+
+    /* batches with jobs not started yet, in order */
+    vlc_threadpool_batch_t *p_first;
+
+    unsigned i_threads; /**< including the calling thread */
+    unsigned i_started;
+    bool b_closing;
+    vlc_thread_t *threads;
+};
+
+/* Starts the next job of the batch, with the lock held */
+static unsigned Take(vlc_threadpool_t *pool, vlc_threadpool_batch_t *b)
+{
+    unsigned i = b->i_next++;
+
+    if (b->i_next == b->i_jobs)
+    {   /* no job left to start: unqueue */
+        vlc_threadpool_batch_t **pp = &pool->p_first;
+        while (*pp != b)
+            pp = &(*pp)->p_next;
+        *pp = b->p_next;
+    }
+    return i;
+}
+
+static void Run(vlc_threadpool_t *pool, vlc_threadpool_batch_t *b, unsigned i)
+{
+    vlc_mutex_unlock(&pool->lock);
+    b->pf_job(b->opaque, i);
+    vlc_mutex_lock(&pool->lock);
+
+    if (++b->i_done == b->i_jobs)
+        vlc_cond_broadcast(&pool->done);
+}
+
+static void *Thread(void *data)
+{
+    vlc_threadpool_t *pool = data;
+
+    vlc_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->p_first == NULL && !pool->b_closing)
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        if (pool->b_closing)
+            break;
+
+        vlc_threadpool_batch_t *b = pool->p_first;
+        Run(pool, b, Take(pool, b));
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+vlc_threadpool_t *vlc_threadpool_New(vlc_object_t *obj, unsigned i_threads)
+{
+    vlc_threadpool_t *pool = malloc(sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    if (i_threads == 0)
+        i_threads = vlc_GetCPUCount();
+    pool->threads = NULL;
+    if (i_threads > 1)
+    {
+        pool->threads = malloc((i_threads - 1) * sizeof (*pool->threads));
+        if (unlikely(pool->threads == NULL))
+            i_threads = 1;
+    }
+
+    pool->obj = obj;
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    vlc_cond_init(&pool->done);
+    pool->p_first = NULL;
+    pool->i_threads = i_threads;
+    pool->i_started = 0;
+    pool->b_closing = false;
+    return pool;
+}
+
+void vlc_threadpool_Delete(vlc_threadpool_t *pool)
+{
+    vlc_mutex_lock(&pool->lock);
+    assert(pool->p_first == NULL);
+    pool->b_closing = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->i_started; i++)
+        vlc_join(pool->threads[i], NULL);
+
+    vlc_cond_destroy(&pool->done);
+    vlc_cond_destroy(&pool->wait);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+/* The threads are only started on first use, with the lock held */
+static void Start(vlc_threadpool_t *pool)
+{
+    while (pool->i_started < pool->i_threads - 1)
+    {
+        if (vlc_clone(&pool->threads[pool->i_started], Thread, pool,
+                      VLC_THREAD_PRIORITY_VIDEO))
+        {
+            msg_Warn(pool->obj, "cannot start worker thread");
+            pool->i_threads = pool->i_started + 1;
+            break;
+        }
+        pool->i_started++;
+    }
+}
+
+#undef vlc_threadpool_Run
+void vlc_threadpool_Run(vlc_object_t *obj, unsigned i_jobs,
+                        void (*pf_job)(void *, unsigned), void *opaque)
+{
+    vlc_threadpool_t *pool = libvlc_priv(obj->obj.libvlc)->threadpool;
+
+    vlc_threadpool_batch_t b = {
+        .pf_job = pf_job, .opaque = opaque, .i_jobs = i_jobs,
+        .i_next = 0, .i_done = 0, .p_next = NULL,
+    };
+
+    vlc_mutex_lock(&pool->lock);
+    if (pool->i_started == 0 && pool->i_threads > 1)
+        Start(pool);
+    if (i_jobs <= 1 || pool->i_threads <= 1)
+    {
+        vlc_mutex_unlock(&pool->lock);
+        for (unsigned i = 0; i < i_jobs; i++)
+            pf_job(opaque, i);
+        return;
+    }
+
+    vlc_threadpool_batch_t **pp = &pool->p_first;
+    while (*pp != NULL)
+        pp = &(*pp)->p_next;
+    *pp = &b;
+    if (i_jobs > 2)
+        vlc_cond_broadcast(&pool->wait);
+    else
+        vlc_cond_signal(&pool->wait);
+
+    /* Help with our own jobs, then wait for the ones still running */
+    while (b.i_next < b.i_jobs)
+        Run(pool, &b, Take(pool, &b));
+    while (b.i_done < b.i_jobs)
+        vlc_cond_wait(&pool->done, &pool->lock);
+    vlc_mutex_unlock(&pool->lock);
+}
+
+#undef vlc_threadpool_GetThreads
+unsigned vlc_threadpool_GetThreads(vlc_object_t *obj)
+{
+    vlc_threadpool_t *pool = libvlc_priv(obj->obj.libvlc)->threadpool;
+
+    vlc_mutex_lock(&pool->lock);
+    unsigned i_threads = pool->i_threads;
+    vlc_mutex_unlock(&pool->lock);
+    return i_threads;
+}
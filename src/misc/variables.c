@@ -28,9 +28,6 @@
 # include "config.h"
 #endif
 
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 #include <assert.h>
 #include <float.h>
 #include <math.h>
@@ -72,7 +69,9 @@ typedef struct callback_table_t
  */
 struct variable_t
 {
-    char *       psz_name; /**< The variable unique name (must be first) */
+    char *       psz_name; /**< The variable unique name */
+    uint32_t     i_hash;   /**< Hash of the name */
+    variable_t * p_next;   /**< Next variable in the same hash bucket */
 
     /** The variable's exported value */
     vlc_value_t  val;
@@ -140,22 +139,96 @@ int_ops    = { CmpInt,     DupDummy,  FreeDummy,  },
 string_ops = { CmpString,  DupString, FreeString, },
 coords_ops = { NULL,       DupDummy,  FreeDummy,  };
 
-static int varcmp( const void *a, const void *b )
+/*****************************************************************************
+ * Variables hash table
+ *****************************************************************************
+ * The variables of an object are chained in hash buckets, so that a lookup
+ * costs one pass over the name and usually a single string comparison,
+ * whatever the number of variables. The table doubles when it gets full.
+ *****************************************************************************/
+#define VAR_TABLE_MIN 16
+
+static uint32_t Hash( const char *psz_name )
+{
+    uint32_t i_hash = 2166136261u; /* FNV-1a */
+
+    while( *psz_name )
+        i_hash = ( i_hash ^ (unsigned char)*(psz_name++) ) * 16777619u;
+    return i_hash;
+}
+
+/**
+ * Finds the link to a variable in its hash bucket.
+ *
+ * \return the link pointing to the variable, or to NULL at the end of the
+ * bucket if there is no such variable, or NULL if the table is empty
+ */
+static variable_t **Find( vlc_object_internals_t *priv, const char *psz_name,
+                          uint32_t i_hash )
+{
+    if( priv->var_table == NULL )
+        return NULL;
+
+    variable_t **pp_var = &priv->var_table[i_hash & priv->var_mask];
+    variable_t *p_var;
+
+    while( (p_var = *pp_var) != NULL
+        && (p_var->i_hash != i_hash || strcmp( p_var->psz_name, psz_name )) )
+        pp_var = &p_var->p_next;
+    return pp_var;
+}
+
+static int Insert( vlc_object_internals_t *priv, variable_t *p_var )
+{
+    if( priv->var_table == NULL || priv->var_count > priv->var_mask )
+    {
+        size_t i_size = priv->var_table ? 2 * (priv->var_mask + 1)
+                                        : VAR_TABLE_MIN;
+        variable_t **table = calloc( i_size, sizeof (*table) );
+        if( unlikely(table == NULL) )
+            return VLC_ENOMEM;
+
+        for( size_t i = 0; priv->var_table && i <= priv->var_mask; i++ )
+        {
+            variable_t *p_next;
+
+            for( variable_t *p = priv->var_table[i]; p != NULL; p = p_next )
+            {
+                p_next = p->p_next;
+                p->p_next = table[p->i_hash & (i_size - 1)];
+                table[p->i_hash & (i_size - 1)] = p;
+            }
+        }
+        free( priv->var_table );
+        priv->var_table = table;
+        priv->var_mask = i_size - 1;
+    }
+
+    variable_t **pp_bucket = &priv->var_table[p_var->i_hash & priv->var_mask];
+
+    p_var->p_next = *pp_bucket;
+    *pp_bucket = p_var;
+    priv->var_count++;
+    return VLC_SUCCESS;
+}
+
+static void Remove( vlc_object_internals_t *priv, variable_t *p_var )
 {
-    const variable_t *va = a, *vb = b;
+    variable_t **pp_var = Find( priv, p_var->psz_name, p_var->i_hash );
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
-    return strcmp( va->psz_name, vb->psz_name );
+    assert( pp_var != NULL && *pp_var == p_var );
+    *pp_var = p_var->p_next;
+    priv->var_count--;
 }
 
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
+    uint32_t i_hash = Hash( psz_name );
     variable_t **pp_var;
 
     vlc_mutex_lock(&priv->var_lock);
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
+    pp_var = Find( priv, psz_name, i_hash );
     return (pp_var != NULL) ? *pp_var : NULL;
 }
 
@@ -285,9 +358,9 @@ static void TriggerListCallback(vlc_object_t *obj, variable_t *var,
 /**
  * Initialize a vlc variable
  *
- * We hash the given string and insert it into the sorted list. The insertion
- * may require slow memory copies, but think about what we gain in the log(n)
- * lookup phase when setting/getting the variable value!
+ * We hash the given string and insert the variable in the hash table of the
+ * object, so that getting and setting its value does not depend on the number
+ * of variables.
  *
  * \param p_this The object in which to create the variable
  * \param psz_name The name of the variable
@@ -303,6 +376,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
         return VLC_ENOMEM;
 
     p_var->psz_name = strdup( psz_name );
+    p_var->i_hash = Hash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -366,17 +440,17 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
-    if( unlikely(pp_var == NULL) )
-        ret = VLC_ENOMEM;
-    else if( (p_oldvar = *pp_var) == p_var ) /* Variable create */
-        p_var = NULL; /* Variable created */
-    else /* Variable already exists */
-    {
+    pp_var = Find( p_priv, psz_name, p_var->i_hash );
+    if( pp_var != NULL && (p_oldvar = *pp_var) != NULL )
+    {   /* Variable already exists */
         assert (((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) == 0);
         p_oldvar->i_usage++;
         p_oldvar->i_type |= i_type & VLC_VAR_ISCOMMAND;
     }
+    else if( unlikely(Insert( p_priv, p_var )) )
+        ret = VLC_ENOMEM;
+    else
+        p_var = NULL; /* Variable created */
     vlc_mutex_unlock( &p_priv->var_lock );
 
     /* If we did not need to create a new variable, free everything... */
@@ -388,8 +462,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
 /**
  * Destroy a vlc variable
  *
- * Look for the variable and destroy it if it is found. As in var_Create we
- * do a call to memmove() but we have performance counterparts elsewhere.
+ * Look for the variable and destroy it if it is found.
  *
  * \param p_this The object that holds the variable
  * \param psz_name The name of the variable
@@ -409,7 +482,7 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
     else if( --p_var->i_usage == 0 )
     {
         assert(!p_var->b_incallback);
-        tdelete( p_var, &p_priv->var_root, varcmp );
+        Remove( p_priv, p_var );
     }
     else
     {
@@ -422,17 +495,24 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
         Destroy( p_var );
 }
 
-static void CleanupVar( void *var )
-{
-    Destroy( var );
-}
-
 void var_DestroyAll( vlc_object_t *obj )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
 
-    tdestroy( priv->var_root, CleanupVar );
-    priv->var_root = NULL;
+    for( size_t i = 0; priv->var_table && i <= priv->var_mask; i++ )
+    {
+        variable_t *p_next;
+
+        for( variable_t *p_var = priv->var_table[i]; p_var; p_var = p_next )
+        {
+            p_next = p_var->p_next;
+            Destroy( p_var );
+        }
+    }
+    free( priv->var_table );
+    priv->var_table = NULL;
+    priv->var_count = 0;
+    priv->var_mask = 0;
 }
 
 #undef var_Change
@@ -1310,13 +1390,8 @@ void var_FreeList( vlc_value_t *p_val, vlc_value_t *p_val2 )
     }
 }
 
-static void DumpVariable(const void *data, const VISIT which, const int depth)
+static void DumpVariable(const variable_t *var)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
-
-    const variable_t *var = *(const variable_t **)data;
     const char *typename = "unknown";
 
     switch (var->i_type & VLC_VAR_TYPE)
@@ -1369,12 +1444,36 @@ static void DumpVariable(const void *data, const VISIT which, const int depth)
     putchar('\n');
 }
 
+static int varcmp(const void *a, const void *b)
+{
+    const variable_t *const *va = a, *const *vb = b;
+
+    return strcmp((*va)->psz_name, (*vb)->psz_name);
+}
+
 void DumpVariables(vlc_object_t *obj)
 {
-    vlc_mutex_lock(&vlc_internals(obj)->var_lock);
-    if (vlc_internals(obj)->var_root == NULL)
+    vlc_object_internals_t *priv = vlc_internals(obj);
+
+    vlc_mutex_lock(&priv->var_lock);
+    if (priv->var_count == 0)
         puts(" `-o No variables");
     else
-        twalk(vlc_internals(obj)->var_root, DumpVariable);
-    vlc_mutex_unlock(&vlc_internals(obj)->var_lock);
+    {   /* Dump in name order, as the hash table is not sorted */
+        const variable_t **vars = malloc(priv->var_count * sizeof (*vars));
+        size_t n = 0;
+
+        if (vars != NULL)
+        {
+            for (size_t i = 0; i <= priv->var_mask; i++)
+                for (variable_t *var = priv->var_table[i]; var != NULL;
+                     var = var->p_next)
+                    vars[n++] = var;
+            qsort(vars, n, sizeof (*vars), varcmp);
+            for (size_t i = 0; i < n; i++)
+                DumpVariable(vars[i]);
+            free(vars);
+        }
+    }
+    vlc_mutex_unlock(&priv->var_lock);
 }
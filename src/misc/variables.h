@@ -35,7 +35,9 @@ struct vlc_object_internals
     char           *psz_name; /* given name */
 
     /* Object variables */
-    void           *var_root;
+    struct variable_t **var_table; /* hash buckets */
+    unsigned        var_count; /* number of variables */
+    unsigned        var_mask; /* number of buckets minus one */
     vlc_mutex_t     var_lock;
     vlc_cond_t      var_wait;
 
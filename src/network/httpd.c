@@ -40,11 +40,14 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 
 #ifdef HAVE_POLL
 # include <poll.h>
@@ -63,8 +66,45 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* Maximum count of stream chunks queued at once for a client */
+#define HTTPD_CL_CHUNKS 64
+
+/* Stream data, copied once from the muxer and referenced by the clients */
+typedef struct
+{
+    atomic_uint refs;
+    int64_t     i_pos;      /* absolute position of the first byte */
+    size_t      i_size;
+    uint8_t     p_data[];
+} httpd_chunk_t;
+
+static httpd_chunk_t *httpd_ChunkNew(const void *p_data, size_t i_size)
+{
+    httpd_chunk_t *chunk = malloc(sizeof (*chunk) + i_size);
+    if (unlikely(chunk == NULL))
+        return NULL;
+
+    atomic_init(&chunk->refs, 1);
+    chunk->i_pos = 0;
+    chunk->i_size = i_size;
+    memcpy(chunk->p_data, p_data, i_size);
+    return chunk;
+}
+
+static httpd_chunk_t *httpd_ChunkHold(httpd_chunk_t *chunk)
+{
+    atomic_fetch_add_explicit(&chunk->refs, 1, memory_order_relaxed);
+    return chunk;
+}
+
+static void httpd_ChunkRelease(httpd_chunk_t *chunk)
+{
+    if (atomic_fetch_sub_explicit(&chunk->refs, 1, memory_order_acq_rel) == 1)
+        free(chunk);
+}
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_HostWake(httpd_host_t *host);
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -83,6 +123,12 @@ struct httpd_host_t
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
+#ifndef _WIN32
+    /* pipe waking the thread up when a stream has new data */
+    int         wakeup[2];
+    atomic_bool b_woken;
+#endif
+
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
      * This will slow down the url research but make my live easier
      * All url will have their cb trigger, but only the first one can answer
@@ -165,6 +211,13 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* Stream data to send after the buffer, as references to the chunks
+     * of the stream: queuing them takes no allocation */
+    httpd_chunk_t *p_chunks[HTTPD_CL_CHUNKS];
+    unsigned i_chunks;          /* count of queued chunks */
+    unsigned i_chunk_first;     /* index of the first chunk not fully sent */
+    size_t   i_chunk_offset;    /* bytes of that chunk not to send */
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -611,10 +664,15 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
-    int64_t     i_buffer_pos;       /* absolute position from beginning */
+    /* Circular buffer of chunks: each chunk is copied once from the muxer,
+     * then the clients hold references to it (a counter, no allocation). */
+    int         i_buffer_size;      /* bytes kept for the late clients */
+    httpd_chunk_t **p_chunks;       /* ring of chunks */
+    size_t      i_chunks_max;       /* ring size (power of two) */
+    size_t      i_chunks_first;     /* index of the oldest chunk */
+    size_t      i_chunks;           /* count of chunks */
+    atomic_llong i_buffer_pos;      /* absolute position from beginning,
+                                     * can be read without the lock */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
     /* custom headers */
@@ -622,6 +680,29 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
+static inline httpd_chunk_t *httpd_StreamChunk(httpd_stream_t *stream,
+                                               size_t i)
+{
+    return stream->p_chunks[(stream->i_chunks_first + i)
+                            & (stream->i_chunks_max - 1)];
+}
+
+/* Finds the chunk holding the given position */
+static size_t httpd_StreamFind(httpd_stream_t *stream, int64_t i_pos)
+{
+    size_t i_low = 0, i_high = stream->i_chunks;
+
+    while (i_high - i_low > 1) {
+        size_t i_mid = (i_low + i_high) / 2;
+
+        if (httpd_StreamChunk(stream, i_mid)->i_pos <= i_pos)
+            i_low = i_mid;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -632,44 +713,54 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        /* Waiting clients come here often: check for data without locking */
+        if (answer->i_body_offset >= atomic_load_explicit(&stream->i_buffer_pos,
+                                                          memory_order_acquire))
             return VLC_EGENERIC;    /* wait, no data available */
 
+        vlc_mutex_lock(&stream->lock);
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass) {
                 /* still waiting for the next keyframe */
+                vlc_mutex_unlock(&stream->lock);
                 return VLC_EGENERIC;
+            }
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        if (answer->i_body_offset < httpd_StreamChunk(stream, 0)->i_pos)
             answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        /* Queue references to the chunks from the client position on */
+        size_t i = httpd_StreamFind(stream, answer->i_body_offset);
+        int64_t i_write = 0;
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+        assert(cl->i_chunks == 0);
+        if (i < stream->i_chunks) {
+            cl->i_chunk_first = 0;
+            cl->i_chunk_offset = answer->i_body_offset
+                               - httpd_StreamChunk(stream, i)->i_pos;
+            i_write = -(int64_t)cl->i_chunk_offset;
+        }
+        for (; i < stream->i_chunks && cl->i_chunks < HTTPD_CL_CHUNKS; i++) {
+            httpd_chunk_t *chunk = httpd_StreamChunk(stream, i);
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+            cl->p_chunks[cl->i_chunks++] = httpd_ChunkHold(chunk);
+            i_write += chunk->i_size;
+        }
+        vlc_mutex_unlock(&stream->lock);
+
+        if (i_write <= 0)
+            return VLC_EGENERIC;    /* wait, no data available */
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
         answer->i_body_offset += i_write;
 
         return VLC_SUCCESS;
@@ -766,10 +857,13 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->p_chunks = NULL;
+    stream->i_chunks_max = 0;
+    stream->i_chunks_first = 0;
+    stream->i_chunks = 0;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
-    stream->i_buffer_pos = 1;
+    atomic_init(&stream->i_buffer_pos, 1);
     stream->i_buffer_last_pos = 1;
     stream->b_has_keyframes = false;
     stream->i_last_keyframe_seen_pos = 0;
@@ -802,42 +896,75 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+/* Appends a chunk, and drops the old ones that are not needed anymore */
+static int httpd_StreamPush(httpd_stream_t *stream, httpd_chunk_t *chunk,
+                            int64_t i_pos)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+    if (stream->i_chunks == stream->i_chunks_max) {
+        size_t i_max = stream->i_chunks_max ? 2 * stream->i_chunks_max : 256;
+        httpd_chunk_t **p_chunks = malloc(i_max * sizeof (*p_chunks));
+        if (unlikely(p_chunks == NULL))
+            return VLC_ENOMEM;
+
+        for (size_t i = 0; i < stream->i_chunks; i++)
+            p_chunks[i] = httpd_StreamChunk(stream, i);
+        free(stream->p_chunks);
+        stream->p_chunks = p_chunks;
+        stream->i_chunks_max = i_max;
+        stream->i_chunks_first = 0;
     }
 
-    stream->i_buffer_pos += i_data;
+    chunk->i_pos = i_pos;
+    stream->p_chunks[(stream->i_chunks_first + stream->i_chunks++)
+                     & (stream->i_chunks_max - 1)] = chunk;
+
+    /* Keep at least the last chunk, for the new clients */
+    while (stream->i_chunks > 1
+        && i_pos + chunk->i_size - httpd_StreamChunk(stream, 0)->i_pos
+                                            > (size_t)stream->i_buffer_size) {
+        httpd_ChunkRelease(httpd_StreamChunk(stream, 0));
+        stream->i_chunks_first = (stream->i_chunks_first + 1)
+                               & (stream->i_chunks_max - 1);
+        stream->i_chunks--;
+    }
+    return VLC_SUCCESS;
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block || !p_block->p_buffer || p_block->i_buffer == 0)
         return VLC_SUCCESS;
 
+    /* Copy the data once: the clients will share it */
+    httpd_chunk_t *p_chunk = httpd_ChunkNew(p_block->p_buffer,
+                                            p_block->i_buffer);
+    if (unlikely(p_chunk == NULL))
+        return VLC_ENOMEM;
+
     vlc_mutex_lock(&stream->lock);
 
+    int64_t i_pos = atomic_load_explicit(&stream->i_buffer_pos,
+                                         memory_order_relaxed);
+
+    if (httpd_StreamPush(stream, p_chunk, i_pos)) {
+        vlc_mutex_unlock(&stream->lock);
+        httpd_ChunkRelease(p_chunk);
+        return VLC_ENOMEM;
+    }
+
     /* save this pointer (to be used by new connection) */
-    stream->i_buffer_last_pos = stream->i_buffer_pos;
+    stream->i_buffer_last_pos = i_pos;
 
     if (p_block->i_flags & BLOCK_FLAG_TYPE_I) {
         stream->b_has_keyframes = true;
-        stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
+        stream->i_last_keyframe_seen_pos = i_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
-
+    atomic_store_explicit(&stream->i_buffer_pos, i_pos + p_chunk->i_size,
+                          memory_order_release);
     vlc_mutex_unlock(&stream->lock);
+
+    httpd_HostWake(stream->url->host);
     return VLC_SUCCESS;
 }
 
@@ -852,7 +979,9 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    for (size_t i = 0; i < stream->i_chunks; i++)
+        httpd_ChunkRelease(httpd_StreamChunk(stream, i));
+    free(stream->p_chunks);
     free(stream);
 }
 
@@ -959,6 +1088,10 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     host->i_ref = 1;
+#ifndef _WIN32
+    host->wakeup[0] = host->wakeup[1] = -1;
+    atomic_init(&host->b_woken, false);
+#endif
 
     host->fds = net_ListenTCP(p_this, url.psz_host, port);
     if (!host->fds) {
@@ -967,6 +1100,15 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     }
     for (host->nfd = 0; host->fds[host->nfd] != -1; host->nfd++);
 
+#ifndef _WIN32
+    if (vlc_pipe(host->wakeup)) {
+        msg_Err(p_this, "cannot create HTTP host wake-up pipe");
+        goto error;
+    }
+    fcntl(host->wakeup[0], F_SETFL, O_NONBLOCK);
+    fcntl(host->wakeup[1], F_SETFL, O_NONBLOCK);
+#endif
+
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
@@ -993,6 +1135,12 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+#ifndef _WIN32
+        if (host->wakeup[0] != -1) {
+            vlc_close(host->wakeup[1]);
+            vlc_close(host->wakeup[0]);
+        }
+#endif
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1039,6 +1187,10 @@ void httpd_HostDelete(httpd_host_t *host)
     TAB_CLEAN(host->i_client, host->client);
 
     vlc_tls_Delete(host->p_tls);
+#ifndef _WIN32
+    vlc_close(host->wakeup[1]);
+    vlc_close(host->wakeup[0]);
+#endif
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
     vlc_mutex_destroy(&host->lock);
@@ -1201,6 +1353,9 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->i_chunks = 0;
+    cl->i_chunk_first = 0;
+    cl->i_chunk_offset = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1226,6 +1381,8 @@ static void httpd_ClientDestroy(httpd_client_t *cl)
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
+    for (unsigned i = cl->i_chunk_first; i < cl->i_chunks; i++)
+        httpd_ChunkRelease(cl->p_chunks[i]);
     free(cl->p_buffer);
     free(cl);
 }
@@ -1276,6 +1433,28 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
     return val;
 }
 
+static
+ssize_t httpd_NetSendv (httpd_client_t *cl, struct iovec *iov, unsigned count)
+{
+    vlc_tls_t *p_tls;
+    ssize_t val;
+
+    p_tls = cl->p_tls;
+    do
+        if (p_tls != NULL)
+            val = p_tls->writev(p_tls, iov, count);
+        else {
+            struct msghdr msg = {
+                .msg_iov = iov,
+                .msg_iovlen = count,
+            };
+
+            val = sendmsg(cl->fd, &msg, MSG_NOSIGNAL);
+        }
+    while (val == -1 && errno == EINTR);
+    return val;
+}
+
 
 static const struct
 {
@@ -1580,9 +1759,47 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
+/* Sends as many of the queued stream chunks as possible */
+static ssize_t httpd_ClientSendChunks(httpd_client_t *cl)
+{
+    struct iovec iov[HTTPD_CL_CHUNKS];
+    unsigned i_iov = 0;
+
+    for (unsigned i = cl->i_chunk_first; i < cl->i_chunks; i++) {
+        const httpd_chunk_t *chunk = cl->p_chunks[i];
+        size_t i_skip = (i == cl->i_chunk_first) ? cl->i_chunk_offset : 0;
+
+        iov[i_iov].iov_base = (uint8_t *)chunk->p_data + i_skip;
+        iov[i_iov].iov_len = chunk->i_size - i_skip;
+        i_iov++;
+    }
+    if (i_iov == 0)
+        return 0;
+
+    ssize_t i_len = httpd_NetSendv(cl, iov, i_iov);
+
+    /* Release the chunks that were sent */
+    for (size_t i_left = (i_len > 0) ? i_len : 0; i_left > 0;) {
+        httpd_chunk_t *chunk = cl->p_chunks[cl->i_chunk_first];
+        size_t i_rest = chunk->i_size - cl->i_chunk_offset;
+
+        if (i_rest > i_left) {
+            cl->i_chunk_offset += i_left;
+            break;
+        }
+        i_left -= i_rest;
+        httpd_ChunkRelease(chunk);
+        cl->i_chunk_first++;
+        cl->i_chunk_offset = 0;
+    }
+    if (cl->i_chunk_first == cl->i_chunks)
+        cl->i_chunks = cl->i_chunk_first = 0;
+    return i_len;
+}
+
 static void httpd_ClientSend(httpd_client_t *cl)
 {
-    int i_len;
+    ssize_t i_len;
 
     if (cl->i_buffer < 0) {
         /* We need to create the header */
@@ -1615,12 +1832,16 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
-    if (i_len >= 0) {
-        cl->i_buffer += i_len;
+    if (cl->i_buffer < cl->i_buffer_size) {
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
+        if (i_len > 0)
+            cl->i_buffer += i_len;
+    } else
+        i_len = httpd_ClientSendChunks(cl);
 
-        if (cl->i_buffer >= cl->i_buffer_size) {
+    if (i_len >= 0) {
+        if (cl->i_buffer >= cl->i_buffer_size && cl->i_chunks == 0) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
                 int     i_msg = cl->query.i_type;
@@ -1642,7 +1863,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
-            } else /* send finished */
+            } else if (cl->i_chunks == 0) /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
     } else {
@@ -1709,15 +1930,32 @@ auth_failed:
     return false;
 }
 
+/* Wakes the host thread up, so that it feeds the waiting stream clients */
+static void httpd_HostWake(httpd_host_t *host)
+{
+#ifndef _WIN32
+    if (!atomic_exchange(&host->b_woken, true))
+        (void) !write(host->wakeup[1], &(char){ 0 }, 1);
+#else
+    (void) host; /* waiting clients are polled */
+#endif
+}
+
 static void httpdLoop(httpd_host_t *host)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
+    struct pollfd ufd[host->nfd + 1 + host->i_client];
     unsigned nfd;
     for (nfd = 0; nfd < host->nfd; nfd++) {
         ufd[nfd].fd = host->fds[nfd];
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
     }
+#ifndef _WIN32
+    ufd[nfd].fd = host->wakeup[0];
+    ufd[nfd].events = POLLIN;
+    ufd[nfd].revents = 0;
+    nfd++;
+#endif
 
     /* add all socket that should be read/write and close dead connection */
     while (host->i_url <= 0) {
@@ -1750,16 +1988,6 @@ static void httpdLoop(httpd_host_t *host)
         pufd->events = pufd->revents = 0;
 
         switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
-
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
-
             case HTTPD_CLIENT_RECEIVE_DONE: {
                 httpd_message_t *answer = &cl->answer;
                 httpd_message_t *query  = &cl->query;
@@ -1945,36 +2173,54 @@ static void httpdLoop(httpd_host_t *host)
                     cl->i_state = HTTPD_CLIENT_WAITING;
                 }
                 break;
+        }
 
-            case HTTPD_CLIENT_WAITING:
-                i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+        if (cl->i_state == HTTPD_CLIENT_WAITING) {
+            i_offset = cl->answer.i_body_offset;
+            int i_msg = cl->query.i_type;
 
-                httpd_MsgInit(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                    &cl->answer, &cl->query);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+        }
+
+        switch (cl->i_state) {
+            case HTTPD_CLIENT_RECEIVING:
+            case HTTPD_CLIENT_TLS_HS_IN:
+                pufd->events = POLLIN;
+                break;
+
+            case HTTPD_CLIENT_SENDING:
+            case HTTPD_CLIENT_TLS_HS_OUT:
+                pufd->events = POLLOUT;
+                break;
+
+#ifndef _WIN32
+            case HTTPD_CLIENT_WAITING:
+                break; /* the stream wakes the thread up on new data */
+#endif
+            default:
+                b_low_delay = true;
         }
 
         if (pufd->events != 0)
             nfd++;
-        else
-            b_low_delay = true;
     }
     vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+    /* we will wait 20ms (not too big) if a client needs to be handled */
     int ret = poll(ufd, nfd, b_low_delay ? 20 : -1);
 
     canc = vlc_savecancel();
@@ -1995,6 +2241,16 @@ static void httpdLoop(httpd_host_t *host)
     now = mdate();
     nfd = host->nfd;
 
+#ifndef _WIN32
+    /* Drain the wake-up pipe before the waiting clients get handled again */
+    if (ufd[nfd++].revents) {
+        char dummy[16];
+
+        while (read(host->wakeup[0], dummy, sizeof (dummy)) > 0);
+        atomic_store(&host->b_woken, false);
+    }
+#endif
+
     for (int i_client = 0; i_client < host->i_client; i_client++) {
         httpd_client_t *cl = host->client[i_client];
         const struct pollfd *pufd = &ufd[nfd];
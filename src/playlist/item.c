@@ -228,6 +228,9 @@ static void input_item_changed( const vlc_event_t * p_event,
 {
     playlist_t *p_playlist = user_data;
 
+    if( p_event->type == vlc_InputItemMetaChanged
+     || p_event->type == vlc_InputItemNameChanged )
+        playlist_SearchIndexUpdate( p_playlist, p_event->p_obj );
     var_SetAddress( p_playlist, "item-change", p_event->p_obj );
 }
 
@@ -304,6 +307,7 @@ playlist_item_t *playlist_ItemNewFromInput( playlist_t *p_playlist,
 
     p->i_last_playlist_id = p_item->i_id;
     vlc_gc_incref( p_item->p_input );
+    playlist_SearchIndexAdd( p_playlist, p_item );
 
     vlc_event_manager_t *p_em = &p_item->p_input->event_manager;
 
@@ -357,6 +361,7 @@ void playlist_ItemRelease( playlist_t *p_playlist, playlist_item_t *p_item )
     vlc_event_detach( p_em, vlc_InputItemErrorWhenReadingChanged,
                       input_item_changed, p_playlist );
 
+    playlist_SearchIndexRemove( p_playlist, p_item );
     vlc_gc_decref( p_item->p_input );
 
     tdelete( p_item, &p->input_tree, playlist_ItemCmpInput );
@@ -791,8 +796,8 @@ static void GoAndPreparse( playlist_t *p_playlist, int i_mode,
 
     if( sys->b_preparse && !input_item_IsPreparsed( p_item->p_input )
      && (EMPTY_STR(psz_artist) || EMPTY_STR(psz_album)) )
-        libvlc_MetadataRequest( p_playlist->obj.libvlc, p_item->p_input, 0, -1,
-                                NULL );
+        libvlc_MetadataRequest( p_playlist->obj.libvlc, p_item->p_input,
+                                META_REQUEST_OPTION_BACKGROUND, -1, NULL );
     free( psz_artist );
     free( psz_album );
 }
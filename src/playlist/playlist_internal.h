@@ -87,6 +87,8 @@ typedef struct playlist_private_t
 
     bool     b_tree; /**< Display as a tree */
     bool     b_preparse; /**< Preparse items */
+
+    struct playlist_search_t *search; /**< Live search index */
 } playlist_private_t;
 
 #define pl_priv( pl ) ((playlist_private_t *)(pl))
@@ -123,6 +125,15 @@ void playlist_SendAddNotify( playlist_t *p_playlist, playlist_item_t *item );
 int playlist_InsertInputItemTree ( playlist_t *,
         playlist_item_t *, input_item_node_t *, int, bool );
 
+/* Live search index */
+typedef struct playlist_search_t playlist_search_t;
+
+playlist_search_t *playlist_SearchIndexNew( void );
+void playlist_SearchIndexDelete( playlist_search_t * );
+void playlist_SearchIndexAdd( playlist_t *, playlist_item_t * );
+void playlist_SearchIndexRemove( playlist_t *, playlist_item_t * );
+void playlist_SearchIndexUpdate( playlist_t *, input_item_t * );
+
 /* Tree walking */
 int playlist_NodeInsert(playlist_t *, playlist_item_t*, playlist_item_t *,
                         int);
@@ -0,0 +1,742 @@
+/*****************************************************************************
+ * preparse_cache.c: persistent cache of preparsing results
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_arrays.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_memstream.h>
+#include <vlc_meta.h>
+#include <vlc_url.h>
+
+#include "preparse_cache.h"
+#include "input/item.h"
+
+/* Cache filename */
+#define CACHE_NAME "preparse.dat"
+/* Magic for the cache file, the records are in the native layout */
+#define CACHE_STRING "preparse cache "PACKAGE_NAME" "PACKAGE_VERSION
+
+/* Records bigger than that (lyrics, huge tags...) are not worth caching */
+#define CACHE_RECORD_MAX (64 << 10)
+
+/*****************************************************************************
+ * Structures/definitions
+ *****************************************************************************/
+typedef struct cache_entry_t cache_entry_t;
+
+struct cache_entry_t
+{
+    char            *psz_uri;
+    int64_t          i_mtime;
+    uint64_t         i_size;
+    uint8_t         *p_data; /**< serialized preparsing results */
+    size_t           i_data;
+    cache_entry_t   *p_prev, *p_next; /**< least recently used first */
+};
+
+struct preparse_cache_t
+{
+    vlc_object_t    *object;
+    char            *psz_dir;
+    unsigned         i_max;
+
+    vlc_mutex_t      lock;
+    bool             b_loaded;
+    bool             b_dirty;
+    vlc_dictionary_t entries;
+    unsigned         i_entries;
+    cache_entry_t   *p_first, *p_last;
+
+    /* Statistics */
+    unsigned         i_hits;
+    unsigned         i_misses;
+};
+
+/*****************************************************************************
+ * Serialization
+ *****************************************************************************/
+#define SAVE_IMMEDIATE( a ) \
+    vlc_memstream_write( ms, &(a), sizeof (a) )
+
+static void SaveString( struct vlc_memstream *ms, const char *str )
+{
+    uint32_t size = (str != NULL) ? (strlen( str ) + 1) : 0;
+
+    SAVE_IMMEDIATE( size );
+    if( size != 0 )
+        vlc_memstream_write( ms, str, size );
+}
+
+typedef struct
+{
+    const uint8_t *p;
+    size_t         i;
+} cache_reader_t;
+
+static int LoadImmediate( void *out, cache_reader_t *r, size_t size )
+{
+    if( r->i < size )
+        return -1;
+
+    memcpy( out, r->p, size );
+    r->p += size;
+    r->i -= size;
+    return 0;
+}
+
+static int LoadString( const char **restrict p, cache_reader_t *r )
+{
+    uint32_t size;
+
+    if( LoadImmediate( &size, r, sizeof (size) ) )
+        return -1;
+
+    if( size == 0 )
+    {
+        *p = NULL;
+        return 0;
+    }
+
+    const char *str = (const char *)r->p;
+
+    if( r->i < size || str[size - 1] != '\0' )
+        return -1;
+
+    r->p += size;
+    r->i -= size;
+    *p = str;
+    return 0;
+}
+
+#define LOAD_IMMEDIATE( a ) \
+    if( LoadImmediate( &(a), r, sizeof (a) ) ) \
+        goto error
+#define LOAD_STRING( a ) \
+    if( LoadString( &(a), r ) ) \
+        goto error
+
+static void SaveEs( struct vlc_memstream *ms, const es_format_t *fmt )
+{
+    SAVE_IMMEDIATE( fmt->i_cat );
+    SAVE_IMMEDIATE( fmt->i_codec );
+    SAVE_IMMEDIATE( fmt->i_original_fourcc );
+    SAVE_IMMEDIATE( fmt->i_id );
+    SAVE_IMMEDIATE( fmt->i_group );
+    SAVE_IMMEDIATE( fmt->i_priority );
+    SAVE_IMMEDIATE( fmt->i_bitrate );
+    SAVE_IMMEDIATE( fmt->i_profile );
+    SAVE_IMMEDIATE( fmt->i_level );
+    SaveString( ms, fmt->psz_language );
+    SaveString( ms, fmt->psz_description );
+
+    switch( fmt->i_cat )
+    {
+        case AUDIO_ES:
+            SAVE_IMMEDIATE( fmt->audio );
+            SAVE_IMMEDIATE( fmt->audio_replay_gain );
+            break;
+        case VIDEO_ES:
+            SAVE_IMMEDIATE( fmt->video ); /* the palette is not kept */
+            break;
+    }
+}
+
+static int LoadEs( es_format_t *fmt, cache_reader_t *r )
+{
+    const char *psz_language, *psz_description;
+    int i_cat;
+
+    LOAD_IMMEDIATE( i_cat );
+    es_format_Init( fmt, i_cat, 0 );
+    LOAD_IMMEDIATE( fmt->i_codec );
+    LOAD_IMMEDIATE( fmt->i_original_fourcc );
+    LOAD_IMMEDIATE( fmt->i_id );
+    LOAD_IMMEDIATE( fmt->i_group );
+    LOAD_IMMEDIATE( fmt->i_priority );
+    LOAD_IMMEDIATE( fmt->i_bitrate );
+    LOAD_IMMEDIATE( fmt->i_profile );
+    LOAD_IMMEDIATE( fmt->i_level );
+    LOAD_STRING( psz_language );
+    LOAD_STRING( psz_description );
+
+    switch( i_cat )
+    {
+        case AUDIO_ES:
+            LOAD_IMMEDIATE( fmt->audio );
+            LOAD_IMMEDIATE( fmt->audio_replay_gain );
+            break;
+        case VIDEO_ES:
+            LOAD_IMMEDIATE( fmt->video );
+            fmt->video.p_palette = NULL;
+            break;
+    }
+
+    /* The strings are owned by the record, es_format_Copy() duplicates them */
+    fmt->psz_language = (char *)psz_language;
+    fmt->psz_description = (char *)psz_description;
+    return 0;
+error:
+    return -1;
+}
+
+/* Serializes the preparsing results of an item, with the item lock held */
+static void SaveItem( struct vlc_memstream *ms, input_item_t *p_item )
+{
+    SAVE_IMMEDIATE( p_item->i_duration );
+
+    uint32_t i_count = VLC_META_TYPE_COUNT;
+    SAVE_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+        SaveString( ms, p_item->p_meta != NULL ?
+                        vlc_meta_Get( p_item->p_meta, i ) : NULL );
+
+    char **ppsz_names = p_item->p_meta != NULL ?
+                        vlc_meta_CopyExtraNames( p_item->p_meta ) : NULL;
+    i_count = 0;
+    while( ppsz_names != NULL && ppsz_names[i_count] != NULL )
+        i_count++;
+    SAVE_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        SaveString( ms, ppsz_names[i] );
+        SaveString( ms, vlc_meta_GetExtra( p_item->p_meta, ppsz_names[i] ) );
+        free( ppsz_names[i] );
+    }
+    free( ppsz_names );
+
+    i_count = p_item->i_es;
+    SAVE_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+        SaveEs( ms, p_item->es[i] );
+
+    i_count = p_item->i_categories;
+    SAVE_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const info_category_t *p_cat = p_item->pp_categories[i];
+        uint32_t i_infos = p_cat->i_infos;
+
+        SaveString( ms, p_cat->psz_name );
+        SAVE_IMMEDIATE( i_infos );
+        for( unsigned j = 0; j < i_infos; j++ )
+        {
+            SaveString( ms, p_cat->pp_infos[j]->psz_name );
+            SaveString( ms, p_cat->pp_infos[j]->psz_value );
+        }
+    }
+}
+
+/* Fills an item from a record that was checked by CheckItem() */
+static void LoadItem( input_item_t *p_item, cache_reader_t *r )
+{
+    mtime_t i_duration;
+    uint32_t i_count;
+
+#define LOAD_CHECKED( a ) \
+    if( LoadImmediate( &(a), r, sizeof (a) ) ) \
+        return
+    LOAD_CHECKED( i_duration );
+    input_item_SetDuration( p_item, i_duration );
+
+    LOAD_CHECKED( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const char *psz_value;
+
+        LoadString( &psz_value, r );
+        if( psz_value != NULL && i < VLC_META_TYPE_COUNT )
+            input_item_SetMeta( p_item, i, psz_value );
+    }
+
+    LOAD_CHECKED( i_count );
+    vlc_mutex_lock( &p_item->lock );
+    if( p_item->p_meta == NULL )
+        p_item->p_meta = vlc_meta_New();
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const char *psz_name, *psz_value;
+
+        LoadString( &psz_name, r );
+        LoadString( &psz_value, r );
+        if( p_item->p_meta != NULL && psz_name != NULL )
+            vlc_meta_AddExtra( p_item->p_meta, psz_name, psz_value );
+    }
+    vlc_mutex_unlock( &p_item->lock );
+
+    LOAD_CHECKED( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        es_format_t fmt;
+
+        LoadEs( &fmt, r );
+        input_item_UpdateTracksInfo( p_item, &fmt );
+    }
+
+    LOAD_CHECKED( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const char *psz_cat;
+        uint32_t i_infos;
+
+        LoadString( &psz_cat, r );
+        LOAD_CHECKED( i_infos );
+        for( unsigned j = 0; j < i_infos; j++ )
+        {
+            const char *psz_name, *psz_value;
+
+            LoadString( &psz_name, r );
+            LoadString( &psz_value, r );
+            if( psz_cat != NULL && psz_name != NULL )
+                input_item_AddInfo( p_item, psz_cat, psz_name, "%s",
+                                    psz_value ? psz_value : "" );
+        }
+    }
+#undef LOAD_CHECKED
+}
+
+/* Walks a record without using it, so that a corrupted one is not half
+ * applied to an item */
+static int CheckItem( cache_reader_t *r )
+{
+    mtime_t i_duration;
+    uint32_t i_count, i_infos;
+    const char *psz;
+    es_format_t fmt;
+
+    LOAD_IMMEDIATE( i_duration );
+    LOAD_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+        LOAD_STRING( psz );
+    LOAD_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < 2 * i_count; i++ )
+        LOAD_STRING( psz );
+    LOAD_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+        if( LoadEs( &fmt, r ) )
+            goto error;
+    LOAD_IMMEDIATE( i_count );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        LOAD_STRING( psz );
+        LOAD_IMMEDIATE( i_infos );
+        for( unsigned j = 0; j < 2 * i_infos; j++ )
+            LOAD_STRING( psz );
+    }
+    return r->i == 0 ? 0 : -1;
+error:
+    return -1;
+}
+
+/*****************************************************************************
+ * Entries
+ *****************************************************************************/
+static void EntryDelete( void *data, void *obj )
+{
+    cache_entry_t *p_entry = data;
+
+    free( p_entry->psz_uri );
+    free( p_entry->p_data );
+    free( p_entry );
+    (void) obj;
+}
+
+static void Unlink( preparse_cache_t *p_cache, cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev != NULL )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next != NULL )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void Append( preparse_cache_t *p_cache, cache_entry_t *p_entry )
+{
+    p_entry->p_next = NULL;
+    p_entry->p_prev = p_cache->p_last;
+    if( p_cache->p_last != NULL )
+        p_cache->p_last->p_next = p_entry;
+    else
+        p_cache->p_first = p_entry;
+    p_cache->p_last = p_entry;
+}
+
+/* Adds or replaces an entry, and evicts the least recently used ones */
+static void Insert( preparse_cache_t *p_cache, cache_entry_t *p_entry )
+{
+    cache_entry_t *p_old =
+        vlc_dictionary_value_for_key( &p_cache->entries, p_entry->psz_uri );
+    if( p_old != NULL )
+    {
+        Unlink( p_cache, p_old );
+        vlc_dictionary_remove_value_for_key( &p_cache->entries,
+                                             p_old->psz_uri, EntryDelete, NULL );
+        p_cache->i_entries--;
+    }
+
+    vlc_dictionary_insert( &p_cache->entries, p_entry->psz_uri, p_entry );
+    Append( p_cache, p_entry );
+    p_cache->i_entries++;
+
+    while( p_cache->i_entries > p_cache->i_max )
+    {
+        cache_entry_t *p_lru = p_cache->p_first;
+
+        Unlink( p_cache, p_lru );
+        vlc_dictionary_remove_value_for_key( &p_cache->entries,
+                                             p_lru->psz_uri, EntryDelete, NULL );
+        p_cache->i_entries--;
+    }
+}
+
+/*****************************************************************************
+ * Cache file
+ *****************************************************************************/
+static void CacheLoad( preparse_cache_t *p_cache )
+{
+    char *psz_filename;
+
+    if( asprintf( &psz_filename, "%s"DIR_SEP CACHE_NAME, p_cache->psz_dir ) == -1 )
+        return;
+
+    block_t *file = block_FilePath( psz_filename, false );
+    free( psz_filename );
+    if( file == NULL )
+        return;
+
+    cache_reader_t reader = { file->p_buffer, file->i_buffer }, *r = &reader;
+    char cachestr[sizeof (CACHE_STRING) - 1];
+
+    if( LoadImmediate( cachestr, r, sizeof (cachestr) )
+     || memcmp( cachestr, CACHE_STRING, sizeof (cachestr) ) )
+    {
+        msg_Warn( p_cache->object, "This doesn't look like a valid preparse "
+                  "cache" );
+        block_Release( file );
+        return;
+    }
+
+    while( r->i > 0 )
+    {
+        const char *psz_uri;
+        int64_t i_mtime;
+        uint64_t i_size;
+        uint32_t i_data;
+
+        LOAD_STRING( psz_uri );
+        LOAD_IMMEDIATE( i_mtime );
+        LOAD_IMMEDIATE( i_size );
+        LOAD_IMMEDIATE( i_data );
+        if( psz_uri == NULL || r->i < i_data )
+            goto error;
+
+        cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+        if( unlikely(p_entry == NULL) )
+            break;
+        p_entry->psz_uri = strdup( psz_uri );
+        p_entry->i_mtime = i_mtime;
+        p_entry->i_size = i_size;
+        p_entry->p_data = malloc( i_data );
+        p_entry->i_data = i_data;
+        if( unlikely(p_entry->psz_uri == NULL || p_entry->p_data == NULL) )
+        {
+            EntryDelete( p_entry, NULL );
+            break;
+        }
+        memcpy( p_entry->p_data, r->p, i_data );
+        r->p += i_data;
+        r->i -= i_data;
+
+        Insert( p_cache, p_entry );
+    }
+
+    msg_Dbg( p_cache->object, "loaded %u preparsed items", p_cache->i_entries );
+    block_Release( file );
+    return;
+
+error:
+    msg_Warn( p_cache->object, "preparse cache truncated (corrupted)" );
+    p_cache->b_dirty = true;
+    block_Release( file );
+}
+
+static int CacheSaveEntries( FILE *file, const preparse_cache_t *p_cache )
+{
+    if( fputs( CACHE_STRING, file ) == EOF )
+        return -1;
+
+    for( const cache_entry_t *p_entry = p_cache->p_first; p_entry != NULL;
+         p_entry = p_entry->p_next )
+    {
+        uint32_t i_uri = strlen( p_entry->psz_uri ) + 1;
+        uint32_t i_data = p_entry->i_data;
+
+        if( fwrite( &i_uri, sizeof (i_uri), 1, file ) != 1
+         || fwrite( p_entry->psz_uri, 1, i_uri, file ) != i_uri
+         || fwrite( &p_entry->i_mtime, sizeof (p_entry->i_mtime), 1, file ) != 1
+         || fwrite( &p_entry->i_size, sizeof (p_entry->i_size), 1, file ) != 1
+         || fwrite( &i_data, sizeof (i_data), 1, file ) != 1
+         || fwrite( p_entry->p_data, 1, i_data, file ) != i_data )
+            return -1;
+    }
+
+    return fflush( file ) ? -1 : 0;
+}
+
+static void CacheSave( preparse_cache_t *p_cache )
+{
+    char *filename = NULL, *tmpname = NULL;
+
+    vlc_mkdir( p_cache->psz_dir, 0700 );
+    if( asprintf( &filename, "%s"DIR_SEP CACHE_NAME, p_cache->psz_dir ) == -1 )
+        goto out;
+
+    if( asprintf( &tmpname, "%s.%"PRIu32, filename, (uint32_t)getpid() ) == -1 )
+        goto out;
+
+    FILE *file = vlc_fopen( tmpname, "wb" );
+    if( file == NULL )
+    {
+        msg_Warn( p_cache->object, "cannot create %s: %s", tmpname,
+                  vlc_strerror_c(errno) );
+        goto out;
+    }
+
+    if( CacheSaveEntries( file, p_cache ) )
+    {
+        msg_Warn( p_cache->object, "cannot write %s: %s", tmpname,
+                  vlc_strerror_c(errno) );
+        clearerr( file );
+        fclose( file );
+        vlc_unlink( tmpname );
+        goto out;
+    }
+
+#if !defined( _WIN32 ) && !defined( __OS2__ )
+    vlc_rename( tmpname, filename ); /* atomically replace old cache */
+    fclose( file );
+#else
+    vlc_unlink( filename );
+    fclose( file );
+    vlc_rename( tmpname, filename );
+#endif
+out:
+    free( filename );
+    free( tmpname );
+}
+
+/*****************************************************************************
+ * Public functions
+ *****************************************************************************/
+preparse_cache_t *preparse_cache_New( vlc_object_t *parent )
+{
+    if( !var_InheritBool( parent, "preparse-cache" ) )
+        return NULL;
+
+    preparse_cache_t *p_cache = malloc( sizeof(*p_cache) );
+    if( unlikely(p_cache == NULL) )
+        return NULL;
+
+    p_cache->psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( unlikely(p_cache->psz_dir == NULL) )
+    {
+        free( p_cache );
+        return NULL;
+    }
+    p_cache->object = parent;
+    p_cache->i_max = var_InheritInteger( parent, "preparse-cache-size" );
+
+    vlc_mutex_init( &p_cache->lock );
+    p_cache->b_loaded = false;
+    p_cache->b_dirty = false;
+    vlc_dictionary_init( &p_cache->entries, 256 );
+    p_cache->i_entries = 0;
+    p_cache->p_first = p_cache->p_last = NULL;
+    p_cache->i_hits = 0;
+    p_cache->i_misses = 0;
+    return p_cache;
+}
+
+/* Returns the URI of a regular local file, and its identity */
+static char *GetIdentity( input_item_t *p_item, int64_t *pi_mtime,
+                          uint64_t *pi_size )
+{
+    vlc_mutex_lock( &p_item->lock );
+    char *psz_uri = ( p_item->i_type == ITEM_TYPE_FILE && !p_item->b_net ) ?
+                    strdup( p_item->psz_uri ) : NULL;
+    vlc_mutex_unlock( &p_item->lock );
+    if( psz_uri == NULL )
+        return NULL;
+
+    char *psz_path = vlc_uri2path( psz_uri );
+    struct stat st;
+
+    if( psz_path == NULL || vlc_stat( psz_path, &st ) || !S_ISREG(st.st_mode) )
+    {
+        free( psz_path );
+        free( psz_uri );
+        return NULL;
+    }
+    free( psz_path );
+
+    *pi_mtime = st.st_mtime;
+    *pi_size = st.st_size;
+    return psz_uri;
+}
+
+bool preparse_cache_Load( preparse_cache_t *p_cache, input_item_t *p_item )
+{
+    int64_t i_mtime;
+    uint64_t i_size;
+    char *psz_uri = GetIdentity( p_item, &i_mtime, &i_size );
+    if( psz_uri == NULL )
+        return false;
+
+    uint8_t *p_data = NULL;
+    size_t i_data = 0;
+
+    vlc_mutex_lock( &p_cache->lock );
+    if( !p_cache->b_loaded )
+    {
+        CacheLoad( p_cache );
+        p_cache->b_loaded = true;
+    }
+
+    cache_entry_t *p_entry =
+        vlc_dictionary_value_for_key( &p_cache->entries, psz_uri );
+    if( p_entry != NULL && p_entry->i_mtime == i_mtime
+     && p_entry->i_size == i_size )
+    {
+        /* Apply a copy outside the lock, the item sends events */
+        p_data = malloc( p_entry->i_data );
+        if( likely(p_data != NULL) )
+        {
+            memcpy( p_data, p_entry->p_data, p_entry->i_data );
+            i_data = p_entry->i_data;
+            Unlink( p_cache, p_entry );
+            Append( p_cache, p_entry );
+        }
+    }
+    if( p_data != NULL )
+        p_cache->i_hits++;
+    else
+        p_cache->i_misses++;
+    vlc_mutex_unlock( &p_cache->lock );
+    free( psz_uri );
+
+    if( p_data == NULL )
+        return false;
+
+    cache_reader_t reader = { p_data, i_data };
+    bool b_valid = CheckItem( &reader ) == 0;
+    if( b_valid )
+    {
+        reader.p = p_data;
+        reader.i = i_data;
+        LoadItem( p_item, &reader );
+    }
+    free( p_data );
+    return b_valid;
+}
+
+void preparse_cache_Store( preparse_cache_t *p_cache, input_item_t *p_item )
+{
+    int64_t i_mtime;
+    uint64_t i_size;
+    char *psz_uri = GetIdentity( p_item, &i_mtime, &i_size );
+    if( psz_uri == NULL )
+        return;
+
+    struct vlc_memstream ms;
+
+    if( vlc_memstream_open( &ms ) )
+    {
+        free( psz_uri );
+        return;
+    }
+
+    vlc_mutex_lock( &p_item->lock );
+    /* Playlists and directories only have sub-items, which are not cached */
+    bool b_tracks = p_item->i_es > 0;
+    if( b_tracks )
+        SaveItem( &ms, p_item );
+    vlc_mutex_unlock( &p_item->lock );
+
+    if( vlc_memstream_close( &ms ) )
+    {
+        free( psz_uri );
+        return;
+    }
+    if( !b_tracks || ms.length > CACHE_RECORD_MAX )
+    {
+        free( ms.ptr );
+        free( psz_uri );
+        return;
+    }
+
+    cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( unlikely(p_entry == NULL) )
+    {
+        free( ms.ptr );
+        free( psz_uri );
+        return;
+    }
+    p_entry->psz_uri = psz_uri;
+    p_entry->i_mtime = i_mtime;
+    p_entry->i_size = i_size;
+    p_entry->p_data = (uint8_t *)ms.ptr;
+    p_entry->i_data = ms.length;
+
+    vlc_mutex_lock( &p_cache->lock );
+    if( !p_cache->b_loaded )
+    {
+        CacheLoad( p_cache );
+        p_cache->b_loaded = true;
+    }
+    Insert( p_cache, p_entry );
+    p_cache->b_dirty = true;
+    vlc_mutex_unlock( &p_cache->lock );
+}
+
+void preparse_cache_Delete( preparse_cache_t *p_cache )
+{
+    if( p_cache->i_hits + p_cache->i_misses > 0 )
+        msg_Dbg( p_cache->object, "preparse cache: %u hits, %u misses",
+                 p_cache->i_hits, p_cache->i_misses );
+
+    if( p_cache->b_dirty )
+        CacheSave( p_cache );
+
+    vlc_dictionary_clear( &p_cache->entries, EntryDelete, NULL );
+    vlc_mutex_destroy( &p_cache->lock );
+    free( p_cache->psz_dir );
+    free( p_cache );
+}
@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * preparse_cache.h: persistent cache of preparsing results
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PLAYLIST_PREPARSE_CACHE_H
+#define _PLAYLIST_PREPARSE_CACHE_H 1
+
+#include <vlc_input_item.h>
+
+/**
+ * Preparse cache opaque structure.
+ *
+ * The cache remembers what preparsing found about local files (duration,
+ * tracks, meta data and information) across sessions. An entry is only used
+ * while the size and modification time of the file are unchanged.
+ */
+typedef struct preparse_cache_t preparse_cache_t;
+
+/**
+ * This function creates the cache object.
+ *
+ * The cache file is only read on the first lookup.
+ * \return NULL if the cache is disabled or on error
+ */
+preparse_cache_t *preparse_cache_New( vlc_object_t * );
+
+/**
+ * This function fills an input item from the cache.
+ *
+ * \return true if the item was found and is up to date
+ */
+bool preparse_cache_Load( preparse_cache_t *, input_item_t * );
+
+/**
+ * This function stores the preparsing results of an input item.
+ */
+void preparse_cache_Store( preparse_cache_t *, input_item_t * );
+
+/**
+ * This function saves the cache file if it was modified and destroys the
+ * cache object.
+ */
+void preparse_cache_Delete( preparse_cache_t * );
+
+#endif
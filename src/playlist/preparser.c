@@ -31,6 +31,7 @@
 
 #include "fetcher.h"
 #include "preparser.h"
+#include "preparse_cache.h"
 #include "input/input_interface.h"
 
 /*****************************************************************************
@@ -42,29 +43,60 @@ struct preparser_entry_t
 {
     input_item_t    *p_item;
     input_item_meta_request_option_t i_options;
-    void            *id;
+    int              i_ids;
+    void           **pp_ids; /**< requesters, for cancellation */
     mtime_t          timeout;
+    mtime_t          i_queued;
+    preparser_entry_t *p_next;
 };
 
-struct playlist_preparser_t
+/* Requests from the user first, then the ones from library scans */
+enum
 {
-    vlc_object_t        *object;
-    playlist_fetcher_t  *p_fetcher;
-    mtime_t              default_timeout;
+    QUEUE_INTERACTIVE,
+    QUEUE_BACKGROUND,
+    QUEUE_COUNT
+};
+
+typedef struct
+{
+    preparser_entry_t  *p_first;
+    preparser_entry_t **pp_last;
 
-    void                *input_id;
+    /* Statistics */
+    unsigned        i_done;
+    mtime_t         i_wait; /**< total time spent in the queue */
+    mtime_t         i_probe; /**< total time spent preparsing */
+} preparser_queue_t;
+
+/* An item being preparsed by a worker */
+typedef struct preparser_task_t
+{
+    playlist_preparser_t *preparser;
+    preparser_entry_t *p_entry;
+    vlc_cond_t       wait;
     enum {
         INPUT_RUNNING,
         INPUT_STOPPED,
         INPUT_CANCELED,
     } input_state;
+    struct preparser_task_t *p_next;
+} preparser_task_t;
+
+struct playlist_preparser_t
+{
+    vlc_object_t        *object;
+    playlist_fetcher_t  *p_fetcher;
+    preparse_cache_t    *p_cache;
+    mtime_t              default_timeout;
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    vlc_cond_t      thread_wait;
-    bool            b_live;
-    preparser_entry_t  **pp_waiting;
-    size_t          i_waiting;
+    unsigned        i_threads;
+    unsigned        i_live;
+    bool            b_closing;
+    preparser_queue_t queues[QUEUE_COUNT];
+    preparser_task_t *p_tasks; /**< items being preparsed */
 };
 
 static void *Thread( void * );
@@ -78,48 +110,160 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
     if( !p_preparser )
         return NULL;
 
-    p_preparser->input_id = NULL;
-    p_preparser->input_state = INPUT_RUNNING;
     p_preparser->object = parent;
     p_preparser->default_timeout = var_InheritInteger( parent, "preparse-timeout" );
     p_preparser->p_fetcher = playlist_fetcher_New( parent );
     if( unlikely(p_preparser->p_fetcher == NULL) )
         msg_Err( parent, "cannot create fetcher" );
+    p_preparser->p_cache = preparse_cache_New( parent );
 
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    vlc_cond_init( &p_preparser->thread_wait );
-    p_preparser->b_live = false;
-    p_preparser->i_waiting = 0;
-    p_preparser->pp_waiting = NULL;
+    p_preparser->i_threads = var_InheritInteger( parent, "preparse-threads" );
+    p_preparser->i_live = 0;
+    p_preparser->b_closing = false;
+    for( unsigned i = 0; i < QUEUE_COUNT; i++ )
+    {
+        preparser_queue_t *p_queue = &p_preparser->queues[i];
+
+        p_queue->p_first = NULL;
+        p_queue->pp_last = &p_queue->p_first;
+        p_queue->i_done = 0;
+        p_queue->i_wait = 0;
+        p_queue->i_probe = 0;
+    }
+    p_preparser->p_tasks = NULL;
 
     return p_preparser;
 }
 
+static void EntryDelete( preparser_entry_t *p_entry )
+{
+    vlc_gc_decref( p_entry->p_item );
+    TAB_CLEAN( p_entry->i_ids, p_entry->pp_ids );
+    free( p_entry );
+}
+
+static void EntryAddId( preparser_entry_t *p_entry, void *id )
+{
+    int i_index;
+
+    TAB_FIND( p_entry->i_ids, p_entry->pp_ids, id, i_index );
+    if( i_index < 0 )
+        TAB_APPEND( p_entry->i_ids, p_entry->pp_ids, id );
+}
+
+/* Removes a requester, returns true if the entry is not wanted anymore */
+static bool EntryRemoveId( preparser_entry_t *p_entry, void *id )
+{
+    int i_index;
+
+    TAB_FIND( p_entry->i_ids, p_entry->pp_ids, id, i_index );
+    if( i_index < 0 )
+        return false;
+    TAB_ERASE( p_entry->i_ids, p_entry->pp_ids, i_index );
+    return p_entry->i_ids == 0;
+}
+
+static void QueueAppend( preparser_queue_t *p_queue, preparser_entry_t *p_entry )
+{
+    p_entry->p_next = NULL;
+    *p_queue->pp_last = p_entry;
+    p_queue->pp_last = &p_entry->p_next;
+}
+
+static void QueueRemove( preparser_queue_t *p_queue, preparser_entry_t **pp )
+{
+    preparser_entry_t *p_entry = *pp;
+
+    *pp = p_entry->p_next;
+    if( p_queue->pp_last == &p_entry->p_next )
+        p_queue->pp_last = pp;
+}
+
+/* Finds a request for the same item, with the lock held. The item is only
+ * preparsed once, and every requester gets the result from its events. */
+static bool Merge( playlist_preparser_t *p_preparser, input_item_t *p_item,
+                   input_item_meta_request_option_t i_options,
+                   mtime_t timeout, void *id, unsigned i_queue )
+{
+    for( preparser_task_t *p_task = p_preparser->p_tasks; p_task != NULL;
+         p_task = p_task->p_next )
+        if( p_task->p_entry->p_item == p_item
+         && !( i_options & ~p_task->p_entry->i_options
+                         & ~META_REQUEST_OPTION_BACKGROUND ) )
+        {
+            EntryAddId( p_task->p_entry, id );
+            return true;
+        }
+
+    for( unsigned i = 0; i < QUEUE_COUNT; i++ )
+    {
+        preparser_queue_t *p_queue = &p_preparser->queues[i];
+
+        for( preparser_entry_t **pp = &p_queue->p_first; *pp != NULL;
+             pp = &(*pp)->p_next )
+        {
+            preparser_entry_t *p_entry = *pp;
+            if( p_entry->p_item != p_item )
+                continue;
+
+            EntryAddId( p_entry, id );
+            /* The most patient requester sets the timeout */
+            if( p_entry->timeout > 0
+             && ( timeout <= 0 || timeout > p_entry->timeout ) )
+                p_entry->timeout = timeout;
+            p_entry->i_options |= i_options;
+            if( i_queue < i )
+            {   /* Move it ahead of the background requests */
+                QueueRemove( p_queue, pp );
+                QueueAppend( &p_preparser->queues[i_queue], p_entry );
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
 void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item,
                               input_item_meta_request_option_t i_options,
                               int timeout, void *id )
 {
+    unsigned i_queue = ( i_options & META_REQUEST_OPTION_BACKGROUND ) ?
+                       QUEUE_BACKGROUND : QUEUE_INTERACTIVE;
+    mtime_t i_timeout = ( timeout < 0 ? p_preparser->default_timeout
+                                      : timeout ) * 1000;
+
+    vlc_mutex_lock( &p_preparser->lock );
+    if( Merge( p_preparser, p_item, i_options, i_timeout, id, i_queue ) )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
+        return;
+    }
+
     preparser_entry_t *p_entry = malloc( sizeof(preparser_entry_t) );
 
     if ( !p_entry )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
         return;
+    }
     p_entry->p_item = p_item;
     p_entry->i_options = i_options;
-    p_entry->id = id;
-    p_entry->timeout = (timeout < 0 ? p_preparser->default_timeout : timeout) * 1000;
+    TAB_INIT( p_entry->i_ids, p_entry->pp_ids );
+    TAB_APPEND( p_entry->i_ids, p_entry->pp_ids, id );
+    p_entry->timeout = i_timeout;
+    p_entry->i_queued = mdate();
     vlc_gc_incref( p_entry->p_item );
 
-    vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_entry );
-    if( !p_preparser->b_live )
+    QueueAppend( &p_preparser->queues[i_queue], p_entry );
+    if( p_preparser->i_live < p_preparser->i_threads )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
         else
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
@@ -136,24 +280,32 @@ void playlist_preparser_Cancel( playlist_preparser_t *p_preparser, void *id )
     assert( id != NULL );
     vlc_mutex_lock( &p_preparser->lock );
 
-    /* Remove entries that match with the id */
-    for( int i = p_preparser->i_waiting - 1; i >= 0; --i )
+    /* Remove entries only requested with the id */
+    for( unsigned i = 0; i < QUEUE_COUNT; i++ )
     {
-        preparser_entry_t *p_entry = p_preparser->pp_waiting[i];
-        if( p_entry->id == id )
+        preparser_queue_t *p_queue = &p_preparser->queues[i];
+
+        for( preparser_entry_t **pp = &p_queue->p_first; *pp != NULL; )
         {
-            vlc_gc_decref( p_entry->p_item );
-            free( p_entry );
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i );
+            preparser_entry_t *p_entry = *pp;
+            if( EntryRemoveId( p_entry, id ) )
+            {
+                QueueRemove( p_queue, pp );
+                EntryDelete( p_entry );
+            }
+            else
+                pp = &p_entry->p_next;
         }
     }
 
-    /* Stop the input_thread reading the item (if any) */
-    if( p_preparser->input_id == id )
-    {
-        p_preparser->input_state = INPUT_CANCELED;
-        vlc_cond_signal( &p_preparser->thread_wait );
-    }
+    /* Stop the input_threads reading the items (if any) */
+    for( preparser_task_t *p_task = p_preparser->p_tasks; p_task != NULL;
+         p_task = p_task->p_next )
+        if( EntryRemoveId( p_task->p_entry, id ) )
+        {
+            p_task->input_state = INPUT_CANCELED;
+            vlc_cond_signal( &p_task->wait );
+        }
     vlc_mutex_unlock( &p_preparser->lock );
 }
 
@@ -161,28 +313,53 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 {
     vlc_mutex_lock( &p_preparser->lock );
     /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
+    for( unsigned i = 0; i < QUEUE_COUNT; i++ )
     {
-        preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
-        vlc_gc_decref( p_entry->p_item );
-        free( p_entry );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        preparser_queue_t *p_queue = &p_preparser->queues[i];
+
+        while( p_queue->p_first != NULL )
+        {
+            preparser_entry_t *p_entry = p_queue->p_first;
+            QueueRemove( p_queue, &p_queue->p_first );
+            EntryDelete( p_entry );
+        }
     }
 
-    p_preparser->input_state = INPUT_CANCELED;
-    vlc_cond_signal( &p_preparser->thread_wait );
+    p_preparser->b_closing = true;
+    for( preparser_task_t *p_task = p_preparser->p_tasks; p_task != NULL;
+         p_task = p_task->p_next )
+    {
+        p_task->input_state = INPUT_CANCELED;
+        vlc_cond_signal( &p_task->wait );
+    }
 
-    while( p_preparser->b_live )
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
+    static const char *const ppsz_queues[QUEUE_COUNT] = {
+        "interactive", "background"
+    };
+    for( unsigned i = 0; i < QUEUE_COUNT; i++ )
+    {
+        const preparser_queue_t *p_queue = &p_preparser->queues[i];
+
+        if( p_queue->i_done > 0 )
+            msg_Dbg( p_preparser->object, "%s preparsing: %u items, "
+                     "average wait %"PRId64" ms, average probe %"PRId64" ms",
+                     ppsz_queues[i], p_queue->i_done,
+                     p_queue->i_wait / p_queue->i_done / 1000,
+                     p_queue->i_probe / p_queue->i_done / 1000 );
+    }
+
     /* Destroy the item preparser */
-    vlc_cond_destroy( &p_preparser->thread_wait );
     vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
 
     if( p_preparser->p_fetcher != NULL )
         playlist_fetcher_Delete( p_preparser->p_fetcher );
+    if( p_preparser->p_cache != NULL )
+        preparse_cache_Delete( p_preparser->p_cache );
     free( p_preparser );
 }
 
@@ -193,15 +370,16 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 static int InputEvent( vlc_object_t *obj, const char *varname,
                        vlc_value_t old, vlc_value_t cur, void *data )
 {
-    playlist_preparser_t *preparser = data;
+    preparser_task_t *p_task = data;
+    playlist_preparser_t *preparser = p_task->preparser;
     int event = cur.i_int;
 
     if( event == INPUT_EVENT_DEAD )
     {
         vlc_mutex_lock( &preparser->lock );
 
-        preparser->input_state = INPUT_STOPPED;
-        vlc_cond_signal( &preparser->thread_wait );
+        p_task->input_state = INPUT_STOPPED;
+        vlc_cond_signal( &p_task->wait );
 
         vlc_mutex_unlock( &preparser->lock );
     }
@@ -214,8 +392,9 @@ static int InputEvent( vlc_object_t *obj, const char *varname,
  * This function preparses an item when needed.
  */
 static void Preparse( playlist_preparser_t *preparser,
-                      preparser_entry_t *p_entry )
+                      preparser_task_t *p_task )
 {
+    preparser_entry_t *p_entry = p_task->p_entry;
     input_item_t *p_item = p_entry->p_item;
 
     vlc_mutex_lock( &p_item->lock );
@@ -238,6 +417,17 @@ static void Preparse( playlist_preparser_t *preparser,
     if( b_preparse && !input_item_IsPreparsed( p_item ) )
     {
         int status;
+
+        /* Unchanged local files are not opened again */
+        if( preparser->p_cache != NULL
+         && preparse_cache_Load( preparser->p_cache, p_item ) )
+        {
+            var_SetAddress( preparser->object, "item-change", p_item );
+            input_item_SetPreparsed( p_item, true );
+            input_item_SignalPreparseEnded( p_item, ITEM_PREPARSE_DONE );
+            return;
+        }
+
         input_thread_t *input = input_CreatePreparser( preparser->object, p_item );
         if( input == NULL )
         {
@@ -245,7 +435,7 @@ static void Preparse( playlist_preparser_t *preparser,
             return;
         }
 
-        var_AddCallback( input, "intf-event", InputEvent, preparser );
+        var_AddCallback( input, "intf-event", InputEvent, p_task );
         if( input_Start( input ) == VLC_SUCCESS )
         {
             vlc_mutex_lock( &preparser->lock );
@@ -253,21 +443,21 @@ static void Preparse( playlist_preparser_t *preparser,
             if( p_entry->timeout > 0 )
             {
                 mtime_t deadline = mdate() + p_entry->timeout;
-                while( preparser->input_state == INPUT_RUNNING )
+                while( p_task->input_state == INPUT_RUNNING )
                 {
-                    if( vlc_cond_timedwait( &preparser->thread_wait,
+                    if( vlc_cond_timedwait( &p_task->wait,
                                             &preparser->lock, deadline ) )
-                        preparser->input_state = INPUT_CANCELED; /* timeout */
+                        p_task->input_state = INPUT_CANCELED; /* timeout */
                 }
             }
             else
             {
-                while( preparser->input_state == INPUT_RUNNING )
-                    vlc_cond_wait( &preparser->thread_wait, &preparser->lock );
+                while( p_task->input_state == INPUT_RUNNING )
+                    vlc_cond_wait( &p_task->wait, &preparser->lock );
             }
-            assert( preparser->input_state == INPUT_STOPPED
-                 || preparser->input_state == INPUT_CANCELED );
-            status = preparser->input_state == INPUT_STOPPED ?
+            assert( p_task->input_state == INPUT_STOPPED
+                 || p_task->input_state == INPUT_CANCELED );
+            status = p_task->input_state == INPUT_STOPPED ?
                      ITEM_PREPARSE_DONE : ITEM_PREPARSE_TIMEOUT;
 
             vlc_mutex_unlock( &preparser->lock );
@@ -275,11 +465,14 @@ static void Preparse( playlist_preparser_t *preparser,
         else
             status = ITEM_PREPARSE_FAILED;
 
-        var_DelCallback( input, "intf-event", InputEvent, preparser );
+        var_DelCallback( input, "intf-event", InputEvent, p_task );
         if( status == ITEM_PREPARSE_TIMEOUT )
             input_Stop( input );
         input_Close( input );
 
+        if( status == ITEM_PREPARSE_DONE && preparser->p_cache != NULL )
+            preparse_cache_Store( preparser->p_cache, p_item );
+
         var_SetAddress( preparser->object, "item-change", p_item );
         input_item_SetPreparsed( p_item, true );
         input_item_SignalPreparseEnded( p_item, status );
@@ -335,37 +528,56 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
 static void *Thread( void *data )
 {
     playlist_preparser_t *p_preparser = data;
+    preparser_task_t task = { .preparser = p_preparser };
 
+    vlc_cond_init( &task.wait );
+    vlc_mutex_lock( &p_preparser->lock );
     for( ;; )
     {
-        preparser_entry_t *p_entry;
+        preparser_queue_t *p_queue = NULL;
 
-        vlc_mutex_lock( &p_preparser->lock );
-        /* */
-        p_preparser->input_state = INPUT_RUNNING;
-        if( p_preparser->i_waiting > 0 )
-        {
-            p_entry = p_preparser->pp_waiting[0];
-            p_preparser->input_id = p_entry->id;
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
-        }
-        else
-        {
-            p_preparser->b_live = false;
-            p_preparser->input_id = NULL;
-            vlc_cond_signal( &p_preparser->wait );
-            vlc_mutex_unlock( &p_preparser->lock );
+        for( unsigned i = 0; i < QUEUE_COUNT && !p_preparser->b_closing; i++ )
+            if( p_preparser->queues[i].p_first != NULL )
+            {
+                p_queue = &p_preparser->queues[i];
+                break;
+            }
+        if( p_queue == NULL )
             break;
-        }
-        vlc_mutex_unlock( &p_preparser->lock );
-        assert( p_entry );
 
-        Preparse( p_preparser, p_entry );
+        preparser_entry_t *p_entry = p_queue->p_first;
+        QueueRemove( p_queue, &p_queue->p_first );
+        task.p_entry = p_entry;
+        task.input_state = INPUT_RUNNING;
+        task.p_next = p_preparser->p_tasks;
+        p_preparser->p_tasks = &task;
 
+        mtime_t i_start = mdate();
+        p_queue->i_wait += i_start - p_entry->i_queued;
+        vlc_mutex_unlock( &p_preparser->lock );
+
+        Preparse( p_preparser, &task );
         Art( p_preparser, p_entry->p_item );
-        vlc_gc_decref( p_entry->p_item );
-        free( p_entry );
+
+        vlc_mutex_lock( &p_preparser->lock );
+        p_queue->i_probe += mdate() - i_start;
+        p_queue->i_done++;
+        for( preparser_task_t **pp = &p_preparser->p_tasks; ;
+             pp = &(*pp)->p_next )
+            if( *pp == &task )
+            {
+                *pp = task.p_next;
+                break;
+            }
+        vlc_mutex_unlock( &p_preparser->lock );
+
+        EntryDelete( p_entry );
+        vlc_mutex_lock( &p_preparser->lock );
     }
+
+    p_preparser->i_live--;
+    vlc_cond_signal( &p_preparser->wait );
+    vlc_mutex_unlock( &p_preparser->lock );
+    vlc_cond_destroy( &task.wait );
     return NULL;
 }
-
@@ -30,13 +30,14 @@
  * Preparser opaque structure.
  *
  * The preparser object will retrieve the meta data of any given input item in
- * an asynchronous way.
+ * an asynchronous way, with up to "preparse-threads" items at a time.
  * It will also issue art fetching requests.
  */
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object.
+ * The preparser threads are spawned on demand.
  */
 playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
 
@@ -48,6 +49,10 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
  * Listen to vlc_InputItemPreparseEnded event to get notified when item is
  * preparsed.
  *
+ * Requests with META_REQUEST_OPTION_BACKGROUND are only served when no other
+ * request is pending. An item already pending is not queued twice: it is
+ * preparsed once for all its requesters, and only canceled with the last one.
+ *
  * @param timeout maximum time allowed to preparse the item. If -1, the default
  * "preparse-timeout" option will be used as a timeout. If 0, it will wait
  * indefinitely. If > 0, the timeout will be used (in milliseconds).
@@ -69,7 +74,7 @@ void playlist_preparser_fetcher_Push( playlist_preparser_t *, input_item_t *,
 void playlist_preparser_Cancel( playlist_preparser_t *, void *id );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function destroys the preparser object and waits for its threads.
  *
  * All pending input items will be released.
  */
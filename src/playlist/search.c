@@ -24,6 +24,10 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#include <wctype.h>
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_playlist.h>
@@ -31,9 +35,593 @@
 #include "playlist_internal.h"
 
 /***************************************************************************
- * Item search functions
+ * Search index
  ***************************************************************************/
 
+/*
+ * Every playlist item has an entry with its title, album and artist, folded
+ * to lower case. The words of these texts are indexed in a hash table, whose
+ * buckets point to the entries containing them. A query looks up its most
+ * selective part (a whole word, a word prefix, suffix or substring) among
+ * the words and only compares the text of those candidates.
+ */
+typedef struct search_entry_t
+{
+    playlist_item_t *p_item;   /**< NULL once the item was released */
+    char            *psz_text; /**< folded text, fields separated by '\n' */
+    uint32_t         i_index;  /**< position in the entries table */
+    unsigned         i_mark;   /**< last query that selected this entry */
+    bool             b_dirty;  /**< text to be indexed again */
+    bool             b_result; /**< in the results of the last query */
+} search_entry_t;
+
+typedef struct search_token_t search_token_t;
+
+struct search_token_t
+{
+    search_token_t  *p_next;    /**< next token with the same hash */
+    uint32_t        *p_entries; /**< entries containing the token */
+    size_t           i_entries;
+    size_t           i_size;
+    char             psz_token[];
+};
+
+#define SEARCH_BUCKETS 65536
+
+struct playlist_search_t
+{
+    /* Protects the index, as the item events come without the playlist
+     * lock. Lock order: playlist, then index, then input items. */
+    vlc_mutex_t      lock;
+
+    search_entry_t **pp_entries;
+    size_t           i_entries;
+    size_t           i_size;
+    size_t           i_stale;   /**< released or reindexed entries */
+    void            *input_tree; /**< input item to entry mapping */
+
+    search_token_t **pp_buckets;
+    search_token_t **pp_tokens; /**< all tokens, for partial matches */
+    size_t           i_tokens;
+    size_t           i_tokens_size;
+
+    uint32_t        *p_dirty;   /**< entries to be indexed again */
+    size_t           i_dirty;
+    size_t           i_dirty_size;
+
+    /* Last query, refined when the next one extends it */
+    char            *psz_last;
+    uint32_t        *p_results;
+    size_t           i_results;
+    size_t           i_results_size;
+    unsigned         i_mark;
+};
+
+static bool Grow( void **pp, size_t *pi_size, size_t i_count, size_t i_elem )
+{
+    if( i_count < *pi_size )
+        return true;
+
+    size_t i_size = *pi_size ? 2 * *pi_size : 16;
+    void *p = realloc( *pp, i_size * i_elem );
+    if( unlikely(p == NULL) )
+        return false;
+    *pp = p;
+    *pi_size = i_size;
+    return true;
+}
+
+#define GROW( p, size, count ) \
+    Grow( (void **)&(p), &(size), (count), sizeof (*(p)) )
+
+/**
+ * Folds a string to lower case, code point per code point like
+ * vlc_strcasestr().
+ */
+static char *SearchFold( const char *psz )
+{
+    /* A lower case code point never takes more than twice the bytes */
+    char *psz_fold = malloc( 2 * strlen( psz ) + 1 ), *p = psz_fold;
+    if( unlikely(psz_fold == NULL) )
+        return NULL;
+
+    for( ;; )
+    {
+        uint32_t cp;
+        size_t s = vlc_towc( psz, &cp );
+
+        if( s == 0 )
+            break;
+        if( s == (size_t)-1 )
+        {   /* Invalid sequence: keep the byte as is */
+            *(p++) = *(psz++);
+            continue;
+        }
+        psz += s;
+
+        cp = towlower( cp );
+        if( cp < 0x80 )
+            *(p++) = cp;
+        else if( cp < 0x800 )
+        {
+            *(p++) = 0xC0 | (cp >> 6);
+            *(p++) = 0x80 | (cp & 0x3F);
+        }
+        else if( cp < 0x10000 )
+        {
+            *(p++) = 0xE0 | (cp >> 12);
+            *(p++) = 0x80 | ((cp >> 6) & 0x3F);
+            *(p++) = 0x80 | (cp & 0x3F);
+        }
+        else
+        {
+            *(p++) = 0xF0 | (cp >> 18);
+            *(p++) = 0x80 | ((cp >> 12) & 0x3F);
+            *(p++) = 0x80 | ((cp >> 6) & 0x3F);
+            *(p++) = 0x80 | (cp & 0x3F);
+        }
+    }
+    *p = '\0';
+    return psz_fold;
+}
+
+/* Words are made of letters, digits and any non-ASCII character */
+static bool IsWordChar( unsigned char c )
+{
+    return c >= 0x80 || ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'z' );
+}
+
+static uint32_t TokenHash( const char *psz, size_t i_len )
+{
+    uint32_t h = 2166136261u; /* FNV-1a */
+
+    for( size_t i = 0; i < i_len; i++ )
+        h = ( h ^ (unsigned char)psz[i] ) * 16777619u;
+    return h % SEARCH_BUCKETS;
+}
+
+static search_token_t *TokenFind( playlist_search_t *s, const char *psz,
+                                  size_t i_len )
+{
+    for( search_token_t *t = s->pp_buckets[TokenHash( psz, i_len )];
+         t != NULL; t = t->p_next )
+        if( !strncmp( t->psz_token, psz, i_len ) && t->psz_token[i_len] == '\0' )
+            return t;
+    return NULL;
+}
+
+static void TokenAdd( playlist_search_t *s, const char *psz, size_t i_len,
+                      uint32_t i_entry )
+{
+    search_token_t *t = TokenFind( s, psz, i_len );
+
+    if( t == NULL )
+    {
+        if( !GROW( s->pp_tokens, s->i_tokens_size, s->i_tokens ) )
+            return;
+        t = malloc( sizeof(*t) + i_len + 1 );
+        if( unlikely(t == NULL) )
+            return;
+
+        uint32_t h = TokenHash( psz, i_len );
+        memcpy( t->psz_token, psz, i_len );
+        t->psz_token[i_len] = '\0';
+        t->p_entries = NULL;
+        t->i_entries = t->i_size = 0;
+        t->p_next = s->pp_buckets[h];
+        s->pp_buckets[h] = t;
+        s->pp_tokens[s->i_tokens++] = t;
+    }
+
+    /* The same word twice in an entry */
+    if( t->i_entries > 0 && t->p_entries[t->i_entries - 1] == i_entry )
+        return;
+    if( GROW( t->p_entries, t->i_size, t->i_entries ) )
+        t->p_entries[t->i_entries++] = i_entry;
+}
+
+static void Tokenize( playlist_search_t *s, uint32_t i_entry )
+{
+    const char *psz = s->pp_entries[i_entry]->psz_text;
+
+    for( ;; )
+    {
+        while( *psz != '\0' && !IsWordChar( *psz ) )
+            psz++;
+        if( *psz == '\0' )
+            break;
+
+        const char *psz_start = psz;
+        while( IsWordChar( *psz ) )
+            psz++;
+        TokenAdd( s, psz_start, psz - psz_start, i_entry );
+    }
+}
+
+/* Title (or name), album and artist, like the search always used */
+static char *GetText( input_item_t *p_input )
+{
+    char *psz_text = NULL;
+
+    vlc_mutex_lock( &p_input->lock );
+    if( p_input->p_meta != NULL )
+    {
+        const char *psz_title = vlc_meta_Get( p_input->p_meta, vlc_meta_Title );
+        const char *psz_album = vlc_meta_Get( p_input->p_meta, vlc_meta_Album );
+        const char *psz_artist = vlc_meta_Get( p_input->p_meta, vlc_meta_Artist );
+        if( psz_title == NULL )
+            psz_title = p_input->psz_name;
+
+        if( asprintf( &psz_text, "%s\n%s\n%s", psz_title ? psz_title : "",
+                      psz_album ? psz_album : "",
+                      psz_artist ? psz_artist : "" ) == -1 )
+            psz_text = NULL;
+    }
+    else if( p_input->psz_name != NULL )
+        psz_text = strdup( p_input->psz_name );
+    vlc_mutex_unlock( &p_input->lock );
+
+    if( psz_text == NULL )
+        return NULL;
+
+    char *psz_fold = SearchFold( psz_text );
+    free( psz_text );
+    return psz_fold;
+}
+
+static int EntryCmp( const void *a, const void *b )
+{
+    const search_entry_t *pa = a, *pb = b;
+
+    if( pa->p_item->p_input == pb->p_item->p_input )
+        return 0;
+    return (((uintptr_t)pa->p_item->p_input) > ((uintptr_t)pb->p_item->p_input))
+        ? +1 : -1;
+}
+
+static search_entry_t *EntryFind( playlist_search_t *s, input_item_t *p_input )
+{
+    playlist_item_t item = { .p_input = p_input };
+    search_entry_t key = { .p_item = &item }, **pp;
+
+    pp = tfind( &key, &s->input_tree, EntryCmp );
+    return (pp != NULL) ? *pp : NULL;
+}
+
+/* Adds an entry to the results of the last query, if it matches */
+static void Refine( playlist_search_t *s, uint32_t i_entry )
+{
+    search_entry_t *e = s->pp_entries[i_entry];
+
+    if( s->psz_last == NULL || e->b_result || e->psz_text == NULL
+     || strstr( e->psz_text, s->psz_last ) == NULL )
+        return;
+
+    if( GROW( s->p_results, s->i_results_size, s->i_results ) )
+    {
+        s->p_results[s->i_results++] = i_entry;
+        e->b_result = true;
+    }
+}
+
+static void ResultsClear( playlist_search_t *s )
+{
+    for( size_t i = 0; i < s->i_results; i++ )
+        s->pp_entries[s->p_results[i]]->b_result = false;
+    s->i_results = 0;
+}
+
+/* Drops the released entries and the tokens of the former texts */
+static void Compact( playlist_search_t *s )
+{
+    size_t i_live = 0;
+
+    ResultsClear( s );
+    free( s->psz_last );
+    s->psz_last = NULL;
+    s->i_dirty = 0;
+
+    for( size_t i = 0; i < s->i_tokens; i++ )
+    {
+        free( s->pp_tokens[i]->p_entries );
+        free( s->pp_tokens[i] );
+    }
+    s->i_tokens = 0;
+    memset( s->pp_buckets, 0, SEARCH_BUCKETS * sizeof (*s->pp_buckets) );
+
+    for( size_t i = 0; i < s->i_entries; i++ )
+    {
+        search_entry_t *e = s->pp_entries[i];
+
+        if( e->p_item == NULL )
+        {
+            free( e );
+            continue;
+        }
+        e->i_index = i_live;
+        s->pp_entries[i_live] = e;
+        if( e->psz_text != NULL )
+            Tokenize( s, i_live );
+        /* Keep the pending updates, with the new positions */
+        if( e->b_dirty )
+            s->p_dirty[s->i_dirty++] = i_live;
+        i_live++;
+    }
+    s->i_entries = i_live;
+    s->i_stale = 0;
+}
+
+static void StaleAdd( playlist_search_t *s )
+{
+    if( ++s->i_stale > 1024 && s->i_stale > s->i_entries / 2 )
+        Compact( s );
+}
+
+/* Indexes the texts of the items that changed */
+static void Reindex( playlist_search_t *s )
+{
+    for( size_t i = 0; i < s->i_dirty; i++ )
+    {
+        uint32_t i_entry = s->p_dirty[i];
+        search_entry_t *e = s->pp_entries[i_entry];
+
+        e->b_dirty = false;
+        if( e->p_item == NULL )
+            continue;
+
+        char *psz_text = GetText( e->p_item->p_input );
+        if( psz_text == NULL || ( e->psz_text != NULL
+                               && !strcmp( psz_text, e->psz_text ) ) )
+        {
+            free( psz_text );
+            continue;
+        }
+
+        free( e->psz_text );
+        e->psz_text = psz_text;
+        Tokenize( s, i_entry );
+        Refine( s, i_entry );
+        s->i_stale++;
+    }
+    s->i_dirty = 0;
+
+    if( s->i_stale > 1024 && s->i_stale > s->i_entries / 2 )
+        Compact( s );
+}
+
+playlist_search_t *playlist_SearchIndexNew( void )
+{
+    playlist_search_t *s = calloc( 1, sizeof(*s) );
+    if( unlikely(s == NULL) )
+        return NULL;
+
+    s->pp_buckets = calloc( SEARCH_BUCKETS, sizeof (*s->pp_buckets) );
+    if( unlikely(s->pp_buckets == NULL) )
+    {
+        free( s );
+        return NULL;
+    }
+    vlc_mutex_init( &s->lock );
+    return s;
+}
+
+void playlist_SearchIndexDelete( playlist_search_t *s )
+{
+    for( size_t i = 0; i < s->i_entries; i++ )
+    {
+        free( s->pp_entries[i]->psz_text );
+        free( s->pp_entries[i] );
+    }
+    for( size_t i = 0; i < s->i_tokens; i++ )
+    {
+        free( s->pp_tokens[i]->p_entries );
+        free( s->pp_tokens[i] );
+    }
+    free( s->pp_entries );
+    free( s->pp_tokens );
+    free( s->pp_buckets );
+    free( s->p_dirty );
+    free( s->p_results );
+    free( s->psz_last );
+    vlc_mutex_destroy( &s->lock );
+    free( s );
+}
+
+/**
+ * Indexes a new playlist item.
+ */
+void playlist_SearchIndexAdd( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_search_t *s = pl_priv(p_playlist)->search;
+    search_entry_t *e = malloc( sizeof(*e) ), **pp;
+
+    PL_ASSERT_LOCKED;
+    if( unlikely(e == NULL) )
+        return;
+    e->p_item = p_item;
+    e->psz_text = GetText( p_item->p_input );
+    e->i_mark = 0;
+    e->b_dirty = false;
+    e->b_result = false;
+
+    vlc_mutex_lock( &s->lock );
+    if( unlikely(s->i_entries >= UINT32_MAX)
+     || !GROW( s->pp_entries, s->i_size, s->i_entries )
+     || (pp = tsearch( e, &s->input_tree, EntryCmp )) == NULL )
+    {
+        vlc_mutex_unlock( &s->lock );
+        free( e->psz_text );
+        free( e );
+        return;
+    }
+    assert( *pp == e );
+
+    uint32_t i_entry = s->i_entries++;
+    e->i_index = i_entry;
+    s->pp_entries[i_entry] = e;
+    if( e->psz_text != NULL )
+    {
+        Tokenize( s, i_entry );
+        Refine( s, i_entry );
+    }
+    vlc_mutex_unlock( &s->lock );
+}
+
+/**
+ * Removes a playlist item from the index.
+ */
+void playlist_SearchIndexRemove( playlist_t *p_playlist,
+                                 playlist_item_t *p_item )
+{
+    playlist_search_t *s = pl_priv(p_playlist)->search;
+
+    PL_ASSERT_LOCKED;
+    vlc_mutex_lock( &s->lock );
+    search_entry_t *e = EntryFind( s, p_item->p_input );
+    if( e != NULL )
+    {
+        tdelete( e, &s->input_tree, EntryCmp );
+        /* The postings still refer to it until the next compaction */
+        e->p_item = NULL;
+        free( e->psz_text );
+        e->psz_text = NULL;
+        StaleAdd( s );
+    }
+    vlc_mutex_unlock( &s->lock );
+}
+
+/**
+ * Marks the text of an item as changed. It is indexed again on the next
+ * search. This is called from the input item events, without the playlist
+ * lock.
+ */
+void playlist_SearchIndexUpdate( playlist_t *p_playlist, input_item_t *p_input )
+{
+    playlist_search_t *s = pl_priv(p_playlist)->search;
+
+    vlc_mutex_lock( &s->lock );
+    search_entry_t *e = EntryFind( s, p_input );
+    if( e != NULL && !e->b_dirty
+     && GROW( s->p_dirty, s->i_dirty_size, s->i_dirty ) )
+    {
+        s->p_dirty[s->i_dirty++] = e->i_index;
+        e->b_dirty = true;
+    }
+    vlc_mutex_unlock( &s->lock );
+}
+
+static void Select( playlist_search_t *s, const uint32_t *p_entries,
+                    size_t i_entries, uint32_t **pp_cand, size_t *pi_cand,
+                    size_t *pi_size )
+{
+    for( size_t i = 0; i < i_entries; i++ )
+    {
+        search_entry_t *e = s->pp_entries[p_entries[i]];
+
+        if( e->i_mark == s->i_mark )
+            continue;
+        e->i_mark = s->i_mark;
+        if( Grow( (void **)pp_cand, pi_size, *pi_cand, sizeof (**pp_cand) ) )
+            (*pp_cand)[(*pi_cand)++] = p_entries[i];
+    }
+}
+
+enum
+{
+    MATCH_SUBSTRING,
+    MATCH_SUFFIX,
+    MATCH_PREFIX,
+    MATCH_EXACT,
+};
+
+/* Finds the entries that may contain the query, from its best word */
+static uint32_t *Candidates( playlist_search_t *s, const char *psz_query,
+                             size_t *pi_cand )
+{
+    const char *psz_best = NULL;
+    size_t i_best = 0;
+    int i_mode = -1;
+
+    for( const char *psz = psz_query; *psz != '\0'; )
+    {
+        if( !IsWordChar( *psz ) )
+        {
+            psz++;
+            continue;
+        }
+
+        const char *psz_start = psz;
+        while( IsWordChar( *psz ) )
+            psz++;
+
+        /* A word cut by the start or the end of the query is partial */
+        bool b_start = psz_start > psz_query, b_end = *psz != '\0';
+        int i_word = b_start ? ( b_end ? MATCH_EXACT : MATCH_PREFIX )
+                             : ( b_end ? MATCH_SUFFIX : MATCH_SUBSTRING );
+        size_t i_len = psz - psz_start;
+
+        if( i_word > i_mode || ( i_word == i_mode && i_len > i_best ) )
+        {
+            psz_best = psz_start;
+            i_best = i_len;
+            i_mode = i_word;
+        }
+    }
+
+    uint32_t *p_cand = NULL;
+    size_t i_size = 0;
+
+    *pi_cand = 0;
+    s->i_mark++;
+    if( i_mode == -1 )
+    {   /* No word to look for */
+        for( size_t i = 0; i < s->i_entries; i++ )
+            if( GROW( p_cand, i_size, *pi_cand ) )
+                p_cand[(*pi_cand)++] = i;
+        return p_cand;
+    }
+
+    if( i_mode == MATCH_EXACT )
+    {
+        search_token_t *t = TokenFind( s, psz_best, i_best );
+        if( t != NULL )
+            Select( s, t->p_entries, t->i_entries, &p_cand, pi_cand, &i_size );
+        return p_cand;
+    }
+
+    for( size_t i = 0; i < s->i_tokens; i++ )
+    {
+        const search_token_t *t = s->pp_tokens[i];
+        const char *psz_token = t->psz_token;
+        size_t i_len = strlen( psz_token );
+        bool b_match;
+
+        if( i_len < i_best )
+            continue;
+        switch( i_mode )
+        {
+            case MATCH_PREFIX:
+                b_match = !strncmp( psz_token, psz_best, i_best );
+                break;
+            case MATCH_SUFFIX:
+                b_match = !strncmp( psz_token + i_len - i_best, psz_best,
+                                    i_best );
+                break;
+            default:
+            {
+                char psz_word[i_best + 1];
+                memcpy( psz_word, psz_best, i_best );
+                psz_word[i_best] = '\0';
+                b_match = strstr( psz_token, psz_word ) != NULL;
+                break;
+            }
+        }
+        if( b_match )
+            Select( s, t->p_entries, t->i_entries, &p_cand, pi_cand, &i_size );
+    }
+    return p_cand;
+}
+
 /***************************************************************************
  * Live search handling
  ***************************************************************************/
@@ -53,61 +641,95 @@ static void playlist_LiveSearchClean( playlist_item_t *p_root )
     }
 }
 
-
 /**
- * Enable/Disable items in the playlist according to the search argument
+ * Disable all items in the playlist
  * @param p_root: the current root item
- * @param psz_string: the string to search
- * @return true if an item match
  */
-static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
-                                               const char *psz_string, bool b_recursive )
+static void playlist_LiveSearchHide( playlist_item_t *p_root, bool b_recursive )
 {
-    int i;
-    bool b_match = false;
-    for( i = 0 ; i < p_root->i_children ; i ++ )
+    for( int i = 0; i < p_root->i_children; i++ )
     {
-        bool b_enable = false;
         playlist_item_t *p_item = p_root->pp_children[i];
-        // Go recurssively if their is some children
-        if( b_recursive && p_item->i_children >= 0 &&
-            playlist_LiveSearchUpdateInternal( p_item, psz_string, true ) )
-        {
-            b_enable = true;
-        }
+        if( b_recursive && p_item->i_children >= 0 )
+            playlist_LiveSearchHide( p_item, true );
+        p_item->i_flags |= PLAYLIST_DBL_FLAG;
+    }
+}
 
-        if( !b_enable )
-        {
-            vlc_mutex_lock( &p_item->p_input->lock );
-            // Do we have some meta ?
-            if( p_item->p_input->p_meta )
-            {
-                // Use Title or fall back to psz_name
-                const char *psz_title = vlc_meta_Get( p_item->p_input->p_meta, vlc_meta_Title );
-                if( !psz_title )
-                    psz_title = p_item->p_input->psz_name;
-                const char *psz_album = vlc_meta_Get( p_item->p_input->p_meta, vlc_meta_Album );
-                const char *psz_artist = vlc_meta_Get( p_item->p_input->p_meta, vlc_meta_Artist );
-                b_enable = ( psz_title && vlc_strcasestr( psz_title, psz_string ) ) ||
-                           ( psz_album && vlc_strcasestr( psz_album, psz_string ) ) ||
-                           ( psz_artist && vlc_strcasestr( psz_artist, psz_string ) );
-            }
-            else
-                b_enable = p_item->p_input->psz_name && vlc_strcasestr( p_item->p_input->psz_name, psz_string );
-            vlc_mutex_unlock( &p_item->p_input->lock );
-        }
+/**
+ * Enable a matching item and the nodes above it, up to the root
+ */
+static void playlist_LiveSearchShow( playlist_item_t *p_root,
+                                     playlist_item_t *p_item, bool b_recursive )
+{
+    playlist_item_t *p_up = p_item->p_parent;
 
-        if( b_enable )
+    if( !b_recursive )
+    {
+        if( p_up == p_root )
             p_item->i_flags &= ~PLAYLIST_DBL_FLAG;
-        else
-            p_item->i_flags |= PLAYLIST_DBL_FLAG;
+        return;
+    }
+
+    while( p_up != NULL && p_up != p_root )
+        p_up = p_up->p_parent;
+    if( p_up == NULL )
+        return; /* not below the root */
 
-        b_match |= b_enable;
-   }
-   return b_match;
+    for( p_up = p_item; p_up != p_root && (p_up->i_flags & PLAYLIST_DBL_FLAG);
+         p_up = p_up->p_parent )
+        p_up->i_flags &= ~PLAYLIST_DBL_FLAG;
 }
 
+/**
+ * Enable/Disable items in the playlist according to the search argument
+ * @param p_playlist: the playlist
+ * @param p_root: the current root item
+ * @param psz_string: the string to search
+ */
+static void playlist_LiveSearchUpdateInternal( playlist_t *p_playlist,
+                                               playlist_item_t *p_root,
+                                               const char *psz_string,
+                                               bool b_recursive )
+{
+    playlist_search_t *s = pl_priv(p_playlist)->search;
+    char *psz_query = SearchFold( psz_string );
+    if( unlikely(psz_query == NULL) )
+        return;
+
+    vlc_mutex_lock( &s->lock );
+    Reindex( s );
+
+    uint32_t *p_cand;
+    size_t i_cand;
+
+    if( s->psz_last != NULL && strstr( psz_query, s->psz_last ) != NULL )
+    {   /* The query extends the last one: only look at its results */
+        p_cand = s->p_results;
+        i_cand = s->i_results;
+        ResultsClear( s );
+        s->p_results = NULL;
+        s->i_results_size = 0;
+    }
+    else
+    {
+        ResultsClear( s );
+        p_cand = Candidates( s, psz_query, &i_cand );
+    }
 
+    free( s->psz_last );
+    s->psz_last = psz_query;
+    for( size_t i = 0; i < i_cand; i++ )
+        Refine( s, p_cand[i] );
+    free( p_cand );
+
+    playlist_LiveSearchHide( p_root, b_recursive );
+    for( size_t i = 0; i < s->i_results; i++ )
+        playlist_LiveSearchShow( p_root,
+                                 s->pp_entries[s->p_results[i]]->p_item,
+                                 b_recursive );
+    vlc_mutex_unlock( &s->lock );
+}
 
 /**
  * Launch the recursive search in the playlist
@@ -122,10 +744,10 @@ int playlist_LiveSearchUpdate( playlist_t *p_playlist, playlist_item_t *p_root,
     PL_ASSERT_LOCKED;
     pl_priv(p_playlist)->b_reset_currently_playing = true;
     if( *psz_string )
-        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive );
+        playlist_LiveSearchUpdateInternal( p_playlist, p_root, psz_string,
+                                           b_recursive );
     else
         playlist_LiveSearchClean( p_root );
     vlc_cond_signal( &pl_priv(p_playlist)->signal );
     return VLC_SUCCESS;
 }
-
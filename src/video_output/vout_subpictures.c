@@ -93,6 +93,15 @@ struct spu_private_t {
 
     /* */
     mtime_t last_sort_date;
+
+    /* Regions laid out, converted or scaled, versus regions for which such
+     * a former result was used again */
+    struct {
+        unsigned rendered;                           /**< by the last render */
+        unsigned reused;                             /**< by the last render */
+        uint64_t total_rendered;
+        uint64_t total_reused;
+    } stats;
 };
 
 /*****************************************************************************
@@ -668,6 +677,8 @@ static void SpuRenderRegion(spu_t *spu,
 
     video_format_t region_fmt;
     picture_t *region_picture;
+    bool rendered = false;
+    bool reused = false;
 
     /* Invalidate area by default */
     *dst_area = spu_area_create(0,0, 0,0, scale_size);
@@ -682,6 +693,10 @@ static void SpuRenderRegion(spu_t *spu,
         /* Check if the rendering has failed ... */
         if (region->fmt.i_chroma == VLC_CODEC_TEXT)
             goto exit;
+        rendered = true;
+    } else if (region->p_text) {
+        /* Laid out by a former render */
+        reused = true;
     }
 
     /* Force palette if requested
@@ -791,9 +806,15 @@ static void SpuRenderRegion(spu_t *spu,
             if (convert_chroma && private->fmt.i_chroma != chroma_list[0])
                 is_changed = true;
 
+            /* Check content changes */
+            if (private->p_source != region->p_picture)
+                is_changed = true;
+
             if (is_changed) {
                 subpicture_region_private_Delete(private);
                 region->p_private = NULL;
+            } else {
+                reused = true;
             }
         }
 
@@ -854,14 +875,12 @@ static void SpuRenderRegion(spu_t *spu,
                 region->p_private = subpicture_region_private_New(&picture->format);
                 if (region->p_private) {
                     region->p_private->p_picture = picture;
-                    if (!region->p_private->p_picture) {
-                        subpicture_region_private_Delete(region->p_private);
-                        region->p_private = NULL;
-                    }
+                    region->p_private->p_source = picture_Hold(region->p_picture);
                 } else {
                     picture_Release(picture);
                 }
             }
+            rendered = true;
         }
 
         /* And use the scaled picture */
@@ -905,14 +924,22 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    /* The region shares the (cached) picture, instead of a copy */
+    subpicture_region_t *dst = *dst_ptr =
+        subpicture_region_NewWithPicture(&region_fmt, region_picture);
     if (dst) {
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
+
+        if (rendered) {
+            sys->stats.rendered++;
+            sys->stats.total_rendered++;
+        } else if (reused) {
+            sys->stats.reused++;
+            sys->stats.total_reused++;
+        }
+
         int fade_alpha = 255;
         if (subpic->b_fade) {
             mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
@@ -1231,6 +1258,9 @@ spu_t *spu_Create(vlc_object_t *object)
     /* */
     sys->last_sort_date = -1;
 
+    sys->stats.rendered = sys->stats.reused = 0;
+    sys->stats.total_rendered = sys->stats.total_reused = 0;
+
     return spu;
 }
 
@@ -1243,6 +1273,9 @@ void spu_Destroy(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    msg_Dbg(spu, "%"PRIu64" regions rendered, %"PRIu64" reused",
+            sys->stats.total_rendered, sys->stats.total_reused);
+
     if (sys->text)
         FilterRelease(sys->text);
 
@@ -1450,6 +1483,9 @@ subpicture_t *spu_Render(spu_t *spu,
 
     vlc_mutex_lock(&sys->lock);
 
+    sys->stats.rendered = 0;
+    sys->stats.reused   = 0;
+
     unsigned int subpicture_count;
     subpicture_t *subpicture_array[VOUT_MAX_SUBPICTURES];
 
@@ -1486,6 +1522,16 @@ subpicture_t *spu_Render(spu_t *spu,
     return render;
 }
 
+void spu_GetRenderStatistics(spu_t *spu, unsigned *rendered, unsigned *reused)
+{
+    spu_private_t *sys = spu->p;
+
+    vlc_mutex_lock(&sys->lock);
+    *rendered = sys->stats.rendered;
+    *reused   = sys->stats.reused;
+    vlc_mutex_unlock(&sys->lock);
+}
+
 void spu_OffsetSubtitleDate(spu_t *spu, mtime_t duration)
 {
     spu_private_t *sys = spu->p;
@@ -0,0 +1,344 @@
+/*****************************************************************************
+ * biquad.c: equalizer biquad filters test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../modules/audio_filter/biquad.h"
+#include "../modules/audio_filter/biquad.c"
+
+#define RATE     48000
+#define SAMPLES  4096          /* per call */
+#define CALLS    8
+#define BANDS    10
+#define EQ_COUNT 5
+
+static uint32_t seed = 1;
+
+static float Random( void )
+{
+    seed = seed * 1103515245 + 12345;
+    return (float)( seed >> 8 ) / ( 1 << 24 ) * 2.f - 1.f;
+}
+
+/* The former param_eq filter */
+static void ProcessEQ( const float *src, float *dest, float *state,
+                       unsigned channels, unsigned samples, const float *coeffs,
+                       unsigned eqCount )
+{
+    unsigned i, chn, eq;
+    float   b0, b1, b2, a1, a2;
+    float   x, y = 0;
+    const float *src1 = src;
+    float *dest1 = dest;
+
+    for (i = 0; i < samples; i++)
+    {
+        float *state1 = state;
+        for (chn = 0; chn < channels; chn++)
+        {
+            const float *coeffs1 = coeffs;
+            x = *src1++;
+            /* Direct form 1 IIRs */
+            for (eq = 0; eq < eqCount; eq++)
+            {
+                b0 = coeffs1[0];
+                b1 = coeffs1[1];
+                b2 = coeffs1[2];
+                a1 = coeffs1[3];
+                a2 = coeffs1[4];
+                coeffs1 += 5;
+                y = x*b0 + state1[0]*b1 + state1[1]*b2 - state1[2]*a1 - state1[3]*a2;
+                state1[1] = state1[0];
+                state1[0] = x;
+                state1[3] = state1[2];
+                state1[2] = y;
+                x = y;
+                state1 += 4;
+            }
+            *dest1++ = y;
+        }
+    }
+}
+
+/* The former equalizer filter */
+#define EQZ_IN_FACTOR (0.25f)
+typedef struct
+{
+    float f_alpha[BANDS], f_beta[BANDS], f_gamma[BANDS];
+    float f_amp[BANDS];
+    float f_gamp;
+    bool b_2eqz;
+
+    float x[32][2];
+    float y[32][BANDS][2];
+    float x2[32][2];
+    float y2[32][BANDS][2];
+} eqz_t;
+
+static void EqzFilter( eqz_t *p_sys, float *out, float *in,
+                       int i_samples, int i_channels )
+{
+    int i, ch, j;
+
+    for( i = 0; i < i_samples; i++ )
+    {
+        for( ch = 0; ch < i_channels; ch++ )
+        {
+            const float x = in[ch];
+            float o = 0.0f;
+
+            for( j = 0; j < BANDS; j++ )
+            {
+                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
+                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
+                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
+
+                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
+                p_sys->y[ch][j][0] = y;
+
+                o += y * p_sys->f_amp[j];
+            }
+            p_sys->x[ch][1] = p_sys->x[ch][0];
+            p_sys->x[ch][0] = x;
+
+            if( p_sys->b_2eqz )
+            {
+                const float x2 = EQZ_IN_FACTOR * x + o;
+                o = 0.0f;
+                for( j = 0; j < BANDS; j++ )
+                {
+                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
+                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
+                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
+
+                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
+                    p_sys->y2[ch][j][0] = y;
+
+                    o += y * p_sys->f_amp[j];
+                }
+                p_sys->x2[ch][1] = p_sys->x2[ch][0];
+                p_sys->x2[ch][0] = x2;
+
+                out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
+            }
+            else
+            {
+                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
+            }
+        }
+
+        in  += i_channels;
+        out += i_channels;
+    }
+}
+
+/* RBJ peaking filter */
+static void PeakCoeffs( float f0, float Q, float gainDB, float *coeffs )
+{
+    float A = powf( 10, gainDB / 40 );
+    float w0 = 2 * (float)M_PI * f0 / RATE;
+    float alpha = sinf( w0 ) / ( 2 * Q );
+    float a0 = 1 + alpha / A;
+
+    coeffs[0] = ( 1 + alpha * A ) / a0;
+    coeffs[1] = -2 * cosf( w0 ) / a0;
+    coeffs[2] = ( 1 - alpha * A ) / a0;
+    coeffs[3] = -2 * cosf( w0 ) / a0;
+    coeffs[4] = ( 1 - alpha / A ) / a0;
+}
+
+/* One octave band-pass, as the equalizer computes them */
+static void BandCoeffs( float f_freq, float *alpha, float *beta, float *gamma )
+{
+    const float f_octave_factor = powf( 2.0f, 0.5f );
+    float f_theta_1 = ( 2.0f * (float) M_PI * f_freq ) / RATE;
+    float f_theta_2 = f_theta_1 / f_octave_factor;
+    float f_sin     = sinf( f_theta_2 );
+    float f_sin_prd = sinf( f_theta_2 * 0.5f * ( f_octave_factor + 1.0f ) )
+                    * sinf( f_theta_2 * 0.5f * ( f_octave_factor - 1.0f ) );
+    float f_sin_hlf = f_sin * 0.5f;
+    float f_den     = f_sin_hlf + f_sin_prd;
+
+    *alpha = f_sin_prd / f_den;
+    *beta  = ( f_sin_hlf - f_sin_prd ) / f_den;
+    *gamma = f_sin * cosf( f_theta_1 ) / f_den;
+}
+
+static float *CreateInput( unsigned i_channels )
+{
+    float *p = malloc( CALLS * SAMPLES * i_channels * sizeof(*p) );
+    assert( p != NULL );
+    for( unsigned i = 0; i < CALLS * SAMPLES * i_channels; i++ )
+        p[i] = Random();
+    return p;
+}
+
+/*
+ * The new filters evaluate every sample exactly as the former ones, but
+ * with -funsafe-math-optimizations the compiler may reassociate either.
+ */
+static void Compare( const float *ref, const float *out, size_t i_count )
+{
+#ifndef __ASSOCIATIVE_MATH__
+    assert( !memcmp( ref, out, i_count * sizeof(*out) ) );
+#else
+    float f_peak = 0.f;
+    for( size_t i = 0; i < i_count; i++ )
+        f_peak = __MAX( f_peak, fabsf( ref[i] ) );
+    for( size_t i = 0; i < i_count; i++ )
+        assert( fabsf( ref[i] - out[i] ) <= 1e-3f * f_peak );
+#endif
+}
+
+static void test_cascade( unsigned i_channels )
+{
+    static const float freqs[EQ_COUNT] = { 100, 300, 1000, 3000, 10000 };
+    float coeffs[EQ_COUNT * 5];
+    for( unsigned i = 0; i < EQ_COUNT; i++ )
+        PeakCoeffs( freqs[i], 3.f, 12.f - 6.f * i, &coeffs[5 * i] );
+
+    float *in = CreateInput( i_channels );
+    float *ref = malloc( CALLS * SAMPLES * i_channels * sizeof(*ref) );
+    float *out = malloc( CALLS * SAMPLES * i_channels * sizeof(*out) );
+    float *state = calloc( i_channels * EQ_COUNT * 4, sizeof(*state) );
+    assert( ref && out && state );
+
+    biquad_t bq;
+    assert( biquad_Init( &bq, i_channels, EQ_COUNT ) == VLC_SUCCESS );
+    for( unsigned i = 0; i < EQ_COUNT; i++ )
+        biquad_SetCoeffs( &bq, i, &coeffs[5 * i] );
+
+    mtime_t i_ref = 0, i_new = 0;
+    for( unsigned i = 0; i < CALLS; i++ )
+    {
+        const size_t i_offset = i * SAMPLES * i_channels;
+        mtime_t i_start = mdate();
+        ProcessEQ( &in[i_offset], &ref[i_offset], state, i_channels,
+                   SAMPLES, coeffs, EQ_COUNT );
+        i_ref += mdate() - i_start;
+
+        /* in place, as the filter does */
+        memcpy( &out[i_offset], &in[i_offset],
+                SAMPLES * i_channels * sizeof(*out) );
+        i_start = mdate();
+        biquad_Cascade( &bq, &out[i_offset], &out[i_offset], SAMPLES );
+        i_new += mdate() - i_start;
+    }
+    Compare( ref, out, CALLS * SAMPLES * i_channels );
+
+    printf( "param_eq  %u ch:        %5"PRId64" us -> %5"PRId64" us\n",
+            i_channels, i_ref, i_new );
+
+    biquad_Clean( &bq );
+    free( state );
+    free( out );
+    free( ref );
+    free( in );
+}
+
+static void test_bank( unsigned i_channels, bool b_2eqz )
+{
+    static const float freqs[BANDS] = { 60, 170, 310, 600, 1000,
+                                        3000, 6000, 12000, 14000, 16000 };
+    eqz_t *eqz = calloc( 1, sizeof(*eqz) );
+    assert( eqz != NULL );
+    eqz->f_gamp = 1.5f;
+    eqz->b_2eqz = b_2eqz;
+
+    biquad_t bq, bq2;
+    assert( biquad_Init( &bq, i_channels, BANDS ) == VLC_SUCCESS );
+    assert( biquad_Init( &bq2, i_channels, BANDS ) == VLC_SUCCESS );
+    for( unsigned i = 0; i < BANDS; i++ )
+    {
+        BandCoeffs( freqs[i], &eqz->f_alpha[i], &eqz->f_beta[i],
+                    &eqz->f_gamma[i] );
+        eqz->f_amp[i] = EQZ_IN_FACTOR * ( powf( 10.f, ( i * 4.f - 18.f ) / 20.f ) - 1.f );
+
+        const float coeffs[5] = { eqz->f_alpha[i], 0.f, -eqz->f_alpha[i],
+                                  -eqz->f_gamma[i], eqz->f_beta[i] };
+        biquad_SetCoeffs( &bq, i, coeffs );
+        biquad_SetCoeffs( &bq2, i, coeffs );
+    }
+
+    float *in = CreateInput( i_channels );
+    float *ref = malloc( CALLS * SAMPLES * i_channels * sizeof(*ref) );
+    float *out = malloc( CALLS * SAMPLES * i_channels * sizeof(*out) );
+    assert( ref && out );
+
+    mtime_t i_ref = 0, i_new = 0;
+    for( unsigned i = 0; i < CALLS; i++ )
+    {
+        const size_t i_offset = i * SAMPLES * i_channels;
+        mtime_t i_start = mdate();
+        EqzFilter( eqz, &ref[i_offset], &in[i_offset], SAMPLES, i_channels );
+        i_ref += mdate() - i_start;
+
+        memcpy( &out[i_offset], &in[i_offset],
+                SAMPLES * i_channels * sizeof(*out) );
+        i_start = mdate();
+        if( b_2eqz )
+        {
+            biquad_Bank( &bq, &out[i_offset], &out[i_offset], SAMPLES,
+                         eqz->f_amp, EQZ_IN_FACTOR, 1.f );
+            biquad_Bank( &bq2, &out[i_offset], &out[i_offset], SAMPLES,
+                         eqz->f_amp, EQZ_IN_FACTOR,
+                         eqz->f_gamp * eqz->f_gamp );
+        }
+        else
+            biquad_Bank( &bq, &out[i_offset], &out[i_offset], SAMPLES,
+                         eqz->f_amp, EQZ_IN_FACTOR, eqz->f_gamp );
+        i_new += mdate() - i_start;
+    }
+    Compare( ref, out, CALLS * SAMPLES * i_channels );
+
+    printf( "equalizer %u ch, %u pass: %5"PRId64" us -> %5"PRId64" us\n",
+            i_channels, b_2eqz ? 2 : 1, i_ref, i_new );
+
+    biquad_Clean( &bq );
+    biquad_Clean( &bq2 );
+    free( out );
+    free( ref );
+    free( in );
+    free( eqz );
+}
+
+int main( void )
+{
+    static const unsigned channels[] = { 1, 2, 3, 4, 5, 6, 8, 9 };
+
+    for( unsigned i = 0; i < ARRAY_SIZE(channels); i++ )
+    {
+        test_cascade( channels[i] );
+        test_bank( channels[i], false );
+        test_bank( channels[i], true );
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*****************************************************************************
+ * scaletempo.c: scaletempo correlation search test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include "../modules/audio_filter/correlation.h"
+#include "../modules/audio_filter/correlation.c"
+
+#define RATE 48000
+
+static uint32_t seed = 1;
+
+static float Random( void )
+{
+    seed = seed * 1103515245 + 12345;
+    return (float)( seed >> 8 ) / ( 1 << 24 ) * 2.f - 1.f;
+}
+
+/* The search of the original filter */
+static void Reference( const float *x, const float *y, unsigned i_length,
+                       unsigned i_step, unsigned i_offsets, float *p_scores )
+{
+    for( unsigned off = 0; off < i_offsets; off++ )
+    {
+        float corr = 0;
+        const float *ps = &y[off * i_step];
+        for( unsigned i = 0; i < i_length; i++ )
+            corr += x[i] * ps[i];
+        p_scores[off] = corr;
+    }
+}
+
+static double Norm( const float *p, unsigned i_count )
+{
+    double d = 0.;
+    for( unsigned i = 0; i < i_count; i++ )
+        d += (double)p[i] * p[i];
+    return sqrt( d );
+}
+
+static void test_dot( void )
+{
+    float a[67], b[67];
+    for( unsigned i = 0; i < 67; i++ )
+    {
+        a[i] = Random();
+        b[i] = Random();
+    }
+    /* every remainder of the vector loops */
+    for( unsigned n = 0; n <= 67; n++ )
+    {
+        double ref = 0.;
+        for( unsigned i = 0; i < n; i++ )
+            ref += (double)a[i] * b[i];
+        assert( fabs( DotC( a, b, n ) - ref ) < 1e-5 );
+        assert( fabs( correlation_Dot( a, b, n ) - ref ) < 1e-5 );
+        /* unaligned */
+        if( n > 0 )
+        {
+            ref -= (double)a[0] * b[0];
+            assert( fabs( correlation_Dot( a + 1, b + 1, n - 1 ) - ref ) < 1e-5 );
+        }
+    }
+}
+
+static mtime_t Bench( correlation_t *c, const float *x, const float *y,
+                      unsigned i_runs )
+{
+    mtime_t i_start = mdate();
+    for( unsigned i = 0; i < i_runs; i++ )
+        correlation_Search( c, x, y );
+    return ( mdate() - i_start ) / i_runs;
+}
+
+/* Same parameters as the filter: ms_stride, percent_overlap and ms_search */
+static void test_config( unsigned i_channels, unsigned ms_stride,
+                         float f_overlap, unsigned ms_search )
+{
+    const unsigned frames_overlap = ms_stride * RATE / 1000 * f_overlap;
+    const unsigned i_length = ( frames_overlap - 1 ) * i_channels;
+    const unsigned i_offsets = ms_search * RATE / 1000;
+    const unsigned i_signal = i_length + ( i_offsets - 1 ) * i_channels;
+    const unsigned i_match = i_offsets * 2 / 3;
+
+    float *x = malloc( i_length * sizeof(*x) );
+    float *y = malloc( i_signal * sizeof(*y) );
+    float *ref = malloc( i_offsets * sizeof(*ref) );
+    float *scores = malloc( i_offsets * sizeof(*scores) );
+    assert( x && y && ref && scores );
+
+    /* the pattern is a windowed copy of the signal at i_match */
+    for( unsigned i = 0; i < i_signal; i++ )
+        y[i] = Random();
+    for( unsigned i = 0; i < i_length; i++ )
+    {
+        const float w = ( i / i_channels + 1 ) *
+                        (float)( frames_overlap - 1 - i / i_channels );
+        x[i] = w * y[i_match * i_channels + i] + Random() * w * .1f;
+    }
+
+    Reference( x, y, i_length, i_channels, i_offsets, ref );
+    const double tolerance = 1e-5 * Norm( x, i_length ) * Norm( y, i_signal );
+
+    correlation_t direct, fft, autom;
+    assert( correlation_Init( &direct, i_length, i_channels, i_offsets,
+                              CORRELATION_DIRECT ) == VLC_SUCCESS );
+    assert( correlation_Init( &fft, i_length, i_channels, i_offsets,
+                              CORRELATION_FFT ) == VLC_SUCCESS );
+    assert( correlation_Init( &autom, i_length, i_channels, i_offsets,
+                              CORRELATION_AUTO ) == VLC_SUCCESS );
+
+    correlation_Compute( &direct, x, y, scores );
+    for( unsigned i = 0; i < i_offsets; i++ )
+        assert( fabs( scores[i] - ref[i] ) <= tolerance );
+    correlation_Compute( &fft, x, y, scores );
+    for( unsigned i = 0; i < i_offsets; i++ )
+        assert( fabs( scores[i] - ref[i] ) <= tolerance );
+
+    assert( correlation_Search( &direct, x, y ) == i_match );
+    assert( correlation_Search( &fft, x, y ) == i_match );
+    assert( correlation_Search( &autom, x, y ) == i_match );
+
+    /* benchmark, in microseconds per search */
+    const unsigned i_runs = 20;
+    mtime_t i_start = mdate();
+    for( unsigned i = 0; i < i_runs; i++ )
+        Reference( x, y, i_length, i_channels, i_offsets, ref );
+    mtime_t i_scalar = ( mdate() - i_start ) / i_runs;
+    mtime_t i_direct = Bench( &direct, x, y, i_runs );
+    mtime_t i_fft = Bench( &fft, x, y, i_runs );
+
+    printf( "%u ch, %4u ms stride, %.2f overlap, %3u ms search: "
+            "scalar %6"PRId64" us, direct %6"PRId64" us, fft %6"PRId64" us, "
+            "auto %s\n", i_channels, ms_stride, f_overlap, ms_search,
+            i_scalar, i_direct, i_fft, autom.i_fft_size ? "fft" : "direct" );
+
+    correlation_Clean( &direct );
+    correlation_Clean( &fft );
+    correlation_Clean( &autom );
+    free( x );
+    free( y );
+    free( ref );
+    free( scores );
+}
+
+int main( void )
+{
+    alarm( 60 );
+
+    test_dot();
+
+    static const unsigned channels[] = { 1, 2, 6 };
+    static const struct
+    {
+        unsigned ms_stride;
+        float    f_overlap;
+        unsigned ms_search;
+    } configs[] = {
+        {  30, .20f,  14 },                 /* defaults */
+        {  30, .50f,  30 },
+        {  60, .20f,  14 },
+        {  60, .50f,  60 },
+        { 120, .50f, 100 },
+        { 200, .50f, 200 },
+    };
+
+    for( unsigned i = 0; i < ARRAY_SIZE(channels); i++ )
+        for( unsigned j = 0; j < ARRAY_SIZE(configs); j++ )
+            test_config( channels[i], configs[j].ms_stride,
+                         configs[j].f_overlap, configs[j].ms_search );
+    return 0;
+}
@@ -0,0 +1,512 @@
+/*****************************************************************************
+ * mp4.c: MP4 demuxer sample tables test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* A one hour recording: one video track and several audio tracks,
+ * interleaved by one second chunks. That is a file of about 7 MB, half of
+ * sample tables, for about 770000 samples. */
+#define HOURS          1
+#define AUDIO_TRACKS   4
+#define TRACKS         (1 + AUDIO_TRACKS)
+
+#define VIDEO_SCALE    25000
+#define VIDEO_DELTA    1000          /* 25 fps */
+#define VIDEO_CHUNK    25
+#define GOP            12
+#define AUDIO_SCALE    48000
+#define AUDIO_DELTA    1024
+#define AUDIO_CHUNK    47
+#define CHUNKS         (HOURS * 3600)
+
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_size;
+    size_t   i_alloc;
+} buffer_t;
+
+static void Grow( buffer_t *b, size_t i_len )
+{
+    if( b->i_size + i_len > b->i_alloc )
+    {
+        b->i_alloc = ( b->i_size + i_len ) * 2;
+        b->p = realloc( b->p, b->i_alloc );
+        assert( b->p != NULL );
+    }
+}
+
+static void W8( buffer_t *b, uint8_t v )
+{
+    Grow( b, 1 );
+    b->p[b->i_size++] = v;
+}
+
+static void W16( buffer_t *b, uint16_t v )
+{
+    Grow( b, 2 );
+    SetWBE( &b->p[b->i_size], v );
+    b->i_size += 2;
+}
+
+static void W32( buffer_t *b, uint32_t v )
+{
+    Grow( b, 4 );
+    SetDWBE( &b->p[b->i_size], v );
+    b->i_size += 4;
+}
+
+static void WType( buffer_t *b, const char *psz_type )
+{
+    Grow( b, 4 );
+    memcpy( &b->p[b->i_size], psz_type, 4 );
+    b->i_size += 4;
+}
+
+static void WZero( buffer_t *b, size_t i_len )
+{
+    Grow( b, i_len );
+    memset( &b->p[b->i_size], 0, i_len );
+    b->i_size += i_len;
+}
+
+static size_t BoxStart( buffer_t *b, const char *psz_type )
+{
+    size_t i_start = b->i_size;
+    W32( b, 0 );
+    WType( b, psz_type );
+    return i_start;
+}
+
+static size_t FullBoxStart( buffer_t *b, const char *psz_type, uint32_t i_flags )
+{
+    size_t i_start = BoxStart( b, psz_type );
+    W32( b, i_flags );
+    return i_start;
+}
+
+static void BoxEnd( buffer_t *b, size_t i_start )
+{
+    SetDWBE( &b->p[i_start], b->i_size - i_start );
+}
+
+static void WMatrix( buffer_t *b )
+{
+    static const uint32_t matrix[9] = { 0x10000, 0, 0, 0, 0x10000, 0, 0, 0,
+                                        0x40000000 };
+    for( unsigned i = 0; i < 9; i++ )
+        W32( b, matrix[i] );
+}
+
+static uint32_t SampleCount( unsigned i_track )
+{
+    return CHUNKS * ( i_track == 0 ? VIDEO_CHUNK : AUDIO_CHUNK );
+}
+
+static uint32_t SampleSize( unsigned i_track, uint32_t i_sample )
+{
+    return 4 + i_sample % ( i_track == 0 ? 5 : 3 );
+}
+
+/* Composition offset of the video samples: each GOP starts with a frame
+ * displayed two frames later */
+static uint32_t SampleOffset( uint32_t i_sample )
+{
+    return ( i_sample % GOP == 0 ? 2 : 1 ) * VIDEO_DELTA;
+}
+
+static void WTrack( buffer_t *b, unsigned i_track, const uint32_t *pi_offsets )
+{
+    const bool b_video = i_track == 0;
+    const uint32_t i_samples = SampleCount( i_track );
+    const uint32_t i_scale = b_video ? VIDEO_SCALE : AUDIO_SCALE;
+    const uint32_t i_delta = b_video ? VIDEO_DELTA : AUDIO_DELTA;
+    const uint32_t i_duration = (uint64_t)i_samples * i_delta * 1000 / i_scale;
+
+    size_t trak = BoxStart( b, "trak" );
+
+    size_t tkhd = FullBoxStart( b, "tkhd", 0x7 );
+    W32( b, 0 ); W32( b, 0 );
+    W32( b, 1 + i_track );
+    W32( b, 0 );
+    W32( b, i_duration );
+    WZero( b, 8 );
+    W16( b, 0 ); W16( b, b_video ? 0 : 1 );
+    W16( b, b_video ? 0 : 0x100 ); W16( b, 0 );
+    WMatrix( b );
+    W32( b, b_video ? 320 << 16 : 0 ); W32( b, b_video ? 240 << 16 : 0 );
+    BoxEnd( b, tkhd );
+
+    size_t mdia = BoxStart( b, "mdia" );
+    size_t mdhd = FullBoxStart( b, "mdhd", 0 );
+    W32( b, 0 ); W32( b, 0 );
+    W32( b, i_scale );
+    W32( b, (uint64_t)i_samples * i_delta );
+    W16( b, 0x55c4 ); W16( b, 0 );
+    BoxEnd( b, mdhd );
+
+    size_t hdlr = FullBoxStart( b, "hdlr", 0 );
+    W32( b, 0 );
+    WType( b, b_video ? "vide" : "soun" );
+    WZero( b, 12 );
+    W8( b, 0 );
+    BoxEnd( b, hdlr );
+
+    size_t minf = BoxStart( b, "minf" );
+    if( b_video )
+    {
+        size_t vmhd = FullBoxStart( b, "vmhd", 1 );
+        WZero( b, 8 );
+        BoxEnd( b, vmhd );
+    }
+    else
+    {
+        size_t smhd = FullBoxStart( b, "smhd", 0 );
+        WZero( b, 4 );
+        BoxEnd( b, smhd );
+    }
+    size_t dinf = BoxStart( b, "dinf" );
+    size_t dref = FullBoxStart( b, "dref", 0 );
+    W32( b, 1 );
+    BoxEnd( b, FullBoxStart( b, "url ", 1 ) );
+    BoxEnd( b, dref );
+    BoxEnd( b, dinf );
+
+    size_t stbl = BoxStart( b, "stbl" );
+
+    size_t stsd = FullBoxStart( b, "stsd", 0 );
+    W32( b, 1 );
+    size_t entry = BoxStart( b, b_video ? "mp4v" : "mp4a" );
+    WZero( b, 6 ); W16( b, 1 );
+    if( b_video )
+    {
+        WZero( b, 16 );
+        W16( b, 320 ); W16( b, 240 );
+        W32( b, 72 << 16 ); W32( b, 72 << 16 );
+        W32( b, 0 ); W16( b, 1 );
+        WZero( b, 32 );
+        W16( b, 24 ); W16( b, 0xffff );
+    }
+    else
+    {
+        WZero( b, 8 );
+        W16( b, 2 ); W16( b, 16 );
+        W16( b, 0 ); W16( b, 0 );
+        W32( b, AUDIO_SCALE << 16 );
+    }
+    BoxEnd( b, entry );
+    BoxEnd( b, stsd );
+
+    size_t stts = FullBoxStart( b, "stts", 0 );
+    W32( b, 1 );
+    W32( b, i_samples ); W32( b, i_delta );
+    BoxEnd( b, stts );
+
+    if( b_video )
+    {
+        size_t ctts = FullBoxStart( b, "ctts", 0 );
+        W32( b, i_samples / GOP * 2 );
+        for( uint32_t i = 0; i < i_samples; i += GOP )
+        {
+            W32( b, 1 ); W32( b, SampleOffset( i ) );
+            W32( b, GOP - 1 ); W32( b, SampleOffset( i + 1 ) );
+        }
+        BoxEnd( b, ctts );
+
+        size_t stss = FullBoxStart( b, "stss", 0 );
+        W32( b, i_samples / GOP );
+        for( uint32_t i = 0; i < i_samples; i += GOP )
+            W32( b, 1 + i );
+        BoxEnd( b, stss );
+    }
+
+    size_t stsc = FullBoxStart( b, "stsc", 0 );
+    W32( b, 1 );
+    W32( b, 1 ); W32( b, b_video ? VIDEO_CHUNK : AUDIO_CHUNK ); W32( b, 1 );
+    BoxEnd( b, stsc );
+
+    size_t stsz = FullBoxStart( b, "stsz", 0 );
+    W32( b, 0 );
+    W32( b, i_samples );
+    for( uint32_t i = 0; i < i_samples; i++ )
+        W32( b, SampleSize( i_track, i ) );
+    BoxEnd( b, stsz );
+
+    size_t stco = FullBoxStart( b, "stco", 0 );
+    W32( b, CHUNKS );
+    for( unsigned i = 0; i < CHUNKS; i++ )
+        W32( b, pi_offsets[i * TRACKS + i_track] );
+    BoxEnd( b, stco );
+
+    BoxEnd( b, stbl );
+    BoxEnd( b, minf );
+    BoxEnd( b, mdia );
+    BoxEnd( b, trak );
+}
+
+/* Every sample starts with its number in the track */
+static buffer_t CreateFile( void )
+{
+    buffer_t b = { NULL, 0, 0 };
+    uint32_t *pi_offsets = malloc( CHUNKS * TRACKS * sizeof(*pi_offsets) );
+    uint32_t pi_sample[TRACKS] = { 0 };
+    assert( pi_offsets != NULL );
+
+    size_t ftyp = BoxStart( &b, "ftyp" );
+    WType( &b, "isom" ); W32( &b, 0 );
+    WType( &b, "isom" );
+    BoxEnd( &b, ftyp );
+
+    size_t mdat = BoxStart( &b, "mdat" );
+    for( unsigned i = 0; i < CHUNKS; i++ )
+    {
+        for( unsigned t = 0; t < TRACKS; t++ )
+        {
+            pi_offsets[i * TRACKS + t] = b.i_size;
+            for( unsigned j = 0; j < ( t == 0 ? VIDEO_CHUNK : AUDIO_CHUNK ); j++ )
+            {
+                const uint32_t i_size = SampleSize( t, pi_sample[t] );
+                W32( &b, pi_sample[t]++ );
+                WZero( &b, i_size - 4 );
+            }
+        }
+    }
+    BoxEnd( &b, mdat );
+
+    size_t moov = BoxStart( &b, "moov" );
+    size_t mvhd = FullBoxStart( &b, "mvhd", 0 );
+    W32( &b, 0 ); W32( &b, 0 );
+    W32( &b, 1000 );
+    W32( &b, HOURS * 3600 * 1000 );
+    W32( &b, 0x10000 ); W16( &b, 0x100 );
+    WZero( &b, 10 );
+    WMatrix( &b );
+    WZero( &b, 24 );
+    W32( &b, TRACKS + 1 );
+    BoxEnd( &b, mvhd );
+    for( unsigned t = 0; t < TRACKS; t++ )
+        WTrack( &b, t, pi_offsets );
+    BoxEnd( &b, moov );
+
+    free( pi_offsets );
+    return b;
+}
+
+/* Checks the samples against their number and timestamps */
+struct es_out_id_t
+{
+    unsigned i_track;
+    uint32_t i_next;
+    unsigned i_blocks;
+};
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    VLC_UNUSED(out);
+    static unsigned i_audio = 0;
+    es_out_id_t *id = malloc( sizeof(*id) );
+    assert( id != NULL );
+    if( fmt->i_cat == VIDEO_ES )
+        id->i_track = 0;
+    else
+    {
+        /* the audio tracks are identical */
+        assert( fmt->i_cat == AUDIO_ES && i_audio < AUDIO_TRACKS );
+        id->i_track = ++i_audio;
+    }
+    id->i_next = UINT32_MAX;
+    id->i_blocks = 0;
+    return id;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    VLC_UNUSED(out);
+    const bool b_video = id->i_track == 0;
+    const uint32_t i_sample = GetDWBE( p_block->p_buffer );
+
+    assert( p_block->i_buffer == SampleSize( id->i_track, i_sample ) );
+    if( id->i_next != UINT32_MAX )
+        assert( i_sample == id->i_next );
+    id->i_next = i_sample + 1;
+    id->i_blocks++;
+
+    const mtime_t i_dts = VLC_TS_0 + CLOCK_FREQ * (int64_t)i_sample *
+                          ( b_video ? VIDEO_DELTA : AUDIO_DELTA ) /
+                          ( b_video ? VIDEO_SCALE : AUDIO_SCALE );
+    assert( p_block->i_dts == i_dts );
+    if( b_video )
+        assert( p_block->i_pts == i_dts + CLOCK_FREQ *
+                (int64_t)SampleOffset( i_sample ) / VIDEO_SCALE );
+
+    block_Release( p_block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    VLC_UNUSED(out);
+    free( id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    VLC_UNUSED(out);
+    if( i_query == ES_OUT_GET_ES_STATE )
+    {
+        (void) va_arg( args, es_out_id_t * );
+        *va_arg( args, bool * ) = true;
+    }
+    return VLC_SUCCESS;
+}
+
+static es_out_id_t *ids[TRACKS];
+
+static es_out_id_t *TrackAdd( es_out_t *out, const es_format_t *fmt )
+{
+    es_out_id_t *id = EsOutAdd( out, fmt );
+    ids[id->i_track] = id;
+    return id;
+}
+
+static size_t GetRSS( void )
+{
+    unsigned long i_size, i_resident = 0;
+    FILE *f = fopen( "/proc/self/statm", "r" );
+    if( f == NULL )
+        return 0;
+    if( fscanf( f, "%lu %lu", &i_size, &i_resident ) != 2 )
+        i_resident = 0;
+    fclose( f );
+    return i_resident * sysconf( _SC_PAGESIZE );
+}
+
+static void ResetTracks( void )
+{
+    for( unsigned i = 0; i < TRACKS; i++ )
+        if( ids[i] != NULL )
+        {
+            ids[i]->i_next = UINT32_MAX;
+            ids[i]->i_blocks = 0;
+        }
+}
+
+static void DemuxSome( demux_t *p_demux, unsigned i_count )
+{
+    ResetTracks();
+    for( unsigned i = 0; i < i_count; i++ )
+        assert( demux_Demux( p_demux ) == VLC_DEMUXER_SUCCESS );
+    for( unsigned i = 0; i < TRACKS; i++ )
+        assert( ids[i] != NULL && ids[i]->i_blocks > 0 );
+}
+
+static void SeekTo( demux_t *p_demux, mtime_t i_time,
+                    uint32_t i_video, uint32_t i_audio )
+{
+    assert( demux_Control( p_demux, DEMUX_SET_TIME, i_time, true )
+            == VLC_SUCCESS );
+    ResetTracks();
+    assert( demux_Demux( p_demux ) == VLC_DEMUXER_SUCCESS );
+    assert( ids[0]->i_next - ids[0]->i_blocks == i_video );
+    for( unsigned i = 1; i < TRACKS; i++ )
+        assert( ids[i]->i_next - ids[i]->i_blocks == i_audio );
+}
+
+static void Test( vlc_object_t *obj )
+{
+    buffer_t file = CreateFile();
+    log( "%zu MB file\n", file.i_size >> 20 );
+
+    es_out_t out = {
+        .pf_add = TrackAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDel,
+        .pf_control = EsOutControl,
+    };
+    stream_t *s = vlc_stream_MemoryNew( obj, file.p, file.i_size, true );
+    assert( s != NULL );
+
+    const size_t i_rss = GetRSS();
+    mtime_t i_start = mdate();
+    demux_t *p_demux = demux_New( obj, "mp4", "", s, &out );
+    assert( p_demux != NULL );
+    log( "opened in %"PRId64" ms, RSS +%zu MB\n", ( mdate() - i_start ) / 1000,
+         ( GetRSS() - i_rss ) >> 20 );
+
+    int64_t i_length;
+    assert( demux_Control( p_demux, DEMUX_GET_LENGTH, &i_length ) == VLC_SUCCESS );
+    assert( i_length == HOURS * 3600 * CLOCK_FREQ );
+
+    DemuxSome( p_demux, 20 );
+    assert( ids[0]->i_next - ids[0]->i_blocks == 0 );
+
+    /* Video goes back to the previous sync sample, audio is exact */
+    SeekTo( p_demux, HOURS * 1800 * CLOCK_FREQ + 300000, HOURS * 1800 * 25,
+            ( HOURS * 1800 * CLOCK_FREQ + 300000 ) * 48 / 1024000 );
+    DemuxSome( p_demux, 20 );
+    SeekTo( p_demux, 90 * CLOCK_FREQ + 500000, ( 90 * 25 + 12 ) / GOP * GOP,
+            ( 90 * CLOCK_FREQ + 500000 ) * 48 / 1024000 );
+
+    i_start = mdate();
+    for( unsigned i = 0; i < 1000; i++ )
+    {
+        const mtime_t i_time = ( (uint64_t)i * 7919 % ( HOURS * 3600 ) )
+                             * CLOCK_FREQ;
+        assert( demux_Control( p_demux, DEMUX_SET_TIME, i_time, true )
+                == VLC_SUCCESS );
+    }
+    log( "1000 seeks in %"PRId64" ms\n", ( mdate() - i_start ) / 1000 );
+
+    /* Reads the end of the file */
+    SeekTo( p_demux, ( HOURS * 3600 - 2 ) * CLOCK_FREQ,
+            ( HOURS * 3600 - 2 ) * 25 / GOP * GOP,
+            ( HOURS * 3600 - 2 ) * CLOCK_FREQ * 48 / 1024000 );
+    while( demux_Demux( p_demux ) == VLC_DEMUXER_SUCCESS );
+    assert( ids[0]->i_next == SampleCount( 0 ) );
+    for( unsigned i = 1; i < TRACKS; i++ )
+        assert( ids[i]->i_next == SampleCount( i ) );
+
+    demux_Delete( p_demux ); /* also deletes the stream */
+    free( file.p );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    Test( VLC_OBJECT(vlc->p_libvlc_int) );
+
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,399 @@
+/*****************************************************************************
+ * ts.c: TS demuxer random access index test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_modules.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* Twenty minutes of H.264 at 25 fps, a key frame every twelve frames, with
+ * the PCR on the video PID half a second ahead of the timestamps */
+#define MINUTES     20
+#define FRAMES      (MINUTES * 60 * 25)
+#define GOP         12
+#define FRAME_TICKS 3600
+#define FIRST_PTS   90000
+#define FIRST_PCR   (FIRST_PTS - 45000)
+#define KEY_PACKETS 24
+#define P_PACKETS   3
+
+#define TS_SIZE     188
+#define PMT_PID     0x20
+#define VIDEO_PID   0x100
+
+static char dir[] = "/tmp/vlc-ts-XXXXXX";
+static FILE *file;
+static uint8_t cc[0x2000];
+
+static uint32_t CRC32( const uint8_t *p, size_t i_size )
+{
+    uint32_t i_crc = 0xffffffff;
+
+    for( size_t i = 0; i < i_size; i++ )
+    {
+        i_crc ^= (uint32_t)p[i] << 24;
+        for( unsigned j = 0; j < 8; j++ )
+            i_crc = ( i_crc & 0x80000000 ) ? ( i_crc << 1 ) ^ 0x04c11db7
+                                           : i_crc << 1;
+    }
+    return i_crc;
+}
+
+/* Writes a packet with as much of the data as fits, returns its size */
+static size_t PutPacket( uint16_t i_pid, bool b_start, bool b_rai, int64_t i_pcr,
+                         const uint8_t *p_data, size_t i_data )
+{
+    uint8_t pkt[TS_SIZE];
+    uint8_t *af = &pkt[4];
+    size_t i_af = 0;
+
+    if( b_rai || i_pcr >= 0 )
+    {
+        af[1] = ( b_rai ? 0x40 : 0 ) | ( i_pcr >= 0 ? 0x10 : 0 );
+        i_af = 2;
+        if( i_pcr >= 0 )
+        {
+            af[2] = i_pcr >> 25;
+            af[3] = i_pcr >> 17;
+            af[4] = i_pcr >> 9;
+            af[5] = i_pcr >> 1;
+            af[6] = ( ( i_pcr & 1 ) << 7 ) | 0x7e;
+            af[7] = 0;
+            i_af += 6;
+        }
+    }
+
+    const size_t i_payload = __MIN( i_data, TS_SIZE - 4 - i_af );
+    const size_t i_total = TS_SIZE - 4 - i_payload;
+    if( i_total > 0 )
+    {
+        if( i_af == 0 && i_total >= 2 )
+        {
+            af[1] = 0;
+            i_af = 2;
+        }
+        if( i_total > i_af )
+            memset( &af[i_af], 0xff, i_total - i_af );
+        af[0] = i_total - 1;
+    }
+
+    pkt[0] = 0x47;
+    pkt[1] = ( b_start ? 0x40 : 0 ) | ( i_pid >> 8 );
+    pkt[2] = i_pid & 0xff;
+    pkt[3] = ( i_total ? 0x30 : 0x10 ) | ( cc[i_pid]++ & 0xf );
+    memcpy( &pkt[4 + i_total], p_data, i_payload );
+    assert( fwrite( pkt, TS_SIZE, 1, file ) == 1 );
+    return i_payload;
+}
+
+static void PutSection( uint16_t i_pid, uint8_t *p_section, size_t i_size )
+{
+    uint8_t payload[TS_SIZE - 4];
+
+    SetWBE( &p_section[1], 0xB000 | ( i_size + 4 - 3 ) );
+    SetDWBE( &p_section[i_size], CRC32( p_section, i_size ) );
+    memset( payload, 0xff, sizeof (payload) );
+    payload[0] = 0; /* pointer field */
+    memcpy( &payload[1], p_section, i_size + 4 );
+    PutPacket( i_pid, true, false, -1, payload, sizeof (payload) );
+}
+
+static void PutTables( void )
+{
+    uint8_t pat[12 + 4] = {
+        0x00, 0, 0, 0x00, 0x01, 0xC1, 0x00, 0x00,
+        0x00, 0x01, 0xE0 | ( PMT_PID >> 8 ), PMT_PID & 0xff,
+    };
+    PutSection( 0, pat, 12 );
+
+    uint8_t pmt[17 + 4] = {
+        0x02, 0, 0, 0x00, 0x01, 0xC1, 0x00, 0x00,
+        0xE0 | ( VIDEO_PID >> 8 ), VIDEO_PID & 0xff, 0xF0, 0x00,
+        0x1B, 0xE0 | ( VIDEO_PID >> 8 ), VIDEO_PID & 0xff, 0xF0, 0x00,
+    };
+    PutSection( PMT_PID, pmt, 17 );
+}
+
+/* Every frame is an access unit delimiter and a slice starting with the
+ * frame number */
+static void PutFrame( unsigned i_frame )
+{
+    const bool b_key = i_frame % GOP == 0;
+    const int64_t i_pts = FIRST_PTS + (int64_t)i_frame * FRAME_TICKS;
+    const size_t i_size = ( b_key ? KEY_PACKETS : P_PACKETS ) * ( TS_SIZE - 4 );
+    uint8_t *p = malloc( i_size ), *p_end = p + i_size;
+    assert( p != NULL );
+
+    memcpy( p, (const uint8_t[]) {
+        0x00, 0x00, 0x01, 0xE0, 0x00, 0x00, 0x80, 0x80, 0x05,
+        0x21 | ( ( i_pts >> 29 ) & 0x0e ), i_pts >> 22,
+        ( ( i_pts >> 14 ) & 0xfe ) | 1, i_pts >> 7, ( ( i_pts << 1 ) & 0xfe ) | 1,
+        0x00, 0x00, 0x00, 0x01, 0x09, 0xF0,
+        0x00, 0x00, 0x00, 0x01, b_key ? 0x65 : 0x41,
+    }, 25 );
+    SetDWBE( &p[25], i_frame );
+    memset( &p[29], 0xaa, i_size - 29 );
+
+    bool b_start = true;
+    for( const uint8_t *p_data = p; p_data < p_end; )
+    {
+        p_data += PutPacket( VIDEO_PID, b_start, b_start && b_key,
+                             b_start ? i_pts - FIRST_PTS + FIRST_PCR : -1,
+                             p_data, p_end - p_data );
+        b_start = false;
+    }
+    free( p );
+}
+
+static void CreateFile( const char *psz_path )
+{
+    file = fopen( psz_path, "wb" );
+    assert( file != NULL );
+    for( unsigned i = 0; i < FRAMES; i++ )
+    {
+        if( i % GOP == 0 )
+            PutTables();
+        PutFrame( i );
+    }
+    fclose( file );
+}
+
+/* Records the first frame output after a seek */
+struct es_out_id_t
+{
+    int i_first;
+};
+
+static es_out_id_t video = { -1 };
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    VLC_UNUSED(out);
+    assert( fmt->i_cat == VIDEO_ES && fmt->i_codec == VLC_CODEC_H264 );
+    return &video;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    VLC_UNUSED(out);
+    if( p_block->i_buffer >= 15 && id->i_first == -1 )
+    {
+        const uint8_t *p = p_block->p_buffer;
+        assert( !memcmp( p, "\x00\x00\x00\x01\x09\xF0\x00\x00\x00\x01", 10 ) );
+        id->i_first = GetDWBE( &p[11] );
+        assert( ( p[10] == 0x65 ) == ( id->i_first % GOP == 0 ) );
+    }
+    block_Release( p_block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    VLC_UNUSED(out); VLC_UNUSED(id);
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    VLC_UNUSED(out);
+    if( i_query == ES_OUT_GET_ES_STATE )
+    {
+        (void) va_arg( args, es_out_id_t * );
+        *va_arg( args, bool * ) = true;
+    }
+    return VLC_SUCCESS;
+}
+
+static es_out_t out = {
+    .pf_add = EsOutAdd,
+    .pf_send = EsOutSend,
+    .pf_del = EsOutDel,
+    .pf_control = EsOutControl,
+};
+
+/* Key frame at or before the given time (the PCR is the time reference) */
+static int KeyFrameAt( mtime_t i_time )
+{
+    const int64_t i_pts = FIRST_PCR + ( i_time - VLC_TS_0 ) * 9 / 100;
+    return ( i_pts - FIRST_PTS ) / FRAME_TICKS / GOP * GOP;
+}
+
+/* Returns the first frame of the next demuxed ones */
+static int DemuxFrame( demux_t *p_demux )
+{
+    video.i_first = -1;
+    while( video.i_first == -1 )
+        assert( demux_Demux( p_demux ) == VLC_DEMUXER_SUCCESS );
+    return video.i_first;
+}
+
+/* Seeks and returns the first frame demuxed after it */
+static int SeekTo( demux_t *p_demux, mtime_t i_time, mtime_t *pi_latency )
+{
+    mtime_t i_start = mdate();
+    assert( demux_Control( p_demux, DEMUX_SET_TIME, i_time, true )
+            == VLC_SUCCESS );
+    if( pi_latency )
+        *pi_latency += mdate() - i_start;
+
+    return DemuxFrame( p_demux );
+}
+
+static bool IsAccurate( demux_t *p_demux, mtime_t i_time )
+{
+    return SeekTo( p_demux, i_time, NULL ) == KeyFrameAt( i_time );
+}
+
+static mtime_t RandomTime( unsigned i )
+{
+    return ( 2 + (uint64_t)i * 7919 % ( MINUTES * 60 - 4 ) ) * CLOCK_FREQ
+         + i * 104729 % CLOCK_FREQ;
+}
+
+static demux_t *Open( vlc_object_t *obj, const char *psz_url )
+{
+    stream_t *s = vlc_stream_NewMRL( obj, psz_url );
+    assert( s != NULL );
+    demux_t *p_demux = demux_New( obj, "ts", "", s, &out );
+    assert( p_demux != NULL );
+    return p_demux;
+}
+
+static void RemoveTree( const char *psz_path )
+{
+    DIR *d = opendir( psz_path );
+    if( d == NULL )
+    {
+        unlink( psz_path );
+        return;
+    }
+
+    struct dirent *ent;
+    while( ( ent = readdir( d ) ) != NULL )
+    {
+        if( !strcmp( ent->d_name, "." ) || !strcmp( ent->d_name, ".." ) )
+            continue;
+
+        char *psz_child;
+        assert( asprintf( &psz_child, "%s/%s", psz_path, ent->d_name ) != -1 );
+        RemoveTree( psz_child );
+        free( psz_child );
+    }
+    closedir( d );
+    rmdir( psz_path );
+}
+
+static void Test( vlc_object_t *obj, const char *psz_url )
+{
+    demux_t *p_demux = Open( obj, psz_url );
+
+    /* What was demuxed is indexed on the fly */
+    while( DemuxFrame( p_demux ) < 10 * 25 );
+    assert( IsAccurate( p_demux, 3 * CLOCK_FREQ + 300000 ) );
+    assert( IsAccurate( p_demux, 7 * CLOCK_FREQ ) );
+
+    /* Elsewhere, the first seek bisects and starts indexing the file */
+    mtime_t i_cold = 0;
+    SeekTo( p_demux, ( MINUTES * 60 / 2 ) * CLOCK_FREQ + 700000, &i_cold );
+    log( "first seek in %"PRId64" us\n", i_cold );
+
+    mtime_t i_start = mdate();
+    bool b_indexed = false;
+    while( !b_indexed )
+    {
+        assert( mdate() - i_start < 20 * CLOCK_FREQ );
+        msleep( CLOCK_FREQ / 20 );
+        b_indexed = true;
+        for( unsigned i = 0; i < 8 && b_indexed; i++ )
+            b_indexed = IsAccurate( p_demux, RandomTime( i ) );
+    }
+    log( "indexed in %"PRId64" ms\n", ( mdate() - i_start ) / 1000 );
+
+    /* Then seeks land on the last key frame before the time */
+    mtime_t i_latency = 0;
+    for( unsigned i = 0; i < 500; i++ )
+    {
+        const mtime_t i_time = RandomTime( i );
+        assert( SeekTo( p_demux, i_time, &i_latency ) == KeyFrameAt( i_time ) );
+    }
+    log( "500 seeks, %"PRId64" us each\n", i_latency / 500 );
+
+    /* Reads the end of the file */
+    assert( IsAccurate( p_demux, ( MINUTES * 60 - 2 ) * CLOCK_FREQ ) );
+    while( demux_Demux( p_demux ) == VLC_DEMUXER_SUCCESS );
+    demux_Delete( p_demux ); /* also saves the index */
+
+    /* The index is kept for the next opening */
+    p_demux = Open( obj, psz_url );
+    DemuxFrame( p_demux ); /* the time reference */
+    i_latency = 0;
+    for( unsigned i = 0; i < 100; i++ )
+    {
+        const mtime_t i_time = RandomTime( 1000 + i );
+        assert( SeekTo( p_demux, i_time, &i_latency ) == KeyFrameAt( i_time ) );
+    }
+    log( "100 seeks after reopening, %"PRId64" us each\n", i_latency / 100 );
+    demux_Delete( p_demux );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 120 );
+
+    char cache[sizeof (dir) + 32], path[sizeof (dir) + 32];
+
+    assert( mkdtemp( dir ) != NULL );
+    snprintf( cache, sizeof (cache), "%s/cache", dir );
+    assert( mkdir( cache, 0700 ) == 0 );
+    setenv( "XDG_CACHE_HOME", cache, 1 );
+    snprintf( path, sizeof (path), "%s/recording.ts", dir );
+    CreateFile( path );
+
+    char *psz_url = vlc_path2uri( path, NULL );
+    assert( psz_url != NULL );
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    int i_ret = 0;
+    if( module_exists( "ts" ) )
+        Test( obj, psz_url );
+    else
+        i_ret = 77;
+
+    libvlc_release( vlc );
+    free( psz_url );
+    RemoveTree( dir );
+    return i_ret;
+}
@@ -0,0 +1,392 @@
+/*****************************************************************************
+ * cbr.c: T-STD simulator for the constant bitrate TS scheduler
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "../modules/mux/mpeg/cbr.h"
+#include "../modules/mux/mpeg/cbr.c"
+
+#define SLICE      200000     /* shaping delay */
+#define PCR_DELAY  70000
+#define DTS_DELAY  400000
+#define DURATION   (20 * CLOCK_FREQ)
+#define START      (10 * 3600 * CLOCK_FREQ)
+
+#define PID_VIDEO  0x100
+#define PID_AUDIO  0x101
+
+#define MAX_AUS    4096
+
+/* Elementary stream and its T-STD buffers, ISO/IEC 13818-1 2.4.2 */
+typedef struct
+{
+    uint16_t i_pid;
+    int      i_cc;
+    mtime_t  i_interval;
+
+    int64_t  i_rx;                 /* transport buffer leak rate (bit/s) */
+    int64_t  i_bs;                 /* elementary buffer size (bytes) */
+
+    /* simulator state */
+    int64_t  i_tb;                 /* transport buffer, in bits * 27 MHz */
+    int64_t  i_tb_time;
+    int64_t  i_arrived;            /* payload bytes */
+    int64_t  i_removed;
+    unsigned i_first_au, i_last_au;
+    unsigned i_au;                 /* access unit being received */
+    int      i_au_left;
+} es_t;
+
+typedef struct
+{
+    es_t    *p_es;
+    int      i_size;
+    mtime_t  i_dts;
+} au_t;
+
+static au_t aus[MAX_AUS];
+static unsigned i_aus;
+
+static block_t *NewPacket( es_t *p_es, bool b_start, bool b_pcr,
+                           unsigned i_au, int *pi_len )
+{
+    const int i_len = __MIN( *pi_len, 184 - ( b_pcr ? 8 : 0 ) );
+    block_t *p_ts = block_Alloc( 188 );
+    assert( p_ts != NULL );
+
+    uint8_t *p = p_ts->p_buffer;
+    const bool b_af = b_pcr || i_len < 184;
+
+    p[0] = 0x47;
+    p[1] = ( b_start ? 0x40 : 0 ) | ( p_es->i_pid >> 8 );
+    p[2] = p_es->i_pid & 0xff;
+    p[3] = ( b_af ? 0x30 : 0x10 ) | p_es->i_cc;
+    p_es->i_cc = ( p_es->i_cc + 1 ) & 0xf;
+    if( b_af )
+    {
+        p[4] = 183 - i_len;
+        if( p[4] > 0 )
+        {
+            p[5] = b_pcr ? 0x10 : 0;
+            memset( &p[6], 0xff, p[4] - 1 );
+        }
+        if( b_pcr )
+            p_ts->i_flags |= BLOCK_FLAG_CLOCK;
+    }
+    memset( &p[188 - i_len], 0x55, i_len );
+    if( b_start )
+        SetDWBE( &p[188 - i_len], i_au );
+
+    *pi_len = i_len;
+    return p_ts;
+}
+
+/* Generates, packetizes and schedules the streams, slice by slice */
+static block_t *Mux( ts_cbr_t *p_cbr, es_t *p_es, unsigned i_es )
+{
+    block_t *p_out = NULL, **pp_out = &p_out;
+    mtime_t pi_next[i_es];
+
+    i_aus = 0;
+    for( unsigned i = 0; i < i_es; i++ )
+        pi_next[i] = START;
+
+    for( mtime_t i_slice = START; i_slice < START + DURATION; i_slice += SLICE )
+    {
+        block_t *p_chain = NULL, **pp_chain = &p_chain;
+        bool b_pcr = true;
+
+        for( ;; )
+        {
+            /* Lowest DTS first, as the TS muxer does */
+            unsigned e = 0;
+            for( unsigned i = 1; i < i_es; i++ )
+                if( pi_next[i] < pi_next[e] )
+                    e = i;
+            if( pi_next[e] >= i_slice + SLICE )
+                break;
+
+            assert( i_aus < MAX_AUS );
+            au_t *p_au = &aus[i_aus];
+            p_au->p_es = &p_es[e];
+            p_au->i_dts = pi_next[e];
+            if( p_es[e].i_pid == PID_VIDEO )
+            {
+                /* 12 frames GOP, I frames 4 times bigger, about 3.5 Mbit/s */
+                const unsigned i_frame = ( pi_next[e] - START ) / p_es[e].i_interval;
+                p_au->i_size = ( i_frame % 12 == 0 ? 56000 : 14000 )
+                             * ( 80 + rand() % 41 ) / 100;
+            }
+            else
+                p_au->i_size = 576;
+            pi_next[e] += p_es[e].i_interval;
+
+            for( int i_left = p_au->i_size; i_left > 0; )
+            {
+                int i_len = i_left;
+                block_t *p_ts = NewPacket( &p_es[e], i_left == p_au->i_size,
+                                           b_pcr && p_es[e].i_pid == PID_VIDEO,
+                                           i_aus, &i_len );
+                if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+                    b_pcr = false;
+                i_left -= i_len;
+                *pp_chain = p_ts;
+                pp_chain = &p_ts->p_next;
+            }
+            i_aus++;
+        }
+
+        *pp_out = ts_cbr_Schedule( p_cbr, p_chain, i_slice, i_slice + SLICE,
+                                   START );
+        while( *pp_out )
+            pp_out = &(*pp_out)->p_next;
+    }
+    return p_out;
+}
+
+static uint16_t PacketPID( const uint8_t *p )
+{
+    return ( ( p[1] & 0x1f ) << 8 ) | p[2];
+}
+
+static int64_t GetPCR( const uint8_t *p )
+{
+    if( !( p[3] & 0x20 ) || p[4] < 7 || !( p[5] & 0x10 ) )
+        return -1;
+
+    const int64_t i_base = ( (int64_t)p[6] << 25 ) | ( p[7] << 17 )
+                         | ( p[8] << 9 ) | ( p[9] << 1 ) | ( p[10] >> 7 );
+    return i_base * 300 + ( ( p[10] & 1 ) << 8 ) + p[11];
+}
+
+/* Checks the multiplex, returns the number of buffer violations */
+static unsigned Check( const ts_cbr_t *p_cbr, block_t *p_out,
+                       es_t *p_es, unsigned i_es )
+{
+    const int64_t i_slot_num = 188 * 8 * INT64_C(27000000);
+    const int64_t i_rate = p_cbr->i_rate;
+    unsigned i_tb_overflows = 0, i_underflows = 0, i_b_overflows = 0;
+
+    /* Arrival times come from the first PCR and the constant rate */
+    int64_t i_ref_pcr = -1, i_ref_index = 0;
+    int64_t i_index = 0;
+    for( block_t *p = p_out; p != NULL && i_ref_pcr < 0; p = p->p_next )
+    {
+        i_ref_pcr = GetPCR( p->p_buffer );
+        i_ref_index = i_index++;
+    }
+    assert( i_ref_pcr >= 0 );
+
+    int64_t i_last_pcr = -1;
+    int64_t i_max_pcr_error = 0, i_max_pcr_interval = 0;
+    mtime_t i_prev_dts = 0;
+    int pi_cc[8192];
+    for( unsigned i = 0; i < 8192; i++ )
+        pi_cc[i] = -1;
+
+    i_index = 0;
+    for( block_t *p = p_out; p != NULL; p = p->p_next, i_index++ )
+    {
+        const uint8_t *b = p->p_buffer;
+        const uint16_t i_pid = PacketPID( b );
+        /* time of the PCR byte of this packet */
+        const int64_t i_time = i_ref_pcr
+                             + ( i_index - i_ref_index ) * i_slot_num / i_rate;
+
+        /* Constant rate */
+        assert( b[0] == 0x47 );
+        if( i_index > 0 )
+        {
+            const mtime_t i_step = p->i_dts - i_prev_dts;
+            assert( i_step * i_rate >= 188 * 8 * CLOCK_FREQ - i_rate &&
+                    i_step * i_rate <= 188 * 8 * CLOCK_FREQ + i_rate );
+        }
+        i_prev_dts = p->i_dts;
+
+        /* PCR accuracy and interval */
+        const int64_t i_pcr = GetPCR( b );
+        if( i_pcr >= 0 )
+        {
+            assert( i_pid == PID_VIDEO );
+            i_max_pcr_error = __MAX( i_max_pcr_error, llabs( i_pcr - i_time ) );
+            if( i_last_pcr >= 0 )
+                i_max_pcr_interval = __MAX( i_max_pcr_interval,
+                                            i_pcr - i_last_pcr );
+            i_last_pcr = i_pcr;
+        }
+
+        if( i_pid == 0x1fff )
+            continue;
+
+        /* Continuity counters */
+        const bool b_payload = b[3] & 0x10;
+        const int i_cc = b[3] & 0xf;
+        if( pi_cc[i_pid] >= 0 )
+            assert( i_cc == ( b_payload ? ( pi_cc[i_pid] + 1 ) & 0xf
+                                        : pi_cc[i_pid] ) );
+        pi_cc[i_pid] = i_cc;
+
+        es_t *p_stream = NULL;
+        for( unsigned i = 0; i < i_es; i++ )
+            if( p_es[i].i_pid == i_pid )
+                p_stream = &p_es[i];
+        assert( p_stream != NULL );
+
+        /* Transport buffer: 512 bytes, leaking at Rx */
+        p_stream->i_tb -= ( i_time - p_stream->i_tb_time ) * p_stream->i_rx;
+        if( p_stream->i_tb < 0 )
+            p_stream->i_tb = 0;
+        p_stream->i_tb_time = i_time;
+        p_stream->i_tb += 188 * 8 * INT64_C(27000000);
+        if( p_stream->i_tb > 512 * 8 * INT64_C(27000000) )
+            i_tb_overflows++;
+
+        if( !b_payload )
+            continue;
+
+        /* Elementary buffer: access units leave it at their DTS */
+        const int i_offset = ( b[3] & 0x20 ) ? 5 + b[4] : 4;
+        const int i_payload = 188 - i_offset;
+        if( b[1] & 0x40 )
+        {
+            p_stream->i_au = GetDWBE( &b[i_offset] );
+            p_stream->i_au_left = aus[p_stream->i_au].i_size;
+        }
+        p_stream->i_au_left -= i_payload;
+        p_stream->i_arrived += i_payload;
+
+        const au_t *p_au = &aus[p_stream->i_au];
+        const int64_t i_decode = ( p_au->i_dts - START + DTS_DELAY ) * 27;
+        if( p_stream->i_au_left == 0 && i_time > i_decode )
+            i_underflows++; /* the access unit came too late */
+
+        while( p_stream->i_first_au < i_aus )
+        {
+            const au_t *p_first = &aus[p_stream->i_first_au];
+            if( p_first->p_es == p_stream )
+            {
+                if( ( p_first->i_dts - START + DTS_DELAY ) * 27 > i_time )
+                    break;
+                p_stream->i_removed += p_first->i_size;
+            }
+            p_stream->i_first_au++;
+        }
+        if( p_stream->i_arrived - p_stream->i_removed > p_stream->i_bs )
+            i_b_overflows++;
+    }
+
+    printf( "%"PRIu64" bit/s: %"PRIu64" packets, %"PRIu64" null, %"PRIu64
+            " PCR only, %"PRIu64" late, %"PRIu64" delayed\n"
+            "  PCR error %"PRId64" ns, interval %"PRId64" us, "
+            "%u TB overflows, %u underflows, %u B overflows\n",
+            p_cbr->i_rate, p_cbr->i_packets, p_cbr->i_nulls, p_cbr->i_pcrs,
+            p_cbr->i_late, p_cbr->i_delayed, i_max_pcr_error * 1000 / 27,
+            i_max_pcr_interval / 27, i_tb_overflows, i_underflows,
+            i_b_overflows );
+
+    assert( i_max_pcr_error * 1000 <= 500 * 27 );
+    assert( i_max_pcr_interval <= ( PCR_DELAY * 27 ) + i_slot_num / i_rate + 1 );
+    return i_tb_overflows + i_underflows + i_b_overflows;
+}
+
+static unsigned Simulate( uint64_t i_rate )
+{
+    /* Video buffers of H.264 level 3. The muxer sends every stream up to
+     * the DTS delay plus a slice ahead, so the audio buffer is sized for
+     * that rather than the 3584 bytes of ISO/IEC 13818-1. */
+    es_t es[2] = {
+        { .i_pid = PID_VIDEO, .i_interval = 40000,
+          .i_rx = 12000000, .i_bs = 10000000 / 8 },
+        { .i_pid = PID_AUDIO, .i_interval = 24000,
+          .i_rx = 2000000,
+          .i_bs = INT64_C(24000) * ( DTS_DELAY + SLICE ) / CLOCK_FREQ + 3584 },
+    };
+    ts_cbr_t cbr;
+
+    ts_cbr_Init( &cbr, i_rate, PCR_DELAY );
+    ts_cbr_SetPCRPID( &cbr, PID_VIDEO );
+    for( unsigned i = 0; i < ARRAY_SIZE(es); i++ )
+        assert( ts_cbr_SetLeakRate( &cbr, es[i].i_pid, es[i].i_rx ) == 0 );
+
+    srand( 0 );
+    block_t *p_out = Mux( &cbr, es, ARRAY_SIZE(es) );
+    unsigned i_violations = Check( &cbr, p_out, es, ARRAY_SIZE(es) );
+
+    assert( cbr.i_packets * 188 * 8 * CLOCK_FREQ >= i_rate * DURATION );
+    block_ChainRelease( p_out );
+    return i_violations;
+}
+
+static void Bench( void )
+{
+    ts_cbr_t cbr;
+    unsigned i_count = 0;
+
+    ts_cbr_Init( &cbr, 300000000, PCR_DELAY );
+    ts_cbr_SetPCRPID( &cbr, PID_VIDEO );
+
+    mtime_t i_start = mdate();
+    for( mtime_t i_slice = 0; i_slice < 10 * CLOCK_FREQ; i_slice += SLICE )
+    {
+        es_t es = { .i_pid = PID_VIDEO };
+        block_t *p_chain = NULL, **pp_chain = &p_chain;
+
+        /* 50 programs worth of data, a tenth of it stuffing */
+        for( unsigned i = 0; i < 300000000 / 10 * 9 / 188 / 8 / 5; i++ )
+        {
+            int i_len = 184;
+            *pp_chain = NewPacket( &es, false, false, 0, &i_len );
+            pp_chain = &(*pp_chain)->p_next;
+        }
+        block_t *p_out = ts_cbr_Schedule( &cbr, p_chain, i_slice,
+                                          i_slice + SLICE, 0 );
+        for( block_t *p = p_out; p != NULL; p = p->p_next )
+            i_count++;
+        block_ChainRelease( p_out );
+    }
+    mtime_t i_duration = mdate() - i_start;
+
+    printf( "scheduled %u packets at %.1f Mpackets/s (%.1f Gbit/s)\n",
+            i_count, (double)i_count / i_duration,
+            (double)i_count * 188 * 8 / i_duration / 1000 );
+}
+
+int main( void )
+{
+    /* Enough room: compliant */
+    assert( Simulate( 6000000 ) == 0 );
+    /* Tight: bursts are smoothed by the slices and the DTS delay */
+    assert( Simulate( 4200000 ) == 0 );
+    /* Not enough bandwidth: the simulator must see the underflows */
+    assert( Simulate( 3000000 ) > 0 );
+
+    Bench();
+    return 0;
+}
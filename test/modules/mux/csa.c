@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * csa.c: test for the DVB-CSA scrambler of the TS muxer
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TS_NO_CSA_CK_MSG
+#include <vlc_common.h>
+#include "../modules/mux/mpeg/csa.h"
+#include "../modules/mux/mpeg/csa.c"
+
+#define BENCH_PACKETS 2000
+
+/* 0x0123456789abcdef as odd key, payload without adaptation field */
+static const uint8_t kat_odd[188] = {
+    0x47, 0x01, 0x00, 0xd0, 0xc8, 0x54, 0x77, 0x18, 0x1e, 0x1c, 0x20, 0xf3,
+    0x01, 0x59, 0xd6, 0x00, 0x4a, 0x8d, 0x96, 0x1e, 0x8e, 0x38, 0x58, 0xcb,
+    0x68, 0xb1, 0x67, 0xb9, 0xe5, 0x53, 0x50, 0xd7, 0x51, 0x96, 0x58, 0x9e,
+    0x4b, 0xdd, 0x65, 0x5a, 0xac, 0x08, 0x3d, 0x9d, 0x52, 0x38, 0x8e, 0x7f,
+    0x46, 0x55, 0xfe, 0x37, 0xc4, 0xb3, 0xc5, 0x03, 0x34, 0x93, 0xe5, 0xf5,
+    0x71, 0x39, 0xac, 0x2d, 0x0d, 0x5b, 0xf0, 0x54, 0x55, 0x31, 0xe9, 0x49,
+    0x06, 0xdd, 0x37, 0xfc, 0xe3, 0x61, 0xe9, 0xb8, 0x25, 0xd5, 0xa5, 0x79,
+    0x5c, 0xfe, 0x43, 0xa8, 0x90, 0x3e, 0x9b, 0xde, 0x79, 0x43, 0xa8, 0xfe,
+    0x3a, 0x1a, 0xd6, 0xfd, 0xdf, 0x57, 0xf0, 0x4a, 0x02, 0xb7, 0xff, 0x46,
+    0xf0, 0xcf, 0xde, 0xd0, 0x57, 0xce, 0x43, 0xc1, 0x31, 0x6a, 0x9d, 0xb7,
+    0x98, 0x0e, 0x57, 0x97, 0x83, 0xbd, 0x57, 0xf9, 0x7f, 0xf4, 0xe2, 0x6a,
+    0x35, 0x84, 0xa6, 0xa8, 0x11, 0xc3, 0xc4, 0x62, 0x35, 0xbc, 0x9d, 0xc6,
+    0x47, 0x96, 0x3b, 0xa2, 0x00, 0xd8, 0x00, 0x3a, 0x26, 0x11, 0xe6, 0xff,
+    0xfc, 0xdb, 0xfb, 0xce, 0x22, 0x1d, 0x0f, 0x62, 0x6b, 0xf2, 0x1e, 0x3e,
+    0xd7, 0xbb, 0x83, 0xa5, 0x99, 0xf7, 0xc4, 0x73, 0x46, 0x08, 0x22, 0x7c,
+    0x0d, 0xe9, 0x4c, 0x6d, 0x3c, 0xef, 0xc0, 0x2a,
+};
+
+/* 0xfedcba9876543210 as even key, payload after an adaptation field */
+static const uint8_t kat_even[188] = {
+    0x47, 0x01, 0x00, 0xb0, 0x07, 0x00, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50,
+    0xa9, 0x0d, 0x6f, 0x37, 0x33, 0xd8, 0xa3, 0x20, 0x53, 0xef, 0x1d, 0xc9,
+    0xd2, 0x84, 0x67, 0xcc, 0x21, 0xaf, 0xb8, 0x82, 0xc3, 0xed, 0x44, 0x24,
+    0x0e, 0x98, 0x23, 0x98, 0xc8, 0x10, 0xcc, 0xfb, 0x67, 0xb9, 0x9d, 0xfc,
+    0x72, 0x93, 0xf5, 0x76, 0xdf, 0xb6, 0x6b, 0x70, 0x6d, 0x94, 0x13, 0x20,
+    0xaa, 0xb8, 0xff, 0x0a, 0x76, 0x40, 0x8d, 0xa0, 0x9c, 0x25, 0xdf, 0xda,
+    0x56, 0x2f, 0x4d, 0x57, 0xe8, 0x57, 0xff, 0xaf, 0xf2, 0x3b, 0x86, 0xef,
+    0x5f, 0xf6, 0xc7, 0xfa, 0x9c, 0xb5, 0xfa, 0x6a, 0x24, 0x02, 0xd4, 0x2a,
+    0xfb, 0x39, 0xf3, 0xf2, 0x32, 0x41, 0x8b, 0xef, 0x36, 0x2a, 0x33, 0x28,
+    0x38, 0x5e, 0xbe, 0x3c, 0xae, 0x39, 0x74, 0xb3, 0xdc, 0xad, 0xfe, 0x8a,
+    0x13, 0x60, 0x4e, 0xce, 0x80, 0x30, 0x90, 0x29, 0x97, 0x35, 0x9d, 0x1a,
+    0x36, 0x3f, 0x62, 0xb1, 0x35, 0x3d, 0x4e, 0xd9, 0x6f, 0x3b, 0xc9, 0x35,
+    0xf2, 0x05, 0x81, 0x5c, 0x4b, 0xcf, 0x63, 0xfb, 0x6a, 0xa3, 0x9b, 0xc1,
+    0x5b, 0xe0, 0x5e, 0xa9, 0xe8, 0x52, 0x7e, 0x48, 0xc2, 0x36, 0x06, 0x4f,
+    0xd3, 0xcd, 0xf6, 0xe6, 0x8f, 0x80, 0xb3, 0xac, 0x15, 0x46, 0xce, 0x07,
+    0x3c, 0xdd, 0x61, 0x53, 0x36, 0x2b, 0x5f, 0xa7,
+};
+
+static void fill_packet( uint8_t *pkt, bool b_af )
+{
+    pkt[0] = 0x47;
+    pkt[1] = 0x01;
+    pkt[2] = 0x00;
+    pkt[3] = b_af ? 0x30 : 0x10;
+    for( int i = 4; i < 188; i++ )
+        pkt[i] = i * 7 + 3;
+    if( b_af )
+    {
+        pkt[4] = 7;
+        pkt[5] = 0;
+    }
+}
+
+static void random_packet( uint8_t *pkt )
+{
+    for( int i = 0; i < 188; i++ )
+        pkt[i] = rand();
+    pkt[0] = 0x47;
+    pkt[3] = (pkt[3] & 0x30) | 0x10;
+    if( pkt[3] & 0x20 )
+        pkt[4] %= 184;
+}
+
+static void test_kat( csa_t *c, bool b_odd, const uint8_t *expected )
+{
+    uint8_t pkt[188], copy[188];
+    uint8_t *pkts[1] = { copy };
+
+    csa_UseKey( NULL, c, b_odd );
+
+    /* Byte-wise scrambler */
+    fill_packet( pkt, !b_odd );
+    csa_Encrypt( c, pkt, 188 );
+    assert( !memcmp( pkt, expected, 188 ) );
+
+    /* Bit-sliced scrambler */
+    fill_packet( copy, !b_odd );
+    csa_EncryptPackets( c, pkts, 1, 188 );
+    assert( !memcmp( copy, expected, 188 ) );
+
+    /* Descrambling */
+    csa_Decrypt( c, pkt, 188 );
+    fill_packet( copy, !b_odd );
+    assert( !memcmp( pkt, copy, 188 ) );
+}
+
+/* The bit-sliced path must match the byte-wise one for any batch */
+static void test_batch( csa_t *c, unsigned i_count, int i_pkt_size )
+{
+    uint8_t (*ref)[188] = malloc( i_count * 188 );
+    uint8_t (*pkt)[188] = malloc( i_count * 188 );
+    uint8_t **pkts = malloc( i_count * sizeof (*pkts) );
+    assert( ref != NULL && pkt != NULL && pkts != NULL );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        random_packet( ref[i] );
+        memcpy( pkt[i], ref[i], 188 );
+        pkts[i] = pkt[i];
+    }
+
+    for( unsigned i = 0; i < i_count; i++ )
+        csa_Encrypt( c, ref[i], i_pkt_size );
+    csa_EncryptPackets( c, pkts, i_count, i_pkt_size );
+    assert( !memcmp( ref, pkt, i_count * 188 ) );
+
+    free( pkts );
+    free( pkt );
+    free( ref );
+}
+
+static void bench( csa_t *c )
+{
+    uint8_t (*pkt)[188] = malloc( BENCH_PACKETS * 188 );
+    uint8_t **pkts = malloc( BENCH_PACKETS * sizeof (*pkts) );
+    assert( pkt != NULL && pkts != NULL );
+
+    for( unsigned i = 0; i < BENCH_PACKETS; i++ )
+    {
+        fill_packet( pkt[i], false );
+        pkts[i] = pkt[i];
+    }
+
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < BENCH_PACKETS; i++ )
+        csa_Encrypt( c, pkt[i], 188 );
+    mtime_t bytewise = mdate() - start;
+
+    start = mdate();
+    csa_EncryptPackets( c, pkts, BENCH_PACKETS, 188 );
+    mtime_t sliced = mdate() - start;
+
+    printf( "byte-wise: %.1f Mbit/s, bit-sliced (%zu lanes): %.1f Mbit/s\n",
+            BENCH_PACKETS * 188 * 8. / bytewise, CSA_LANES,
+            BENCH_PACKETS * 188 * 8. / sliced );
+
+    free( pkts );
+    free( pkt );
+}
+
+int main( void )
+{
+    char odd[] = "0x0123456789abcdef", even[] = "fedcba9876543210";
+    csa_t *c = csa_New();
+    assert( c != NULL );
+
+    assert( csa_SetCW( NULL, c, odd, true ) == VLC_SUCCESS );
+    assert( csa_SetCW( NULL, c, even, false ) == VLC_SUCCESS );
+
+    test_kat( c, true, kat_odd );
+    test_kat( c, false, kat_even );
+
+    srand( 0 );
+    for( unsigned count = 1; count <= 2 * CSA_LANES + 1; count += 13 )
+    {
+        csa_UseKey( NULL, c, count & 1 );
+        test_batch( c, count, 188 );
+        test_batch( c, count, 100 );
+        test_batch( c, count, 12 );
+    }
+
+    bench( c );
+
+    csa_Delete( c );
+    return 0;
+}
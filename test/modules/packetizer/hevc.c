@@ -0,0 +1,390 @@
+/*****************************************************************************
+ * hevc.c: HEVC packetizer test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_modules.h>
+
+#include <inttypes.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* Ten seconds of 2160p50 at about 25 Mbit/s, one slice per picture */
+#define WIDTH    3840
+#define HEIGHT   2160
+#define FRAMES   500
+#define GOP      50
+#define IDR_SIZE 400000
+#define P_SIZE   55000
+
+#define NAL_TRAIL_R 1
+#define NAL_IDR     19
+#define NAL_VPS     32
+#define NAL_SPS     33
+#define NAL_PPS     34
+
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_size;
+    uint64_t i_bits;
+    unsigned i_count;
+} bits_t;
+
+static uint8_t *p_stream;
+static size_t i_stream;
+static size_t pi_au_offset[FRAMES + 1];
+static size_t i_xps; /* size of the VPS, SPS and PPS of each IDR picture */
+
+/* Byte counts logged by the packetizer when it is closed */
+static uint64_t i_bytes_shared;
+static uint64_t i_bytes_copied;
+static bool b_bytes_logged;
+
+static uint32_t seed = 1;
+
+static unsigned Random( unsigned max )
+{
+    seed = seed * 1103515245 + 12345;
+    return ( seed >> 8 ) % max;
+}
+
+static void PutBits( bits_t *b, unsigned i_count, uint32_t i_value )
+{
+    while( i_count-- > 0 )
+    {
+        b->i_bits = ( b->i_bits << 1 ) | ( ( i_value >> i_count ) & 1 );
+        if( ++b->i_count == 8 )
+        {
+            b->p[b->i_size++] = b->i_bits;
+            b->i_bits = b->i_count = 0;
+        }
+    }
+}
+
+static void PutUE( bits_t *b, uint32_t i_value )
+{
+    unsigned i_len = 0;
+
+    while( ( i_value + 1 ) >> ( i_len + 1 ) )
+        i_len++;
+    PutBits( b, i_len, 0 );
+    PutBits( b, i_len + 1, i_value + 1 );
+}
+
+static void PutTrailingBits( bits_t *b )
+{
+    PutBits( b, 1, 1 );
+    if( b->i_count > 0 )
+        PutBits( b, 8 - b->i_count, 0 );
+}
+
+static void PutProfileTierLevel( bits_t *b )
+{
+    PutBits( b, 8, 0x01 );        /* space, tier, Main profile */
+    PutBits( b, 32, 0x60000000 ); /* compatibility flags */
+    PutBits( b, 4, 0x9 );         /* progressive, frame only */
+    PutBits( b, 32, 0 );
+    PutBits( b, 12, 0 );
+    PutBits( b, 8, 153 );         /* level 5.1 */
+}
+
+/* Writes a NAL unit with a 4-byte startcode and emulation prevention */
+static void PutNAL( unsigned i_type, const uint8_t *p_rbsp, size_t i_rbsp )
+{
+    uint8_t *p = &p_stream[i_stream];
+    unsigned i_zeros = 0;
+
+    *p++ = 0; *p++ = 0; *p++ = 0; *p++ = 1;
+    *p++ = i_type << 1;
+    *p++ = 1;
+    for( size_t i = 0; i < i_rbsp; i++ )
+    {
+        if( i_zeros == 2 && p_rbsp[i] <= 3 )
+        {
+            *p++ = 3;
+            i_zeros = 0;
+        }
+        i_zeros = p_rbsp[i] ? 0 : i_zeros + 1;
+        *p++ = p_rbsp[i];
+    }
+    i_stream = p - p_stream;
+}
+
+static void PutParameterSets( void )
+{
+    uint8_t buf[64];
+    bits_t b;
+
+    b = (bits_t) { .p = buf };
+    PutBits( &b, 4, 0 );          /* vps_video_parameter_set_id */
+    PutBits( &b, 2, 3 );          /* base layer internal & available */
+    PutBits( &b, 6, 0 );
+    PutBits( &b, 3, 0 );          /* vps_max_sub_layers_minus1 */
+    PutBits( &b, 1, 1 );
+    PutBits( &b, 16, 0xffff );
+    PutProfileTierLevel( &b );
+    PutBits( &b, 1, 1 );
+    PutUE( &b, 4 ); PutUE( &b, 2 ); PutUE( &b, 0 );
+    PutBits( &b, 6, 0 );          /* vps_max_layer_id */
+    PutUE( &b, 0 );
+    PutBits( &b, 2, 0 );          /* no timing, no extension */
+    PutTrailingBits( &b );
+    PutNAL( NAL_VPS, buf, b.i_size );
+
+    b = (bits_t) { .p = buf };
+    PutBits( &b, 4, 0 );
+    PutBits( &b, 3, 0 );
+    PutBits( &b, 1, 1 );
+    PutProfileTierLevel( &b );
+    PutUE( &b, 0 );               /* sps_seq_parameter_set_id */
+    PutUE( &b, 1 );               /* 4:2:0 */
+    PutUE( &b, WIDTH );
+    PutUE( &b, HEIGHT );
+    PutBits( &b, 1, 0 );
+    PutUE( &b, 0 ); PutUE( &b, 0 ); /* 8 bits */
+    PutUE( &b, 4 );
+    PutBits( &b, 1, 1 );
+    PutUE( &b, 4 ); PutUE( &b, 2 ); PutUE( &b, 0 );
+    PutUE( &b, 0 ); PutUE( &b, 3 ); /* 8x8 to 64x64 coding blocks */
+    PutUE( &b, 0 ); PutUE( &b, 3 );
+    PutUE( &b, 0 ); PutUE( &b, 0 );
+    PutBits( &b, 4, 0 );          /* scaling, amp, sao, pcm */
+    PutUE( &b, 0 );               /* num_short_term_ref_pic_sets */
+    PutBits( &b, 5, 0 );
+    PutTrailingBits( &b );
+    PutNAL( NAL_SPS, buf, b.i_size );
+
+    b = (bits_t) { .p = buf };
+    PutUE( &b, 0 ); PutUE( &b, 0 );
+    PutBits( &b, 7, 0 );
+    PutUE( &b, 0 ); PutUE( &b, 0 );
+    PutUE( &b, 0 );               /* init_qp_minus26 */
+    PutBits( &b, 3, 0 );
+    PutUE( &b, 0 ); PutUE( &b, 0 );
+    PutBits( &b, 10, 0 );
+    PutUE( &b, 0 );
+    PutBits( &b, 2, 0 );
+    PutTrailingBits( &b );
+    PutNAL( NAL_PPS, buf, b.i_size );
+}
+
+static void PutSlice( unsigned i_type, size_t i_size )
+{
+    uint8_t *p_rbsp = malloc( i_size );
+    assert( p_rbsp != NULL );
+
+    p_rbsp[0] = 0x80 | Random( 0x80 ); /* first_slice_segment_in_pic_flag */
+    for( size_t i = 1; i < i_size; i++ )
+        p_rbsp[i] = 1 + Random( 255 );
+    PutNAL( i_type, p_rbsp, i_size );
+    free( p_rbsp );
+}
+
+static void CreateStream( void )
+{
+    p_stream = malloc( FRAMES * ( P_SIZE * 2 ) + ( FRAMES / GOP ) * IDR_SIZE * 2 );
+    assert( p_stream != NULL );
+
+    for( unsigned i = 0; i < FRAMES; i++ )
+    {
+        pi_au_offset[i] = i_stream;
+        if( i % GOP == 0 )
+        {
+            PutParameterSets();
+            i_xps = i_stream - pi_au_offset[i];
+            PutSlice( NAL_IDR, IDR_SIZE - IDR_SIZE / 4 + Random( IDR_SIZE / 2 ) );
+        }
+        else
+            PutSlice( NAL_TRAIL_R, P_SIZE - P_SIZE / 4 + Random( P_SIZE / 2 ) );
+    }
+    pi_au_offset[FRAMES] = i_stream;
+}
+
+static void LogCallback( void *data, int level, const libvlc_log_t *ctx,
+                         const char *fmt, va_list ap )
+{
+    char psz_msg[256];
+    uint64_t i_shared, i_copied;
+
+    vsnprintf( psz_msg, sizeof (psz_msg), fmt, ap );
+    if( sscanf( psz_msg, "%"SCNu64" bytes referenced, %"SCNu64" bytes copied",
+                &i_shared, &i_copied ) == 2 )
+    {
+        i_bytes_shared = i_shared;
+        i_bytes_copied = i_copied;
+        b_bytes_logged = true;
+    }
+    (void) data; (void) level; (void) ctx;
+}
+
+/* Checks an output access unit against the input stream. The trailing zero
+ * bytes of its last NAL unit may be dropped. */
+static void CheckAU( const block_t *p_au, unsigned i )
+{
+    assert( p_au->p_next == NULL );
+    assert( i < FRAMES );
+
+    const uint8_t *p = &p_stream[pi_au_offset[i]];
+    const size_t i_au = pi_au_offset[i + 1] - pi_au_offset[i];
+
+    assert( p_au->i_buffer <= i_au && p_au->i_buffer + 4 >= i_au );
+    assert( !memcmp( p_au->p_buffer, p, p_au->i_buffer ) );
+    for( size_t j = p_au->i_buffer; j < i_au; j++ )
+        assert( p[j] == 0 );
+}
+
+/* Packetizes the stream, cut in blocks of the given size (0: one block per
+ * access unit, as the TS demuxer outputs PES packets) */
+static void Packetize( vlc_object_t *obj, size_t i_block, const char *psz_mode )
+{
+    decoder_t *p_dec = vlc_object_create( obj, sizeof (*p_dec) );
+    assert( p_dec != NULL );
+
+    es_format_Init( &p_dec->fmt_in, VIDEO_ES, VLC_CODEC_HEVC );
+    es_format_Init( &p_dec->fmt_out, UNKNOWN_ES, 0 );
+    p_dec->p_module = module_need( p_dec, "packetizer", "packetizer_hevc", true );
+    assert( p_dec->p_module != NULL );
+
+    unsigned i_aus = 0;
+    size_t i_out = 0;
+    mtime_t i_start = mdate();
+
+    for( unsigned i = 0; i <= FRAMES; i++ )
+    {
+        block_t *p_block = NULL;
+
+        if( i < FRAMES )
+        {
+            const size_t i_au = pi_au_offset[i + 1] - pi_au_offset[i];
+
+            for( size_t i_pos = 0; i_pos < i_au; )
+            {
+                size_t i_size = i_block ? __MIN( i_block, i_au - i_pos )
+                                        : i_au;
+
+                p_block = block_Alloc( i_size );
+                assert( p_block != NULL );
+                memcpy( p_block->p_buffer,
+                        &p_stream[pi_au_offset[i] + i_pos], i_size );
+                p_block->i_dts = p_block->i_pts =
+                    VLC_TS_0 + i * CLOCK_FREQ / 50;
+                i_pos += i_size;
+
+                block_t *p_au;
+                while( ( p_au = p_dec->pf_packetize( p_dec, &p_block ) ) )
+                {
+                    CheckAU( p_au, i_aus );
+                    i_out += p_au->i_buffer;
+                    i_aus++;
+                    block_Release( p_au );
+                }
+            }
+        }
+        else
+        {
+            block_t *p_au;
+            while( ( p_au = p_dec->pf_packetize( p_dec, NULL ) ) )
+            {
+                CheckAU( p_au, i_aus );
+                i_out += p_au->i_buffer;
+                i_aus++;
+                block_Release( p_au );
+            }
+        }
+    }
+    mtime_t i_time = mdate() - i_start;
+
+    assert( p_dec->fmt_out.video.i_width == WIDTH );
+    assert( p_dec->fmt_out.video.i_height == HEIGHT );
+    assert( i_aus >= FRAMES - 1 );
+
+    log( "%-10s %7.1f MB/s, %u access units, %zu bytes\n", psz_mode,
+         i_stream * (double)CLOCK_FREQ / i_time / 1000000, i_aus, i_out );
+
+    b_bytes_logged = false;
+    module_unneed( p_dec, p_dec->p_module );
+    assert( b_bytes_logged );
+
+    log( "%-10s %"PRIu64" bytes referenced, %"PRIu64" bytes copied\n",
+         psz_mode, i_bytes_shared, i_bytes_copied );
+
+    /* Every output byte was referenced, or copied from the input */
+    assert( i_out <= i_bytes_shared + i_bytes_copied );
+
+    if( i_block == 0 )
+    {
+        /* With one block per access unit, only IDR pictures are copied: their
+         * parameter sets are too small to be referenced, and the access unit
+         * is then gathered. Each parameter set may carry the prepended
+         * startcode byte and trailing zeros. Single-slice pictures are not
+         * copied at all. */
+        size_t i_idr = 0;
+
+        for( unsigned i = 0; i < FRAMES; i += GOP )
+            i_idr += pi_au_offset[i + 1] - pi_au_offset[i];
+        assert( i_bytes_copied >= i_idr + FRAMES / GOP * i_xps );
+        assert( i_bytes_copied <= i_idr + FRAMES / GOP * ( i_xps + 3 * 5 ) );
+        assert( i_bytes_shared >= i_stream - FRAMES / GOP * i_xps - FRAMES * 4 );
+    }
+    else if( i_block < 1024 )
+        /* TS payloads are smaller than the fragments worth referencing */
+        assert( i_bytes_shared == 0 );
+    else
+        assert( i_bytes_shared > 0 );
+
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    vlc_object_release( p_dec );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 60 );
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    if( !module_exists( "packetizer_hevc" ) )
+    {
+        libvlc_release( vlc );
+        return 77;
+    }
+
+    libvlc_log_set( vlc, LogCallback, NULL );
+
+    CreateStream();
+    Packetize( obj, 0, "pes" );
+    Packetize( obj, 65536, "64k" );
+    Packetize( obj, 184, "ts" );
+
+    free( p_stream );
+    libvlc_log_unset( vlc );
+    libvlc_release( vlc );
+    return 0;
+}
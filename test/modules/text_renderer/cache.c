@@ -0,0 +1,204 @@
+/*****************************************************************************
+ * cache.c: test for the glyph and layout cache of the freetype renderer
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include "../modules/text_renderer/freetype/cache.h"
+#include "../modules/text_renderer/freetype/cache.c"
+
+/* Values are their own key: a small integer */
+#define VALUE_SIZE 100
+#define ENTRY_SIZE (sizeof (cache_entry_t) + sizeof (int) + VALUE_SIZE)
+
+static int freed[8192];
+static unsigned i_freed;
+
+static void Free( void *p_value )
+{
+    assert( i_freed < ARRAY_SIZE(freed) );
+    freed[i_freed++] = *(int *)p_value;
+    free( p_value );
+}
+
+static void Put( text_cache_t *p_cache, int i_key, size_t i_size )
+{
+    int *p_value = malloc( sizeof (*p_value) );
+    assert( p_value != NULL );
+    *p_value = i_key;
+    CachePut( p_cache, &i_key, sizeof (i_key), p_value, i_size );
+}
+
+static bool Has( text_cache_t *p_cache, int i_key )
+{
+    int *p_value = CacheGet( p_cache, &i_key, sizeof (i_key) );
+    assert( p_value == NULL || *p_value == i_key );
+    return p_value != NULL;
+}
+
+static void CheckStats( text_cache_t *p_cache, uint64_t i_hits,
+                        uint64_t i_misses, size_t i_size )
+{
+    uint64_t i_cur_hits, i_cur_misses;
+    size_t i_cur_size;
+
+    CacheGetStats( p_cache, &i_cur_hits, &i_cur_misses, &i_cur_size );
+    assert( i_cur_hits == i_hits );
+    assert( i_cur_misses == i_misses );
+    assert( i_cur_size == i_size );
+}
+
+/* The least recently used entries are evicted first, and a lookup makes
+ * an entry the most recently used one */
+static void test_lru( void )
+{
+    text_cache_t *p_cache = CacheNew( 3 * ENTRY_SIZE, Free );
+    assert( p_cache != NULL );
+    i_freed = 0;
+
+    Put( p_cache, 1, VALUE_SIZE );
+    Put( p_cache, 2, VALUE_SIZE );
+    Put( p_cache, 3, VALUE_SIZE );
+    assert( i_freed == 0 );
+    CheckStats( p_cache, 0, 0, 3 * ENTRY_SIZE );
+
+    assert( Has( p_cache, 1 ) );    /* 2 is now the oldest */
+    Put( p_cache, 4, VALUE_SIZE );
+    assert( i_freed == 1 && freed[0] == 2 );
+
+    Put( p_cache, 5, VALUE_SIZE );
+    assert( i_freed == 2 && freed[1] == 3 );
+
+    assert( Has( p_cache, 4 ) );
+    assert( Has( p_cache, 1 ) );
+    Put( p_cache, 6, VALUE_SIZE );
+    assert( i_freed == 3 && freed[2] == 5 );
+
+    assert( !Has( p_cache, 2 ) && !Has( p_cache, 3 ) && !Has( p_cache, 5 ) );
+    assert( Has( p_cache, 1 ) && Has( p_cache, 4 ) && Has( p_cache, 6 ) );
+    CheckStats( p_cache, 6, 3, 3 * ENTRY_SIZE );
+
+    /* A larger value evicts as many entries as needed, oldest first */
+    Put( p_cache, 7, VALUE_SIZE + ENTRY_SIZE );
+    assert( i_freed == 5 && freed[3] == 1 && freed[4] == 4 );
+    CheckStats( p_cache, 6, 3, 3 * ENTRY_SIZE );
+
+    CacheDelete( p_cache );
+    assert( i_freed == 7 );
+    assert( ( freed[5] == 6 && freed[6] == 7 ) );
+}
+
+/* The memory used never exceeds the limit, and a value larger than the
+ * limit is not cached at all */
+static void test_limit( void )
+{
+    const size_t i_max = 10 * ENTRY_SIZE + ENTRY_SIZE / 2;
+    text_cache_t *p_cache = CacheNew( i_max, Free );
+    assert( p_cache != NULL );
+    i_freed = 0;
+
+    for( int i = 0; i < 1000; i++ )
+    {
+        uint64_t i_hits, i_misses;
+        size_t i_size;
+
+        Put( p_cache, i, VALUE_SIZE + i % 7 );
+        CacheGetStats( p_cache, &i_hits, &i_misses, &i_size );
+        assert( i_size <= i_max );
+    }
+    /* The last ones are still there */
+    for( int i = 990; i < 1000; i++ )
+        if( i % 7 < 4 )
+            assert( Has( p_cache, i ) );
+
+    unsigned i_count = i_freed;
+    Put( p_cache, 1000, i_max );
+    assert( i_freed == i_count + 1 && freed[i_count] == 1000 );
+    assert( !Has( p_cache, 1000 ) );
+    assert( Has( p_cache, 999 ) );   /* nothing was evicted for it */
+
+    CacheDelete( p_cache );
+    assert( i_freed == 1001 );
+}
+
+/* freetype-cache-size=0: nothing is kept */
+static void test_disabled( void )
+{
+    text_cache_t *p_cache = CacheNew( 0, Free );
+    assert( p_cache != NULL );
+    i_freed = 0;
+
+    for( int i = 0; i < 10; i++ )
+    {
+        Put( p_cache, i, 0 );
+        assert( i_freed == (unsigned)i + 1 && freed[i] == i );
+        assert( !Has( p_cache, i ) );
+    }
+    CheckStats( p_cache, 0, 10, 0 );
+    CacheDelete( p_cache );
+    assert( i_freed == 10 );
+}
+
+/* More keys than hash buckets, with keys of various lengths */
+static void test_keys( void )
+{
+    const int i_count = 4 * CACHE_BUCKETS;
+    text_cache_t *p_cache = CacheNew( SIZE_MAX, Free );
+    assert( p_cache != NULL );
+    i_freed = 0;
+
+    for( int i = 0; i < i_count; i++ )
+        Put( p_cache, i, 0 );
+    for( int i = 0; i < i_count; i++ )
+        assert( Has( p_cache, i ) );
+    assert( !Has( p_cache, i_count ) );
+
+    /* A key is a prefix of the other: both are distinct */
+    static const char psz_long[] = "subtitle text";
+    int *p_value = malloc( sizeof (*p_value) );
+    assert( p_value != NULL );
+    *p_value = -1;
+    CachePut( p_cache, psz_long, 8, p_value, 0 );
+    assert( CacheGet( p_cache, psz_long, sizeof (psz_long) ) == NULL );
+    assert( CacheGet( p_cache, psz_long, 8 ) == p_value );
+
+    CheckStats( p_cache, i_count + 1, 2,
+                i_count * ( sizeof (cache_entry_t) + sizeof (int) )
+                + sizeof (cache_entry_t) + 8 );
+    CacheDelete( p_cache );
+    assert( i_freed == (unsigned)i_count + 1 );
+}
+
+int main( void )
+{
+    test_lru();
+    test_limit();
+    test_disabled();
+    test_keys();
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*****************************************************************************
+ * slices.c: slice-parallel video filters test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* 4K frames */
+#define WIDTH  3840
+#define HEIGHT 2160
+#define FRAMES 8
+
+static const char *const filters[] = {
+    "adjust{contrast=1.3,hue=20,saturation=1.4,gamma=1.2}",
+    "deinterlace{mode=yadif}",
+    "hqdn3d",
+};
+
+static uint32_t seed = 1;
+
+static uint8_t Random( void )
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 24;
+}
+
+/* Moving gradients with some noise, and combing between the fields */
+static void Fill( picture_t *p_pic, unsigned i_frame )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+        {
+            uint8_t *p_line = &p->p_pixels[y * p->i_pitch];
+            const int i_shift = ( y & 1 ) ? 4 * i_frame : 0;
+
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+                p_line[x] = ( ( x + i_shift + y / 2 ) >> 2 )
+                          + ( Random() & 15 ) + 32 * i;
+        }
+    }
+}
+
+static bool Equal( const picture_t *a, const picture_t *b )
+{
+    for( int i = 0; i < a->i_planes; i++ )
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+
+        assert( pa->i_visible_lines == pb->i_visible_lines );
+        for( int y = 0; y < pa->i_visible_lines; y++ )
+            if( memcmp( &pa->p_pixels[y * pa->i_pitch],
+                        &pb->p_pixels[y * pb->i_pitch],
+                        pa->i_visible_pitch ) )
+                return false;
+    }
+    return true;
+}
+
+static picture_t *BufferNew( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+static filter_chain_t *ChainNew( libvlc_instance_t *vlc, const es_format_t *fmt,
+                                 const char *psz_chain )
+{
+    filter_owner_t owner = {
+        .video = { .buffer_new = BufferNew },
+    };
+    filter_chain_t *p_chain =
+        filter_chain_NewVideo( vlc->p_libvlc_int, false, &owner );
+    assert( p_chain != NULL );
+
+    filter_chain_Reset( p_chain, fmt, fmt );
+    assert( filter_chain_AppendFromString( p_chain, psz_chain ) == 1 );
+    return p_chain;
+}
+
+/* Runs a filter on the same frames without and with parallel bands */
+static void Test( libvlc_instance_t *serial, libvlc_instance_t *parallel,
+                  const char *psz_chain )
+{
+    video_format_t vfmt;
+    es_format_t fmt;
+
+    video_format_Setup( &vfmt, VLC_CODEC_I420, WIDTH, HEIGHT,
+                        WIDTH, HEIGHT, 1, 1 );
+    es_format_Init( &fmt, VIDEO_ES, VLC_CODEC_I420 );
+    fmt.video = vfmt;
+
+    filter_chain_t *p_serial = ChainNew( serial, &fmt, psz_chain );
+    filter_chain_t *p_parallel = ChainNew( parallel, &fmt, psz_chain );
+    mtime_t i_serial = 0, i_parallel = 0;
+    unsigned i_outputs = 0;
+
+    for( unsigned i = 0; i < FRAMES; i++ )
+    {
+        picture_t *p_pic = picture_NewFromFormat( &vfmt );
+        picture_t *p_copy = picture_NewFromFormat( &vfmt );
+        assert( p_pic != NULL && p_copy != NULL );
+
+        Fill( p_pic, i );
+        p_pic->date = VLC_TS_0 + i * CLOCK_FREQ / 25;
+        p_pic->b_progressive = false;
+        p_pic->b_top_field_first = true;
+        p_pic->i_nb_fields = 2;
+        picture_Copy( p_copy, p_pic );
+
+        mtime_t i_start = mdate();
+        picture_t *p_out_serial = filter_chain_VideoFilter( p_serial, p_pic );
+        i_serial += mdate() - i_start;
+
+        i_start = mdate();
+        picture_t *p_out_parallel =
+            filter_chain_VideoFilter( p_parallel, p_copy );
+        i_parallel += mdate() - i_start;
+
+        assert( ( p_out_serial == NULL ) == ( p_out_parallel == NULL ) );
+        if( p_out_serial == NULL )
+            continue;
+
+        assert( Equal( p_out_serial, p_out_parallel ) );
+        i_outputs++;
+        picture_Release( p_out_serial );
+        picture_Release( p_out_parallel );
+    }
+    assert( i_outputs > 0 );
+
+    log( "%-56s %6.1f fps %6.1f fps\n", psz_chain,
+         FRAMES * (double)CLOCK_FREQ / i_serial,
+         FRAMES * (double)CLOCK_FREQ / i_parallel );
+
+    filter_chain_Delete( p_serial );
+    filter_chain_Delete( p_parallel );
+    es_format_Clean( &fmt );
+}
+
+static libvlc_instance_t *Create( const char *psz_threads )
+{
+    const char *args[test_defaults_nargs + 1];
+
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        args[i] = test_defaults_args[i];
+    args[test_defaults_nargs] = psz_threads;
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs + 1, args );
+    assert( vlc != NULL );
+    return vlc;
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 60 ); /* 4K pictures are slow to filter on a single CPU */
+
+    libvlc_instance_t *serial = Create( "--worker-threads=1" );
+    /* Not one per CPU, to split the pictures even on a single CPU */
+    libvlc_instance_t *parallel = Create( "--worker-threads=4" );
+
+    log( "%-56s %10s %10s\n", "filter", "serial", "parallel" );
+    for( size_t i = 0; i < ARRAY_SIZE(filters); i++ )
+        Test( serial, parallel, filters[i] );
+
+    libvlc_release( parallel );
+    libvlc_release( serial );
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*****************************************************************************
+ * seekindex.c: persistent seek index test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_seekindex.h>
+#include <vlc_url.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* An index of a two hours file, one entry per video frame */
+#define ENTRIES   (2 * 3600 * 25)
+#define FILE_SIZE (1 << 20)
+#define FORMAT    VLC_FOURCC('t','e','s','t')
+
+static char dir[] = "/tmp/vlc-seekindex-XXXXXX";
+
+static void CreateFile( const char *psz_path, size_t i_size )
+{
+    FILE *file = fopen( psz_path, "wb" );
+    assert( file != NULL );
+    for( size_t i = 0; i < i_size; i++ )
+        fputc( i & 0xff, file );
+    fclose( file );
+}
+
+static void RemoveTree( const char *psz_path )
+{
+    DIR *d = opendir( psz_path );
+    if( d == NULL )
+    {
+        unlink( psz_path );
+        return;
+    }
+
+    struct dirent *ent;
+    while( ( ent = readdir( d ) ) != NULL )
+    {
+        if( !strcmp( ent->d_name, "." ) || !strcmp( ent->d_name, ".." ) )
+            continue;
+
+        char *psz_child;
+        assert( asprintf( &psz_child, "%s/%s", psz_path, ent->d_name ) != -1 );
+        RemoveTree( psz_child );
+        free( psz_child );
+    }
+    closedir( d );
+    rmdir( psz_path );
+}
+
+static size_t Load( vlc_object_t *obj, const char *psz_url, vlc_fourcc_t i_format,
+                    vlc_seekindex_entry_t **pp_entries, mtime_t *pi_time )
+{
+    stream_t *s = vlc_stream_NewMRL( obj, psz_url );
+    assert( s != NULL );
+
+    mtime_t i_start = mdate();
+    size_t i_entries = vlc_seekindex_Load( obj, s, i_format, pp_entries );
+    if( pi_time )
+        *pi_time = mdate() - i_start;
+    vlc_stream_Delete( s );
+    return i_entries;
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    char cache[sizeof (dir) + 32], path[sizeof (dir) + 32];
+
+    assert( mkdtemp( dir ) != NULL );
+    snprintf( cache, sizeof (cache), "%s/cache", dir );
+    assert( mkdir( cache, 0700 ) == 0 );
+    setenv( "XDG_CACHE_HOME", cache, 1 );
+    snprintf( path, sizeof (path), "%s/media.bin", dir );
+    CreateFile( path, FILE_SIZE );
+
+    char *psz_url = vlc_path2uri( path, NULL );
+    assert( psz_url != NULL );
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    stream_t *s = vlc_stream_NewMRL( obj, psz_url );
+    if( s == NULL )
+    {
+        libvlc_release( vlc );
+        free( psz_url );
+        RemoveTree( dir );
+        return 77; /* no file access */
+    }
+
+    vlc_seekindex_entry_t *p_entries = malloc( ENTRIES * sizeof(*p_entries) );
+    assert( p_entries != NULL );
+    for( size_t i = 0; i < ENTRIES; i++ )
+    {
+        p_entries[i] = (vlc_seekindex_entry_t) {
+            .i_pos = (uint64_t)i * FILE_SIZE / ENTRIES,
+            .i_size = 1000 + i % 977,
+            .i_time = i * CLOCK_FREQ / 25 - ( i % 3 ) * 1000,
+            .i_track = i % 4,
+            .i_flags = ( i % 12 ) == 0,
+        };
+    }
+
+    /* Nothing was saved yet */
+    vlc_seekindex_entry_t *p_loaded;
+    assert( vlc_seekindex_Load( obj, s, FORMAT, &p_loaded ) == 0 );
+
+    mtime_t i_start = mdate();
+    assert( vlc_seekindex_Save( obj, s, FORMAT, p_entries, ENTRIES )
+            == VLC_SUCCESS );
+    mtime_t i_save = mdate() - i_start;
+    vlc_stream_Delete( s );
+
+    /* Round trip */
+    mtime_t i_load;
+    assert( Load( obj, psz_url, FORMAT, &p_loaded, &i_load ) == ENTRIES );
+    assert( !memcmp( p_loaded, p_entries, ENTRIES * sizeof(*p_entries) ) );
+    free( p_loaded );
+
+    log( "%u entries: saved in %"PRId64" ms, loaded in %"PRId64" ms\n",
+         ENTRIES, i_save / 1000, i_load / 1000 );
+
+    /* Another demuxer format */
+    assert( Load( obj, psz_url, VLC_FOURCC('t','e','s','u'),
+                  &p_loaded, NULL ) == 0 );
+
+    /* Modified file */
+    CreateFile( path, FILE_SIZE + 1 );
+    assert( Load( obj, psz_url, FORMAT, &p_loaded, NULL ) == 0 );
+
+    /* Indexes of other files, of 10 MiB each, saved 1 to 8 days ago, and
+     * a temporary file. Saving brings the total back under 48 MiB. */
+    char others[9][sizeof (cache) + 48];
+    struct utimbuf times;
+
+    for( unsigned i = 0; i < 9; i++ )
+    {
+        snprintf( others[i], sizeof (others[i]), "%s/vlc/seekindex/%u.idx%s",
+                  cache, i, i < 8 ? "" : ".1" );
+        CreateFile( others[i], 0 );
+        assert( truncate( others[i], 10 << 20 ) == 0 ); /* sparse */
+        times.actime = times.modtime = time( NULL ) - ( 8 - i ) * 86400;
+        assert( utime( others[i], &times ) == 0 );
+    }
+
+    s = vlc_stream_NewMRL( obj, psz_url );
+    assert( s != NULL );
+    assert( vlc_seekindex_Save( obj, s, FORMAT, p_entries, ENTRIES )
+            == VLC_SUCCESS );
+    vlc_stream_Delete( s );
+    assert( Load( obj, psz_url, FORMAT, &p_loaded, NULL ) == ENTRIES );
+    free( p_loaded );
+
+    for( unsigned i = 0; i < 9; i++ )
+    {
+        struct stat st;
+        assert( ( stat( others[i], &st ) == 0 ) == ( i >= 4 ) );
+    }
+
+    free( p_entries );
+    libvlc_release( vlc );
+    free( psz_url );
+    RemoveTree( dir );
+    return 0;
+}
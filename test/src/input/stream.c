@@ -26,9 +26,11 @@
 #include <vlc_rand.h>
 #include <vlc_fs.h>
 
+#include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -182,7 +184,7 @@ stream_close( struct reader *p_reader )
 }
 
 static struct reader *
-stream_open( const char *psz_url )
+stream_open( const char *psz_url, bool b_mmap )
 {
     libvlc_instance_t *p_vlc;
     struct reader *p_reader;
@@ -194,6 +196,7 @@ stream_open( const char *psz_url )
         "--no-media-library",
         "--vout=dummy",
         "--aout=dummy",
+        b_mmap ? "--file-mmap" : "--no-file-mmap",
     };
 
     p_reader = calloc( 1, sizeof(struct reader) );
@@ -216,7 +219,7 @@ stream_open( const char *psz_url )
     p_reader->pf_tell = stream_tell;
     p_reader->pf_seek = stream_seek;
     p_reader->p_data = p_vlc;
-    p_reader->psz_name = "stream";
+    p_reader->psz_name = b_mmap ? "stream (mmap)" : "stream";
     return p_reader;
 }
 
@@ -360,6 +363,108 @@ fill_rand( int i_fd, size_t i_size )
     }
     assert( i_written == i_size );
 }
+
+/* Process counters, from /proc/self on Linux (zero elsewhere) */
+struct usage
+{
+    uint64_t i_read_calls;  /* read() and pread() system calls */
+    uint64_t i_read_bytes;  /* bytes copied out of the kernel by them */
+    uint64_t i_faults;      /* page faults */
+    uint64_t i_rss;         /* resident set size in bytes */
+    mtime_t  i_cpu;
+};
+
+static int i_io_fd = -1, i_statm_fd = -1;
+
+static uint64_t
+proc_value( int i_fd, const char *psz_key )
+{
+    char psz_buf[1024];
+    ssize_t i_len = i_fd != -1 ? pread( i_fd, psz_buf, sizeof (psz_buf) - 1, 0 )
+                               : -1;
+    if( i_len <= 0 )
+        return 0;
+    psz_buf[i_len] = '\0';
+
+    const char *psz = strstr( psz_buf, psz_key );
+    return psz != NULL ? strtoull( psz + strlen( psz_key ), NULL, 10 ) : 0;
+}
+
+static void
+get_usage( struct usage *p_usage )
+{
+    struct rusage ru;
+
+    /* syscr and rchar include the reads of the counters themselves: two
+     * calls and less than 2 KiB per sample, negligible here */
+    p_usage->i_read_calls = proc_value( i_io_fd, "syscr: " );
+    p_usage->i_read_bytes = proc_value( i_io_fd, "rchar: " );
+
+    /* The second field of statm is the resident set size in pages */
+    char psz_buf[64];
+    ssize_t i_len = i_statm_fd != -1
+        ? pread( i_statm_fd, psz_buf, sizeof (psz_buf) - 1, 0 ) : -1;
+    p_usage->i_rss = 0;
+    if( i_len > 0 )
+    {
+        const char *psz;
+
+        psz_buf[i_len] = '\0';
+        psz = strchr( psz_buf, ' ' );
+        if( psz != NULL )
+            p_usage->i_rss = strtoull( psz, NULL, 10 ) * sysconf( _SC_PAGESIZE );
+    }
+
+    getrusage( RUSAGE_SELF, &ru );
+    p_usage->i_faults = ru.ru_minflt + ru.ru_majflt;
+    p_usage->i_cpu = ( ru.ru_utime.tv_sec + ru.ru_stime.tv_sec ) * CLOCK_FREQ
+                   + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/* Reads the whole file sequentially, as a demuxer does, and logs what each
+ * access path costs */
+static void
+benchmark( const char *psz_url, bool b_mmap )
+{
+    static uint8_t p_buf[65536];
+    struct reader *p_reader = stream_open( psz_url, b_mmap );
+    struct usage start, end;
+    uint64_t i_total = 0, i_rss_max = 0;
+
+    assert( p_reader != NULL );
+    get_usage( &start );
+    mtime_t i_start = mdate();
+
+    for( ;; )
+    {
+        ssize_t i_ret = vlc_stream_Read( p_reader->u.s, p_buf, sizeof (p_buf) );
+        assert( i_ret >= 0 );
+        if( i_ret == 0 )
+            break;
+        /* Sample the resident memory every MiB */
+        if( ( i_total >> 20 ) != ( ( i_total + i_ret ) >> 20 ) )
+        {
+            get_usage( &end );
+            i_rss_max = __MAX( i_rss_max, end.i_rss );
+        }
+        i_total += i_ret;
+    }
+
+    mtime_t i_wall = mdate() - i_start;
+    get_usage( &end );
+    assert( i_total == RAND_FILE_SIZE );
+
+    log( "%-13s: %6.0f MiB/s, %4"PRId64" ms CPU, %6"PRIu64" read calls, "
+         "%5.1f MiB copied by read, %6"PRIu64" page faults, "
+         "%+6.1f MiB peak RSS\n", p_reader->psz_name,
+         (double)i_total * CLOCK_FREQ / ( i_wall ? i_wall : 1 ) / ( 1 << 20 ),
+         ( end.i_cpu - start.i_cpu ) / 1000,
+         end.i_read_calls - start.i_read_calls,
+         (double)( end.i_read_bytes - start.i_read_bytes ) / ( 1 << 20 ),
+         end.i_faults - start.i_faults,
+         ( (double)i_rss_max - start.i_rss ) / ( 1 << 20 ) );
+    p_reader->pf_close( p_reader );
+}
 #endif
 
 int
@@ -374,18 +479,32 @@ main( void )
     char *psz_url;
     int i_tmp_fd;
 
-    log( "Test random file with libc, and stream\n" );
+    log( "Test random file with libc, stream and mapped stream\n" );
     i_tmp_fd = vlc_mkstemp( psz_tmp_path );
     fill_rand( i_tmp_fd, RAND_FILE_SIZE );
     assert( i_tmp_fd != -1 );
     assert( asprintf( &psz_url, "file://%s", psz_tmp_path ) != -1 );
 
     assert( ( pp_readers[0] = libc_open( psz_tmp_path ) ) );
-    assert( ( pp_readers[1] = stream_open( psz_url ) ) );
+    assert( ( pp_readers[1] = stream_open( psz_url, false ) ) );
+    assert( ( pp_readers[2] = stream_open( psz_url, true ) ) );
 
-    test( pp_readers, 2, NULL );
-    for( unsigned int i = 0; i < 2; ++i )
+    test( pp_readers, 3, NULL );
+    for( unsigned int i = 0; i < 3; ++i )
         pp_readers[i]->pf_close( pp_readers[i] );
+
+    log( "Benchmark the read and mapped file paths\n" );
+    i_io_fd = open( "/proc/self/io", O_RDONLY );
+    i_statm_fd = open( "/proc/self/statm", O_RDONLY );
+    if( i_io_fd == -1 || i_statm_fd == -1 )
+        log( "WARNING: no /proc/self counters, only timing is measured\n" );
+    /* The file is in the page cache already: the tests above read it */
+    benchmark( psz_url, false );
+    benchmark( psz_url, true );
+    if( i_io_fd != -1 )
+        close( i_io_fd );
+    if( i_statm_fd != -1 )
+        close( i_statm_fd );
     free( psz_url );
 
     close( i_tmp_fd );
@@ -393,7 +512,7 @@ main( void )
 
     log( "Test http url with stream\n" );
     alarm( 0 );
-    if( !( pp_readers[0] = stream_open( HTTP_URL ) ) )
+    if( !( pp_readers[0] = stream_open( HTTP_URL, false ) ) )
     {
         log( "WARNING: can't test http url" );
         return 0;
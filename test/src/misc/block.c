@@ -0,0 +1,314 @@
+/*****************************************************************************
+ * block.c: test for data blocks and the block pool
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <string.h>
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define BENCH_LOOPS 200000
+#define XFER_COUNT  100
+#define XFER_SIZE   20000
+
+/* A 6-way stream output duplicate, with each output holding about one
+ * second of 2 MB/s video, like a muxer or a network queue would */
+#define FANOUT_WAYS   6
+#define FANOUT_FRAMES 50
+#define FANOUT_SIZE   40000
+
+static void test_block_data( size_t size )
+{
+    block_t *block = block_Alloc( size );
+    assert( block != NULL );
+    assert( block->i_buffer == size );
+    assert( ((uintptr_t)block->p_buffer % 32) == 0 );
+
+    for( size_t i = 0; i < size; i++ )
+        block->p_buffer[i] = i & 0xff;
+
+    /* Grow the payload both ways */
+    block = block_Realloc( block, 100, size + 1000 );
+    assert( block != NULL );
+    assert( block->i_buffer == 100 + size + 1000 );
+    for( size_t i = 0; i < size; i++ )
+        assert( block->p_buffer[100 + i] == (i & 0xff) );
+
+    /* Shrink it back */
+    block = block_Realloc( block, -100, 100 + size );
+    assert( block != NULL );
+    assert( block->i_buffer == size );
+    for( size_t i = 0; i < size; i++ )
+        assert( block->p_buffer[i] == (i & 0xff) );
+
+    block_Release( block );
+}
+
+static void test_block( void )
+{
+    static const size_t sizes[] = { 0, 1, 188, 1316, 4000, 65536, 200000 };
+
+    for( size_t i = 0; i < ARRAY_SIZE(sizes); i++ )
+        test_block_data( sizes[i] );
+}
+
+static void test_share( void )
+{
+    block_t *block = block_Alloc( 1000 );
+    block_t *refs[3];
+
+    assert( block != NULL );
+    for( size_t i = 0; i < block->i_buffer; i++ )
+        block->p_buffer[i] = i & 0xff;
+    block->i_pts = 42;
+
+    assert( block_Share( block, refs, 2 ) == VLC_SUCCESS );
+    assert( refs[0]->p_buffer == refs[1]->p_buffer );
+    assert( refs[0]->i_buffer == 1000 && refs[1]->i_pts == 42 );
+
+    /* References have their own properties and view of the payload */
+    refs[0]->i_pts = 0;
+    refs[0]->p_buffer += 10;
+    refs[0]->i_buffer -= 20;
+    assert( refs[1]->i_pts == 42 && refs[1]->i_buffer == 1000 );
+
+    /* Sharing a reference again */
+    block = refs[1];
+    assert( block_Share( block, &refs[1], 2 ) == VLC_SUCCESS );
+    assert( refs[1] == block && refs[2]->p_buffer == block->p_buffer );
+
+    /* Expanding copies the payload and leaves the other references alone */
+    const uint8_t *p_shared = refs[1]->p_buffer;
+    refs[1] = block_Realloc( refs[1], 4, refs[1]->i_buffer );
+    assert( refs[1] != NULL && refs[1]->p_buffer + 4 != p_shared );
+    memset( refs[1]->p_buffer, 0, 4 );
+    for( size_t i = 0; i < 1000; i++ )
+        assert( refs[1]->p_buffer[4 + i] == (i & 0xff)
+             && refs[2]->p_buffer[i] == (i & 0xff) );
+
+    /* So does any reallocation, as the caller may then write in place */
+    refs[0] = block_Realloc( refs[0], 0, refs[0]->i_buffer );
+    assert( refs[0] != NULL && refs[0]->p_buffer != p_shared + 10 );
+    assert( refs[0]->i_buffer == 980 && refs[0]->p_buffer[0] == 10 );
+
+    /* Trimming directly does not */
+    refs[2]->p_buffer += 100;
+    refs[2]->i_buffer = 500;
+    assert( refs[2]->p_buffer == p_shared + 100 );
+
+    /* The last reference to a payload can write to it */
+    assert( block_MakeWritable( refs[2] ) == refs[2] );
+
+    for( size_t i = 0; i < ARRAY_SIZE(refs); i++ )
+        block_Release( refs[i] );
+
+    /* Writing to a shared payload gets a copy */
+    block = block_Alloc( 100 );
+    assert( block != NULL );
+    memset( block->p_buffer, 1, 100 );
+    assert( block_Share( block, refs, 2 ) == VLC_SUCCESS );
+    refs[0] = block_MakeWritable( refs[0] );
+    assert( refs[0] != NULL && refs[0]->p_buffer != refs[1]->p_buffer );
+    memset( refs[0]->p_buffer, 2, 100 );
+    assert( refs[1]->p_buffer[0] == 1 && refs[1]->p_buffer[99] == 1 );
+    block_Release( refs[0] );
+    block_Release( refs[1] );
+}
+
+static long resident( void )
+{
+    long pages = 0;
+    FILE *stream = fopen( "/proc/self/statm", "r" );
+
+    if( stream != NULL )
+    {
+        if( fscanf( stream, "%*d %ld", &pages ) != 1 )
+            pages = 0;
+        fclose( stream );
+    }
+    return pages * sysconf( _SC_PAGESIZE );
+}
+
+/* Feeds frames to several outputs, either copied or shared */
+static void bench_fanout( bool shared )
+{
+    block_t *queues[FANOUT_WAYS][FANOUT_FRAMES];
+    uint64_t copied = 0;
+    long rss = resident();
+    mtime_t start = mdate();
+
+    for( unsigned i = 0; i < FANOUT_FRAMES; i++ )
+    {
+        block_t *frame = block_Alloc( FANOUT_SIZE );
+        block_t *refs[FANOUT_WAYS];
+
+        assert( frame != NULL );
+        memset( frame->p_buffer, i, frame->i_buffer );
+
+        if( !shared || block_Share( frame, refs, FANOUT_WAYS ) )
+        {
+            for( unsigned j = 0; j < FANOUT_WAYS - 1; j++ )
+            {
+                refs[j] = block_Duplicate( frame );
+                assert( refs[j] != NULL );
+                copied += frame->i_buffer;
+            }
+            refs[FANOUT_WAYS - 1] = frame;
+        }
+
+        for( unsigned j = 0; j < FANOUT_WAYS; j++ )
+            queues[j][i] = refs[j];
+    }
+
+    mtime_t duration = mdate() - start;
+    rss = resident() - rss;
+
+    for( unsigned j = 0; j < FANOUT_WAYS; j++ )
+        for( unsigned i = 0; i < FANOUT_FRAMES; i++ )
+        {
+            assert( queues[j][i]->p_buffer[0] == (uint8_t)i );
+            block_Release( queues[j][i] );
+        }
+
+    log( "%u-way %s: %"PRIu64" bytes copied, %ld KiB resident, "
+         "%.1f us per frame\n", FANOUT_WAYS, shared ? "share" : "duplicate",
+         copied, rss / 1024, duration / (double)FANOUT_FRAMES );
+}
+
+static void bench_block( const char *name, size_t size )
+{
+    block_t *blocks[8];
+    mtime_t start = mdate();
+
+    for( unsigned i = 0; i < BENCH_LOOPS; i++ )
+    {
+        for( unsigned j = 0; j < ARRAY_SIZE(blocks); j++ )
+        {
+            blocks[j] = block_Alloc( size );
+            assert( blocks[j] != NULL );
+        }
+        for( unsigned j = 0; j < ARRAY_SIZE(blocks); j++ )
+            block_Release( blocks[j] );
+    }
+
+    mtime_t duration = mdate() - start;
+    log( "%s: %zu bytes: %.1f ns per allocation\n", name, size,
+         duration * 1000. / (BENCH_LOOPS * ARRAY_SIZE(blocks)) );
+}
+
+static void bench( const char *name )
+{
+    bench_block( name, 188 );
+    bench_block( name, 1316 );
+    bench_block( name, 65536 );
+}
+
+static void *release_thread( void *data )
+{
+    block_t *chain = data;
+
+    block_ChainRelease( chain );
+    return NULL;
+}
+
+static void test_pool( void )
+{
+    block_pool_stats_t before, after;
+
+    block_pool_GetStats( &before );
+    test_block();
+    block_pool_GetStats( &after );
+    assert( after.allocs > before.allocs );
+
+    /* Recycling within a thread */
+    block_Release( block_Alloc( 188 ) );
+    block_pool_GetStats( &before );
+    block_Release( block_Alloc( 188 ) );
+    block_pool_GetStats( &after );
+    assert( after.allocs == before.allocs + 1 );
+    assert( after.hits == before.hits + 1 );
+    assert( after.held == before.held );
+
+    /* Too large for the pool */
+    block_pool_GetStats( &before );
+    block_Release( block_Alloc( 1 << 20 ) );
+    block_pool_GetStats( &after );
+    assert( after.allocs == before.allocs );
+
+    /* Blocks released by another thread come back to the allocating one */
+    block_t *chain = NULL;
+    block_t **pp_last = &chain;
+    for( unsigned i = 0; i < XFER_COUNT; i++ )
+    {
+        block_t *block = block_Alloc( XFER_SIZE );
+        assert( block != NULL );
+        block_ChainLastAppend( &pp_last, block );
+    }
+
+    vlc_thread_t th;
+    block_pool_GetStats( &before );
+    assert( vlc_clone( &th, release_thread, chain,
+                       VLC_THREAD_PRIORITY_LOW ) == 0 );
+    vlc_join( th, NULL );
+    block_pool_GetStats( &after );
+    assert( after.held >= before.held + XFER_COUNT * XFER_SIZE );
+
+    for( unsigned i = 0; i < XFER_COUNT; i++ )
+    {
+        block_t *block = block_Alloc( XFER_SIZE );
+        assert( block != NULL );
+        block->p_next = chain;
+        chain = block;
+    }
+    block_pool_GetStats( &before );
+    assert( before.hits == after.hits + XFER_COUNT );
+    block_ChainRelease( chain );
+}
+
+int main( void )
+{
+    static const char *args[] = { "-v", "--block-pool" };
+
+    test_init();
+
+    log( "Testing blocks without pool\n" );
+    test_block();
+    test_share();
+    bench( "malloc" );
+
+    /* Shared first, as freed memory may remain resident afterwards */
+    bench_fanout( true );
+    bench_fanout( false );
+
+    libvlc_instance_t *vlc = libvlc_new( ARRAY_SIZE(args), args );
+    assert( vlc != NULL );
+
+    log( "Testing blocks with pool\n" );
+    test_pool();
+    bench( "pool" );
+
+    block_pool_stats_t stats;
+    block_pool_GetStats( &stats );
+    log( "pool: %"PRIu64" allocations, %.1f%% hits, %zu bytes held\n",
+         stats.allocs, stats.allocs ? stats.hits * 100. / stats.allocs : 0.,
+         stats.held );
+
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * fifo.c: test for block FIFOs
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define BENCH_COUNT  500000
+#define BENCH_BLOCKS 64
+
+static void test_fifo_single( block_fifo_t *fifo )
+{
+    block_t *chain = NULL, **pp_last = &chain;
+
+    assert( vlc_fifo_GetCount( fifo ) == 0 );
+    assert( vlc_fifo_GetBytes( fifo ) == 0 );
+
+    for( unsigned i = 0; i < 10; i++ )
+    {
+        block_t *block = block_Alloc( i );
+        assert( block != NULL );
+        block->i_dts = i;
+        block_ChainLastAppend( &pp_last, block );
+    }
+
+    /* Queue a chain, then single blocks */
+    block_FifoPut( fifo, chain );
+    block_FifoPut( fifo, NULL );
+    for( unsigned i = 10; i < 20; i++ )
+    {
+        block_t *block = block_Alloc( i );
+        assert( block != NULL );
+        block->i_dts = i;
+        block_FifoPut( fifo, block );
+    }
+
+    assert( vlc_fifo_GetCount( fifo ) == 20 );
+    assert( vlc_fifo_GetBytes( fifo ) == 19 * 20 / 2 );
+    assert( block_FifoShow( fifo )->i_dts == 0 );
+
+    for( unsigned i = 0; i < 15; i++ )
+    {
+        block_t *block = block_FifoGet( fifo );
+        assert( block->i_dts == i );
+        assert( block->i_buffer == i );
+        assert( block->p_next == NULL );
+        block_Release( block );
+    }
+
+    assert( vlc_fifo_GetCount( fifo ) == 5 );
+    block_FifoEmpty( fifo );
+    assert( vlc_fifo_GetCount( fifo ) == 0 );
+    assert( vlc_fifo_GetBytes( fifo ) == 0 );
+
+    block_FifoPut( fifo, block_Alloc( 1 ) );
+}
+
+struct bench
+{
+    block_fifo_t *full;
+    block_fifo_t *empty;
+};
+
+static void *producer( void *data )
+{
+    struct bench *bench = data;
+
+    for( unsigned i = 0; i < BENCH_COUNT; i++ )
+    {
+        block_t *block = block_FifoGet( bench->empty );
+        block->i_dts = i;
+        block_FifoPut( bench->full, block );
+    }
+    return NULL;
+}
+
+/* Blocks go round between two threads, as in the UDP stream output */
+static void bench_fifo( const char *name, block_fifo_t *(*create)(void) )
+{
+    struct bench bench = { create(), create() };
+    vlc_thread_t th;
+
+    assert( bench.full != NULL && bench.empty != NULL );
+    for( unsigned i = 0; i < BENCH_BLOCKS; i++ )
+        block_FifoPut( bench.empty, block_Alloc( 188 ) );
+
+    mtime_t start = mdate();
+
+    assert( vlc_clone( &th, producer, &bench,
+                       VLC_THREAD_PRIORITY_LOW ) == 0 );
+    for( unsigned i = 0; i < BENCH_COUNT; i++ )
+    {
+        block_t *block = block_FifoGet( bench.full );
+        assert( block->i_dts == i );
+        block_FifoPut( bench.empty, block );
+    }
+    vlc_join( th, NULL );
+
+    mtime_t duration = mdate() - start;
+    log( "%s: %.1f ns per block\n", name, duration * 1000. / BENCH_COUNT );
+
+    assert( vlc_fifo_GetCount( bench.full ) == 0 );
+    assert( vlc_fifo_GetCount( bench.empty ) == BENCH_BLOCKS );
+    block_FifoRelease( bench.full );
+    block_FifoRelease( bench.empty );
+}
+
+static void *sleeper( void *data )
+{
+    block_fifo_t *fifo = data;
+
+    block_Release( block_FifoGet( fifo ) );
+    /* Wait forever */
+    block_Release( block_FifoGet( fifo ) );
+    return NULL;
+}
+
+static void test_fifo_cancel( block_fifo_t *fifo )
+{
+    vlc_thread_t th;
+
+    assert( vlc_clone( &th, sleeper, fifo, VLC_THREAD_PRIORITY_LOW ) == 0 );
+    msleep( 10000 );
+    block_FifoPut( fifo, block_Alloc( 1 ) );
+    msleep( 10000 );
+    vlc_cancel( th );
+    vlc_join( th, NULL );
+}
+
+static void test_fifo( const char *name, block_fifo_t *(*create)(void) )
+{
+    block_fifo_t *fifo = create();
+    assert( fifo != NULL );
+
+    log( "Testing %s FIFO\n", name );
+    test_fifo_single( fifo );
+    block_FifoRelease( fifo );
+
+    bench_fifo( name, create );
+
+    fifo = create();
+    assert( fifo != NULL );
+    test_fifo_cancel( fifo );
+    block_FifoRelease( fifo );
+}
+
+int main( void )
+{
+    test_init();
+
+    test_fifo( "locked", block_FifoNew );
+    test_fifo( "SPSC", block_FifoNewSPSC );
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*****************************************************************************
+ * image.c: image handler test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_image.h>
+#include <vlc_picture.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* Cover art sized images, alternately in PNG and JPEG, like a library
+ * where each album has its own */
+#define IMAGES 200
+#define WIDTH  600
+#define HEIGHT 600
+#define THUMB  160
+
+static const vlc_fourcc_t codecs[] = { VLC_CODEC_PNG, VLC_CODEC_JPEG };
+
+static block_t *images[IMAGES];
+
+static void Fill( picture_t *p_pic, unsigned i_image )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] =
+                    ( x * ( i_image + 1 ) + y * ( i + 1 ) ) >> 2;
+    }
+}
+
+/* Encodes the source images, returns false if the codecs are missing */
+static bool Create( vlc_object_t *obj )
+{
+    image_handler_t *p_image = image_HandlerCreate( obj );
+    video_format_t fmt;
+    bool b_ok = true;
+
+    assert( p_image != NULL );
+    video_format_Setup( &fmt, VLC_CODEC_I420, WIDTH, HEIGHT, WIDTH, HEIGHT,
+                        1, 1 );
+
+    for( unsigned i = 0; i < IMAGES && b_ok; i++ )
+    {
+        picture_t *p_pic = picture_NewFromFormat( &fmt );
+        video_format_t fmt_out;
+
+        assert( p_pic != NULL );
+        Fill( p_pic, i % 16 );
+        video_format_Init( &fmt_out, codecs[i % ARRAY_SIZE(codecs)] );
+        images[i] = image_Write( p_image, p_pic, &fmt, &fmt_out );
+        b_ok = images[i] != NULL;
+        picture_Release( p_pic );
+    }
+
+    image_HandlerDelete( p_image );
+    return b_ok;
+}
+
+/* Makes a PNG thumbnail of every image with a single handler */
+static void Thumbnails( image_handler_t *p_image, const char *psz_mode )
+{
+    mtime_t i_start = mdate();
+
+    for( unsigned i = 0; i < IMAGES; i++ )
+    {
+        video_format_t fmt_in, fmt_pic, fmt_out;
+
+        video_format_Init( &fmt_in, codecs[i % ARRAY_SIZE(codecs)] );
+        video_format_Init( &fmt_pic, 0 );
+        fmt_pic.i_width = THUMB;
+
+        picture_t *p_pic = image_Read( p_image, block_Duplicate( images[i] ),
+                                       &fmt_in, &fmt_pic );
+        assert( p_pic != NULL );
+        assert( fmt_pic.i_width == THUMB && fmt_pic.i_height == THUMB );
+
+        video_format_Init( &fmt_out, VLC_CODEC_PNG );
+        fmt_out.i_width = fmt_pic.i_width;
+        fmt_out.i_height = fmt_pic.i_height;
+        block_t *p_block = image_Write( p_image, p_pic, &fmt_pic, &fmt_out );
+        assert( p_block != NULL );
+        block_Release( p_block );
+        picture_Release( p_pic );
+    }
+
+    log( "%-12s %7.1f images/s\n", psz_mode,
+         IMAGES * (double)CLOCK_FREQ / ( mdate() - i_start ) );
+}
+
+static void Batch( vlc_object_t *obj )
+{
+    image_batch_item_t items[IMAGES];
+
+    for( unsigned i = 0; i < IMAGES; i++ )
+    {
+        items[i].psz_url = NULL;
+        items[i].p_block = block_Duplicate( images[i] );
+        video_format_Init( &items[i].fmt_in, codecs[i % ARRAY_SIZE(codecs)] );
+        video_format_Init( &items[i].fmt_out, VLC_CODEC_PNG );
+        items[i].fmt_out.i_width = THUMB;
+    }
+
+    mtime_t i_start = mdate();
+    image_Batch( obj, items, IMAGES );
+    log( "%-12s %7.1f images/s\n", "batch",
+         IMAGES * (double)CLOCK_FREQ / ( mdate() - i_start ) );
+
+    for( unsigned i = 0; i < IMAGES; i++ )
+    {
+        assert( items[i].p_block == NULL );
+        assert( items[i].p_result != NULL );
+        block_Release( items[i].p_result );
+    }
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 60 );
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    bool b_supported = Create( obj );
+    if( b_supported )
+    {
+        image_handler_t *p_image = image_HandlerCreate( obj );
+        assert( p_image != NULL );
+        Thumbnails( p_image, "handler" );
+        image_HandlerDelete( p_image );
+
+        p_image = image_HandlerCreatePersistent( obj );
+        assert( p_image != NULL );
+        Thumbnails( p_image, "persistent" );
+        image_HandlerDelete( p_image );
+
+        Batch( obj );
+    }
+
+    for( unsigned i = 0; i < IMAGES; i++ )
+        if( images[i] != NULL )
+            block_Release( images[i] );
+    libvlc_release( vlc );
+    return b_supported ? 0 : 77; /* no PNG or JPEG support */
+}
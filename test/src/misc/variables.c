@@ -26,6 +26,8 @@
 #include "../../libvlc/test.h"
 #include "../lib/libvlc_internal.h"
 
+#include <vlc_atomic.h>
+
 static const char *psz_var_name[] = {
     "a", "abcdef", "abcdefg", "abc123", "abc-123", "é€!!"
 };
@@ -443,6 +445,73 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+/* Many variables, like a video output or an input, hammered by a few
+ * threads, like the decoders and the interface */
+#define BENCH_VARS    100
+#define BENCH_THREADS 4
+#define BENCH_LOOPS   100000
+
+static int bench_callback( vlc_object_t *p_this, char const *psz_var,
+                           vlc_value_t oldval, vlc_value_t newval,
+                           void *p_data )
+{
+    (void) p_this; (void) psz_var; (void) oldval; (void) newval;
+    atomic_fetch_add( (atomic_uint *)p_data, 1 );
+    return VLC_SUCCESS;
+}
+
+static void *bench_thread( void *data )
+{
+    vlc_object_t *obj = data;
+    char psz_name[16];
+
+    for( unsigned i = 0; i < BENCH_LOOPS; i++ )
+    {
+        snprintf( psz_name, sizeof (psz_name), "bench-%u",
+                  i % BENCH_VARS );
+        var_SetInteger( obj, psz_name, i );
+        assert( var_GetInteger( obj, psz_name ) >= 0 );
+        var_TriggerCallback( obj, "bench-trigger" );
+    }
+    return NULL;
+}
+
+static void test_benchmark( libvlc_int_t *p_libvlc )
+{
+    vlc_object_t *obj = VLC_OBJECT(p_libvlc);
+    char psz_name[16];
+    atomic_uint i_calls = ATOMIC_VAR_INIT(0);
+    vlc_thread_t threads[BENCH_THREADS];
+
+    for( unsigned i = 0; i < BENCH_VARS; i++ )
+    {
+        snprintf( psz_name, sizeof (psz_name), "bench-%u", i );
+        var_Create( obj, psz_name, VLC_VAR_INTEGER );
+    }
+    var_Create( obj, "bench-trigger", VLC_VAR_VOID );
+    var_AddCallback( obj, "bench-trigger", bench_callback, &i_calls );
+
+    mtime_t i_start = mdate();
+    for( unsigned i = 0; i < BENCH_THREADS; i++ )
+        assert( !vlc_clone( &threads[i], bench_thread, obj,
+                            VLC_THREAD_PRIORITY_LOW ) );
+    for( unsigned i = 0; i < BENCH_THREADS; i++ )
+        vlc_join( threads[i], NULL );
+    mtime_t i_time = mdate() - i_start;
+
+    assert( atomic_load( &i_calls ) == BENCH_THREADS * BENCH_LOOPS );
+    log( "%u threads: %.0f get/set/trigger per second\n", BENCH_THREADS,
+         BENCH_THREADS * BENCH_LOOPS * (double)CLOCK_FREQ / i_time );
+
+    var_DelCallback( obj, "bench-trigger", bench_callback, &i_calls );
+    var_Destroy( obj, "bench-trigger" );
+    for( unsigned i = 0; i < BENCH_VARS; i++ )
+    {
+        snprintf( psz_name, sizeof (psz_name), "bench-%u", i );
+        var_Destroy( obj, psz_name );
+    }
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -480,6 +549,9 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    log( "Benchmarking concurrent accesses\n" );
+    test_benchmark( p_libvlc );
 }
 
 
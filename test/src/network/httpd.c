@@ -0,0 +1,243 @@
+/*****************************************************************************
+ * httpd.c: HTTP stream server load test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* Many viewers of a single 2 Mbit/s transport stream on the loopback */
+#define PORT     18081
+#define PACKET   (7 * 188)
+#define BITRATE  2000000
+#define DURATION (2 * CLOCK_FREQ)
+
+static const unsigned loads[] = { 50, 100, 200, 400 };
+
+typedef struct
+{
+    int *fds;
+    uint64_t *received;
+    unsigned count;
+    atomic_bool b_stop;
+    mtime_t i_cpu;
+} viewers_t;
+
+static mtime_t ThreadCPU( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+    return ts.tv_sec * CLOCK_FREQ + ts.tv_nsec / 1000;
+}
+
+static mtime_t ProcessCPU( void )
+{
+    struct rusage ru;
+
+    getrusage( RUSAGE_SELF, &ru );
+    return ( ru.ru_utime.tv_sec + ru.ru_stime.tv_sec ) * CLOCK_FREQ
+         + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static int Connect( void )
+{
+    static const char req[] = "GET /stream HTTP/1.0\r\n\r\n";
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons( PORT ),
+        .sin_addr.s_addr = htonl( INADDR_LOOPBACK ),
+    };
+
+    int fd = socket( AF_INET, SOCK_STREAM, 0 );
+    if( fd == -1 )
+        return -1;
+    if( connect( fd, (struct sockaddr *)&addr, sizeof (addr) )
+     || send( fd, req, sizeof (req) - 1, 0 ) != sizeof (req) - 1 )
+    {
+        close( fd );
+        return -1;
+    }
+    fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+    return fd;
+}
+
+/* Reads and discards everything the server sends to the viewers */
+static void *Watch( void *data )
+{
+    viewers_t *v = data;
+    struct pollfd ufd[v->count];
+    char buf[65536];
+    mtime_t i_start = ThreadCPU();
+
+    for( unsigned i = 0; i < v->count; i++ )
+    {
+        ufd[i].fd = v->fds[i];
+        ufd[i].events = POLLIN;
+    }
+
+    while( !atomic_load( &v->b_stop ) )
+    {
+        if( poll( ufd, v->count, 10 ) <= 0 )
+            continue;
+
+        for( unsigned i = 0; i < v->count; i++ )
+        {
+            if( !( ufd[i].revents & POLLIN ) )
+                continue;
+
+            ssize_t val;
+            while( ( val = recv( ufd[i].fd, buf, sizeof (buf), 0 ) ) > 0 )
+                v->received[i] += val;
+            if( val == 0 )
+                ufd[i].fd = -1; /* closed by the server */
+        }
+    }
+
+    v->i_cpu = ThreadCPU() - i_start;
+    return NULL;
+}
+
+/* Feeds the stream in real time to the given number of viewers */
+static void Load( httpd_stream_t *stream, unsigned count )
+{
+    int fds[count];
+    uint64_t received[count];
+    viewers_t v = { .fds = fds, .received = received, .count = count };
+    pthread_t th;
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        fds[i] = Connect();
+        assert( fds[i] != -1 );
+        received[i] = 0;
+    }
+    atomic_init( &v.b_stop, false );
+    assert( pthread_create( &th, NULL, Watch, &v ) == 0 );
+
+    block_t *p_block = block_Alloc( PACKET );
+    assert( p_block != NULL );
+    memset( p_block->p_buffer, 0x47, PACKET );
+
+    const mtime_t i_period = PACKET * 8 * CLOCK_FREQ / BITRATE;
+    mtime_t i_start = mdate(), i_cpu = ProcessCPU();
+    unsigned i_packets = 0;
+
+    for( mtime_t i_date = i_start; i_date < i_start + DURATION;
+         i_date += i_period )
+    {
+        mwait( i_date );
+        assert( httpd_StreamSend( stream, p_block ) == VLC_SUCCESS );
+        i_packets++;
+    }
+    msleep( CLOCK_FREQ / 10 ); /* let the last packets go out */
+
+    atomic_store( &v.b_stop, true );
+    pthread_join( th, NULL );
+    mtime_t i_wall = mdate() - i_start;
+    i_cpu = ProcessCPU() - i_cpu - v.i_cpu;
+    block_Release( p_block );
+
+    /* A viewer keeps up if it got nearly the whole stream */
+    unsigned i_sustained = 0;
+    for( unsigned i = 0; i < count; i++ )
+    {
+        assert( received[i] > 0 );
+        if( received[i] >= (uint64_t)i_packets * PACKET * 9 / 10 )
+            i_sustained++;
+        close( fds[i] );
+    }
+
+    double f_load = (double)i_cpu / i_wall;
+    log( "%3u viewers: %3u sustained, %5.1f%% CPU, %7.0f viewers/core\n",
+         count, i_sustained, 100. * f_load,
+         i_sustained / __MAX( f_load, 0.001 ) );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 60 );
+
+    struct rlimit rl;
+    unsigned i_max = loads[ARRAY_SIZE(loads) - 1];
+
+    getrlimit( RLIMIT_NOFILE, &rl );
+    if( rl.rlim_cur < 2 * i_max + 64 && rl.rlim_max > rl.rlim_cur )
+    {
+        rl.rlim_cur = __MIN( rl.rlim_max, 2 * i_max + 64 );
+        setrlimit( RLIMIT_NOFILE, &rl );
+    }
+
+    const char *args[test_defaults_nargs + 2];
+    char psz_port[32];
+
+    snprintf( psz_port, sizeof (psz_port), "--http-port=%u", PORT );
+
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        args[i] = test_defaults_args[i];
+    args[test_defaults_nargs] = "--http-host=127.0.0.1";
+    args[test_defaults_nargs + 1] = psz_port;
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs + 2, args );
+    assert( vlc != NULL );
+
+    httpd_host_t *host = vlc_http_HostNew( VLC_OBJECT(vlc->p_libvlc_int) );
+    if( host == NULL )
+    {
+        libvlc_release( vlc );
+        return 77; /* port in use or no networking */
+    }
+
+    httpd_stream_t *stream = httpd_StreamNew( host, "/stream", "video/mp2t",
+                                              NULL, NULL );
+    assert( stream != NULL );
+
+    for( unsigned i = 0; i < ARRAY_SIZE(loads); i++ )
+    {
+        getrlimit( RLIMIT_NOFILE, &rl );
+        if( rl.rlim_cur < 2 * loads[i] + 64 )
+        {
+            log( "%3u viewers: skipped, too few file descriptors\n",
+                 loads[i] );
+            break;
+        }
+        Load( stream, loads[i] );
+    }
+
+    httpd_StreamDelete( stream );
+    httpd_HostDelete( host );
+    libvlc_release( vlc );
+    return 0;
+}
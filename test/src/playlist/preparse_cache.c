@@ -0,0 +1,192 @@
+/*****************************************************************************
+ * preparse_cache.c: preparsing cache test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* A small library of silent WAV files of different durations */
+#define FILES 64
+#define RATE  8000
+
+static char dir[] = "/tmp/vlc-preparse-XXXXXX";
+static char paths[FILES][sizeof (dir) + 16];
+
+static void WriteLE( FILE *file, uint32_t value, unsigned bytes )
+{
+    for( unsigned i = 0; i < bytes; i++ )
+        fputc( ( value >> ( 8 * i ) ) & 0xff, file );
+}
+
+/* The size of a file does not depend on its sample rate */
+static void CreateFiles( uint32_t i_rate )
+{
+    for( unsigned i = 0; i < FILES; i++ )
+    {
+        const uint32_t i_data = RATE * ( i + 1 ) / 4;
+
+        snprintf( paths[i], sizeof (paths[i]), "%s/%02u.wav", dir, i );
+        FILE *file = fopen( paths[i], "wb" );
+        assert( file != NULL );
+
+        fputs( "RIFF", file );
+        WriteLE( file, 36 + i_data, 4 );
+        fputs( "WAVEfmt ", file );
+        WriteLE( file, 16, 4 );
+        WriteLE( file, 1, 2 ); /* PCM */
+        WriteLE( file, 1, 2 ); /* mono */
+        WriteLE( file, i_rate, 4 );
+        WriteLE( file, i_rate, 4 );
+        WriteLE( file, 1, 2 );
+        WriteLE( file, 8, 2 );
+        fputs( "data", file );
+        WriteLE( file, i_data, 4 );
+        for( uint32_t j = 0; j < i_data; j++ )
+            fputc( 0x80, file );
+        fclose( file );
+    }
+}
+
+static void ParseEnded( const libvlc_event_t *event, void *data )
+{
+    (void) event;
+    vlc_sem_post( data );
+}
+
+/* Preparses the whole library, returns false if nothing could be parsed */
+static bool Scan( const char *psz_mode, uint32_t i_rate,
+                  libvlc_time_t *durations )
+{
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    libvlc_media_t *medias[FILES];
+    vlc_sem_t sem;
+    bool b_parsed = true;
+
+    vlc_sem_init( &sem, 0 );
+    mtime_t i_start = mdate();
+    for( unsigned i = 0; i < FILES; i++ )
+    {
+        medias[i] = libvlc_media_new_path( vlc, paths[i] );
+        assert( medias[i] != NULL );
+        libvlc_event_attach( libvlc_media_event_manager( medias[i] ),
+                             libvlc_MediaParsedChanged, ParseEnded, &sem );
+        assert( libvlc_media_parse_with_options( medias[i],
+                                    libvlc_media_parse_local, -1 ) == 0 );
+    }
+    for( unsigned i = 0; i < FILES; i++ )
+        vlc_sem_wait( &sem );
+    mtime_t i_time = mdate() - i_start;
+
+    for( unsigned i = 0; i < FILES; i++ )
+    {
+        libvlc_media_track_t **pp_tracks;
+        unsigned i_tracks = libvlc_media_tracks_get( medias[i], &pp_tracks );
+        libvlc_time_t i_duration = libvlc_media_get_duration( medias[i] );
+
+        if( i_tracks == 0 )
+            b_parsed = false;
+        else
+        {
+            assert( pp_tracks[0]->i_type == libvlc_track_audio );
+            assert( pp_tracks[0]->audio->i_rate == i_rate );
+            libvlc_media_tracks_release( pp_tracks, i_tracks );
+        }
+
+        if( durations[i] == 0 )
+            durations[i] = i_duration;
+        else
+            assert( durations[i] == i_duration );
+        libvlc_media_release( medias[i] );
+    }
+    vlc_sem_destroy( &sem );
+    libvlc_release( vlc );
+
+    log( "%-6s %7.1f items/s\n", psz_mode,
+         FILES * (double)CLOCK_FREQ / i_time );
+    return b_parsed;
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    char cache[sizeof (dir) + 32];
+    libvlc_time_t durations[FILES] = { 0 }, halved[FILES] = { 0 };
+
+    assert( mkdtemp( dir ) != NULL );
+    snprintf( cache, sizeof (cache), "%s/cache", dir );
+    assert( mkdir( cache, 0700 ) == 0 );
+    setenv( "XDG_CACHE_HOME", cache, 1 );
+    CreateFiles( RATE );
+
+    bool b_supported = Scan( "cold", RATE, durations );
+    if( b_supported )
+    {
+        struct stat st[FILES];
+        struct utimbuf times;
+
+        /* Files that only differ in content, with the same size and time,
+         * are only seen through the cache */
+        for( unsigned i = 0; i < FILES; i++ )
+            assert( stat( paths[i], &st[i] ) == 0 );
+        CreateFiles( 2 * RATE );
+        for( unsigned i = 0; i < FILES; i++ )
+        {
+            times.actime = st[i].st_atime;
+            times.modtime = st[i].st_mtime;
+            assert( utime( paths[i], &times ) == 0 );
+        }
+        assert( Scan( "warm", RATE, durations ) );
+
+        /* A newer time invalidates the entries */
+        for( unsigned i = 0; i < FILES; i++ )
+        {
+            times.actime = st[i].st_atime;
+            times.modtime = st[i].st_mtime + 1;
+            assert( utime( paths[i], &times ) == 0 );
+        }
+        assert( Scan( "stale", 2 * RATE, halved ) );
+        for( unsigned i = 0; i < FILES; i++ )
+            assert( 2 * halved[i] == durations[i] );
+    }
+
+    for( unsigned i = 0; i < FILES; i++ )
+        unlink( paths[i] );
+    strcat( cache, "/vlc/preparse.dat" );
+    unlink( cache );
+    *strrchr( cache, '/' ) = '\0';
+    rmdir( cache );
+    *strrchr( cache, '/' ) = '\0';
+    rmdir( cache );
+    rmdir( dir );
+    return b_supported ? 0 : 77; /* no WAV support */
+}
@@ -0,0 +1,280 @@
+/*****************************************************************************
+ * preparser.c: preparser queues test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_events.h>
+#include <vlc_input_item.h>
+#include <vlc_modules.h>
+#include <vlc_threads.h>
+#include <vlc_url.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* Directories of two files preparse quickly. A FIFO starved of data blocks
+ * its worker until the request times out or is canceled. */
+#define DIRS 4
+
+static char dir[] = "/tmp/vlc-preparser-XXXXXX";
+static char fifo[sizeof (dir) + 16];
+static char dirs[DIRS][sizeof (dir) + 16];
+static int fd = -1; /* keeps the FIFO open for writing */
+
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static vlc_cond_t wait = VLC_STATIC_COND;
+static input_item_t *ended[2 * DIRS + 2];
+static int status[2 * DIRS + 2];
+static unsigned i_ended, i_trees;
+
+static void PreparseEnded( const vlc_event_t *event, void *data )
+{
+    vlc_mutex_lock( &lock );
+    assert( i_ended < ARRAY_SIZE(ended) );
+    ended[i_ended] = data;
+    status[i_ended] = event->u.input_item_preparse_ended.new_status;
+    i_ended++;
+    vlc_cond_signal( &wait );
+    vlc_mutex_unlock( &lock );
+}
+
+static void SubItemTreeAdded( const vlc_event_t *event, void *data )
+{
+    assert( event->u.input_item_subitem_tree_added.p_root->i_children == 2 );
+    vlc_mutex_lock( &lock );
+    i_trees++;
+    vlc_mutex_unlock( &lock );
+    (void) data;
+}
+
+static input_item_t *NewItem( const char *psz_path )
+{
+    char *psz_uri = vlc_path2uri( psz_path, NULL );
+    assert( psz_uri != NULL );
+
+    input_item_t *p_item = input_item_New( psz_uri, psz_path );
+    assert( p_item != NULL );
+    free( psz_uri );
+
+    vlc_event_attach( &p_item->event_manager, vlc_InputItemPreparseEnded,
+                      PreparseEnded, p_item );
+    vlc_event_attach( &p_item->event_manager, vlc_InputItemSubItemTreeAdded,
+                      SubItemTreeAdded, p_item );
+    return p_item;
+}
+
+static void WaitEnded( unsigned i_count )
+{
+    vlc_mutex_lock( &lock );
+    while( i_ended < i_count )
+        vlc_cond_wait( &wait, &lock );
+    vlc_mutex_unlock( &lock );
+}
+
+/* Waits until a worker reads from the FIFO */
+static void WaitReading( void )
+{
+    int i_queued;
+
+    assert( write( fd, "", 1 ) == 1 );
+    do
+    {
+        msleep( CLOCK_FREQ / 100 );
+        assert( ioctl( fd, FIONREAD, &i_queued ) == 0 );
+    }
+    while( i_queued > 0 );
+}
+
+static libvlc_instance_t *Create( const char *psz_threads )
+{
+    const char *args[test_defaults_nargs + 2];
+
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        args[i] = test_defaults_args[i];
+    args[test_defaults_nargs] = psz_threads;
+    args[test_defaults_nargs + 1] = "--no-preparse-cache";
+
+    libvlc_instance_t *vlc = libvlc_new( ARRAY_SIZE(args), args );
+    assert( vlc != NULL );
+    i_ended = i_trees = 0;
+    return vlc;
+}
+
+/* Interactive requests are served before the background ones */
+static void test_priority( void )
+{
+    libvlc_instance_t *vlc = Create( "--preparse-threads=1" );
+    libvlc_int_t *obj = vlc->p_libvlc_int;
+    input_item_t *p_fifo = NewItem( fifo ), *items[2 * DIRS];
+    int id;
+
+    /* Keeps the only worker busy */
+    assert( libvlc_MetadataRequest( obj, p_fifo, META_REQUEST_OPTION_SCOPE_LOCAL,
+                                    0, &id ) == VLC_SUCCESS );
+    WaitReading();
+    for( unsigned i = 0; i < 2 * DIRS; i++ )
+    {
+        bool b_background = i < DIRS;
+
+        items[i] = NewItem( dirs[i % DIRS] );
+        assert( libvlc_MetadataRequest( obj, items[i],
+                    META_REQUEST_OPTION_SCOPE_LOCAL
+                  | ( b_background ? META_REQUEST_OPTION_BACKGROUND : 0 ),
+                    0, NULL ) == VLC_SUCCESS );
+    }
+    libvlc_MetadataCancel( obj, &id );
+    WaitEnded( 2 * DIRS + 1 );
+
+    assert( ended[0] == p_fifo && status[0] == ITEM_PREPARSE_TIMEOUT );
+    for( unsigned i = 0; i < 2 * DIRS; i++ )
+    {
+        /* The interactive ones first, then in order of request */
+        assert( ended[1 + i] == items[( i + DIRS ) % ( 2 * DIRS )] );
+        assert( status[1 + i] == ITEM_PREPARSE_DONE );
+    }
+    assert( i_trees == 2 * DIRS );
+
+    libvlc_release( vlc );
+    input_item_Release( p_fifo );
+    for( unsigned i = 0; i < 2 * DIRS; i++ )
+        input_item_Release( items[i] );
+}
+
+/* An item requested several times is preparsed once, and canceled with its
+ * last requester */
+static void test_merge( void )
+{
+    libvlc_instance_t *vlc = Create( "--preparse-threads=4" );
+    libvlc_int_t *obj = vlc->p_libvlc_int;
+    input_item_t *p_dir = NewItem( dirs[0] ), *p_fifo = NewItem( fifo );
+    int ids[4];
+
+    for( unsigned i = 0; i < 4; i++ )
+        assert( libvlc_MetadataRequest( obj, p_dir, META_REQUEST_OPTION_SCOPE_LOCAL,
+                                        0, &ids[i] ) == VLC_SUCCESS );
+    WaitEnded( 1 );
+    assert( ended[0] == p_dir && status[0] == ITEM_PREPARSE_DONE );
+
+    assert( libvlc_MetadataRequest( obj, p_fifo, META_REQUEST_OPTION_SCOPE_LOCAL,
+                                    0, &ids[0] ) == VLC_SUCCESS );
+    WaitReading();
+    assert( libvlc_MetadataRequest( obj, p_fifo, META_REQUEST_OPTION_SCOPE_LOCAL,
+                                    0, &ids[1] ) == VLC_SUCCESS );
+    libvlc_MetadataCancel( obj, &ids[0] );
+    msleep( CLOCK_FREQ / 10 );
+    vlc_mutex_lock( &lock );
+    assert( i_ended == 1 );
+    vlc_mutex_unlock( &lock );
+
+    libvlc_MetadataCancel( obj, &ids[1] );
+    WaitEnded( 2 );
+    assert( ended[1] == p_fifo && status[1] == ITEM_PREPARSE_TIMEOUT );
+
+    /* Waits for the workers: nothing else may be preparsed */
+    libvlc_release( vlc );
+    assert( i_ended == 2 && i_trees == 1 );
+    input_item_Release( p_dir );
+    input_item_Release( p_fifo );
+}
+
+/* Probes that take too long are stopped */
+static void test_timeout( void )
+{
+    libvlc_instance_t *vlc = Create( "--preparse-threads=2" );
+    input_item_t *p_fifo = NewItem( fifo );
+
+    mtime_t i_start = mdate();
+    assert( libvlc_MetadataRequest( vlc->p_libvlc_int, p_fifo,
+                                    META_REQUEST_OPTION_SCOPE_LOCAL, 200,
+                                    NULL ) == VLC_SUCCESS );
+    WaitEnded( 1 );
+    mtime_t i_time = mdate() - i_start;
+
+    assert( status[0] == ITEM_PREPARSE_TIMEOUT );
+    assert( i_time >= 200000 && i_time < 5 * CLOCK_FREQ );
+    log( "timed out after %"PRId64" ms\n", i_time / 1000 );
+
+    libvlc_release( vlc );
+    input_item_Release( p_fifo );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    assert( mkdtemp( dir ) != NULL );
+    snprintf( fifo, sizeof (fifo), "%s/fifo", dir );
+    assert( mkfifo( fifo, 0600 ) == 0 );
+    /* A FIFO with a writer blocks its readers instead of ending */
+    fd = open( fifo, O_RDWR );
+    assert( fd != -1 );
+
+    for( unsigned i = 0; i < DIRS; i++ )
+    {
+        char path[sizeof (dirs[i]) + 16];
+
+        snprintf( dirs[i], sizeof (dirs[i]), "%s/%u", dir, i );
+        assert( mkdir( dirs[i], 0700 ) == 0 );
+        for( char c = 'a'; c <= 'b'; c++ )
+        {
+            snprintf( path, sizeof (path), "%s/%c.wav", dirs[i], c );
+            FILE *file = fopen( path, "wb" );
+            assert( file != NULL );
+            fclose( file );
+        }
+    }
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+    bool b_supported = module_exists( "filesystem" )
+                    && module_exists( "playlist" );
+    libvlc_release( vlc );
+
+    if( b_supported )
+    {
+        test_priority();
+        test_merge();
+        test_timeout();
+    }
+
+    close( fd );
+    unlink( fifo );
+    for( unsigned i = 0; i < DIRS; i++ )
+    {
+        char path[sizeof (dirs[i]) + 16];
+
+        for( char c = 'a'; c <= 'b'; c++ )
+        {
+            snprintf( path, sizeof (path), "%s/%c.wav", dirs[i], c );
+            unlink( path );
+        }
+        rmdir( dirs[i] );
+    }
+    rmdir( dir );
+    return b_supported ? 0 : 77;
+}
@@ -0,0 +1,183 @@
+/*****************************************************************************
+ * search.c: playlist live search test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+#include "../src/libvlc.h"
+
+#include <vlc_common.h>
+#include <vlc_charset.h>
+#include <vlc_input_item.h>
+#include <vlc_playlist.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+/* A synthetic library of 1M items, in albums of 1000 tracks */
+#define NODES 1000
+#define ITEMS 1000
+
+static const char *const words[] = {
+    "love", "night", "the", "beat", "dream", "fire", "blue", "moon", "heart",
+    "rain", "city", "light", "dance", "gold", "road", "river", "song", "star",
+    "wild", "time", "Été", "Ölfeld",
+};
+
+static uint32_t seed = 1;
+
+static unsigned Random( unsigned max )
+{
+    seed = seed * 1103515245 + 12345;
+    return ( seed >> 8 ) % max;
+}
+
+static void Fill( playlist_t *p_playlist )
+{
+    mtime_t i_start = mdate();
+
+    playlist_Lock( p_playlist );
+    for( unsigned i = 0; i < NODES; i++ )
+    {
+        char psz_name[32];
+
+        snprintf( psz_name, sizeof (psz_name), "Album %u", i );
+        playlist_item_t *p_node = playlist_NodeCreate( p_playlist, psz_name,
+                                        p_playlist->p_playing, PLAYLIST_END, 0 );
+        assert( p_node != NULL );
+
+        for( unsigned j = 0; j < ITEMS; j++ )
+        {
+            char psz_title[128];
+
+            snprintf( psz_title, sizeof (psz_title), "%s %s %s - Artist%u",
+                      words[Random( ARRAY_SIZE(words) )],
+                      words[Random( ARRAY_SIZE(words) )],
+                      words[Random( ARRAY_SIZE(words) )], Random( 5000 ) );
+
+            input_item_t *p_input = input_item_New( "vlc://nop", psz_title );
+            assert( p_input != NULL );
+            assert( playlist_NodeAddInput( p_playlist, p_input, p_node,
+                                           0, PLAYLIST_END ) );
+            input_item_Release( p_input );
+        }
+    }
+    playlist_Unlock( p_playlist );
+
+    log( "%u items added in %"PRId64" ms\n", NODES * ITEMS,
+         ( mdate() - i_start ) / 1000 );
+}
+
+/* Compares the visible items with a full walk */
+static void Check( playlist_t *p_playlist, const char *psz_query )
+{
+    playlist_item_t *p_playing = p_playlist->p_playing;
+
+    for( int i = 0; i < p_playing->i_children; i++ )
+    {
+        playlist_item_t *p_node = p_playing->pp_children[i];
+        bool b_node = vlc_strcasestr( p_node->p_input->psz_name,
+                                      psz_query ) != NULL;
+
+        for( int j = 0; j < p_node->i_children; j++ )
+        {
+            playlist_item_t *p_item = p_node->pp_children[j];
+            bool b_match = vlc_strcasestr( p_item->p_input->psz_name,
+                                           psz_query ) != NULL;
+
+            assert( b_match == !( p_item->i_flags & PLAYLIST_DBL_FLAG ) );
+            b_node |= b_match;
+        }
+        assert( b_node == !( p_node->i_flags & PLAYLIST_DBL_FLAG ) );
+    }
+}
+
+/* Types a query one character at a time, like a search box */
+static void Type( playlist_t *p_playlist, const char *psz_query )
+{
+    char psz_typed[strlen( psz_query ) + 1];
+    mtime_t i_max = 0;
+
+    for( size_t i = 1; i <= strlen( psz_query ); i++ )
+    {
+        if( ( psz_query[i] & 0xC0 ) == 0x80 )
+            continue; /* in the middle of a character */
+        memcpy( psz_typed, psz_query, i );
+        psz_typed[i] = '\0';
+
+        mtime_t i_start = mdate();
+        playlist_Lock( p_playlist );
+        playlist_LiveSearchUpdate( p_playlist, p_playlist->p_playing,
+                                   psz_typed, true );
+        playlist_Unlock( p_playlist );
+        i_max = __MAX( i_max, mdate() - i_start );
+    }
+
+    playlist_Lock( p_playlist );
+    Check( p_playlist, psz_query );
+    playlist_Unlock( p_playlist );
+    log( "%-16s worst keystroke %6.1f ms\n", psz_query, i_max / 1000. );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 120 );
+
+    const char *args[test_defaults_nargs + 1];
+
+    for( int i = 0; i < test_defaults_nargs; i++ )
+        args[i] = test_defaults_args[i];
+    args[test_defaults_nargs] = "--no-auto-preparse";
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs + 1, args );
+    assert( vlc != NULL );
+    if( libvlc_add_intf( vlc, "dummy" ) )
+    {
+        libvlc_release( vlc );
+        return 77;
+    }
+
+    playlist_t *p_playlist = libvlc_priv( vlc->p_libvlc_int )->playlist;
+    assert( p_playlist != NULL );
+    Fill( p_playlist );
+
+    Type( p_playlist, "beat love" );
+    Type( p_playlist, "ght" );
+    Type( p_playlist, "e b" );
+    Type( p_playlist, "artist4999" );
+    Type( p_playlist, "été" );
+    Type( p_playlist, "album 99" );
+    Type( p_playlist, "nothing" );
+
+    /* Renamed items are searched with their new name */
+    playlist_Lock( p_playlist );
+    playlist_item_t *p_item = p_playlist->p_playing->pp_children[0]
+                                                  ->pp_children[0];
+    playlist_Unlock( p_playlist );
+    input_item_SetName( p_item->p_input, "zebra crossing" );
+    Type( p_playlist, "zebra" );
+
+    playlist_Lock( p_playlist );
+    playlist_LiveSearchUpdate( p_playlist, p_playlist->p_playing, "", true );
+    playlist_Unlock( p_playlist );
+
+    libvlc_release( vlc );
+    return 0;
+}
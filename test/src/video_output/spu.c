@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * spu.c: test for the subpicture unit region cache
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_subpicture.h>
+#include <vlc_spu.h>
+#include <vlc_text_style.h>
+
+static const vlc_fourcc_t chromas[] = { VLC_CODEC_YUVA, 0 };
+
+/* Renders for an output of the given size, returns the region width, or 0
+ * if no region could be rendered */
+static unsigned render( spu_t *spu, unsigned width, unsigned height,
+                        unsigned *rendered, unsigned *reused )
+{
+    video_format_t fmt_src, fmt_dst;
+
+    video_format_Setup( &fmt_src, VLC_CODEC_I420, 64, 32, 64, 32, 1, 1 );
+    video_format_Setup( &fmt_dst, VLC_CODEC_I420, width, height,
+                        width, height, 1, 1 );
+
+    subpicture_t *out = spu_Render( spu, chromas, &fmt_dst, &fmt_src,
+                                    1000, 1000, false );
+    unsigned region_width = 0;
+    if( out != NULL )
+    {
+        if( out->p_region != NULL )
+        {
+            assert( out->p_region->p_next == NULL );
+            region_width = out->p_region->fmt.i_visible_width;
+        }
+        subpicture_Delete( out );
+    }
+
+    spu_GetRenderStatistics( spu, rendered, reused );
+    log( "%ux%u: %u rendered, %u reused\n", width, height,
+         *rendered, *reused );
+    return region_width;
+}
+
+static void put_region( spu_t *spu, subpicture_region_t *region )
+{
+    subpicture_t *subpic = subpicture_New( NULL );
+    assert( subpic != NULL );
+
+    subpic->p_region = region;
+    subpic->i_channel = spu_RegisterChannel( spu );
+    subpic->i_start = 0;
+    subpic->b_ephemer = true;
+    subpic->b_absolute = true;
+    subpic->i_original_picture_width = 64;
+    subpic->i_original_picture_height = 32;
+    spu_PutSubpicture( spu, subpic );
+}
+
+/* Text is laid out once, then reused. Returns false without a text
+ * renderer */
+static bool test_text( vlc_object_t *obj )
+{
+    unsigned rendered, reused;
+    spu_t *spu = spu_Create( obj );
+    assert( spu != NULL );
+
+    video_format_t fmt;
+    video_format_Init( &fmt, VLC_CODEC_TEXT );
+    subpicture_region_t *region = subpicture_region_New( &fmt );
+    assert( region != NULL );
+    region->p_text = text_segment_New( "Hello" );
+    put_region( spu, region );
+
+    if( render( spu, 64, 32, &rendered, &reused ) == 0 )
+    {
+        log( "no text renderer available, skipping\n" );
+        assert( rendered == 0 && reused == 0 );
+        spu_Destroy( spu );
+        return false;
+    }
+    assert( rendered == 1 && reused == 0 );
+    for( int i = 0; i < 3; i++ )
+    {
+        render( spu, 64, 32, &rendered, &reused );
+        assert( rendered == 0 && reused == 1 );
+    }
+
+    spu_Destroy( spu );
+    return true;
+}
+
+/* Scaled pictures are kept until the output size changes */
+static void test_scale( vlc_object_t *obj )
+{
+    unsigned rendered, reused;
+    spu_t *spu = spu_Create( obj );
+    assert( spu != NULL );
+
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_YUVA, 32, 16, 32, 16, 1, 1 );
+    subpicture_region_t *region = subpicture_region_New( &fmt );
+    assert( region != NULL );
+    put_region( spu, region );
+
+    /* Regions at their size are neither rendered nor reused */
+    assert( render( spu, 64, 32, &rendered, &reused ) == 32 );
+    assert( rendered == 0 && reused == 0 );
+
+    if( render( spu, 128, 64, &rendered, &reused ) != 64 )
+    {
+        log( "no scaler available, skipping\n" );
+        spu_Destroy( spu );
+        return;
+    }
+    assert( rendered == 1 && reused == 0 );
+    render( spu, 128, 64, &rendered, &reused );
+    assert( rendered == 0 && reused == 1 );
+    assert( render( spu, 256, 128, &rendered, &reused ) == 128 );
+    assert( rendered == 1 && reused == 0 );
+    render( spu, 256, 128, &rendered, &reused );
+    assert( rendered == 0 && reused == 1 );
+
+    spu_Destroy( spu );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    bool b_text = test_text( VLC_OBJECT(vlc->p_libvlc_int) );
+    test_scale( VLC_OBJECT(vlc->p_libvlc_int) );
+
+    libvlc_release( vlc );
+    return b_text ? 0 : 77;
+}